@@ -0,0 +1,138 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *      Cycle budget benchmark for the Class B tests.
+ *
+ *      This application runs each test once, or once per section, and then
+ *      lets the RTC interrupt run for a few periods. It is meant to be run in
+ *      the cycle counting simulator tools/avrsim, which reports the cycles and
+ *      the stack used by every call. The tool tools/cyclebudget compares them
+ *      with a stored baseline:
+ *
+ *      \code
+ *      tools/avrsim/avrsim -q -m main -C classb_sram_test -j results.json UserApplication.elf
+ *      tools/cyclebudget/cyclebudget -b baseline.json results.json
+ *      \endcode
+ *
+ *      The measurements are:
+ *        - the boot time: the March C- test of XmegaRAMTest/ramtest.S in
+ *          .init1 and the C start-up code, up to \c main,
+ *        - each section of \ref classb_sram_test(),
+ *        - the software and hardware Flash CRC16 and CRC32 over 1 KB, 64 KB and
+ *          256 KB: one \c bench_ function each,
+ *        - \ref classb_register_test(),
+ *        - \ref classb_intmon_callback() with the \ref N_INTERRUPTS interrupts
+ *          that the project declares in \ref CLASSB_INTMON_TABLE, all enabled,
+ *        - the RTC compare interrupt, with the frequency test and the
+ *          interrupt monitor, and the timer overflow interrupt of the
+ *          frequency test: the diagnostic overhead per tick.
+ *
+ *      The project is built for the ATxmega256A3U, which has the 256 KB of
+ *      Flash of the ATxmega256A3BU of the other examples and the 16-bit RTC
+ *      that the simulator models. The checksums are compared with zero, so
+ *      the CRC tests report an error; this does not change their run time.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#include "avr_compiler.h"
+#include "classb_sram.h"
+#include "classb_crc.h"
+#include "classb_cpu.h"
+#include "classb_interrupt_monitor.h"
+#include "classb_freq.h"
+
+
+//! \name Configuration parameters
+//@{
+
+//! \brief Number of RTC compare interrupts to measure.
+#define BENCH_RTC_TICKS 4
+
+//@}
+
+
+//! \brief Global error flag
+NO_INIT volatile uint8_t classb_error;
+
+//! \brief Reference checksums for the CRC tests.
+uint16_t EEPROM_DECLARE( bench_crc16 );
+uint32_t EEPROM_DECLARE( bench_crc32 );
+
+
+//! \brief Define the benchmark function bench_<name>, which makes one call.
+//!
+//! The functions are not inlined so that the simulator reports each call
+//! separately.
+#define BENCH(name, call) \
+	void __attribute__((noinline)) bench_ ## name (void) { call; }
+
+BENCH(crc16_flash_sw_1k,   CLASSB_CRC16_Flash_SW(0, 1024UL, &bench_crc16))
+BENCH(crc16_flash_sw_64k,  CLASSB_CRC16_Flash_SW(0, 65536UL, &bench_crc16))
+BENCH(crc16_flash_sw_256k, CLASSB_CRC16_Flash_SW(0, 262144UL, &bench_crc16))
+BENCH(crc32_flash_sw_1k,   CLASSB_CRC32_Flash_SW(0, 1024UL, &bench_crc32))
+BENCH(crc32_flash_sw_64k,  CLASSB_CRC32_Flash_SW(0, 65536UL, &bench_crc32))
+BENCH(crc32_flash_sw_256k, CLASSB_CRC32_Flash_SW(0, 262144UL, &bench_crc32))
+BENCH(crc16_flash_hw_1k,   CLASSB_CRC16_Flash_HW(0, 1024UL, &bench_crc16))
+BENCH(crc16_flash_hw_64k,  CLASSB_CRC16_Flash_HW(0, 65536UL, &bench_crc16))
+BENCH(crc16_flash_hw_256k, CLASSB_CRC16_Flash_HW(0, 262144UL, &bench_crc16))
+BENCH(crc32_flash_hw_1k,   CLASSB_CRC32_Flash_HW(CRC_FLASH_RANGE, 0, 1024UL, &bench_crc32))
+BENCH(crc32_flash_hw_64k,  CLASSB_CRC32_Flash_HW(CRC_FLASH_RANGE, 0, 65536UL, &bench_crc32))
+BENCH(crc32_flash_hw_256k, CLASSB_CRC32_Flash_HW(CRC_FLASH_RANGE, 0, 262144UL, &bench_crc32))
+BENCH(register_test,       classb_register_test())
+BENCH(intmon_callback,     classb_intmon_callback())
+
+
+int main(void)
+{
+	uint8_t i, ticks;
+	uint16_t cnt, last;
+
+	// Each call tests the next section; avrsim -C classb_sram_test reports them.
+	for (i = 0; i < CLASSB_NSEC_TOTAL; i++)
+		classb_sram_test();
+
+	bench_crc16_flash_sw_1k();
+	bench_crc16_flash_sw_64k();
+	bench_crc16_flash_sw_256k();
+	bench_crc32_flash_sw_1k();
+	bench_crc32_flash_sw_64k();
+	bench_crc32_flash_sw_256k();
+	bench_crc16_flash_hw_1k();
+	bench_crc16_flash_hw_64k();
+	bench_crc16_flash_hw_256k();
+	bench_crc32_flash_hw_1k();
+	bench_crc32_flash_hw_64k();
+	bench_crc32_flash_hw_256k();
+
+	bench_register_test();
+
+	// Monitor all interrupts. They are declared with a reference of 0 and none
+	// of them occurs, which is within the limits.
+	for (i = 0; i < N_INTERRUPTS; i++)
+		classb_intmon_set_state((enum classb_int_identifiers)i, ENABLE);
+	bench_intmon_callback();
+
+	// Let the RTC interrupt run. It resets the counter, so a count lower than
+	// the last one means that it has run.
+	classb_rtc_setup();
+	classb_freq_setup_timer();
+	sei();
+	last = 0;
+	for (ticks = 0; ticks < BENCH_RTC_TICKS; ) {
+		cnt = RTC_TEST.CNT;
+		if (cnt < last)
+			ticks++;
+		last = cnt;
+	}
+	cli();
+
+	return 0;
+}
@@ -25,6 +25,8 @@
  *        - \ref classb_precalculated_flash_crc 
  *        - \ref classb_precalculated_eeprom_crc
  *        .
+ *      Alternatively, the host tool tools/crc_embed can compute the checksums
+ *      and store them in the ELF file after linking.
  *			
  * \par Application note:
  *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
@@ -195,6 +197,9 @@ ISR(SWITCH_INT0_vect) {
 	//// These lines should produce the same checksum (different than the CRC16 checksum)
 	//checksum_test_flash_4 = CLASSB_CRC16_Flash_HW (APP_SECTION_START, APP_SECTION_SIZE, &classb_precalculated_flash_crc);
 	//checksum_test_flash_5 = CLASSB_CRC16_Flash_SW (APP_SECTION_START, APP_SECTION_SIZE, &classb_precalculated_flash_crc);
+	//// This line checks the application section page by page. It requires a page map in EEPROM, e.g.
+	//// uint32_t EEPROM_DECLARE( classb_flash_page_crc[APP_SECTION_SIZE / CLASSB_CRC_PAGE_SIZE] );
+	//checksum_test_flash_2 = CLASSB_CRC32_Flash_Pages (APP_SECTION_START, APP_SECTION_SIZE / CLASSB_CRC_PAGE_SIZE, classb_flash_page_crc, &classb_precalculated_flash_crc);
 	
 	// Compute the checksum of the data section in EEPROM
 	volatile uint16_t checksum_test_eeprom = CLASSB_CRC16_EEPROM_HW(data_eeprom, sizeof(data_eeprom), &classb_precalculated_eeprom_crc);
@@ -203,6 +208,9 @@ ISR(SWITCH_INT0_vect) {
 	//// These lines should produce the same checksum (different than the CRC16 checksum)
 	//volatile uint32_t checksum_test_eeprom_3 = CLASSB_CRC32_EEPROM_HW(data_eeprom, sizeof(data_eeprom), &classb_precalculated_eeprom_crc);
 	//volatile uint32_t checksum_test_eeprom_4 = CLASSB_CRC32_EEPROM_SW(data_eeprom, sizeof(data_eeprom), &classb_precalculated_eeprom_crc);
+	//// This line starts the same test in the background. It requires CLASSB_CRC_USE_DMA and the result
+	//// is checked in the DMA interrupt, see classb_crc_dma_busy() and classb_crc_dma_checksum.
+	//CLASSB_CRC16_EEPROM_DMA(data_eeprom, sizeof(data_eeprom), &classb_precalculated_eeprom_crc);
 	
 }
 
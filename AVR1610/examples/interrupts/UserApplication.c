@@ -64,13 +64,10 @@
 
 //!\brief Frequency in Hz of the T/C interrupt.
 //!
-//! This is used to compute the value written to the PER register.
+//! This is used to compute the value written to the PER register. The reference
+//! for \ref MY_INTERRUPT in \ref CLASSB_INTMON_TABLE is computed from the same value.
 #define F_TC_INT 30
 
-//!\brief Tolerance for number of T/C interrupts (%).
-//! 
-#define TC_INT_TOL 15		
-
 //!\brief TC prescaler
 //!
 //! The TC runs on the system clock scaled down by this parameter.
@@ -86,10 +83,6 @@
 //! \name Internal parameters
 //@{
 
-//! \brief Reference for number of TC interrupts 
-//! 
-#define TC_INT_COUNT_REF		(uint32_t) ( ( (1e0L * F_TC_INT) * CLASSB_RTC_INT_PERIOD) / CLASSB_RTC_FREQ )				
-
 //! \brief Label for the TC prescaler group configuration
 #define TC_PRESCALER_gc		LABEL(TC_CLKSEL_DIV, TC_PRESCALER, _gc)
 
@@ -177,9 +170,6 @@ int main(void)
 	setup_led_switches_pmic();
 	setup_example_tc_interrupt();
 	
-	// Register the interrupt in the monitor
-	classb_intmon_reg_int(MY_INTERRUPT, TC_INT_COUNT_REF, TC_INT_TOL); 	
-	
 	// Setup the RTC. The monitor is called back from the RTC interrupt.
     classb_rtc_setup();	
 		
@@ -223,13 +213,11 @@ ISR(SWITCH1_INT0_vect) {
 
 /*! \brief TC overflow interrupt
  *		
- *	The interrupt counter is incremented by calling \ref classb_intmon_increase(). 
+ *	The interrupt counter is incremented by \ref CLASSB_INTMON_ISR(). 
  *	After that an LED is toggled.
  */
-ISR(TCD0_OVF_vect) {
+CLASSB_INTMON_ISR(TCD0_OVF_vect, MY_INTERRUPT) {
 
-	classb_intmon_increase(MY_INTERRUPT);
-	
 	// Toggle LED.
 	LEDPORT.OUTTGL = PIN1_bm;
 }
\ No newline at end of file
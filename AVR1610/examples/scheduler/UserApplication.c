@@ -0,0 +1,181 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		This is a demo application for the scheduler of the Class B tests.
+ *
+ *		The SRAM test, the CPU registers test and the CRC test of an SRAM
+ *		region are registered with the scheduler, each with its period and
+ *		the budget of one slice. The application has nothing else to do, so
+ *		the main loop calls the idle hook of the scheduler, which runs the
+ *		tests for a fixed time and then puts the CPU to sleep until the next
+ *		interrupt. The CPU frequency test runs from the RTC interrupt as
+ *		usual. The second LED is toggled every time the SRAM test completes a
+ *		pass. The achieved diagnostic intervals and the time spent in each
+ *		test can be read in \ref classb_sched_tasks, and the active and sleep
+ *		times in \ref classb_sched_busy and \ref classb_sched_sleep.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#include "avr_compiler.h"
+#include "classb_rtc_common.h"
+#include "classb_scheduler.h"
+#include "classb_sram.h"
+#include "classb_cpu.h"
+#include "classb_crc_ram.h"
+
+
+//! \name Configuration parameters
+//@{
+
+//! \brief Period of the SRAM test (ms).
+#define SRAM_PERIOD_MS			10000UL
+
+//! \brief Budget of a slice of the SRAM test, i.e. one section (us).
+#define SRAM_BUDGET_US			80000UL
+
+//! \brief Period of the CPU registers test (ms).
+#define REGISTERS_PERIOD_MS		1000UL
+
+//! \brief Budget of a slice of the CPU registers test, i.e. the whole test (us).
+#define REGISTERS_BUDGET_US		500UL
+
+//! \brief Period of the CRC test of the SRAM region (ms).
+#define CRC_RAM_PERIOD_MS		1000UL
+
+//! \brief Budget of a slice of the CRC test, i.e. \ref CLASSB_CRC_RAM_SLICE bytes (us).
+#define CRC_RAM_BUDGET_US		1000UL
+
+//! \brief Time given to the tests each time the application is idle (us).
+#define MAIN_LOOP_BUDGET_US		100000UL
+
+//@}
+
+
+//! \name Board configuration
+//@{
+#if __AVR_ATxmega256A3BU__ | __ATxmega256A3BU__ | __DOXYGEN__
+#  define LEDPORT PORTR
+#elif defined(__AVR_ATxmega128A1__) | defined(__ATxmega128A1__)
+#  define LEDPORT PORTE
+#endif
+//@}
+
+
+//! \name Global variables
+//@{
+
+//! \brief Global error flag
+NO_INIT volatile uint8_t classb_error;
+
+//! \brief Data that does not change after initialization, checked by the CRC test.
+uint8_t lookup_table[256];
+
+//@}
+
+
+//! \brief Setup the LEDs.
+void setup_leds() {
+
+	// Set direction and state of LED pins
+	LEDPORT.DIRSET = PIN0_bm | PIN1_bm;
+	PORTCFG.MPCMASK = PIN0_bm | PIN1_bm;
+	LEDPORT.PIN0CTRL |= PORT_INVEN_bm;
+
+	// Enable LOW level interrupts in the INT controller
+	PMIC.CTRL |= PMIC_LOLVLEN_bm;
+
+	// Turn on LED that signals correct operation
+	LEDPORT.OUTSET = PIN0_bm;
+}
+
+
+//! \brief Step function for the SRAM test: one section per slice.
+bool sram_step(void)
+{
+	static uint8_t section = 0;
+
+	// The SRAM test must not be interrupted.
+	cli();
+	classb_sram_test();
+	sei();
+
+	if (++section < CLASSB_NSEC_TOTAL)
+		return false;
+
+	section = 0;
+	// Toggle the second LED when a pass is completed.
+	LEDPORT.OUTTGL = PIN1_bm;
+	return true;
+}
+
+
+//! \brief Step function for the CPU registers test: the whole test in one slice.
+bool registers_step(void)
+{
+	// The return value is not considered because the test changes the global
+	// \ref classb_error in the case of an error.
+	cli();
+	classb_register_test();
+	sei();
+
+	return true;
+}
+
+
+//! \brief Step function for the CRC test of the SRAM region.
+bool crc_ram_step(void)
+{
+	return classb_crc_ram_test();
+}
+
+
+/*! \brief
+ *      Main entry point of the application. Sets up the tests and gives time
+ *		to the scheduler until an error has occurred.
+ *	\callgraph
+ */
+int main(void)
+{
+	uint16_t i;
+
+	setup_leds();
+
+	// Initialize the data that is checked by the CRC test, and register it.
+	for (i = 0; i < sizeof(lookup_table); i++)
+		lookup_table[i] = (uint8_t) (i * 37);
+	classb_crc_ram_reg_region(MY_RAM_REGION, lookup_table, sizeof(lookup_table));
+
+	// The RTC keeps the time of the scheduler and runs the CPU frequency test.
+	classb_freq_setup_timer();
+	classb_rtc_setup();
+	classb_sched_setup();
+
+	classb_sched_reg_task(SCHED_SRAM, sram_step, CLASSB_SCHED_MS(SRAM_PERIOD_MS), CLASSB_SCHED_US(SRAM_BUDGET_US));
+	classb_sched_reg_task(SCHED_REGISTERS, registers_step, CLASSB_SCHED_MS(REGISTERS_PERIOD_MS), CLASSB_SCHED_US(REGISTERS_BUDGET_US));
+	classb_sched_reg_task(SCHED_CRC_RAM, crc_ram_step, CLASSB_SCHED_MS(CRC_RAM_PERIOD_MS), CLASSB_SCHED_US(CRC_RAM_BUDGET_US));
+
+	// Turn on interrupts globally.
+	sei();
+
+	while(!classb_error) {
+		// The application would do its own work here, and call classb_sched_run()
+		// instead if there was work left.
+
+		classb_sched_idle(CLASSB_SCHED_US(MAIN_LOOP_BUDGET_US));
+	};
+
+	// If this is executed there has been an error.
+	// Disable interrupts
+	cli();
+	// Turn off LEDs to indicate error.
+	LEDPORT.OUTCLR = PIN0_bm | PIN1_bm;
+
+}
@@ -100,20 +100,13 @@ static void classb_dac_adc_test(DAC_t *dacptr, ADC_t *adcptr, uint16_t dac_out,
     adcptr->CH3.INTFLAGS = ADC_CH_CHIF_bm;
 }
 
-/*! \brief Functional test for the ADC, DAC and analog MUX.
- *
- * This function configures the DAC to output a constant voltage, after which
- * the ADC is set to do 12 bit, signed conversions of the DAC.
- * Range checking of the conversion results is then done to verify that ADC and DAC
- * are working correctly. 
- *
- * \param dacptr Base address for registers of DAC module to test.
- * \param adcptr Base address for registers of ADC module to test.
- *
+/*! 
+ * \internal
+ * \brief Sets up the DAC to output a constant voltage and the ADC to do 12 bit, 
+ *        signed conversions of the DAC in its four channels.
  */
-void classb_analog_io_test(DAC_t *dacptr, ADC_t *adcptr)
+static void classb_analog_setup(DAC_t *dacptr, ADC_t *adcptr)
 {
-
     // Set up the DAC
     // Single channel, 1V reference, internal output, 
     dacptr->CTRLA = DAC_IDOEN_bm | DAC_ENABLE_bm;
@@ -142,7 +135,23 @@ void classb_analog_io_test(DAC_t *dacptr, ADC_t *adcptr)
     adcptr->REFCTRL = ADC_REFSEL_INT1V_gc;
 	// Pre-scale clock by 512.
     adcptr->PRESCALER = ADC_PRESCALER_DIV512_gc;
+}
+
+/*! \brief Functional test for the ADC, DAC and analog MUX.
+ *
+ * This function configures the DAC to output a constant voltage, after which
+ * the ADC is set to do 12 bit, signed conversions of the DAC.
+ * Range checking of the conversion results is then done to verify that ADC and DAC
+ * are working correctly. 
+ *
+ * \param dacptr Base address for registers of DAC module to test.
+ * \param adcptr Base address for registers of ADC module to test.
+ *
+ */
+void classb_analog_io_test(DAC_t *dacptr, ADC_t *adcptr)
+{
 
+	classb_analog_setup(dacptr, adcptr);
     
 	// Write five values to the DAC and read them from the ADC.
 	// -For the DAC the range is (0x000,0xFFF)
@@ -160,3 +169,170 @@ void classb_analog_io_test(DAC_t *dacptr, ADC_t *adcptr)
     adcptr->CTRLA &= ~ADC_ENABLE_bm;
     dacptr->CTRLA &= ~DAC_ENABLE_bm;
 }
+
+
+/******************* Background test ******************/
+
+#if defined(CLASSB_ANALOG_USE_DMA) || defined(__DOXYGEN__)
+
+//! \brief Results of the last background test, for each DAC value and ADC channel.
+int16_t classb_analog_results[CLASSB_ANALOG_LEVELS][CLASSB_ANALOG_CHANNELS];
+
+//! \internal \brief Values written to the DAC, the same as in \ref classb_analog_io_test().
+//!
+//! They are read by the DMA controller, so they are kept in SRAM.
+static uint16_t analog_dac_levels[CLASSB_ANALOG_LEVELS] = { 0x000, 0x400, 0x800, 0xC00, 0xFFF };
+
+//! \internal \brief Expected results for each DAC value.
+static const int16_t PROGMEM_DECLARE( analog_adc_levels[CLASSB_ANALOG_LEVELS] ) = { 0x000, 0x200, 0x400, 0x600, 0x7FF };
+
+//! \internal \brief DAC and ADC modules of the running test.
+static DAC_t *analog_dacptr;
+static ADC_t *analog_adcptr;
+
+//! \internal \brief True while a background test is running.
+static volatile bool analog_running = false;
+
+
+/*! \brief Starts the ADC, DAC and analog MUX test in the background.
+ *
+ * The first value is written to the DAC, and the event system starts a sweep of 
+ * the four ADC channels every period of \ref CLASSB_ANALOG_EVSRC_gc. When channel 3 
+ * is complete, the first DMA channel copies the four results to 
+ * \ref classb_analog_results, and the second one writes the next value to the DAC. 
+ * The CPU is not used until the interrupt at the end of the last sweep.
+ *
+ * \param dacptr Base address for registers of DAC module to test.
+ * \param adcptr Base address for registers of ADC module to test.
+ *
+ * \retval true  the test was started.
+ * \retval false a background test is already running.
+ */
+bool classb_analog_start(DAC_t *dacptr, ADC_t *adcptr)
+{
+	uintptr_t src, dest;
+	uint8_t trigger;
+
+	if (analog_running)
+		return false;
+
+	analog_running = true;
+	analog_dacptr = dacptr;
+	analog_adcptr = adcptr;
+
+	// The end of conversion of channel 3, the last one in the sweep, triggers both
+	// DMA channels. They may be served in any order, since the results are kept in
+	// the ADC until the next sweep, which only starts on the next event.
+#ifdef ADCB
+	trigger = (adcptr == &ADCB) ? DMA_CH_TRIGSRC_ADCB_CH3_gc : DMA_CH_TRIGSRC_ADCA_CH3_gc;
+#else
+	trigger = DMA_CH_TRIGSRC_ADCA_CH3_gc;
+#endif
+
+	classb_analog_setup(dacptr, adcptr);
+	dacptr->CH0DATA = analog_dac_levels[0];
+
+	// Sweep the four channels on each event.
+	adcptr->CH0.INTFLAGS = ADC_CH_CHIF_bm;
+	adcptr->CH1.INTFLAGS = ADC_CH_CHIF_bm;
+	adcptr->CH2.INTFLAGS = ADC_CH_CHIF_bm;
+	adcptr->CH3.INTFLAGS = ADC_CH_CHIF_bm;
+	adcptr->EVCTRL = ADC_SWEEP_0123_gc | CLASSB_ANALOG_ADC_EVSEL_gc | ADC_EVACT_SWEEP_gc;
+
+	DMA.CTRL |= DMA_ENABLE_bm;
+
+	// One burst of the four results for each sweep, into consecutive rows of the buffer.
+	src = (uintptr_t)&adcptr->CH0RES;
+	dest = (uintptr_t)classb_analog_results;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.CTRLA = 0;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.ADDRCTRL = DMA_CH_SRCRELOAD_BURST_gc | DMA_CH_SRCDIR_INC_gc |
+			DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_INC_gc;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.TRIGSRC = trigger;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.TRFCNT = sizeof(classb_analog_results);
+	CLASSB_ANALOG_DMA_RES_CHANNEL.SRCADDR0 = src & 0xFF;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.SRCADDR1 = (src >> 8) & 0xFF;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.SRCADDR2 = 0;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.DESTADDR0 = dest & 0xFF;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.DESTADDR1 = (dest >> 8) & 0xFF;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.DESTADDR2 = 0;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm |
+			CLASSB_ANALOG_DMA_TRNINTLVL_gc | CLASSB_ANALOG_DMA_ERRINTLVL_gc;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_8BYTE_gc;
+
+	// One burst of the next DAC value for each sweep, until the last value.
+	src = (uintptr_t)&analog_dac_levels[1];
+	dest = (uintptr_t)&dacptr->CH0DATA;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.CTRLA = 0;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_INC_gc |
+			DMA_CH_DESTRELOAD_BURST_gc | DMA_CH_DESTDIR_INC_gc;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.TRIGSRC = trigger;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.TRFCNT = sizeof(analog_dac_levels) - sizeof(analog_dac_levels[0]);
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.SRCADDR0 = src & 0xFF;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.SRCADDR1 = (src >> 8) & 0xFF;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.SRCADDR2 = 0;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.DESTADDR0 = dest & 0xFF;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.DESTADDR1 = (dest >> 8) & 0xFF;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.DESTADDR2 = 0;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_2BYTE_gc;
+
+	// Start the sweeps.
+	EVSYS.CLASSB_ANALOG_EVCH_MUX = CLASSB_ANALOG_EVSRC_gc;
+
+	return true;
+}
+
+
+/*! \brief Check whether a background test is running.
+ *
+ * \retval true  the test is running.
+ * \retval false the last test is complete and \ref classb_analog_results is valid.
+ */
+bool classb_analog_busy(void)
+{
+	return analog_running;
+}
+
+
+/*! \brief Interrupt for the end of the last sweep.
+ *
+ * The sweeps, the DMA channels, the ADC and the DAC are stopped, and then all the
+ * results are checked in one pass. If a result deviates from the expected value more
+ * than \ref CLASSB_ADC_DEV, or a DMA transaction failed, \ref CLASSB_ERROR_HANDLER_ANALOG()
+ * would be called.
+ */
+ISR(CLASSB_ANALOG_DMA_vect)
+{
+	bool failed = ((CLASSB_ANALOG_DMA_RES_CHANNEL.CTRLB | CLASSB_ANALOG_DMA_DAC_CHANNEL.CTRLB) &
+			DMA_CH_ERRIF_bm) ? true : false;
+	int16_t expected, adcDev;
+
+	// Stop the sweeps and clear the flags.
+	EVSYS.CLASSB_ANALOG_EVCH_MUX = EVSYS_CHMUX_OFF_gc;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.CTRLB |= DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+	CLASSB_ANALOG_DMA_RES_CHANNEL.CTRLA = 0;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.CTRLB |= DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+	CLASSB_ANALOG_DMA_DAC_CHANNEL.CTRLA = 0;
+
+	// Disable the ADC and DAC
+	analog_adcptr->EVCTRL = 0;
+	analog_adcptr->CTRLA &= ~ADC_ENABLE_bm;
+	analog_dacptr->CTRLA &= ~DAC_ENABLE_bm;
+
+	// Do a range check on all the conversion results.
+	for (uint8_t level = 0; level < CLASSB_ANALOG_LEVELS; level++) {
+		expected = (int16_t) PROGMEM_READ_WORD(&analog_adc_levels[level]);
+		for (uint8_t ch = 0; ch < CLASSB_ANALOG_CHANNELS; ch++) {
+			adcDev = classb_analog_results[level][ch] - expected;
+			if (abs(adcDev) > CLASSB_ADC_DEV)
+				failed = true;
+		}
+	}
+
+	analog_running = false;
+
+	if (failed)
+		CLASSB_ERROR_HANDLER_ANALOG();
+}
+
+#endif // CLASSB_ANALOG_USE_DMA
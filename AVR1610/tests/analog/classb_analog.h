@@ -70,9 +70,53 @@
 //! repeated until all modules are tested. Further, the ADC module to test should 
 //! be able to read from the DAC module it is tested together with. 
 //! 
+//! If \ref CLASSB_ANALOG_USE_DMA is defined, the same test can also run in the 
+//! background with \ref classb_analog_start(). The sweeps are started by the event 
+//! system, and DMA channels copy the results of each sweep to \ref classb_analog_results 
+//! and write the next value to the DAC. When the last sweep is complete, the interrupt 
+//! of the DMA channel checks all the results at once and stops the test. The 
+//! application can check whether the test is still running with \ref classb_analog_busy().
+//! 
 //! \note 
-//!  - Interrupts should be disabled during this test.
+//!  - Interrupts should be disabled during \ref classb_analog_io_test().
+//!  - The ADC and the DAC must not be used by the application while the test runs
+//!  in the background.
+//@{
+
+//! \name Settings for the background test
 //@{
+#if defined(__DOXYGEN__)
+ //! \brief Compile the background test
+ //!
+ //! This takes over an event channel, two DMA channels and the interrupt vector of
+ //! the first one.
+ #define CLASSB_ANALOG_USE_DMA
+#else
+ //#define CLASSB_ANALOG_USE_DMA
+#endif
+
+//! \brief Event channel that starts the sweeps of the ADC, 0 to 4.
+#define CLASSB_ANALOG_EVCH			4
+
+//! \brief Event selection of the ADC. The first channel must be \ref CLASSB_ANALOG_EVCH.
+#define CLASSB_ANALOG_ADC_EVSEL_gc	ADC_EVSEL_4567_gc
+
+//! \brief Source of the events that start the sweeps.
+//!
+//! The period of the events has to be longer than a sweep of four conversions, which
+//! also gives the DAC time to settle after each value. The default is the peripheral
+//! clock divided by 32768.
+#define CLASSB_ANALOG_EVSRC_gc		EVSYS_CHMUX_PRESCALER_32768_gc
+
+//! \brief DMA channel that copies the results, e.g. 1 -> DMA.CH1.
+#define CLASSB_ANALOG_DMA_RES		1
+
+//! \brief DMA channel that writes the values to the DAC, e.g. 2 -> DMA.CH2.
+#define CLASSB_ANALOG_DMA_DAC		2
+
+//! \brief Interrupt level for the end of the test: LO, MED or HI.
+#define CLASSB_ANALOG_DMA_INTLVL	LO
+//@}
 
 //! \internal \name Internal settings
 //@{
@@ -81,12 +125,47 @@
 //! Error offset for the ADC is +-2mV, which corresponds to +-0x40 when the 
 //! reference is 1V and  \c TOP is \c 2047.
 #define CLASSB_ADC_DEV      0x40
+
+//! \internal \brief Number of values generated by the DAC.
+#define CLASSB_ANALOG_LEVELS	5
+
+//! \internal \brief Number of ADC channels that read each value.
+#define CLASSB_ANALOG_CHANNELS	4
+
+//! \internal \brief Label for the multiplexer register of the event channel
+#define CLASSB_ANALOG_EVCH_MUX		LABEL(CH, CLASSB_ANALOG_EVCH, MUX)
+
+//! \internal \brief Label for the DMA channel of the results
+#define CLASSB_ANALOG_DMA_RES_CHANNEL	LABEL(DMA.CH, CLASSB_ANALOG_DMA_RES,)
+
+//! \internal \brief Label for the DMA channel of the DAC
+#define CLASSB_ANALOG_DMA_DAC_CHANNEL	LABEL(DMA.CH, CLASSB_ANALOG_DMA_DAC,)
+
+//! \internal \brief Label for the interrupt vector of the DMA channel of the results
+#define CLASSB_ANALOG_DMA_vect		LABEL(DMA_CH, CLASSB_ANALOG_DMA_RES, _vect)
+
+//! \internal \brief Label for the transaction complete interrupt level
+#define CLASSB_ANALOG_DMA_TRNINTLVL_gc	LABEL(DMA_CH_TRNINTLVL_, CLASSB_ANALOG_DMA_INTLVL, _gc)
+
+//! \internal \brief Label for the error interrupt level
+#define CLASSB_ANALOG_DMA_ERRINTLVL_gc	LABEL(DMA_CH_ERRINTLVL_, CLASSB_ANALOG_DMA_INTLVL, _gc)
 //@}
 
 
 //! \name Class B Test
 //@{			
 void classb_analog_io_test(DAC_t *dacptr, ADC_t *adcptr);
+#if defined(CLASSB_ANALOG_USE_DMA) || defined(__DOXYGEN__)
+bool classb_analog_start(DAC_t *dacptr, ADC_t *adcptr);
+bool classb_analog_busy(void);
+#endif
+//@}
+
+//! \name Global variables
+//@{
+#if defined(CLASSB_ANALOG_USE_DMA) || defined(__DOXYGEN__)
+extern int16_t classb_analog_results[CLASSB_ANALOG_LEVELS][CLASSB_ANALOG_CHANNELS];
+#endif
 //@}
 
 
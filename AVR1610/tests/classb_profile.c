@@ -0,0 +1,168 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Profiling of the Class B tests with a free-running 32-bit counter.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#include "classb_profile.h"
+
+//! \ingroup profile
+//@{
+
+//! \brief Execution times of the routines.
+struct classb_profile_entry classb_profile_table[N_PROFILE_ROUTINES];
+
+//! \internal \brief Cycles spent reading the counter, subtracted from every execution.
+static uint16_t profile_overhead = 0;
+
+
+/*! \brief Starts the 32-bit counter and clears the table.
+ *
+ * The first TC counts the peripheral clock and its overflow event clocks the second
+ * one. This should be called from the main application before the routines run.
+ */
+void classb_profile_setup(void)
+{
+	uint32_t t;
+
+	CLASSB_PROFILE_TC_LO.CTRLA = TC_CLKSEL_OFF_gc;
+	CLASSB_PROFILE_TC_HI.CTRLA = TC_CLKSEL_OFF_gc;
+	CLASSB_PROFILE_TC_LO.PER = 0xFFFF;
+	CLASSB_PROFILE_TC_HI.PER = 0xFFFF;
+	CLASSB_PROFILE_TC_LO.CNT = 0;
+	CLASSB_PROFILE_TC_HI.CNT = 0;
+
+	// Route the overflows of the first TC to the clock of the second one.
+	EVSYS.CLASSB_PROFILE_EVCH_MUX = CLASSB_PROFILE_EVCH_OVF_gc;
+	CLASSB_PROFILE_TC_HI.CTRLA = CLASSB_PROFILE_CLKSEL_gc;
+	CLASSB_PROFILE_TC_LO.CTRLA = TC_CLKSEL_DIV1_gc;
+
+	// The time between two readings is what a probe adds to a routine.
+	profile_overhead = 0;
+	t = classb_profile_time();
+	profile_overhead = (uint16_t) (classb_profile_time() - t);
+
+	classb_profile_reset();
+}
+
+
+/*! \brief Clears the execution times of all routines.
+ */
+void classb_profile_reset(void)
+{
+	ENTER_CRITICAL_REGION();
+	for (uint8_t i = 0; i < N_PROFILE_ROUTINES; i++) {
+		classb_profile_table[i].min = 0xFFFFFFFF;
+		classb_profile_table[i].max = 0;
+		classb_profile_table[i].sum = 0;
+		classb_profile_table[i].n = 0;
+		classb_profile_table[i].count = 0;
+	}
+	LEAVE_CRITICAL_REGION();
+}
+
+
+/*! \brief Returns the 32-bit counter, in CPU cycles.
+ *
+ * The high word is read before and after the low word. If it changed, the
+ * overflow happened between the readings, and the low word tells on which
+ * side of it it was read.
+ */
+uint32_t classb_profile_time(void)
+{
+	uint16_t high, low, high2;
+
+	ENTER_CRITICAL_REGION();
+	high = CLASSB_PROFILE_TC_HI.CNT;
+	low = CLASSB_PROFILE_TC_LO.CNT;
+	high2 = CLASSB_PROFILE_TC_HI.CNT;
+	LEAVE_CRITICAL_REGION();
+
+	if (high != high2 && low < 0x8000)
+		high = high2;
+
+	return ((uint32_t) high << 16) | low;
+}
+
+
+/*! \brief Stamps the entry of a routine.
+ *
+ * \param identifier	Routine identifier. Use symbol declared in \ref classb_profile_identifiers.
+ */
+void classb_profile_begin(enum classb_profile_identifiers identifier)
+{
+	classb_profile_table[identifier].start = classb_profile_time();
+}
+
+
+/*! \brief Stamps the exit of a routine and updates its execution times.
+ *
+ * \param identifier	Routine identifier. Use symbol declared in \ref classb_profile_identifiers.
+ */
+void classb_profile_end(enum classb_profile_identifiers identifier)
+{
+	uint32_t cycles = classb_profile_time();
+	struct classb_profile_entry *entry = &classb_profile_table[identifier];
+
+	cycles -= entry->start;
+	cycles = (cycles > profile_overhead) ? cycles - profile_overhead : 0;
+
+	if (cycles < entry->min)
+		entry->min = cycles;
+	if (cycles > entry->max)
+		entry->max = cycles;
+
+	// Halve the mean before it overflows.
+	if (entry->n == 0xFFFF || entry->sum > 0xFFFFFFFF - cycles) {
+		entry->sum >>= 1;
+		entry->n >>= 1;
+	}
+	entry->sum += cycles;
+	entry->n++;
+
+	if (entry->count != 0xFFFF)
+		entry->count++;
+}
+
+
+/*! \brief Copies the execution times of a routine.
+ *
+ * Interrupts are disabled during the copy, so that the times are consistent
+ * even for routines that run from an interrupt.
+ *
+ * \param identifier	Routine identifier. Use symbol declared in \ref classb_profile_identifiers.
+ * \param entry			Where to copy the times.
+ */
+void classb_profile_get(enum classb_profile_identifiers identifier, struct classb_profile_entry *entry)
+{
+	ENTER_CRITICAL_REGION();
+	*entry = classb_profile_table[identifier];
+	LEAVE_CRITICAL_REGION();
+}
+
+
+/*! \brief Returns the mean execution time of a routine, in CPU cycles.
+ *
+ * \param identifier	Routine identifier. Use symbol declared in \ref classb_profile_identifiers.
+ *
+ * \return The mean, or 0 if the routine has not run.
+ */
+uint32_t classb_profile_mean(enum classb_profile_identifiers identifier)
+{
+	struct classb_profile_entry entry;
+
+	classb_profile_get(identifier, &entry);
+
+	return entry.n ? entry.sum / entry.n : 0;
+}
+
+//@}
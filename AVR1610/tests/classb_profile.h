@@ -0,0 +1,169 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Settings and definitions for the profiling of the Class B tests.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#ifndef CLASSB_PROFILE_H_
+#define CLASSB_PROFILE_H_
+
+#include "avr_compiler.h"
+
+
+//! \defgroup profile Profiling
+//!
+//! \brief Execution times of the Class B routines, measured on the device.
+//!
+//! The entry and the exit of the routines in \ref classb_profile_identifiers are
+//! stamped with a free-running 32-bit counter of CPU cycles. For each routine the
+//! shortest, longest and mean number of cycles and the number of calls are kept in
+//! \ref classb_profile_table, which the application can read with
+//! \ref classb_profile_get().
+//!
+//! The counter is made of two 16-bit TCs on the same port: the first one counts
+//! the peripheral clock, and its overflow event is routed through an event channel
+//! to the second one, which counts the overflows. The 32 bits are read without
+//! interrupts, see \ref classb_profile_time().
+//!
+//! Profiling is enabled by defining \ref CLASSB_PROFILE, and
+//! \ref classb_profile_setup() is then called from the main application. If it is
+//! not defined, \ref CLASSB_PROFILE_BEGIN() and \ref CLASSB_PROFILE_END() expand to
+//! nothing, classb_profile.c need not be built and the timers are not used.
+//!
+//! \note The cycles include the interrupts that preempt a routine, and the cost of
+//! reading the counter is subtracted. A routine must not be profiled from two
+//! contexts at the same time, e.g. from the main loop and from an interrupt.
+//!
+//@{
+
+//! \defgroup profile_conf Settings
+//! \brief Settings for the profiling
+//@{
+
+#ifdef __DOXYGEN__
+ //! \brief Enable the profiling.
+ //!
+ //! This symbol can be defined at the compiler level or in this file.
+ #define CLASSB_PROFILE
+#else
+ //#define CLASSB_PROFILE
+#endif
+
+//! \brief Enumeration of the routines that are profiled.
+//!
+//! Routine identifiers are included before \ref N_PROFILE_ROUTINES, so that it will hold
+//! the total number of routines. The application can add its own routines.
+enum classb_profile_identifiers { PROFILE_SRAM_TEST, //!< \ref classb_sram_test()
+								  PROFILE_CRC_FLASH, //!< CRC tests of the Flash
+								  PROFILE_CRC_EEPROM, //!< CRC tests of the EEPROM
+								  PROFILE_CRC_RAM, //!< \ref classb_crc_ram_test()
+								  PROFILE_FREQ_CALLBACK, //!< \ref classb_freq_callback()
+								  PROFILE_INTMON_CALLBACK, //!< \ref classb_intmon_callback()
+								  PROFILE_RTC_ISR, //!< The whole RTC compare interrupt
+								  N_PROFILE_ROUTINES //!< This will keep the number of routines
+								};
+
+//! \brief Port of the TCs, e.g. E -> TCE0 and TCE1.
+//!
+//! They must not be the TCs of the CPU frequency test or of the scheduler.
+#define CLASSB_PROFILE_TC_PORT		E
+
+//! \brief Event channel for the overflows of the first TC, 0 to 7.
+#define CLASSB_PROFILE_EVCH			7
+
+//@}
+
+//! \internal \defgroup profile_int_conf Internal settings
+//!
+//! \brief This constants should not be modified.
+//@{
+
+//! \internal \brief Label for the TC with the low word of the counter
+#define CLASSB_PROFILE_TC_LO		LABEL(TC, CLASSB_PROFILE_TC_PORT, 0)
+
+//! \internal \brief Label for the TC with the high word of the counter
+#define CLASSB_PROFILE_TC_HI		LABEL(TC, CLASSB_PROFILE_TC_PORT, 1)
+
+//! \internal \brief Label for the multiplexer register of the event channel
+#define CLASSB_PROFILE_EVCH_MUX		LABEL(CH, CLASSB_PROFILE_EVCH, MUX)
+
+//! \internal \brief Label for the overflow event of the first TC
+#define CLASSB_PROFILE_EVCH_OVF_gc	LABEL(EVSYS_CHMUX_TC, CLASSB_PROFILE_TC_PORT, 0_OVF_gc)
+
+//! \internal \brief Label for the clock selection of the second TC
+#define CLASSB_PROFILE_CLKSEL_gc	LABEL(TC_CLKSEL_EVCH, CLASSB_PROFILE_EVCH, _gc)
+
+//@}
+
+//! \defgroup profile_def Profile data interface
+//! \brief Definition of data structures used by the profiling.
+//@{
+
+/*!
+ *  \brief Execution times of a routine, in CPU cycles.
+ */
+struct classb_profile_entry {
+	//! \internal \brief Time of the last entry.
+	uint32_t start;
+	//! \brief Shortest execution.
+	uint32_t min;
+	//! \brief Longest execution.
+	uint32_t max;
+	//! \brief Sum of the executions in the mean.
+	//!
+	//! \c sum and \c n are halved before they overflow, so older executions weigh less.
+	uint32_t sum;
+	//! \brief Number of executions in the mean.
+	uint16_t n;
+	//! \brief Number of executions, saturated at 0xFFFF.
+	uint16_t count;
+};
+
+//@}
+
+//! \name Global variables
+//@{
+extern struct classb_profile_entry classb_profile_table[N_PROFILE_ROUTINES];
+//@}
+
+//! \defgroup profile_func Functions
+//! \brief Functions related to the profiling
+//@{
+void classb_profile_setup( void );
+void classb_profile_reset( void );
+uint32_t classb_profile_time( void );
+void classb_profile_begin( enum classb_profile_identifiers identifier );
+void classb_profile_end( enum classb_profile_identifiers identifier );
+void classb_profile_get( enum classb_profile_identifiers identifier, struct classb_profile_entry *entry );
+uint32_t classb_profile_mean( enum classb_profile_identifiers identifier );
+//@}
+
+//! \name Probes
+//! \brief Stamp the entry and the exit of a routine.
+//!
+//! These are placed in the routines, and expand to nothing if \ref CLASSB_PROFILE
+//! is not defined.
+//@{
+#if defined(CLASSB_PROFILE) || defined(__DOXYGEN__)
+ //! \brief Entry of a routine.
+ #define CLASSB_PROFILE_BEGIN(identifier)	classb_profile_begin(identifier)
+ //! \brief Exit of a routine.
+ #define CLASSB_PROFILE_END(identifier)		classb_profile_end(identifier)
+#else
+ #define CLASSB_PROFILE_BEGIN(identifier)	do{}while(0)
+ #define CLASSB_PROFILE_END(identifier)		do{}while(0)
+#endif
+//@}
+
+//@}
+
+#endif /* CLASSB_PROFILE_H_ */
@@ -51,6 +51,7 @@
 
 
 #include "classb_rtc_common.h"
+#include "classb_profile.h"
 
 //! \addtogroup rtc_driver
 //@{
@@ -131,6 +132,8 @@ void classb_rtc_setup() {
 //!  It is possible to add user-defined code to the RTC interrupt through
 //!  \ref CLASSB_ACTIONS_RTC().
 ISR(RTC_TEST_COMP_vect) {
+	
+	CLASSB_PROFILE_BEGIN(PROFILE_RTC_ISR);
 		
 	// Reset the RTC 
 	while (rtc_is_busy());
@@ -143,13 +146,26 @@ ISR(RTC_TEST_COMP_vect) {
 		classb_freq_callback();
 	#endif
 	
+	#ifdef CLASSB_CLOCK_MON
+		classb_clkmon_callback();
+	#endif
+	
 	#ifdef CLASSB_INT_MON
 		classb_intmon_callback(); 
 	#endif
 	
+	#ifdef CLASSB_SCHEDULER
+		classb_sched_tick();
+		#ifdef CLASSB_SCHED_RTC
+			classb_sched_run(CLASSB_SCHED_RTC_BUDGET);
+		#endif
+	#endif
+	
 	
 	// User-configurable actions
 	CLASSB_ACTIONS_RTC();
+	
+	CLASSB_PROFILE_END(PROFILE_RTC_ISR);
 }
 
 //@} 
\ No newline at end of file
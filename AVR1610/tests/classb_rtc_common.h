@@ -113,12 +113,18 @@
  //@{
  //! \brief Test for the CPU frequency.
  #define CLASSB_FREQ_TEST 
+ //! \brief Monitor of several clock domains.
+ #define CLASSB_CLOCK_MON
  //! \brief Interrupt monitor.
  #define CLASSB_INT_MON
+ //! \brief Scheduler of the Class B tests.
+ #define CLASSB_SCHEDULER
  //@}
 #else
   //#define CLASSB_FREQ_TEST
+  //#define CLASSB_CLOCK_MON
   //#define CLASSB_INT_MON
+  //#define CLASSB_SCHEDULER
 #endif
 
 
@@ -126,9 +132,15 @@
 #ifdef CLASSB_FREQ_TEST
 #  include "classb_freq.h"
 #endif
+#ifdef CLASSB_CLOCK_MON
+#  include "classb_clock_monitor.h"
+#endif
 #ifdef CLASSB_INT_MON
 #  include "classb_interrupt_monitor.h"
 #endif
+#ifdef CLASSB_SCHEDULER
+#  include "classb_scheduler.h"
+#endif
 
 
 // Workaround for missing CNT, PER and COMP in device header files.
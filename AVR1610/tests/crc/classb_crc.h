@@ -83,6 +83,8 @@
  * in software and hardware.
  *  - \ref classb_crc_sw 
  *  - \ref classb_crc_hw 
+ *  - \ref classb_crc_pages 
+ *  - \ref classb_crc_ram 
  * 
  * \section crc_usage Usage
  * 
@@ -95,6 +97,12 @@
  * To calculate a Flash checksum, use the functions 
  *  - \c CLASSB_CRC[16/32]_Flash_[SW/HW].
  *  
+ * To check the Flash page by page against a map of page checksums, see 
+ * \ref classb_crc_pages.
+ *  
+ * To check data in SRAM that is not modified after initialization, see 
+ * \ref classb_crc_ram.
+ *  
  * If there should be any error, the error handler \ref CLASSB_ERROR_HANDLER_CRC() would 
  * be called.
  *  
@@ -136,6 +144,15 @@
 #define CLASSB_CRC_16_BIT 
 //! \brief Compile 32-bit functions 
 #define CLASSB_CRC_32_BIT 
+#if defined(__DOXYGEN__)
+ //! \brief Compile the DMA-fed functions of the hardware implementation
+ //!
+ //! This requires \ref CLASSB_CRC_USE_HW and takes over one DMA channel and
+ //! its interrupt vector, see \ref crc_dma_conf.
+ #define CLASSB_CRC_USE_DMA
+#else
+ //#define CLASSB_CRC_USE_DMA
+#endif
 //@}
 
 
@@ -215,6 +232,14 @@ typedef uint32_t crcbytenum_t;
  #include "classb_crc_sw.h"
 #endif
 
+#ifdef CLASSB_CRC_32_BIT
+ #include "classb_crc_pages.h"
+#endif
+
+#ifdef CLASSB_CRC_16_BIT
+ #include "classb_crc_ram.h"
+#endif
+
 #if defined(__GNUC__) && !defined(__OPTIMIZE__)
 # error Optimization must be enabled to successfully write to protected registers, due to timing constraints.
 #endif
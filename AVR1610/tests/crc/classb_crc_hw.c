@@ -37,6 +37,7 @@
  */
 
 #include "classb_crc_hw.h"
+#include "classb_profile.h"
 
 //! \ingroup classb_crc_hw
 //@{
@@ -121,7 +122,8 @@ void crc_io_checksum_byte_add(uint8_t data)
  *
  * The CRC registers will be reset one peripheral clock cycle after the
  * RESET[1] bit is set. The initial value is reset to 0 after loading it into
- * the CHECKSUM registers.
+ * the CHECKSUM registers. The reset leaves the CRC32 bit alone, so the
+ * CRC-16 polynomial is selected here; CRC-32 is enabled after the reset.
  *
  */
 static inline void crc_reset(void)
@@ -129,6 +131,9 @@ static inline void crc_reset(void)
 	// Reset module
 	CRC_CTRL |= CRC_RESET_RESET0_gc;
 
+	// Select CRC-16 again after a CRC-32 calculation
+	CRC_CTRL &= ~CRC_CRC32_bm;
+
 	// Set initial checksum value
 	CRC.CHECKSUM0 = crc_initial_value & 0xFF;
 	CRC.CHECKSUM1 = (crc_initial_value >> 8) & 0xFF;
@@ -393,6 +398,7 @@ uint32_t crc_io_checksum_byte_stop(void)
  */
 uint16_t CLASSB_CRC16_EEPROM_HW (eepromptr_t origDataptr, crcbytenum_t numBytes, eeprom_uint16ptr_t pchecksum)
 {
+    CLASSB_PROFILE_BEGIN(PROFILE_CRC_EEPROM);
     eeprom_uint8ptr_t dataptr = origDataptr;
 	
 	crc_set_initial_value(CRC16_INITIAL_REMAINDER);
@@ -420,6 +426,7 @@ uint16_t CLASSB_CRC16_EEPROM_HW (eepromptr_t origDataptr, crcbytenum_t numBytes,
 
 
 
+    CLASSB_PROFILE_END(PROFILE_CRC_EEPROM);
 	// Return 16 bits
     return (checksum & 0x0000FFFF);
 }
@@ -438,6 +445,7 @@ uint16_t CLASSB_CRC16_EEPROM_HW (eepromptr_t origDataptr, crcbytenum_t numBytes,
  */
 uint16_t CLASSB_CRC16_Flash_HW (flashptr_t origDataptr, crcbytenum_t numBytes, eeprom_uint16ptr_t pchecksum )
 {
+    CLASSB_PROFILE_BEGIN(PROFILE_CRC_FLASH);
     flash_uint8ptr_t dataptr = origDataptr;
     uint8_t dataTemp;
 	
@@ -472,6 +480,7 @@ uint16_t CLASSB_CRC16_Flash_HW (flashptr_t origDataptr, crcbytenum_t numBytes, e
 	 CLASSB_EEMAP_END();
 	#endif
 
+    CLASSB_PROFILE_END(PROFILE_CRC_FLASH);
     return (checksum & 0x0000FFFF);
 }
 
@@ -517,6 +526,7 @@ void crc16_append_value(uint16_t value, void *ptr)
  */
 uint32_t CLASSB_CRC32_EEPROM_HW (eepromptr_t origDataptr, crcbytenum_t numBytes, eeprom_uint32ptr_t pchecksum)
 {
+    CLASSB_PROFILE_BEGIN(PROFILE_CRC_EEPROM);
     eeprom_uint8ptr_t dataptr = origDataptr; 
 	crc_set_initial_value(CRC32_INITIAL_REMAINDER);
 
@@ -542,6 +552,7 @@ uint32_t CLASSB_CRC32_EEPROM_HW (eepromptr_t origDataptr, crcbytenum_t numBytes,
 
     
 
+    CLASSB_PROFILE_END(PROFILE_CRC_EEPROM);
     return (checksum);
 }
 
@@ -559,6 +570,7 @@ uint32_t CLASSB_CRC32_EEPROM_HW (eepromptr_t origDataptr, crcbytenum_t numBytes,
  */
 uint32_t CLASSB_CRC32_Flash_HW (NVM_CMD_t crc_type, flashptr_t origDataptr, crcbytenum_t numBytes, eeprom_uint32ptr_t pchecksum)
 {
+    CLASSB_PROFILE_BEGIN(PROFILE_CRC_FLASH);
     flash_uint8ptr_t dataptr = origDataptr;
 	crc_set_initial_value(CRC32_INITIAL_REMAINDER);
 	
@@ -579,6 +591,7 @@ uint32_t CLASSB_CRC32_Flash_HW (NVM_CMD_t crc_type, flashptr_t origDataptr, crcb
 	 CLASSB_EEMAP_END();
 	#endif
 	
+    CLASSB_PROFILE_END(PROFILE_CRC_FLASH);
     return(checksum);
 }
 
@@ -710,5 +723,283 @@ void nvm_issue_flash_range_crc(flash_addr_t start_addr, flash_addr_t end_addr)
 
 #endif //defined(CLASSB_CRC_USE_HW) && defined(CLASSB_CRC_32_BIT)
 
-//@}
 
+/******************* CRC DMA Functions ******************/
+
+#if (defined(CLASSB_CRC_USE_HW) && defined(CLASSB_CRC_USE_DMA)) || defined(__DOXYGEN__)
+
+//! \brief Checksum computed by the last DMA-fed CRC test.
+volatile uint32_t classb_crc_dma_checksum;
+
+//! \internal \brief Reference checksum for the running DMA-fed CRC test.
+static uint32_t crc_dma_reference;
+
+//! \internal \brief True while a DMA-fed CRC test is running.
+static volatile bool crc_dma_running = false;
+
+//! \internal \brief True if EEPROM has to be unmapped when the test is complete.
+static bool crc_dma_eemap_disable = false;
+
+//! \internal \brief Destination of the DMA transaction. 
+//!
+//! The data only has to pass through the DMA channel, so it is written to this 
+//! fixed location.
+static volatile uint8_t crc_dma_sink;
+
+
+/**
+ * \internal
+ * 
+ * \brief Map EEPROM into data memory for a DMA-fed CRC test
+ *
+ * Memory mapping is kept enabled until the end of the test. It is disabled in 
+ * the interrupt if it was not enabled before.
+ */
+static void crc_dma_eemap_begin(void)
+{
+	crc_dma_eemap_disable = (NVM.CTRLB & NVM_EEMAPEN_bm) ? false : true;
+
+	if (crc_dma_eemap_disable) {
+		// Ensure that NVM is ready before enabling memory mapping.
+		do {} while (NVM.STATUS & NVM_NVMBUSY_bm);
+		NVM.CTRLB |= NVM_EEMAPEN_bm;
+	}
+}
+
+
+/**
+ * \internal
+ * 
+ * \brief Start a CRC computation fed by a DMA channel
+ *
+ * This function resets the CRC module, selects the DMA channel 
+ * \ref CLASSB_CRC_DMA_CH as data source and starts a block transfer of the 
+ * selected number of bytes. The CPU is not used for the transfer. When the 
+ * transaction is complete, the interrupt compares the checksum with 
+ * \c reference.
+ *
+ * \param data          data buffer to perform CRC on (data memory space)
+ * \param len           the number of bytes to perform CRC on
+ * \param crc_16_32     enum to indicate whether CRC-32 or CRC-16 shall be used
+ * \param reference     expected checksum
+ *
+ * \retval true  the computation was started
+ * \retval false a DMA-fed test is already running or \c len is zero
+ */
+bool crc_dma_checksum_start(const void *data, uint16_t len, enum crc_16_32_t crc_16_32, uint32_t reference)
+{
+	uintptr_t src = (uintptr_t)data;
+	uintptr_t dest = (uintptr_t)&crc_dma_sink;
+
+	if (crc_dma_running || (len == 0))
+		return false;
+
+	crc_dma_running = true;
+	crc_dma_reference = reference;
+
+	// Initialize CRC calculations on the DMA channel
+	crc_reset();
+	if (crc_16_32 == CRC_32BIT) {
+		crc_32_enable();
+	}
+	crc_set_source(CLASSB_CRC_DMA_SOURCE_gc);
+
+	// Configure the DMA channel: one block from the source to a fixed destination
+	DMA.CTRL |= DMA_ENABLE_bm;
+	CLASSB_CRC_DMA_CHANNEL.CTRLA = 0;
+	CLASSB_CRC_DMA_CHANNEL.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_INC_gc |
+			DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_FIXED_gc;
+	CLASSB_CRC_DMA_CHANNEL.TRIGSRC = DMA_CH_TRIGSRC_OFF_gc;
+	CLASSB_CRC_DMA_CHANNEL.TRFCNT = len;
+	CLASSB_CRC_DMA_CHANNEL.SRCADDR0 = src & 0xFF;
+	CLASSB_CRC_DMA_CHANNEL.SRCADDR1 = (src >> 8) & 0xFF;
+	CLASSB_CRC_DMA_CHANNEL.SRCADDR2 = 0;
+	CLASSB_CRC_DMA_CHANNEL.DESTADDR0 = dest & 0xFF;
+	CLASSB_CRC_DMA_CHANNEL.DESTADDR1 = (dest >> 8) & 0xFF;
+	CLASSB_CRC_DMA_CHANNEL.DESTADDR2 = 0;
+
+	// Clear the flags and enable the interrupts
+	CLASSB_CRC_DMA_CHANNEL.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm |
+			CLASSB_CRC_DMA_TRNINTLVL_gc | CLASSB_CRC_DMA_ERRINTLVL_gc;
+
+	// Enable the channel and request the whole block with one trigger
+	CLASSB_CRC_DMA_CHANNEL.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+	CLASSB_CRC_DMA_CHANNEL.CTRLA |= DMA_CH_TRFREQ_bm;
+
+	return true;
+}
+
+
+/*! \brief Check whether a DMA-fed CRC test is running.
+ *
+ * \retval true  the checksum is being computed.
+ * \retval false the last test is complete and \ref classb_crc_dma_checksum is valid.
+ */
+bool classb_crc_dma_busy(void)
+{
+	return crc_dma_running;
+}
+
+
+/*! \brief Interrupt for the end of the DMA transaction.
+ *
+ * The checksum is read and compared with the reference. If they were different,
+ * or the DMA transaction failed, \ref CLASSB_ERROR_HANDLER_CRC() would be called.
+ * Memory mapping of EEPROM is restored.
+ */
+ISR(CLASSB_CRC_DMA_vect)
+{
+	bool dma_error = (CLASSB_CRC_DMA_CHANNEL.CTRLB & DMA_CH_ERRIF_bm) ? true : false;
+
+	// Clear the flags and disable the channel
+	CLASSB_CRC_DMA_CHANNEL.CTRLB |= DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+	CLASSB_CRC_DMA_CHANNEL.CTRLA = 0;
+
+	if (dma_error) {
+		// The CRC module would wait for the transaction forever.
+		CRC_CTRL |= CRC_RESET_RESET0_gc;
+		crc_disable();
+		classb_crc_dma_checksum = 0;
+	} else {
+		classb_crc_dma_checksum = crc_checksum_complete();
+	}
+
+	if (crc_dma_eemap_disable) {
+		NVM.CTRLB &= ~NVM_EEMAPEN_bm;
+		crc_dma_eemap_disable = false;
+	}
+
+	crc_dma_running = false;
+
+	// Compare checksums and handle error if necessary.
+	if (dma_error || (classb_crc_dma_checksum != crc_dma_reference))
+		CLASSB_ERROR_HANDLER_CRC();
+}
+
+#endif // defined(CLASSB_CRC_USE_HW) && defined(CLASSB_CRC_USE_DMA)
+
+
+#if (defined(CLASSB_CRC_USE_HW) && defined(CLASSB_CRC_USE_DMA) && defined(CLASSB_CRC_16_BIT)) || defined(__DOXYGEN__)
+
+/*! \brief Start a 16-bit CRC test of an EEPROM address range fed by DMA.
+ *
+ * The reference checksum is read when the test starts. The result is checked 
+ * in the interrupt of the DMA channel and stored in \ref classb_crc_dma_checksum.
+ *
+ * \param origDataptr Address of EEPROM location to start CRC computation at.
+ * \param numBytes    Number of bytes of the data.
+ * \param pchecksum	  Pointer to the checksum stored in EEPROM.
+ *
+ * \retval true  the test was started.
+ * \retval false a DMA-fed test is already running or \c numBytes is zero.
+ *
+ * \note No sanity checking of addresses is done. 
+ */
+bool CLASSB_CRC16_EEPROM_DMA (eepromptr_t origDataptr, uint16_t numBytes, eeprom_uint16ptr_t pchecksum)
+{
+	eeprom_uint8ptr_t dataptr = origDataptr;
+	uint16_t reference;
+
+	if (crc_dma_running || (numBytes == 0))
+		return false;
+
+	crc_set_initial_value(CRC16_INITIAL_REMAINDER);
+
+	// Map EEPROM until the end of the test.
+	crc_dma_eemap_begin();
+	dataptr += MAPPED_EEPROM_START;
+
+	#if defined(__ICCAVR__)
+	 reference = *pchecksum;
+	#elif defined(__GNUC__)
+	 reference = *(eeprom_uint16ptr_t)(MAPPED_EEPROM_START + (uintptr_t) pchecksum);
+	#endif
+
+	return crc_dma_checksum_start((void*)dataptr, numBytes, CRC_16BIT, reference);
+}
+
+
+/*! \brief Start a 16-bit CRC test of a data section in SRAM fed by DMA.
+ *
+ * \param dataptr   Address of the data in SRAM.
+ * \param numBytes  Number of bytes of the data.
+ * \param checksum  Expected checksum.
+ *
+ * \retval true  the test was started.
+ * \retval false a DMA-fed test is already running or \c numBytes is zero.
+ */
+bool CLASSB_CRC16_SRAM_DMA (const void *dataptr, uint16_t numBytes, uint16_t checksum)
+{
+	if (crc_dma_running || (numBytes == 0))
+		return false;
+
+	crc_set_initial_value(CRC16_INITIAL_REMAINDER);
+
+	return crc_dma_checksum_start(dataptr, numBytes, CRC_16BIT, checksum);
+}
+
+#endif // defined(CLASSB_CRC_USE_HW) && defined(CLASSB_CRC_USE_DMA) && defined(CLASSB_CRC_16_BIT)
+
+
+#if (defined(CLASSB_CRC_USE_HW) && defined(CLASSB_CRC_USE_DMA) && defined(CLASSB_CRC_32_BIT)) || defined(__DOXYGEN__)
+
+/*! \brief Start a 32-bit CRC test of an EEPROM address range fed by DMA.
+ *
+ * The reference checksum is read when the test starts. The result is checked 
+ * in the interrupt of the DMA channel and stored in \ref classb_crc_dma_checksum.
+ *
+ * \param origDataptr Address of EEPROM location to start CRC computation at.
+ * \param numBytes    Number of bytes of the data.
+ * \param pchecksum	  Pointer to the checksum stored in EEPROM.
+ *
+ * \retval true  the test was started.
+ * \retval false a DMA-fed test is already running or \c numBytes is zero.
+ *
+ * \note No sanity checking of addresses is done. 
+ */
+bool CLASSB_CRC32_EEPROM_DMA (eepromptr_t origDataptr, uint16_t numBytes, eeprom_uint32ptr_t pchecksum)
+{
+	eeprom_uint8ptr_t dataptr = origDataptr;
+	uint32_t reference;
+
+	if (crc_dma_running || (numBytes == 0))
+		return false;
+
+	crc_set_initial_value(CRC32_INITIAL_REMAINDER);
+
+	// Map EEPROM until the end of the test.
+	crc_dma_eemap_begin();
+	dataptr += MAPPED_EEPROM_START;
+
+	#if defined(__ICCAVR__)
+	 reference = *pchecksum;
+	#elif defined(__GNUC__)
+	 reference = *(eeprom_uint32ptr_t)(MAPPED_EEPROM_START + (uintptr_t) pchecksum);
+	#endif
+
+	return crc_dma_checksum_start((void*)dataptr, numBytes, CRC_32BIT, reference);
+}
+
+
+/*! \brief Start a 32-bit CRC test of a data section in SRAM fed by DMA.
+ *
+ * \param dataptr   Address of the data in SRAM.
+ * \param numBytes  Number of bytes of the data.
+ * \param checksum  Expected checksum.
+ *
+ * \retval true  the test was started.
+ * \retval false a DMA-fed test is already running or \c numBytes is zero.
+ */
+bool CLASSB_CRC32_SRAM_DMA (const void *dataptr, uint16_t numBytes, uint32_t checksum)
+{
+	if (crc_dma_running || (numBytes == 0))
+		return false;
+
+	crc_set_initial_value(CRC32_INITIAL_REMAINDER);
+
+	return crc_dma_checksum_start(dataptr, numBytes, CRC_32BIT, checksum);
+}
+
+#endif // defined(CLASSB_CRC_USE_HW) && defined(CLASSB_CRC_USE_DMA) && defined(CLASSB_CRC_32_BIT)
+
+//@}
@@ -66,6 +66,21 @@
  * \li When specifying Flash or EEPROM addresses, 0x000000 denotes the start of 
  * physical memory.
  *
+ * If \ref CLASSB_CRC_USE_DMA is defined, EEPROM and SRAM can also be checked 
+ * with a DMA channel that streams the data into the CRC module. The test is 
+ * started with \ref CLASSB_CRC16_EEPROM_DMA(), \ref CLASSB_CRC32_EEPROM_DMA(), 
+ * \ref CLASSB_CRC16_SRAM_DMA() or \ref CLASSB_CRC32_SRAM_DMA() and the CPU is 
+ * free while the checksum is computed. When the DMA transaction is complete, an 
+ * interrupt reads the checksum, compares it with the reference and calls 
+ * \ref CLASSB_ERROR_HANDLER_CRC() if they are different. \ref classb_crc_dma_busy() 
+ * tells whether the test is still running.
+ *
+ * \note \li The CRC module cannot be used by other functions while a DMA-fed 
+ * test is running. 
+ * \li The interrupt level \ref CLASSB_CRC_DMA_INTLVL has to be enabled in the PMIC.
+ * \li EEPROM is kept memory mapped until the test is complete, so the NVM 
+ * controller should not be used to access EEPROM in the meantime.
+ *
  */
 
 //@{
@@ -84,6 +99,55 @@
 //@}
 
 
+#if defined(CLASSB_CRC_USE_DMA) || defined(__DOXYGEN__)
+
+//! \defgroup crc_dma_conf Configuration of the DMA-fed CRC
+//! 
+//! \brief Settings for the CRC tests that use a DMA channel.
+//@{
+
+//! \brief DMA channel that feeds the CRC module, e.g. 0 -> DMA.CH0.
+#define CLASSB_CRC_DMA_CH			0
+
+//! \brief Interrupt level for the end of the DMA transaction: LO, MED or HI.
+#define CLASSB_CRC_DMA_INTLVL		LO
+
+//! \internal \brief Label for the DMA channel
+#define CLASSB_CRC_DMA_CHANNEL		LABEL(DMA.CH, CLASSB_CRC_DMA_CH,)
+
+//! \internal \brief Label for the CRC source that corresponds to the DMA channel
+#define CLASSB_CRC_DMA_SOURCE_gc	LABEL(CRC_SOURCE_DMAC, CLASSB_CRC_DMA_CH, _gc)
+
+//! \internal \brief Label for the interrupt vector of the DMA channel
+#define CLASSB_CRC_DMA_vect		LABEL(DMA_CH, CLASSB_CRC_DMA_CH, _vect)
+
+//! \internal \brief Label for the transaction complete interrupt level
+#define CLASSB_CRC_DMA_TRNINTLVL_gc	LABEL(DMA_CH_TRNINTLVL_, CLASSB_CRC_DMA_INTLVL, _gc)
+
+//! \internal \brief Label for the error interrupt level
+#define CLASSB_CRC_DMA_ERRINTLVL_gc	LABEL(DMA_CH_ERRINTLVL_, CLASSB_CRC_DMA_INTLVL, _gc)
+
+//@}
+
+//! \name DMA-fed CRC tests
+//! 
+//! \brief Invariant memory tests where the checksum is computed in the background.
+//@{
+bool CLASSB_CRC16_EEPROM_DMA (eepromptr_t dataptr, uint16_t numBytes, eeprom_uint16ptr_t pchecksum);
+bool CLASSB_CRC32_EEPROM_DMA (eepromptr_t dataptr, uint16_t numBytes, eeprom_uint32ptr_t pchecksum);
+bool CLASSB_CRC16_SRAM_DMA (const void *dataptr, uint16_t numBytes, uint16_t checksum);
+bool CLASSB_CRC32_SRAM_DMA (const void *dataptr, uint16_t numBytes, uint32_t checksum);
+bool classb_crc_dma_busy (void);
+//@}
+
+//! \name Global variables
+//@{
+extern volatile uint32_t classb_crc_dma_checksum;
+//@}
+
+#endif // defined(CLASSB_CRC_USE_DMA)
+
+
 //! \name CRC tests
 //! 
 //! \brief Invariant memory tests based on CRC that are compliant with IEC60730 Class B.
@@ -115,6 +179,9 @@ uint32_t crc_io_checksum(void *data, uint16_t len, enum crc_16_32_t crc_16_32);
 void crc_io_checksum_byte_start(enum crc_16_32_t crc_16_32);
 void crc_io_checksum_byte_add(uint8_t data);
 uint32_t crc_io_checksum_byte_stop(void);
+#if defined(CLASSB_CRC_USE_DMA)
+bool crc_dma_checksum_start(const void *data, uint16_t len, enum crc_16_32_t crc_16_32, uint32_t reference);
+#endif
 void nvm_issue_flash_range_crc(flash_addr_t start_addr, flash_addr_t end_addr);
 //@}
 
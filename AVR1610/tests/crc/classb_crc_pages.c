@@ -0,0 +1,254 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Page-level CRC map for the Flash memory.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#include "classb_crc_pages.h"
+#include "classb_profile.h"
+
+//! \ingroup classb_crc_pages
+//@{
+
+#if defined(CLASSB_CRC_32_BIT) || defined(__DOXYGEN__)
+
+//! \brief Index of the first page that failed in the last check, or
+//! \ref CLASSB_CRC_NO_PAGE if all pages were correct.
+volatile uint16_t classb_crc_failed_page = CLASSB_CRC_NO_PAGE;
+
+//! \internal \brief Reflected IEEE 802.3 polynomial used for the CRC arithmetic.
+#define CRC32_REFL_POLYNOMIAL	0xEDB88320UL
+
+//! \internal \brief Table of x^(2^n) modulo the CRC32 polynomial, for n = 0..31.
+//!
+//! The values are given in the reflected representation, i.e. x^0 is 0x80000000.
+static const uint32_t PROGMEM_DECLARE( classb_crc32_x2n_table[32] ) = {
+	0x40000000, 0x20000000, 0x08000000, 0x00800000,
+	0x00008000, 0xEDB88320, 0xB1E6B092, 0xA06A2517,
+	0xED627DAE, 0x88D14467, 0xD7BBFE6A, 0xEC447F11,
+	0x8E7EA170, 0x6427800E, 0x4D47BAE0, 0x09FE548F,
+	0x83852D0F, 0x30362F1A, 0x7B5A9CC3, 0x31FEC169,
+	0x9FEC022A, 0x6C8DEDC4, 0x15D6874D, 0x5FDE7A4E,
+	0xBAD90E37, 0x2E4E5EEF, 0x4EABA214, 0xA8A472C0,
+	0x429A969E, 0x148D302A, 0xC40BA6D0, 0xC4E22C3C
+};
+
+
+/*! \internal \brief Multiply two polynomials modulo the CRC32 polynomial.
+ *
+ * Both operands and the result are in the reflected representation.
+ *
+ * \param a First factor.
+ * \param b Second factor.
+ *
+ * \return a * b modulo the CRC32 polynomial.
+ */
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+	uint32_t m = 0x80000000UL;
+	uint32_t p = 0;
+
+	for (;;) {
+		if (a & m) {
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ CRC32_REFL_POLYNOMIAL : b >> 1;
+	}
+
+	return p;
+}
+
+
+/*! \internal \brief Compute x^(n * 2^k) modulo the CRC32 polynomial.
+ *
+ * \param n Exponent.
+ * \param k Base 2 logarithm of the multiplier of \c n, e.g. 3 for bytes.
+ *
+ * \return x^(n * 2^k) modulo the CRC32 polynomial (reflected).
+ */
+static uint32_t crc32_x2nmodp(crcbytenum_t n, uint8_t k)
+{
+	uint32_t p = 0x80000000UL;
+
+	while (n) {
+		if (n & 1)
+			p = crc32_multmodp(PROGMEM_READ_DWORD(&classb_crc32_x2n_table[k & 31]), p);
+		n >>= 1;
+		k++;
+	}
+
+	return p;
+}
+
+
+/*! \brief Combine the checksums of two consecutive blocks of data.
+ *
+ * Given the IEEE 802.3 CRC of a first block, \c crc1, and of a second block of
+ * \c len2 bytes, \c crc2, this function returns the CRC of both blocks
+ * concatenated. The data itself is not needed.
+ *
+ * \param crc1 Checksum of the first block.
+ * \param crc2 Checksum of the second block.
+ * \param len2 Number of bytes in the second block.
+ *
+ * \return Checksum of the concatenation of both blocks.
+ */
+uint32_t classb_crc32_combine(uint32_t crc1, uint32_t crc2, crcbytenum_t len2)
+{
+	return crc32_multmodp(crc32_x2nmodp(len2, 3), crc1) ^ crc2;
+}
+
+
+/*! \internal \brief Read a 32-bit value from EEPROM.
+ *
+ * \param ptr Pointer to the value in EEPROM.
+ */
+static uint32_t crc_pages_read_eeprom(eeprom_uint32ptr_t ptr)
+{
+	uint32_t value;
+
+	#if defined(__ICCAVR__)
+	 value = *ptr;
+	#elif defined(__GNUC__)
+	 // Ensure that EEPROM is memory mapped.
+	 CLASSB_EEMAP_BEGIN();
+	 value = *(eeprom_uint32ptr_t)(MAPPED_EEPROM_START + (uintptr_t) ptr);
+	 // Disable memory mapping of EEPROM, if necessary.
+	 CLASSB_EEMAP_END();
+	#endif
+
+	return value;
+}
+
+
+/*! \internal \brief Compute the 32-bit CRC of one Flash page.
+ *
+ * The hardware CRC module is used if available, otherwise the checksum is
+ * computed in software.
+ *
+ * \param dataptr Address of the first byte of the page.
+ */
+static uint32_t crc32_flash_page(flash_uint8ptr_t dataptr)
+{
+#if defined(CLASSB_CRC_USE_HW)
+	crc_set_initial_value(CRC32_INITIAL_REMAINDER);
+	return crc_flash_checksum(CRC_FLASH_RANGE, (flash_addr_t)dataptr, CLASSB_CRC_PAGE_SIZE);
+#else
+	uint32_t remainder = CRC32_INITIAL_REMAINDER;
+	uint8_t dataTemp;
+
+	for (crcbytenum_t numBytes = CLASSB_CRC_PAGE_SIZE; numBytes != 0; numBytes--)
+	{
+#if (PROGMEM_SIZE >= 0x10000UL)
+		 dataTemp = PROGMEM_READ_BYTE_FAR(dataptr++);
+#else
+         dataTemp = PROGMEM_READ_BYTE(dataptr++);
+#endif
+
+#if defined(CRC_USE_32BIT_LOOKUP_TABLE)
+		CLASSB_CRC_REFL_TABLE_32(dataTemp, remainder, CLASSB_CRC32Table);
+#else
+		CLASSB_CRC_REFL(dataTemp, remainder, CRC32_POLYNOMIAL, 32);
+#endif
+	}
+
+	return remainder ^ CRC32_FINAL_XOR_VALUE;
+#endif
+}
+
+
+/*! \brief Check a Flash range page by page against a CRC page map.
+ *
+ * Each page is compared with its entry in the page map. The checksum of the whole
+ * range is derived from the page checksums and compared with \c pchecksum, so
+ * the page map is checked against the reference checksum of the range as well.
+ *
+ * \param origDataptr Address of the first page in Flash.
+ * \param numPages    Number of pages to check.
+ * \param pagemap     Pointer to the page map stored in EEPROM.
+ * \param pchecksum	  Pointer to the checksum of the whole range stored in EEPROM.
+ *
+ * \return Checksum of the whole range.
+ *
+ * \note No sanity checking of addresses is done.
+ */
+uint32_t CLASSB_CRC32_Flash_Pages (flashptr_t origDataptr, uint16_t numPages, eeprom_uint32ptr_t pagemap, eeprom_uint32ptr_t pchecksum)
+{
+	CLASSB_PROFILE_BEGIN(PROFILE_CRC_FLASH);
+	flash_uint8ptr_t dataptr = origDataptr;
+	// x^(8*CLASSB_CRC_PAGE_SIZE) is the factor that appends a page to the checksum.
+	uint32_t xpage = crc32_x2nmodp(CLASSB_CRC_PAGE_SIZE, 3);
+	uint32_t combined = 0;
+	uint32_t checksum;
+
+	classb_crc_failed_page = CLASSB_CRC_NO_PAGE;
+
+	for (uint16_t page = 0; page < numPages; page++)
+	{
+		checksum = crc32_flash_page(dataptr);
+		dataptr += CLASSB_CRC_PAGE_SIZE;
+
+		// Keep the first page that failed.
+		if ( (checksum != crc_pages_read_eeprom(pagemap + page)) && (classb_crc_failed_page == CLASSB_CRC_NO_PAGE) )
+		{
+			classb_crc_failed_page = page;
+			CLASSB_ERROR_HANDLER_CRC();
+		}
+
+		combined = (page == 0) ? checksum : (crc32_multmodp(xpage, combined) ^ checksum);
+	}
+
+	// If all pages were correct, the map has to match the checksum of the whole range.
+	if ( (classb_crc_failed_page == CLASSB_CRC_NO_PAGE) && (combined != crc_pages_read_eeprom(pchecksum)) )
+		CLASSB_ERROR_HANDLER_CRC();
+
+	CLASSB_PROFILE_END(PROFILE_CRC_FLASH);
+	return (combined);
+}
+
+
+/*! \brief Check a single Flash page against a CRC page map.
+ *
+ * \param origDataptr Address of the first page in Flash, i.e. the page that
+ *                    corresponds to the first entry of the page map.
+ * \param page        Index of the page to check.
+ * \param pagemap     Pointer to the page map stored in EEPROM.
+ *
+ * \return Checksum of the page.
+ *
+ * \note No sanity checking of addresses is done.
+ */
+uint32_t CLASSB_CRC32_Flash_Page (flashptr_t origDataptr, uint16_t page, eeprom_uint32ptr_t pagemap)
+{
+	CLASSB_PROFILE_BEGIN(PROFILE_CRC_FLASH);
+	flash_uint8ptr_t dataptr = origDataptr;
+	uint32_t checksum;
+
+	dataptr += (crcbytenum_t)page * CLASSB_CRC_PAGE_SIZE;
+	checksum = crc32_flash_page(dataptr);
+
+	if (checksum != crc_pages_read_eeprom(pagemap + page))
+	{
+		classb_crc_failed_page = page;
+		CLASSB_ERROR_HANDLER_CRC();
+	}
+
+	CLASSB_PROFILE_END(PROFILE_CRC_FLASH);
+	return (checksum);
+}
+
+#endif // defined(CLASSB_CRC_32_BIT)
+
+//@}
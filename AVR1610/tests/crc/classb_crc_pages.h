@@ -0,0 +1,88 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Settings and definitions for the page-level CRC map of the Flash.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#ifndef __CRC_H_PAGES__
+#define __CRC_H_PAGES__
+
+#include "avr_compiler.h"
+#include "classb_crc.h"
+
+//! \ingroup classb_crc
+//!
+//! \defgroup classb_crc_pages CRC page map
+//!
+//! \brief Flash test based on one 32-bit CRC per Flash page.
+//!
+//! Instead of a single checksum for a whole Flash range, a page map holds one
+//! IEEE 802.3 CRC per Flash page of \ref CLASSB_CRC_PAGE_SIZE bytes. The map is
+//! stored in EEPROM as an array of \c uint32_t, where element \c i is the CRC of
+//! page \c i counted from the start of the range.
+//!
+//! \ref CLASSB_CRC32_Flash_Pages() checks every page against its entry in the map
+//! and, at the same time, derives the checksum of the whole range from the page
+//! checksums with \ref classb_crc32_combine(). The result is compared with the
+//! checksum of the whole range, so the map itself is verified against the same
+//! reference value that \ref CLASSB_CRC32_Flash_HW() and \ref CLASSB_CRC32_Flash_SW()
+//! use, without reading the Flash a second time.
+//!
+//! \ref CLASSB_CRC32_Flash_Page() checks a single page. After a partial update,
+//! e.g. by a bootloader, only the pages that changed have to be checked again.
+//!
+//! If a page should be wrong, its index would be stored in \ref classb_crc_failed_page
+//! and the error handler \ref CLASSB_ERROR_HANDLER_CRC() would be called.
+//!
+//! The checksums are computed with the CRC hardware module if \ref CLASSB_CRC_USE_HW
+//! is defined, and in software otherwise.
+//!
+//! \note The page map is not written by this module. It has to be generated
+//! when the application is built, in the same way as the reference checksum.
+//!
+//@{
+
+//! \name Settings for the CRC page map
+//@{
+#if defined(PROGMEM_PAGE_SIZE) || defined(__DOXYGEN__)
+ //! \brief Size of a Flash page in bytes, i.e. the number of bytes covered by each
+ //! entry of the page map. This should be an even number.
+ #define CLASSB_CRC_PAGE_SIZE		((crcbytenum_t) PROGMEM_PAGE_SIZE)
+#else
+ #define CLASSB_CRC_PAGE_SIZE		512UL
+#endif
+
+//! \brief Value of \ref classb_crc_failed_page when no page has failed.
+#define CLASSB_CRC_NO_PAGE			0xFFFF
+//@}
+
+//! \name Global variables
+//@{
+extern volatile uint16_t classb_crc_failed_page;
+//@}
+
+//! \name CRC tests
+//!
+//! \brief Invariant memory tests based on CRC that are compliant with IEC60730 Class B.
+//@{
+uint32_t CLASSB_CRC32_Flash_Pages (flashptr_t dataptr, uint16_t numPages, eeprom_uint32ptr_t pagemap, eeprom_uint32ptr_t pchecksum);
+uint32_t CLASSB_CRC32_Flash_Page (flashptr_t dataptr, uint16_t page, eeprom_uint32ptr_t pagemap);
+//@}
+
+//! \name CRC arithmetic
+//@{
+uint32_t classb_crc32_combine (uint32_t crc1, uint32_t crc2, crcbytenum_t len2);
+//@}
+
+//@}
+
+#endif
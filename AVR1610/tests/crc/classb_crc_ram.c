@@ -0,0 +1,175 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		CRC test of invariant data in SRAM.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#include "classb_crc_ram.h"
+#include "classb_profile.h"
+
+//! \ingroup classb_crc_ram
+//@{
+
+#if defined(CLASSB_CRC_16_BIT) || defined(__DOXYGEN__)
+
+#if !defined(CLASSB_CRC_USE_HW) && !defined(CLASSB_CRC_USE_SW)
+# error The SRAM region test requires the hardware or the software CRC implementation.
+#endif
+
+//! \brief Identifier of the last region that failed, or
+//! \ref CLASSB_CRC_NO_REGION if all regions were correct.
+volatile uint8_t classb_crc_ram_failed_region = CLASSB_CRC_NO_REGION;
+
+//! \internal \brief Array of data structures for the regions that should be checked.
+static struct classb_ram_region ram_regions[N_RAM_REGIONS];
+
+//! \internal \brief Region that is being checked.
+static uint8_t ram_region_current = 0;
+
+//! \internal \brief Offset of the next slice within the current region.
+static uint16_t ram_region_offset = 0;
+
+//! \internal \brief Checksum of the current region up to \ref ram_region_offset.
+static uint16_t ram_region_crc = CRC16_INITIAL_REMAINDER;
+
+
+/*! \internal \brief Compute the 16-bit CRC of a block of data in SRAM.
+ *
+ * \param crc     Checksum of the preceding data, or \ref CRC16_INITIAL_REMAINDER.
+ * \param dataptr Address of the data.
+ * \param len     Number of bytes.
+ *
+ * \return Checksum of the preceding data and this block.
+ */
+static uint16_t crc_ram_block(uint16_t crc, const uint8_t *dataptr, uint16_t len)
+{
+#if defined(CLASSB_CRC_USE_HW)
+	crc_set_initial_value(crc);
+	return (uint16_t) crc_io_checksum((void*)dataptr, len, CRC_16BIT);
+#else
+	uint8_t dataTemp;
+
+	for (; len != 0; len--)
+	{
+		dataTemp = *dataptr++;
+
+#ifdef CRC_USE_16BIT_LOOKUP_TABLE
+		CLASSB_CRC_TABLE_16(dataTemp, crc, CLASSB_CRC16Table);
+#else
+		CLASSB_CRC(dataTemp, crc, CRC16_POLYNOMIAL, 16);
+#endif
+	}
+
+	return crc;
+#endif
+}
+
+
+/*! \internal \brief Move on to the next region.
+ *
+ * \retval true  all regions have been checked.
+ * \retval false there are regions left in this pass.
+ */
+static bool crc_ram_next_region(void)
+{
+	ram_region_offset = 0;
+	ram_region_crc = CRC16_INITIAL_REMAINDER;
+
+	if (++ram_region_current >= N_RAM_REGIONS) {
+		ram_region_current = 0;
+		return true;
+	}
+
+	return false;
+}
+
+
+/** \brief Registers an SRAM region and computes its reference checksum.
+ *
+ * This function should be called from the main application once the region has
+ * been initialized, and again every time the application modifies the region.
+ * If the region is being checked, the check starts again from its first byte.
+ *
+ *  \param identifier	Region identifier. Use symbol declared in \ref classb_ram_region_identifiers.
+ *  \param start		Start address of the region in SRAM.
+ *  \param size			Size of the region in bytes. Zero removes the region from the test.
+ */
+void classb_crc_ram_reg_region(enum classb_ram_region_identifiers identifier, const void *start, uint16_t size)
+{
+	ram_regions[identifier].start = (const uint8_t *) start;
+	ram_regions[identifier].size = size;
+	ram_regions[identifier].reference = crc_ram_block(CRC16_INITIAL_REMAINDER, (const uint8_t *) start, size);
+
+	if (identifier == ram_region_current) {
+		ram_region_offset = 0;
+		ram_region_crc = CRC16_INITIAL_REMAINDER;
+	}
+}
+
+
+/*! \internal \brief Checks the next slice of the current region.
+ *
+ * \retval true  all regions have been checked.
+ * \retval false there are regions left in this pass.
+ */
+static bool crc_ram_slice(void)
+{
+	struct classb_ram_region *region = &ram_regions[ram_region_current];
+	uint16_t len;
+
+	if (region->size == 0)
+		return crc_ram_next_region();
+
+	len = region->size - ram_region_offset;
+	if (len > CLASSB_CRC_RAM_SLICE)
+		len = CLASSB_CRC_RAM_SLICE;
+
+	ram_region_crc = crc_ram_block(ram_region_crc, region->start + ram_region_offset, len);
+	ram_region_offset += len;
+
+	if (ram_region_offset < region->size)
+		return false;
+
+	// Compare checksums and handle error if necessary.
+	if (ram_region_crc != region->reference) {
+		classb_crc_ram_failed_region = ram_region_current;
+		CLASSB_ERROR_HANDLER_CRC();
+	}
+
+	return crc_ram_next_region();
+}
+
+
+/** \brief Checks the next slice of the registered SRAM regions.
+ *
+ * The checksum of at most \ref CLASSB_CRC_RAM_SLICE bytes of the current region is
+ * computed. If this was the last slice, the checksum of the region is compared with
+ * the reference and the next region is selected. Regions that are not registered
+ * are skipped.
+ *
+ * \retval true  a pass over all the regions has been completed.
+ * \retval false there are regions left in this pass.
+ */
+bool classb_crc_ram_test(void)
+{
+	bool done;
+
+	CLASSB_PROFILE_BEGIN(PROFILE_CRC_RAM);
+	done = crc_ram_slice();
+	CLASSB_PROFILE_END(PROFILE_CRC_RAM);
+
+	return done;
+}
+
+#endif // defined(CLASSB_CRC_16_BIT)
+
+//@}
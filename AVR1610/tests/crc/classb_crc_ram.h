@@ -0,0 +1,105 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Settings and definitions for the CRC test of invariant data in SRAM.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#ifndef __CRC_H_RAM__
+#define __CRC_H_RAM__
+
+#include "avr_compiler.h"
+#include "classb_crc.h"
+
+//! \ingroup classb_crc
+//!
+//! \defgroup classb_crc_ram CRC test of invariant SRAM regions
+//!
+//! \brief Test for data in SRAM that does not change after initialization.
+//!
+//! Lookup tables in \c .data, calibration values copied from EEPROM or configuration
+//! structures are invariant once the application has initialized them, but they are
+//! not covered by the Flash and EEPROM tests. This module keeps a 16-bit CRC of each
+//! of these regions and checks them periodically.
+//!
+//! In order to check a region, the following steps should be followed:
+//!   -# Add an identifier for the region in \ref classb_ram_region_identifiers.
+//!   -# After the region has been initialized, the main application calls
+//!   \ref classb_crc_ram_reg_region(). The reference checksum is computed at this point.
+//!   -# \ref classb_crc_ram_test() is called periodically, e.g. from the main loop. Each
+//!   call computes the checksum of at most \ref CLASSB_CRC_RAM_SLICE bytes, so the time
+//!   spent in each call is bounded. When the last slice of a region has been processed,
+//!   the checksum is compared with the reference and the next region is started.
+//!   -# If the application has to modify a region, it calls
+//!   \ref classb_crc_ram_reg_region() again afterwards to update the reference.
+//!
+//! The slices are computed with the CRC hardware module if \ref CLASSB_CRC_USE_HW is
+//! defined, and in software otherwise. The checksum of each slice is used as the
+//! initial value for the next one.
+//!
+//! If a region should be wrong, its identifier would be stored in
+//! \ref classb_crc_ram_failed_region and the error handler \ref CLASSB_ERROR_HANDLER_CRC()
+//! would be called.
+//!
+//! \note The CRC hardware module cannot be shared with a running DMA-fed test,
+//! see \ref CLASSB_CRC_USE_DMA.
+//!
+//@{
+
+//! \name Settings for the SRAM regions
+//@{
+
+//! \brief Enumeration of SRAM region identifiers.
+//!
+//! This enumeration holds the identifiers for the SRAM regions that should be checked.
+//! Region identifiers are included before \ref N_RAM_REGIONS, so that it will hold the
+//! total number of regions.
+enum classb_ram_region_identifiers { MY_RAM_REGION, //!< Identifier of the region
+									 N_RAM_REGIONS //!< This will keep the number of regions
+								   };
+
+//! \brief Maximum number of bytes checked in each call to \ref classb_crc_ram_test().
+#define CLASSB_CRC_RAM_SLICE		64
+
+//! \brief Value of \ref classb_crc_ram_failed_region when no region has failed.
+#define CLASSB_CRC_NO_REGION		0xFF
+//@}
+
+/*!
+ *  \internal \brief Data structure for the SRAM regions that are checked.
+ *   The main application has to register the region by calling
+ *   \ref classb_crc_ram_reg_region(). It is that function that sets the values of the structure.
+ */
+struct classb_ram_region {
+	//! \brief Start address of the region.
+	const uint8_t *start;
+	//! \brief Size of the region in bytes. Zero if the region is not registered.
+	uint16_t size;
+	//! \brief Reference checksum of the region.
+	uint16_t reference;
+};
+
+//! \name Global variables
+//@{
+extern volatile uint8_t classb_crc_ram_failed_region;
+//@}
+
+//! \name CRC tests
+//!
+//! \brief Invariant memory tests based on CRC that are compliant with IEC60730 Class B.
+//@{
+void classb_crc_ram_reg_region (enum classb_ram_region_identifiers identifier, const void *start, uint16_t size);
+bool classb_crc_ram_test (void);
+//@}
+
+//@}
+
+#endif
@@ -53,6 +53,7 @@
 
 #include "avr_compiler.h"
 #include "classb_crc.h"
+#include "classb_crc_tables.h"
 
 //! \ingroup classb_crc
 //! 
@@ -64,6 +65,7 @@
 //! methods: 
 //!   - Lookup table: this uses a CRC lookup table to speed up the computations. 
 //!   The lookup table requires 512 (for 16 bit) or 1024 (for 32 bit) bytes of flash memory. 
+//!   The tables are generated at compile time, see \ref classb_crc_tables. 
 //!   - Direct computation: this calculates the checksum for each byte using a polynomial 
 //!   division each time it is called. This version occupies no space in flash memory, 
 //!   but is 3.5-4x slower than lookup table method.
@@ -202,6 +204,61 @@
     crc = PROGMEM_READ_WORD(&table[data]) ^ (crc << 8); \
 }
 
+/*! \internal\brief Update 32-bit CRC value for one input byte.
+ *
+ * \note This macro assumes that the CRC lookup table is located in the lower
+ * 64 kB address range of Flash.
+ *
+ * \param data  Input data byte.
+ * \param crc   Variable that holds the CRC value.
+ * \param table Table that contains pre-calculated CRC values.
+ */
+#define CLASSB_CRC_TABLE_32(data,crc,table) { \
+    data ^= crc >> (32 - 8); \
+    crc = PROGMEM_READ_DWORD(&table[data]) ^ (crc << 8); \
+}
+
+/*! \internal \brief Update 16-bit CRC value for one input byte (reflected polynomial).
+ *
+ * \note This macro assumes that the CRC lookup table is located in the lower
+ * 64 kB address range of Flash.
+ *
+ * \param data  Input data byte.
+ * \param crc   Variable that holds the CRC value.
+ * \param table Table that contains pre-calculated CRC values.
+ */
+#define CLASSB_CRC_REFL_TABLE_16(data,crc,table) { \
+    data ^= crc & 0xFF; \
+    crc = PROGMEM_READ_WORD(&table[data]) ^ (crc >> 8); \
+}
+
+/*! \internal \brief Update 8-bit CRC value for one input byte.
+ *
+ * \note This macro works for both normal and reflected polynomials, and
+ * assumes that the CRC lookup table is located in the lower 64 kB address
+ * range of Flash.
+ *
+ * \param data  Input data byte.
+ * \param crc   Variable that holds the CRC value.
+ * \param table Table that contains pre-calculated CRC values.
+ */
+#define CLASSB_CRC_TABLE_8(data,crc,table) { \
+    data ^= crc; \
+    crc = PROGMEM_READ_BYTE(&table[data]); \
+}
+
+//@}
+
+//! \internal
+//! 
+//! \name Lookup tables
+//@{
+#if defined(CLASSB_CRC_16_BIT) && defined(CRC_USE_16BIT_LOOKUP_TABLE)
+extern const uint16_t PROGMEM_DECLARE( CLASSB_CRC16Table[256] );
+#endif
+#if defined(CLASSB_CRC_32_BIT) && defined(CRC_USE_32BIT_LOOKUP_TABLE)
+extern const uint32_t PROGMEM_DECLARE( CLASSB_CRC32Table[256] );
+#endif
 //@}
 
 //! \name CRC tests
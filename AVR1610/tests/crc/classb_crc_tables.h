@@ -0,0 +1,204 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Macros that generate CRC lookup tables at compile time.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#ifndef __CRC_H_TABLES__
+#define __CRC_H_TABLES__
+
+//! \ingroup classb_crc_sw
+//!
+//! \defgroup classb_crc_tables CRC lookup table generator
+//!
+//! \brief Generate the 256-entry lookup tables for any CRC polynomial at compile time.
+//!
+//! The preprocessor expands \ref CLASSB_CRC_TABLE_INIT() and \ref CLASSB_CRC_REFL_TABLE_INIT()
+//! to the initializer of a lookup table, so the table is computed by the compiler and
+//! can be placed in Flash like any other constant. This is how \c CLASSB_CRC16Table and
+//! \c CLASSB_CRC32Table are defined. Other checksums can be defined in the same way,
+//! for example:
+//!
+//! \code
+//! // CRC-32C (Castagnoli), reflected: use with CLASSB_CRC_REFL_TABLE_32().
+//! CLASSB_CRC_REFL_TABLE_BITS(crc32c_table, 0x82F63B78UL);
+//! const uint32_t PROGMEM_DECLARE( crc32c_table[256] ) = CLASSB_CRC_REFL_TABLE_INIT(crc32c_table, 0x82F63B78UL);
+//! // CRC-16/IBM, reflected: use with CLASSB_CRC_REFL_TABLE_16().
+//! CLASSB_CRC_REFL_TABLE_BITS(crc16_ibm_table, 0xA001);
+//! const uint16_t PROGMEM_DECLARE( crc16_ibm_table[256] ) = CLASSB_CRC_REFL_TABLE_INIT(crc16_ibm_table, 0xA001);
+//! // CRC-8 with polynomial 0x07: use with CLASSB_CRC_TABLE_8().
+//! CLASSB_CRC_TABLE_BITS(crc8_table, 0x07, 8);
+//! const uint8_t PROGMEM_DECLARE( crc8_table[256] ) = CLASSB_CRC_TABLE_INIT(crc8_table, 0x07, 8);
+//! \endcode
+//!
+//! The table only depends on the polynomial, the width and the bit order. The initial
+//! remainder and the final XOR value are applied by the code that uses the table, in
+//! the same way as \ref CRC32_INITIAL_REMAINDER and \ref CRC32_FINAL_XOR_VALUE.
+//!
+//! Each entry is the sum of the remainders of the bits of its index. These are
+//! computed one division step after the other, and whether the polynomial is added
+//! in a step is kept in an enumeration constant that is declared before the table,
+//! so each step only refers to the previous remainder once.
+//!
+//! A table is therefore defined in two steps: \ref CLASSB_CRC_TABLE_BITS() (or
+//! \ref CLASSB_CRC_REFL_TABLE_BITS()) declares the constants, and the initializer
+//! with the same name uses them. The constants are the enumerators \c name_q0 to
+//! \c name_q6 of an anonymous enumeration. They are declared at file scope next to
+//! the table, so the name of each table must be unique in the file and these
+//! identifiers must not be used for anything else.
+//!
+//! \note The polynomial is given in the normal form (e.g. 0x1021) for
+//! \ref CLASSB_CRC_TABLE_INIT() and in the reflected form (e.g. 0xEDB88320) for
+//! \ref CLASSB_CRC_REFL_TABLE_INIT(). The width can be 8 to 32 bits.
+//@{
+
+//! \name Table initializers
+//@{
+
+/*! \brief Declares the constants for the lookup table of a CRC computed MSB first.
+ *
+ * This has to be placed before \ref CLASSB_CRC_TABLE_INIT() with the same arguments.
+ *
+ * \param name    Name of the table, used as prefix of the constants.
+ * \param poly    CRC polynomial in the normal form.
+ * \param crcbits Number of CRC bits.
+ */
+#define CLASSB_CRC_TABLE_BITS(name, poly, crcbits) \
+	enum { \
+		name##_q0 = CLASSB_CRC_GEN_TOP(CLASSB_CRC_GEN_E0(name, poly), crcbits), \
+		name##_q1 = CLASSB_CRC_GEN_TOP(CLASSB_CRC_GEN_E1(name, poly), crcbits), \
+		name##_q2 = CLASSB_CRC_GEN_TOP(CLASSB_CRC_GEN_E2(name, poly), crcbits), \
+		name##_q3 = CLASSB_CRC_GEN_TOP(CLASSB_CRC_GEN_E3(name, poly), crcbits), \
+		name##_q4 = CLASSB_CRC_GEN_TOP(CLASSB_CRC_GEN_E4(name, poly), crcbits), \
+		name##_q5 = CLASSB_CRC_GEN_TOP(CLASSB_CRC_GEN_E5(name, poly), crcbits), \
+		name##_q6 = CLASSB_CRC_GEN_TOP(CLASSB_CRC_GEN_E6(name, poly), crcbits) \
+	}
+
+/*! \brief Initializer for the lookup table of a CRC computed MSB first.
+ *
+ * \param name    Name given to \ref CLASSB_CRC_TABLE_BITS().
+ * \param poly    CRC polynomial in the normal form.
+ * \param crcbits Number of CRC bits.
+ */
+#define CLASSB_CRC_TABLE_INIT(name, poly, crcbits) \
+	{ CLASSB_CRC_GEN_256(CLASSB_CRC_GEN_ENTRY, 0, name, poly, crcbits) }
+
+/*! \brief Declares the constants for the lookup table of a CRC computed LSB first (reflected).
+ *
+ * This has to be placed before \ref CLASSB_CRC_REFL_TABLE_INIT() with the same arguments.
+ *
+ * \param name    Name of the table, used as prefix of the constants.
+ * \param poly    CRC polynomial in the reflected form.
+ */
+#define CLASSB_CRC_REFL_TABLE_BITS(name, poly) \
+	enum { \
+		name##_q0 = (int) (CLASSB_CRC_GEN_REFL_E0(name, poly) & 1UL), \
+		name##_q1 = (int) (CLASSB_CRC_GEN_REFL_E1(name, poly) & 1UL), \
+		name##_q2 = (int) (CLASSB_CRC_GEN_REFL_E2(name, poly) & 1UL), \
+		name##_q3 = (int) (CLASSB_CRC_GEN_REFL_E3(name, poly) & 1UL), \
+		name##_q4 = (int) (CLASSB_CRC_GEN_REFL_E4(name, poly) & 1UL), \
+		name##_q5 = (int) (CLASSB_CRC_GEN_REFL_E5(name, poly) & 1UL), \
+		name##_q6 = (int) (CLASSB_CRC_GEN_REFL_E6(name, poly) & 1UL) \
+	}
+
+/*! \brief Initializer for the lookup table of a CRC computed LSB first (reflected).
+ *
+ * \param name    Name given to \ref CLASSB_CRC_REFL_TABLE_BITS().
+ * \param poly    CRC polynomial in the reflected form.
+ */
+#define CLASSB_CRC_REFL_TABLE_INIT(name, poly) \
+	{ CLASSB_CRC_GEN_256(CLASSB_CRC_GEN_REFL_ENTRY, 0, name, poly, 0) }
+//@}
+
+
+//! \internal
+//! \name Internal macros for the table generator
+//@{
+
+//! \internal \brief Mask with the \c crcbits least significant bits set.
+#define CLASSB_CRC_GEN_MASK(crcbits)	(0xFFFFFFFFUL >> (32 - (crcbits)))
+
+//! \internal \brief Most significant bit of a remainder, as an \c int.
+#define CLASSB_CRC_GEN_TOP(rem, crcbits)	((int) (((rem) >> ((crcbits) - 1)) & 1UL))
+
+//! \internal \name Remainders of the bits of a byte, MSB first.
+//!
+//! \c E<i> is the remainder of bit \c i of the input byte. The bits above the CRC
+//! width are removed when the entry is masked. The polynomial is added in step
+//! \c i if \c name_q<i> is set.
+//@{
+#define CLASSB_CRC_GEN_E0(name, poly)	((unsigned long)(poly))
+#define CLASSB_CRC_GEN_E1(name, poly)	((CLASSB_CRC_GEN_E0(name, poly) << 1) ^ ((unsigned long)(poly) * name##_q0))
+#define CLASSB_CRC_GEN_E2(name, poly)	((CLASSB_CRC_GEN_E1(name, poly) << 1) ^ ((unsigned long)(poly) * name##_q1))
+#define CLASSB_CRC_GEN_E3(name, poly)	((CLASSB_CRC_GEN_E2(name, poly) << 1) ^ ((unsigned long)(poly) * name##_q2))
+#define CLASSB_CRC_GEN_E4(name, poly)	((CLASSB_CRC_GEN_E3(name, poly) << 1) ^ ((unsigned long)(poly) * name##_q3))
+#define CLASSB_CRC_GEN_E5(name, poly)	((CLASSB_CRC_GEN_E4(name, poly) << 1) ^ ((unsigned long)(poly) * name##_q4))
+#define CLASSB_CRC_GEN_E6(name, poly)	((CLASSB_CRC_GEN_E5(name, poly) << 1) ^ ((unsigned long)(poly) * name##_q5))
+#define CLASSB_CRC_GEN_E7(name, poly)	((CLASSB_CRC_GEN_E6(name, poly) << 1) ^ ((unsigned long)(poly) * name##_q6))
+//@}
+
+//! \internal \name Remainders of the bits of a byte, LSB first.
+//!
+//! \c REFL_E<i> is the remainder of bit <tt>7-i</tt> of the input byte.
+//@{
+#define CLASSB_CRC_GEN_REFL_E0(name, poly)	((unsigned long)(poly))
+#define CLASSB_CRC_GEN_REFL_E1(name, poly)	((CLASSB_CRC_GEN_REFL_E0(name, poly) >> 1) ^ ((unsigned long)(poly) * name##_q0))
+#define CLASSB_CRC_GEN_REFL_E2(name, poly)	((CLASSB_CRC_GEN_REFL_E1(name, poly) >> 1) ^ ((unsigned long)(poly) * name##_q1))
+#define CLASSB_CRC_GEN_REFL_E3(name, poly)	((CLASSB_CRC_GEN_REFL_E2(name, poly) >> 1) ^ ((unsigned long)(poly) * name##_q2))
+#define CLASSB_CRC_GEN_REFL_E4(name, poly)	((CLASSB_CRC_GEN_REFL_E3(name, poly) >> 1) ^ ((unsigned long)(poly) * name##_q3))
+#define CLASSB_CRC_GEN_REFL_E5(name, poly)	((CLASSB_CRC_GEN_REFL_E4(name, poly) >> 1) ^ ((unsigned long)(poly) * name##_q4))
+#define CLASSB_CRC_GEN_REFL_E6(name, poly)	((CLASSB_CRC_GEN_REFL_E5(name, poly) >> 1) ^ ((unsigned long)(poly) * name##_q5))
+#define CLASSB_CRC_GEN_REFL_E7(name, poly)	((CLASSB_CRC_GEN_REFL_E6(name, poly) >> 1) ^ ((unsigned long)(poly) * name##_q6))
+//@}
+
+//! \internal \brief Remainder \c rem if bit \c i of \c n is set, otherwise 0.
+#define CLASSB_CRC_GEN_BIT(n, i, rem)	((0UL - (((unsigned long)(n) >> (i)) & 1UL)) & (rem))
+
+//! \internal \brief Table entry for input byte \c n, MSB first.
+#define CLASSB_CRC_GEN_ENTRY(n, name, poly, crcbits) \
+	( ( CLASSB_CRC_GEN_BIT(n, 0, CLASSB_CRC_GEN_E0(name, poly)) ^ CLASSB_CRC_GEN_BIT(n, 1, CLASSB_CRC_GEN_E1(name, poly)) ^ \
+	CLASSB_CRC_GEN_BIT(n, 2, CLASSB_CRC_GEN_E2(name, poly)) ^ CLASSB_CRC_GEN_BIT(n, 3, CLASSB_CRC_GEN_E3(name, poly)) ^ \
+	CLASSB_CRC_GEN_BIT(n, 4, CLASSB_CRC_GEN_E4(name, poly)) ^ CLASSB_CRC_GEN_BIT(n, 5, CLASSB_CRC_GEN_E5(name, poly)) ^ \
+	CLASSB_CRC_GEN_BIT(n, 6, CLASSB_CRC_GEN_E6(name, poly)) ^ CLASSB_CRC_GEN_BIT(n, 7, CLASSB_CRC_GEN_E7(name, poly)) ) \
+	& CLASSB_CRC_GEN_MASK(crcbits) )
+
+//! \internal \brief Table entry for input byte \c n, LSB first.
+#define CLASSB_CRC_GEN_REFL_ENTRY(n, name, poly, crcbits) \
+	( CLASSB_CRC_GEN_BIT(n, 7, CLASSB_CRC_GEN_REFL_E0(name, poly)) ^ CLASSB_CRC_GEN_BIT(n, 6, CLASSB_CRC_GEN_REFL_E1(name, poly)) ^ \
+	CLASSB_CRC_GEN_BIT(n, 5, CLASSB_CRC_GEN_REFL_E2(name, poly)) ^ CLASSB_CRC_GEN_BIT(n, 4, CLASSB_CRC_GEN_REFL_E3(name, poly)) ^ \
+	CLASSB_CRC_GEN_BIT(n, 3, CLASSB_CRC_GEN_REFL_E4(name, poly)) ^ CLASSB_CRC_GEN_BIT(n, 2, CLASSB_CRC_GEN_REFL_E5(name, poly)) ^ \
+	CLASSB_CRC_GEN_BIT(n, 1, CLASSB_CRC_GEN_REFL_E6(name, poly)) ^ CLASSB_CRC_GEN_BIT(n, 0, CLASSB_CRC_GEN_REFL_E7(name, poly)) )
+
+//! \internal \brief Entries \c n to <tt>n+3</tt>.
+#define CLASSB_CRC_GEN_4(entry, n, name, poly, crcbits) \
+	entry((n), name, poly, crcbits), entry((n) + 1, name, poly, crcbits), \
+	entry((n) + 2, name, poly, crcbits), entry((n) + 3, name, poly, crcbits)
+
+//! \internal \brief Entries \c n to <tt>n+15</tt>.
+#define CLASSB_CRC_GEN_16(entry, n, name, poly, crcbits) \
+	CLASSB_CRC_GEN_4(entry, (n), name, poly, crcbits), CLASSB_CRC_GEN_4(entry, (n) + 4, name, poly, crcbits), \
+	CLASSB_CRC_GEN_4(entry, (n) + 8, name, poly, crcbits), CLASSB_CRC_GEN_4(entry, (n) + 12, name, poly, crcbits)
+
+//! \internal \brief Entries \c n to <tt>n+63</tt>.
+#define CLASSB_CRC_GEN_64(entry, n, name, poly, crcbits) \
+	CLASSB_CRC_GEN_16(entry, (n), name, poly, crcbits), CLASSB_CRC_GEN_16(entry, (n) + 16, name, poly, crcbits), \
+	CLASSB_CRC_GEN_16(entry, (n) + 32, name, poly, crcbits), CLASSB_CRC_GEN_16(entry, (n) + 48, name, poly, crcbits)
+
+//! \internal \brief Entries \c n to <tt>n+255</tt>.
+#define CLASSB_CRC_GEN_256(entry, n, name, poly, crcbits) \
+	CLASSB_CRC_GEN_64(entry, (n), name, poly, crcbits), CLASSB_CRC_GEN_64(entry, (n) + 64, name, poly, crcbits), \
+	CLASSB_CRC_GEN_64(entry, (n) + 128, name, poly, crcbits), CLASSB_CRC_GEN_64(entry, (n) + 192, name, poly, crcbits)
+//@}
+
+//@}
+
+#endif
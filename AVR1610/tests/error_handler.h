@@ -89,12 +89,16 @@ NO_INIT extern volatile uint8_t classb_error;
 #define CLASSB_ERROR_HANDLER_CRC() do{classb_error = 1;}while(0)
 //! Error handler for the CPU frequency test
 #define CLASSB_ERROR_HANDLER_FREQ() do{classb_error = 1;}while(0)
+//! Error handler for the clock domain monitor
+#define CLASSB_ERROR_HANDLER_CLKMON() do{classb_error = 1;}while(0)
 //! Error handler for the interrupt monitor 
 #define CLASSB_ERROR_HANDLER_INTERRUPT() do{classb_error = 1;}while(0)
 //! Error handler for the CPU registers test 
 #define CLASSB_ERROR_HANDLER_REGISTERS() do{classb_error = 1;}while(0)
 //! Error handler for the SRAM test	
 #define CLASSB_ERROR_HANDLER_SRAM() do{classb_error = 1;}while(0)
+//! Error handler for a test that the scheduler could not complete within its period
+#define CLASSB_ERROR_HANDLER_SCHED() do{classb_error = 1;}while(0)
 //! Error handler for watchdog timer test 	
 #define CLASSB_ERROR_HANDLER_WDT() do{}while(1)
 //@}
@@ -118,6 +122,9 @@ NO_INIT extern volatile uint8_t classb_error;
 //! Configurable actions in the RTC interrupt.
 #define CLASSB_ACTIONS_RTC() ;	
 
+//! Configurable actions when a slice of a scheduled test takes longer than its budget.
+#define CLASSB_ACTIONS_SCHED_OVERRUN() do{}while(0)
+
 //! First group of configurable actions in the watchdog timer test.
 #define CLASSB_ACTIONS_WDT_RUNTIME_FAILURE() \
 		do{\
@@ -0,0 +1,129 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Monitor of several clock domains against the RTC.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#include "classb_clock_monitor.h"
+
+//! \ingroup clock_monitor
+//@{
+
+//! \internal \brief Entry of \ref CLASSB_CLKMON_TABLE for \ref clkmon_references.
+#define CLKMON_REFERENCE(identifier, port, module, channel, source, frequency, tolerance) \
+	(uint16_t) CLASSB_CLKMON_COUNT(frequency),
+
+//! \internal \brief Entry of \ref CLASSB_CLKMON_TABLE for \ref clkmon_limits.
+#define CLKMON_LIMIT(identifier, port, module, channel, source, frequency, tolerance) \
+	(uint16_t) CLASSB_CLKMON_LIMIT(frequency, tolerance),
+
+//! \internal \brief Entry of \ref CLASSB_CLKMON_TABLE that fails to compile if the count does not fit in the TC.
+#define CLKMON_FITS(identifier, port, module, channel, source, frequency, tolerance) \
+	typedef char LABEL(clkmon_fits_, identifier,)[(CLASSB_CLKMON_COUNT(frequency) + \
+			CLASSB_CLKMON_LIMIT(frequency, tolerance) <= 0xFFFFUL) ? 1 : -1];
+
+//! \internal \brief Entry of \ref CLASSB_CLKMON_TABLE for \ref classb_clkmon_setup().
+//!
+//! The TC is clocked by the event channel of the clock, and captures its count in
+//! channel A on the RTC event.
+#define CLKMON_SETUP(identifier, port, module, channel, source, frequency, tolerance) \
+	LABEL(TC, port, module).CTRLA = TC_CLKSEL_OFF_gc; \
+	LABEL(TC, port, module).PER = 0xFFFF; \
+	LABEL(TC, port, module).CNT = 0; \
+	EVSYS.LABEL(CH, channel, MUX) = (source); \
+	LABEL(TC, port, module).CTRLB = LABEL(TC, module, _CCAEN_bm); \
+	LABEL(TC, port, module).CTRLD = TC_EVACT_CAPT_gc | CLASSB_CLKMON_EVSEL_gc; \
+	LABEL(TC, port, module).CTRLA = LABEL(TC_CLKSEL_EVCH, channel, _gc);
+
+//! \internal \brief Entry of \ref CLASSB_CLKMON_TABLE for \ref classb_clkmon_callback().
+//!
+//! The capture flag is read first, since reading the capture clears it.
+#define CLKMON_CHECK(identifier, port, module, channel, source, frequency, tolerance) \
+	flags = LABEL(TC, port, module).INTFLAGS; \
+	clkmon_check(identifier, flags & LABEL(TC, module, _CCAIF_bm), LABEL(TC, port, module).CCA);
+
+CLASSB_CLKMON_TABLE(CLKMON_FITS)
+
+//! \internal \brief Expected count of each clock within an RTC period.
+static const uint16_t PROGMEM_DECLARE( clkmon_references[N_CLKMON_CLOCKS] ) = { CLASSB_CLKMON_TABLE(CLKMON_REFERENCE) };
+
+//! \internal \brief Limit for the deviation of the count of each clock.
+static const uint16_t PROGMEM_DECLARE( clkmon_limits[N_CLKMON_CLOCKS] ) = { CLASSB_CLKMON_TABLE(CLKMON_LIMIT) };
+
+//! \brief Count of each clock in the last RTC period.
+uint16_t classb_clkmon_counts[N_CLKMON_CLOCKS];
+
+//! \internal \brief Capture of each clock at the end of the last RTC period.
+static uint16_t clkmon_last[N_CLKMON_CLOCKS];
+
+//! \internal \brief The first captures have been taken, so the next ones can be checked.
+static bool clkmon_started = false;
+
+
+/*! \brief Sets up the TCs and the event channels of the clocks.
+ *
+ * This should be called from the main application before \ref classb_rtc_setup().
+ */
+void classb_clkmon_setup(void)
+{
+	EVSYS.CLASSB_CLKMON_EVCH_RTC_MUX = EVSYS_CHMUX_RTC_CMP_gc;
+
+	CLASSB_CLKMON_TABLE(CLKMON_SETUP)
+
+	clkmon_started = false;
+}
+
+
+/*! \internal \brief Checks the capture of a clock.
+ *
+ * \param i			Clock identifier.
+ * \param captured	The capture flag of the TC was set.
+ * \param capture	The count captured at the end of the RTC period.
+ */
+static inline void clkmon_check(uint8_t i, uint8_t captured, uint16_t capture)
+{
+	uint16_t count = capture - clkmon_last[i];
+	uint16_t reference = PROGMEM_READ_WORD(&clkmon_references[i]);
+
+	clkmon_last[i] = capture;
+	if (!clkmon_started)
+		return;
+
+	classb_clkmon_counts[i] = count;
+
+	// There is an error if the RTC event did not reach the TC, or if the count
+	// is not within the allowed range.
+	count = (count > reference) ? (count - reference) : (reference - count);
+	if (!captured || count > PROGMEM_READ_WORD(&clkmon_limits[i]))
+		CLASSB_ERROR_HANDLER_CLKMON();
+}
+
+
+/*! \brief The clock domain monitor.
+ *
+ * For each clock in \ref CLASSB_CLKMON_TABLE, this compares the count captured in
+ * the last RTC period with the reference.
+ *
+ * \note This should be called back from the RTC interrupt. See \ref rtc_driver.
+ *
+ * \callergraph
+ */
+void classb_clkmon_callback(void)
+{
+	uint8_t flags;
+
+	CLASSB_CLKMON_TABLE(CLKMON_CHECK)
+
+	clkmon_started = true;
+}
+
+//@}
@@ -0,0 +1,126 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Settings and definitions for the monitor of several clock domains.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#ifndef CLASSB_CLOCK_MONITOR_H_
+#define CLASSB_CLOCK_MONITOR_H_
+
+#include "avr_compiler.h"
+#include "classb_rtc_common.h"
+#include "error_handler.h"
+
+
+//! \defgroup clock_monitor Clock Domain Monitor
+//!
+//! \brief A test for the frequency of several clocks at once.
+//!
+//! The CPU frequency test, \ref cpu_freq, checks the CPU clock against the RTC.
+//! This monitor checks any number of clock domains against the same RTC period,
+//! e.g. the peripheral clock from the PLL, or an external clock that reaches a pin,
+//! such as a crystal oscillator that times a USART.
+//!
+//! Each clock domain has its own 16-bit TC, clocked by an event channel whose source
+//! is the clock, e.g. a prescaler of the peripheral clock or a port pin. The RTC
+//! compare match event captures all the TCs at the same time, so they are measured
+//! over exactly the same window. \ref classb_clkmon_callback() is then called from
+//! the RTC interrupt, and only reads the captures and compares the difference from
+//! the last ones with the reference of each clock. There are no other interrupts.
+//!
+//! In order to monitor a clock, the following steps should be followed:
+//!   -# Declare the clock in \ref CLASSB_CLKMON_TABLE.
+//!   -# \ref CLASSB_CLOCK_MON is defined, so that the RTC interrupt calls the
+//!   monitor. See \ref rtc_driver.
+//!   -# The main application calls \ref classb_clkmon_setup() and then
+//!   \ref classb_rtc_setup().
+//!
+//! The first RTC period after the setup is not checked. The count of each clock in
+//! the last period is kept in \ref classb_clkmon_counts.
+//!
+//! The error handler related to this test is CLASSB_ERROR_HANDLER_CLKMON().
+//!
+//@{
+
+//! \defgroup clkmon_conf Settings
+//! \brief Settings for the clock domain monitor
+//@{
+
+//! \brief Table of the clock domains that are monitored.
+//!
+//! Each entry is <tt>X(identifier, port, module, channel, source, frequency, tolerance)</tt>:
+//!   - \c identifier is added to \ref classb_clkmon_identifiers.
+//!   - \c port and \c module select the TC that counts the clock, e.g. D and 0 -> TCD0.
+//!   It must not be a TC used by another test.
+//!   - \c channel is the event channel, 0 to 7, that clocks the TC.
+//!   - \c source is the multiplexer setting of the event channel, e.g.
+//!   \c EVSYS_CHMUX_PRESCALER_1024_gc or \c EVSYS_CHMUX_PORTD_PIN0_gc.
+//!   - \c frequency is the expected frequency of the events (Hz).
+//!   - \c tolerance is the allowed deviation (%) of the count with respect to the
+//!   reference.
+//!
+//! The reference and the limit of each clock are computed by the compiler. The
+//! reference plus the limit must fit in 16 bits, i.e. the events should be slower than
+//! <tt>65535 * CLASSB_RTC_FREQ / CLASSB_RTC_INT_PERIOD</tt> Hz, which is checked at
+//! compile time.
+#define CLASSB_CLKMON_TABLE(X) \
+	X(CLKMON_PER, D, 0, 0, EVSYS_CHMUX_PRESCALER_1024_gc, F_CPU / 1024UL, 10)
+
+//! \brief Event channel for the RTC compare match, 0 to 7.
+//!
+//! This may be the same channel as \ref CLASSB_FREQ_EVCH_RTC.
+#define CLASSB_CLKMON_EVCH_RTC		6
+
+//@}
+
+//! \internal \defgroup clkmon_int_conf Internal settings
+//!
+//! \brief This constants should not be modified.
+//@{
+
+//! \internal \brief Expected count within an RTC period of events with frequency \c f (Hz).
+#define CLASSB_CLKMON_COUNT(f)		((1UL * (f) * CLASSB_RTC_INT_PERIOD) / CLASSB_RTC_FREQ)
+
+//! \internal \brief Limit for the deviation of the count, for \c f (Hz) and \c tol (%).
+#define CLASSB_CLKMON_LIMIT(f, tol)	((CLASSB_CLKMON_COUNT(f) * (tol)) / 100UL)
+
+//! \internal \brief Label for the multiplexer register of the RTC event channel
+#define CLASSB_CLKMON_EVCH_RTC_MUX	LABEL(CH, CLASSB_CLKMON_EVCH_RTC, MUX)
+
+//! \internal \brief Label for the event selection of the captures
+#define CLASSB_CLKMON_EVSEL_gc		LABEL(TC_EVSEL_CH, CLASSB_CLKMON_EVCH_RTC, _gc)
+
+//! \internal \brief Entry of \ref CLASSB_CLKMON_TABLE for \ref classb_clkmon_identifiers.
+#define CLASSB_CLKMON_ID(identifier, port, module, channel, source, frequency, tolerance)	identifier,
+
+//@}
+
+//! \brief Enumeration of clock domain identifiers.
+enum classb_clkmon_identifiers { CLASSB_CLKMON_TABLE(CLASSB_CLKMON_ID)
+								 N_CLKMON_CLOCKS //!< This will keep the number of clock domains
+							   };
+
+//! \name Global variables
+//@{
+extern uint16_t classb_clkmon_counts[N_CLKMON_CLOCKS];
+//@}
+
+//! \defgroup clkmon_func Functions
+//! \brief Functions related to the clock domain monitor
+//@{
+void classb_clkmon_setup( void );
+void classb_clkmon_callback( void );
+//@}
+
+//@}
+
+#endif /* CLASSB_CLOCK_MONITOR_H_ */
@@ -51,16 +51,117 @@
 
 #include "avr_compiler.h"
 #include "classb_freq.h"
+#include "classb_profile.h"
 
 //! \addtogroup cpu_freq
 //@{
 
+#ifdef CLASSB_FREQ_CASCADE
+
+//! \internal \brief The 32-bit count at the last capture.
+static uint32_t classb_freq_last = 0;
+
+//! \internal \brief The first capture has been taken, so the next one can be checked.
+static bool classb_freq_started = false;
+
+#else
+
 //! \internal \brief This counts the number of TC overflows. 
 //! This variable is used to keep the MSW (bits 31 to 16) of the TC count.
 volatile uint16_t classb_tc_ovf_cnt = 0;
 
+#endif
+
+//@}
+
+#ifdef CLASSB_FREQ_CASCADE
+
+//! \brief This sets up the TCs that are used in the frequency test.
+//!	The overflows of the first TC clock the second one, and the RTC compare event 
+//!	captures both of them.
+void classb_freq_setup_timer() 
+{
+	CLASSB_TEST_TC.CTRLA = TC_CLKSEL_OFF_gc;
+	CLASSB_FREQ_HI_TC.CTRLA = TC_CLKSEL_OFF_gc;
+	CLASSB_TEST_TC.PER = CLASSB_TC_PER;
+	CLASSB_FREQ_HI_TC.PER = 0xFFFF;
+	CLASSB_TEST_TC.CNT = 0;
+	CLASSB_FREQ_HI_TC.CNT = 0;
+
+	// Route the overflows of the first TC and the RTC compare match to the event channels.
+	EVSYS.CLASSB_FREQ_EVCH_OVF_MUX = CLASSB_FREQ_EVCH_OVF_gc;
+	EVSYS.CLASSB_FREQ_EVCH_RTC_MUX = EVSYS_CHMUX_RTC_CMP_gc;
+
+	// Capture both TCs in channel A on the RTC event. The capture of the second TC is 
+	// delayed by one cycle, so that it includes an overflow of the first one in the 
+	// same cycle.
+	CLASSB_TEST_TC.CTRLB = CLASSB_TEST_TC_CCAEN_bm;
+	CLASSB_TEST_TC.CTRLD = TC_EVACT_CAPT_gc | CLASSB_FREQ_EVSEL_gc;
+	CLASSB_FREQ_HI_TC.CTRLB = CLASSB_FREQ_HI_TC_CCAEN_bm;
+	CLASSB_FREQ_HI_TC.CTRLD = TC_EVACT_CAPT_gc | CLASSB_FREQ_EVSEL_gc | CLASSB_FREQ_HI_TC_EVDLY_bm;
+
+	// Limit for the number of overflows before the first RTC interrupt.
+	CLASSB_FREQ_HI_TC.CCB = CLASSB_COUNT_OVF_MAX + 1;
+	CLASSB_FREQ_HI_TC.INTCTRLB = TC_CCBINTLVL_LO_gc;
+
+	classb_freq_started = false;
+
+	// Start the TCs, the second one with the overflows of the first one.
+	CLASSB_FREQ_HI_TC.CTRLA = CLASSB_FREQ_HI_CLKSEL_gc;
+	CLASSB_TEST_TC.CTRLA = CLASSB_TC_PRESCALER_gc;
+}
+
+//! \brief This is called back from the RTC interrupt.
+//!
+//! This function reads the 32-bit count captured on the RTC compare event, and 
+//! calculates the difference between the count in the last RTC period and the 
+//! predefined reference. The error handler would be called if the relative 
+//! difference should be higher than the tolerance, or if there was no capture.
+void classb_freq_callback() 
+{
+	uint16_t high;
+	uint32_t count, tccount;
+
+	CLASSB_PROFILE_BEGIN(PROFILE_FREQ_CALLBACK);
+
+	// The capture flag is set by the RTC event, and cleared when the capture is read.
+	if (!(CLASSB_TEST_TC.INTFLAGS & CLASSB_TEST_TC_CCAIF_bm))
+		CLASSB_ERROR_HANDLER_FREQ();
+
+	high = CLASSB_FREQ_HI_TC.CCA;
+	count = ((uint32_t) high << 16) | CLASSB_TEST_TC.CCA;
+
+	// Move the limit for the number of overflows to the next RTC period.
+	CLASSB_FREQ_HI_TC.CCB = high + CLASSB_COUNT_OVF_MAX + 1;
+
+	if (classb_freq_started) {
+		// Compute the absolute difference between reference and count in the last period.
+		tccount = count - classb_freq_last;
+		tccount = (tccount > CLASSB_TC_COUNT_REF)?(tccount-CLASSB_TC_COUNT_REF):(CLASSB_TC_COUNT_REF-tccount);
+
+		// If the difference was larger than expected, the error should be handled 
+		if (tccount > CLASSB_MAX_DIF)
+			CLASSB_ERROR_HANDLER_FREQ();
+	}
+	classb_freq_last = count;
+	classb_freq_started = true;
+
+	CLASSB_PROFILE_END(PROFILE_FREQ_CALLBACK);
+}
+
+//! \addtogroup func_freq
+//@{
+//! \brief Compare B interrupt of the TC with the high word.
+//! The compare value is moved forward in every RTC interrupt, so this only runs 
+//! if the RTC interrupt is too slow, and the error handler is called.
+ISR(CLASSB_FREQ_HI_TC_CCB_vect) 
+{	
+	CLASSB_ERROR_HANDLER_FREQ();
+}
 //@}
 
+#else
+
 //! \brief This sets up the TC that is used in the frequency test.
 //!	This configures the period, prescaler and overflow interrupt. 
 void classb_freq_setup_timer() 
@@ -85,6 +186,7 @@ void classb_freq_setup_timer()
 //! difference should be higher than the tolerance.
 void classb_freq_callback() 
 {
+	CLASSB_PROFILE_BEGIN(PROFILE_FREQ_CALLBACK);
 	// Read the count in the TC and include the overflow counter as MSB
 	volatile uint32_t tccount = CLASSB_TEST_TC.CNT;		
 	tccount |= ((uint32_t)classb_tc_ovf_cnt) << 16;
@@ -101,6 +203,8 @@ void classb_freq_callback()
 	
 	// Reset TC
 	CLASSB_TEST_TC.CNT = 0;
+
+	CLASSB_PROFILE_END(PROFILE_FREQ_CALLBACK);
 }
 
 //! \addtogroup func_freq
@@ -119,4 +223,6 @@ ISR(CLASSB_TEST_TC_OVF_vect)
 	if ( classb_tc_ovf_cnt++ >= CLASSB_COUNT_OVF_MAX )
 		CLASSB_ERROR_HANDLER_FREQ();
 }
-//@}
\ No newline at end of file
+//@}
+
+#endif
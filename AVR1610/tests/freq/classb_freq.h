@@ -80,6 +80,14 @@
 //!  If this was exceeded, the program would assume that the RTC was not 
 //!  working correctly and the error handler would be called as well.
 //! 
+//!  If \ref CLASSB_FREQ_CASCADE is defined, a second TC, \ref CLASSB_FREQ_HI_TC_PORT, 
+//!  counts the overflows of the first one through the event system instead, so that 
+//!  together they make a 32-bit counter that is never reset. The RTC compare event 
+//!  captures both TCs at the same time, and \ref classb_freq_callback() compares the 
+//!  difference between the last two captures with the reference. There is no overflow 
+//!  interrupt. The limit for the number of overflows is a compare on the second TC, 
+//!  moved forward in every callback, so its interrupt only runs if the RTC fails.
+//! 
 //!  The test is flexible and it is possible to choose some settings for the 
 //!  TC and RTC. However, it is important to choose values for \ref CLASSB_RTC_INT_PERIOD, 
 //!  \ref CLASSB_RTC_FREQ, \ref CLASSB_TC_PRESCALER and \ref CLASSB_TOLERANCE so that the frequency of 
@@ -127,6 +135,30 @@
 //! and expected CPU, e.g. 25 -> 25%.
 #define CLASSB_TOLERANCE			25UL
 
+#ifdef __DOXYGEN__
+ //! \brief Count with two TCs cascaded through the event system.
+ //!
+ //! This symbol can be defined at the compiler level or in this file.
+ #define CLASSB_FREQ_CASCADE
+#else
+ //#define CLASSB_FREQ_CASCADE
+#endif
+
+//! \brief Port of the TC with the high word of the count, e.g. F -> TCF0.
+//!
+//! This is only used if \ref CLASSB_FREQ_CASCADE is defined. It must not be a TC 
+//! used by the scheduler, the profiling or the statistics of the interrupt monitor.
+#define CLASSB_FREQ_HI_TC_PORT		F
+
+//! \brief Module of the TC with the high word of the count, e.g. 0 -> TCF0.
+#define CLASSB_FREQ_HI_TC_MOD		0
+
+//! \brief Event channel for the overflows of the first TC, 0 to 7.
+#define CLASSB_FREQ_EVCH_OVF		5
+
+//! \brief Event channel for the RTC compare match, 0 to 7.
+#define CLASSB_FREQ_EVCH_RTC		6
+
 //@}
 
 
@@ -176,6 +208,39 @@
 //! would be assumed to be faulty and the error handler would be called. 
 #define CLASSB_COUNT_OVF_MAX		(uint16_t)  ( ( CLASSB_TC_COUNT_REF + CLASSB_MAX_DIF )>> 16)
 
+//! \internal \brief Label for the capture flag of the TC
+#define CLASSB_TEST_TC_CCAIF_bm		LABEL(TC, CLASSB_TC_MOD, _CCAIF_bm)
+
+//! \internal \brief Label for the capture enable of the TC
+#define CLASSB_TEST_TC_CCAEN_bm		LABEL(TC, CLASSB_TC_MOD, _CCAEN_bm)
+
+//! \internal \brief Label for the TC with the high word of the count
+#define CLASSB_FREQ_HI_TC			LABEL(TC, CLASSB_FREQ_HI_TC_PORT, CLASSB_FREQ_HI_TC_MOD)
+
+//! \internal \brief Label for the compare B interrupt vector of the TC with the high word
+#define CLASSB_FREQ_HI_TC_CCB_vect	LABEL(TC, CLASSB_FREQ_HI_TC_PORT, LABEL(CLASSB_FREQ_HI_TC_MOD, _CCB_vect,))
+
+//! \internal \brief Label for the capture enable of the TC with the high word
+#define CLASSB_FREQ_HI_TC_CCAEN_bm	LABEL(TC, CLASSB_FREQ_HI_TC_MOD, _CCAEN_bm)
+
+//! \internal \brief Label for the event delay of the TC with the high word
+#define CLASSB_FREQ_HI_TC_EVDLY_bm	LABEL(TC, CLASSB_FREQ_HI_TC_MOD, _EVDLY_bm)
+
+//! \internal \brief Label for the clock selection of the TC with the high word
+#define CLASSB_FREQ_HI_CLKSEL_gc	LABEL(TC_CLKSEL_EVCH, CLASSB_FREQ_EVCH_OVF, _gc)
+
+//! \internal \brief Label for the multiplexer register of the overflow event channel
+#define CLASSB_FREQ_EVCH_OVF_MUX	LABEL(CH, CLASSB_FREQ_EVCH_OVF, MUX)
+
+//! \internal \brief Label for the overflow event of the first TC
+#define CLASSB_FREQ_EVCH_OVF_gc		LABEL(EVSYS_CHMUX_TCC, CLASSB_TC_MOD, _OVF_gc)
+
+//! \internal \brief Label for the multiplexer register of the RTC event channel
+#define CLASSB_FREQ_EVCH_RTC_MUX	LABEL(CH, CLASSB_FREQ_EVCH_RTC, MUX)
+
+//! \internal \brief Label for the event selection of the captures
+#define CLASSB_FREQ_EVSEL_gc		LABEL(TC_EVSEL_CH, CLASSB_FREQ_EVCH_RTC, _gc)
+
 //@}
 
 
@@ -52,51 +52,26 @@
 
 
 #include "classb_interrupt_monitor.h"
+#include "classb_profile.h"
 
-//! \brief Array of data structures for the interrupts that should be monitored
-struct intmon_interrupt monitored_interrupts[N_INTERRUPTS];
+//! \internal \brief Entry of \ref CLASSB_INTMON_TABLE for \ref classb_intmon_n.
+#define INTMON_REFERENCE(identifier, reference, tolerance)	(reference),
 
+//! \internal \brief Entry of \ref CLASSB_INTMON_TABLE for \ref classb_intmon_l.
+#define INTMON_LIMIT(identifier, reference, tolerance)	(uint16_t) ((1UL * (reference) * (tolerance)) / 100),
 
-/** \brief Registers an interrupt. 
- * 
- * This function registers the information that the monitor needs in order to 
- * check an interrupt. It should be called from the main application. Interrupts 
- * must be declared in \ref classb_int_identifiers in the configuration file. 
- * Note that by default the interrupt is not active for monitoring, i.e. the 
- * state is \c OFF.
- *
- *  \param identifier	Interrupt identifier. Use symbol declared in \ref classb_int_identifiers
- *  \param reference	Number of expected executions for the interrupt within an RTC period: 
- *						<tt>F_INT (Hz) * CLASSB_RTC_INT_PERIOD / CLASSB_RTC_FREQ (Hz) </tt>
- *  \param tolerance	The allowed deviation (%) with respect to interrupt_counter for the interrupt counter.
- *	\callergraph
- */
-void classb_intmon_reg_int(enum classb_int_identifiers identifier, uint16_t reference, uint8_t tolerance) 
-{
-	
-	monitored_interrupts[identifier].n = reference;
-	monitored_interrupts[identifier].c = 0;
-	monitored_interrupts[identifier].l = (reference * tolerance) / 100;
-	monitored_interrupts[identifier].s = OFF;	
-	
-}
+//! \internal \brief Entry of \ref CLASSB_INTMON_TABLE for \ref classb_intmon_s.
+#define INTMON_STATE(identifier, reference, tolerance)	OFF,
 
-/*! \brief Increases the interrupt counter of the specified interrupt.
- *
- *  This is called from the interrupt routine and it will increases the counter 
- *  if the interrupt is \c ON.
- *
- *  \param identifier	Interrupt identifier. Use symbol declared in \ref classb_int_identifiers 
- *
- *	\callergraph
- */
-void classb_intmon_increase( enum classb_int_identifiers identifier ) 
-{	
-
-	if (monitored_interrupts[identifier].s == ON)
-		monitored_interrupts[identifier].c++;
+//! \name Interrupt data
+//@{
+const uint16_t PROGMEM_DECLARE( classb_intmon_n[N_INTERRUPTS] ) = { CLASSB_INTMON_TABLE(INTMON_REFERENCE) };
+volatile uint16_t classb_intmon_c[N_INTERRUPTS];
+const uint16_t PROGMEM_DECLARE( classb_intmon_l[N_INTERRUPTS] ) = { CLASSB_INTMON_TABLE(INTMON_LIMIT) };
+volatile uint8_t classb_intmon_s[N_INTERRUPTS] = { CLASSB_INTMON_TABLE(INTMON_STATE) };
+uint8_t classb_intmon_active[CLASSB_INTMON_MAP_SIZE];
+//@}
 
-}
 
 /*! \brief Set a state for the specified interrupt.
  * 
@@ -117,7 +92,7 @@ void classb_intmon_set_state( enum classb_int_identifiers identifier, enum class
 	{
 		case ENABLE:
 #ifdef CLASSB_STRICT
-			if (monitored_interrupts[identifier].s != OFF) 
+			if (classb_intmon_s[identifier] != OFF) 
 			{
 				CLASSB_ERROR_HANDLER_INTERRUPT();
 				break;
@@ -127,7 +102,7 @@ void classb_intmon_set_state( enum classb_int_identifiers identifier, enum class
 
 		case DISABLE:
 #ifdef CLASSB_STRICT
-			if (monitored_interrupts[identifier].s != ON) 
+			if (classb_intmon_s[identifier] != ON) 
 			{
 				CLASSB_ERROR_HANDLER_INTERRUPT();
 				break;
@@ -138,26 +113,294 @@ void classb_intmon_set_state( enum classb_int_identifiers identifier, enum class
 			CLASSB_ERROR_HANDLER_INTERRUPT();
 	}
 	
-	// Set the new state only if CLASSB_CONDITION1_INTERRUPT is true.
-	if(CLASSB_CONDITION1_INTERRUPT)	
-		monitored_interrupts[identifier].s = state;	
+	// Set the new state only if CLASSB_CONDITION1_INTERRUPT is true. The monitor
+	// may change the bitmap from the RTC interrupt, so this is done atomically.
+	if(CLASSB_CONDITION1_INTERRUPT) {
+		ENTER_CRITICAL_REGION();
+		classb_intmon_s[identifier] = state;
+		classb_intmon_active[identifier >> 3] |= 1 << (identifier & 7);
+		LEAVE_CRITICAL_REGION();
+	}
 			
 }
 
 
 
+#ifdef CLASSB_INTMON_STATS
+
+//! \internal \brief Entry of \ref CLASSB_INTMON_TABLE for \ref intmon_names.
+#define INTMON_NAME(identifier, reference, tolerance)	#identifier "\0"
+
+//! \brief Statistics of the rates of the interrupts.
+struct classb_intmon_stats classb_intmon_stats[N_INTERRUPTS];
+
+//! \internal \brief Names of the interrupts for \ref classb_intmon_stats_dump(), each ended by a null.
+static const char PROGMEM_DECLARE( intmon_names[] ) = CLASSB_INTMON_TABLE(INTMON_NAME);
+
+
+/*! \brief Starts the TC that stamps the interrupts and clears the statistics.
+ *
+ * The TC runs freely over its whole 16-bit range.
+ */
+void classb_intmon_stats_setup(void)
+{
+	CLASSB_INTMON_STATS_TC.CTRLA = TC_CLKSEL_OFF_gc;
+	CLASSB_INTMON_STATS_TC.PER = 0xFFFF;
+	CLASSB_INTMON_STATS_TC.CNT = 0;
+	CLASSB_INTMON_STATS_TC.CTRLA = CLASSB_INTMON_STATS_TC_PRESCALER_gc;
+
+	classb_intmon_stats_reset();
+}
+
+
+/*! \brief Clears the statistics of all interrupts.
+ */
+void classb_intmon_stats_reset(void)
+{
+	ENTER_CRITICAL_REGION();
+	for (uint8_t i = 0; i < N_INTERRUPTS; i++) {
+		struct classb_intmon_stats *stats = &classb_intmon_stats[i];
+
+		stats->stamped = false;
+		stats->count_min = 0xFFFF;
+		stats->count_max = 0;
+		stats->gap_min = 0xFFFF;
+		stats->gap_max = 0;
+		for (uint8_t bin = 0; bin < CLASSB_INTMON_STATS_BINS; bin++) {
+			stats->count_hist[bin] = 0;
+			stats->gap_hist[bin] = 0;
+		}
+	}
+	LEAVE_CRITICAL_REGION();
+}
+
+
+/*! \internal \brief Returns the bin of a value in a histogram, i.e. its number of significant bits.
+ *
+ * This takes the same time for every value.
+ */
+static inline uint8_t intmon_stats_bin(uint16_t x)
+{
+	uint8_t bin = 0;
+
+	if (x & 0xFF00) { bin += 8; x >>= 8; }
+	if (x & 0x00F0) { bin += 4; x >>= 4; }
+	if (x & 0x000C) { bin += 2; x >>= 2; }
+	if (x & 0x0002) { bin += 1; x >>= 1; }
+
+	return bin + (uint8_t) x;
+}
+
+
+/*! \internal \brief Records a value in a histogram and in its bounds.
+ */
+static inline void intmon_stats_record(uint16_t x, uint8_t *hist, uint16_t *min, uint16_t *max)
+{
+	uint8_t bin = intmon_stats_bin(x);
+
+	if (hist[bin] != 0xFF)
+		hist[bin]++;
+	if (x < *min)
+		*min = x;
+	if (x > *max)
+		*max = x;
+}
+
+
+/*! \brief Stamps an execution of an interrupt and records the gap since the last one.
+ *
+ * This is called by \ref classb_intmon_increase() and takes the same time for every
+ * execution.
+ *
+ * \param identifier	Interrupt identifier. Use symbol declared in \ref classb_int_identifiers.
+ */
+void classb_intmon_stats_stamp(enum classb_int_identifiers identifier)
+{
+	struct classb_intmon_stats *stats = &classb_intmon_stats[identifier];
+	uint16_t now;
+
+	// The count is read with interrupts disabled since the TEMP register of the TC
+	// is shared with interrupts of other levels.
+	ENTER_CRITICAL_REGION();
+	now = CLASSB_INTMON_STATS_TC.CNT;
+	LEAVE_CRITICAL_REGION();
+
+	if (stats->stamped)
+		intmon_stats_record(now - stats->last, stats->gap_hist, &stats->gap_min, &stats->gap_max);
+	stats->last = now;
+	stats->stamped = true;
+}
+
+
+/*! \brief Copies the statistics of an interrupt.
+ *
+ * Interrupts are disabled during the copy, so that the statistics are consistent.
+ *
+ * \param identifier	Interrupt identifier. Use symbol declared in \ref classb_int_identifiers.
+ * \param stats			Where to copy the statistics.
+ */
+void classb_intmon_stats_get(enum classb_int_identifiers identifier, struct classb_intmon_stats *stats)
+{
+	ENTER_CRITICAL_REGION();
+	*stats = classb_intmon_stats[identifier];
+	LEAVE_CRITICAL_REGION();
+}
+
+
+/*! \internal \brief Writes a space and a number in decimal.
+ */
+static void intmon_stats_put_number(void (*put)(char c), uint16_t x)
+{
+	char digits[5];
+	uint8_t n = 0;
+
+	do {
+		digits[n++] = '0' + x % 10;
+		x /= 10;
+	} while (x);
+
+	put(' ');
+	while (n)
+		put(digits[--n]);
+}
+
+
+/*! \internal \brief Writes a histogram.
+ */
+static void intmon_stats_put_hist(void (*put)(char c), const uint8_t *hist)
+{
+	put(' ');
+	put(':');
+	for (uint8_t bin = 0; bin < CLASSB_INTMON_STATS_BINS; bin++)
+		intmon_stats_put_number(put, hist[bin]);
+}
+
+
+/*! \brief Writes the statistics of all interrupts as text.
+ *
+ * There is one line per interrupt, in the order of \ref classb_int_identifiers:
+ * \verbatim <name> <count_min> <count_max> <gap_min> <gap_max> : <count_hist> : <gap_hist> \endverbatim
+ * with the numbers in decimal and the 17 bins of each histogram. Bounds are 65535 and 0
+ * while no value has been recorded. The characters are passed to \c put, e.g. a
+ * function that sends them over a USART to a host.
+ *
+ * \param put	Function that writes a character.
+ */
+void classb_intmon_stats_dump(void (*put)(char c))
+{
+	struct classb_intmon_stats stats;
+	const char PROGMEM_PTR_T name = intmon_names;
+	char c;
+
+	for (uint8_t i = 0; i < N_INTERRUPTS; i++) {
+		classb_intmon_stats_get((enum classb_int_identifiers) i, &stats);
+
+		while ((c = PROGMEM_READ_BYTE(name++)) != '\0')
+			put(c);
+
+		intmon_stats_put_number(put, stats.count_min);
+		intmon_stats_put_number(put, stats.count_max);
+		intmon_stats_put_number(put, stats.gap_min);
+		intmon_stats_put_number(put, stats.gap_max);
+		intmon_stats_put_hist(put, stats.count_hist);
+		intmon_stats_put_hist(put, stats.gap_hist);
+		put('\n');
+	}
+}
+
+#endif // CLASSB_INTMON_STATS
+
+
 //! \internal\brief Returns the absolute value of the difference between two numbers.
 static inline uint16_t abs_diff(uint16_t a, uint16_t b) 
 {
 	return (a > b)?(a - b):(b - a);
 }
 
+/*! \internal \brief Checks an interrupt that is not \c OFF.
+ *
+ * \param i		Interrupt identifier.
+ * \param bit	Bit of the interrupt in its byte of \ref classb_intmon_active.
+ */
+static inline void intmon_check(uint8_t i, uint8_t bit)
+{
+	uint16_t c = classb_intmon_c[i];
+
+	switch (classb_intmon_s[i])
+	{
+		case ON:
+#ifdef CLASSB_INTMON_STATS
+			intmon_stats_record(c, classb_intmon_stats[i].count_hist,
+				&classb_intmon_stats[i].count_min, &classb_intmon_stats[i].count_max);
+#endif
+			// Check whether the counter is within the allowed range
+			if ( abs_diff(c, PROGMEM_READ_WORD(&classb_intmon_n[i])) > PROGMEM_READ_WORD(&classb_intmon_l[i])) {
+				CLASSB_ERROR_HANDLER_INTERRUPT();
+				break;
+			}
+			// Reset counter			
+			classb_intmon_c[i] = 0;
+			break;
+		case ENABLE:
+			// The counter is only increased when the state is ON, so it must
+			// still be zero from when the interrupt was turned off.
+			if (c)
+				CLASSB_ERROR_HANDLER_INTERRUPT();
+			// Change state
+			classb_intmon_s[i] = ON;
+#ifdef CLASSB_INTMON_STATS
+			classb_intmon_stats[i].stamped = false;
+#endif
+			break;
+		case OFF:
+			// Only the monitor sets this state, and it leaves the active set too.
+			if (c)
+				CLASSB_ERROR_HANDLER_INTERRUPT();
+			classb_intmon_active[i >> 3] &= ~bit;
+			break;
+		case DISABLE:
+			// Change state, reset the counter and leave the active set
+			classb_intmon_s[i] = OFF;
+			classb_intmon_c[i] = 0;
+			classb_intmon_active[i >> 3] &= ~bit;
+			break;
+		default:
+			CLASSB_ERROR_HANDLER_INTERRUPT(); 
+	}
+}
+
+/*! \internal \brief Checks the interrupts in \ref classb_intmon_active.
+ *
+ * Groups of eight interrupts that are \c OFF are skipped at once.
+ */
+static inline void intmon_check_active(void)
+{
+	uint8_t byte, map, bit, i;
+
+	for (byte = 0; byte < CLASSB_INTMON_MAP_SIZE; byte++) 
+	{
+		map = classb_intmon_active[byte];
+		for (i = byte << 3, bit = 1; map; i++, bit <<= 1) 
+		{
+			if (!(map & bit))
+				continue;
+			map &= ~bit;
+
+			intmon_check(i, bit);
+			
+			// If CLASSB_CONDITION2_INTERRUPT is true, there is no need to check the other interrupts.
+			if (CLASSB_CONDITION2_INTERRUPT)
+				return;
+		}
+	}
+}
+
 /*! \brief The interrupt monitor.
  * 
- * For each registered interrupt, this function compares the counter with 
- * the expected value. There is an error if the difference is greater 
- * than the limit or if the interrupt is disabled and the counter is different 
- * than zero. If \ref CLASSB_CONDITION2_INTERRUPT is true, the monitor will stop 
+ * For each interrupt in \ref classb_intmon_active, this function compares the 
+ * counter with the expected value. There is an error if the difference is greater 
+ * than the limit, or if an interrupt is enabled and the counter is different than 
+ * zero. If \ref CLASSB_CONDITION2_INTERRUPT is true, the monitor will stop 
  * immediately, i.e. the remaining interrupts are not checked. 
  * 
  * \note This should be called back from the RTC interrupt. See \ref rtc_driver.
@@ -166,41 +409,7 @@ static inline uint16_t abs_diff(uint16_t a, uint16_t b)
  */
 void classb_intmon_callback() 
 {
-	
-	for (uint8_t i = 0; i < N_INTERRUPTS; i++ ) 
-	{
-		
-		switch (monitored_interrupts[i].s)
-		{
-			case ON:
-				// Check whether the counter is within the allowed range
-				if ( (uint16_t) abs_diff(monitored_interrupts[i].c, monitored_interrupts[i].n) > monitored_interrupts[i].l) {
-					CLASSB_ERROR_HANDLER_INTERRUPT();
-					break;
-				}
-				// Reset counter			
-				monitored_interrupts[i].c = 0;
-				break;
-			case OFF:
-				// The counter is only increased when the state is ON.
-				if (monitored_interrupts[i].c)
-					CLASSB_ERROR_HANDLER_INTERRUPT();
-				break;			
-			case ENABLE:											
-				// Change state
-				monitored_interrupts[i].s = ON;					
-				break;
-			case DISABLE:				
-				// Change state and reset the counter
-				monitored_interrupts[i].s = OFF;
-				monitored_interrupts[i].c = 0;
-				break;
-			default:
-				CLASSB_ERROR_HANDLER_INTERRUPT(); 
-		}
-		
-		// If CLASSB_CONDITION2_INTERRUPT is true, there is no need to check the other interrupts.
-		if (CLASSB_CONDITION2_INTERRUPT)
-			break;								
-	}
+	CLASSB_PROFILE_BEGIN(PROFILE_INTMON_CALLBACK);
+	intmon_check_active();
+	CLASSB_PROFILE_END(PROFILE_INTMON_CALLBACK);
 }
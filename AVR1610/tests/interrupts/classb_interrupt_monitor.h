@@ -68,12 +68,13 @@
 //!  \ref CLASSB_INT_MON should be defined. See \ref rtc_driver for more details. 
 //! 
 //!  In order to monitor an interrupt, the following steps should be followed: 
-//!   -# Register the interrupt in \ref classb_int_identifiers. 
-//!   -# The main application registers the interrupt by calling 
-//!   \ref classb_intmon_reg_int(). This gives the monitor information on the 
-//!   interrupt, for example the expected frequency.
+//!   -# Declare the interrupt in \ref CLASSB_INTMON_TABLE. This gives the monitor 
+//!   the identifier of the interrupt, the expected number of executions and the 
+//!   tolerance. The identifier is added to \ref classb_int_identifiers, and the 
+//!   reference and the limit are computed by the compiler and kept in Flash, so no 
+//!   registration is needed at run time.
 //!   -# The interrupts that have to be monitored should call \ref classb_intmon_increase() 
-//!   on each execution. 
+//!   on each execution, or be declared with \ref CLASSB_INTMON_ISR(), which does it.
 //!   -# The main application requests that the monitor starts checking the interrupt. 
 //!   This is done by changing the interrupt state to \c ENABLE with 
 //!   \ref classb_intmon_set_state(). The next time the interrupt monitor runs the 
@@ -89,9 +90,18 @@
 //!  
 //!  Note that the interrupt counter is only increased if the interrupt is \c ON. 
 //!  When an interrupt is \c OFF, the counter should be zero and otherwise the error 
-//!  flag will be set. Further, enabling an interrupt that is \c ON or disabling an 
+//!  flag will be set when it is enabled again. Further, enabling an interrupt that is \c ON or disabling an 
 //!  interrupt that is \c OFF will call the error handler if \ref CLASSB_STRICT is defined.
 //!  
+//!  The monitor keeps a bitmap of the interrupts that are not \c OFF, so that it
+//!  runs in a time that depends on the number of interrupts being monitored, not on
+//!  \ref N_INTERRUPTS.
+//!  
+//!  If \ref CLASSB_INTMON_STATS is defined, the monitor also keeps statistics of the 
+//!  interrupt rates, see \ref classb_intmon_stats. They show how the counters and the 
+//!  times between executions are distributed, e.g. a steady drift or bursts, before 
+//!  they trip the error handler.
+//!  
 //!  The error handler related to this test is CLASSB_ERROR_HANDLER_INTERRUPT(). 
 //!
 
@@ -102,14 +112,39 @@
 //! \brief Settings for the interrupt monitor
 //@{
 
+//! \brief Table of the interrupts that are monitored.
+//!
+//! Each entry is <tt>X(identifier, reference, tolerance)</tt>:
+//!   - \c identifier is added to \ref classb_int_identifiers.
+//!   - \c reference is the number of expected executions of the interrupt within an
+//!   RTC period. It can be computed from the frequency of the interrupt with
+//!   \ref CLASSB_INTMON_COUNT().
+//!   - \c tolerance is the allowed deviation (%) of the interrupt counter with respect
+//!   to \c reference.
+//!
+//! Both values must be constant expressions, since the compiler computes the limit
+//! of each interrupt.
+//!
+//! The table can also be defined at the compiler level, so that each application
+//! declares its own interrupts, e.g.
+//! <tt>-D"CLASSB_INTMON_TABLE(X)=X(MY_INTERRUPT,CLASSB_INTMON_COUNT(30),15)"</tt>.
+#ifndef CLASSB_INTMON_TABLE
+#define CLASSB_INTMON_TABLE(X) \
+	X(MY_INTERRUPT, CLASSB_INTMON_COUNT(30), 15)
+#endif
+
+//! \brief Number of executions within an RTC period of an interrupt with frequency \c f_int (Hz).
+#define CLASSB_INTMON_COUNT(f_int)	((uint16_t) ((1UL * (f_int) * CLASSB_RTC_INT_PERIOD) / CLASSB_RTC_FREQ))
+
+//! \internal \brief Entry of \ref CLASSB_INTMON_TABLE for \ref classb_int_identifiers.
+#define CLASSB_INTMON_ID(identifier, reference, tolerance)	identifier,
+
 //! \brief Enumeration of interrupt identifiers.
 //! 
-//! This enumeration holds the identifiers for the interrupts that should be monitored. 
+//! This enumeration holds the identifiers for the interrupts in \ref CLASSB_INTMON_TABLE.
 //! These identifiers are used in the interrupt when calling functions related to the 
-//! interrupt monitor: \ref classb_intmon_reg_int(), \ref classb_intmon_increase() and 
-//! \ref classb_intmon_set_state(). Interrupt identifiers are included before 
-//! \ref N_INTERRUPTS, so that it will hold the total number of registered interrupts.
-enum classb_int_identifiers { MY_INTERRUPT, //!< Identifier of the interrupt
+//! interrupt monitor: \ref classb_intmon_increase() and \ref classb_intmon_set_state().
+enum classb_int_identifiers { CLASSB_INTMON_TABLE(CLASSB_INTMON_ID)
 							  N_INTERRUPTS //!< This will keep the number of registered interrupts
 							};
 
@@ -119,6 +154,48 @@ enum classb_int_identifiers { MY_INTERRUPT, //!< Identifier of the interrupt
 //! an interrupt that is on \c OFF state will call the error handler.
 #define CLASSB_STRICT 
 
+#ifdef __DOXYGEN__
+ //! \brief Enable the statistics of the interrupt rates.
+ //!
+ //! This symbol can be defined at the compiler level or in this file. If it is
+ //! defined, \ref classb_intmon_stats_setup() is called from the main application
+ //! before the interrupts are enabled.
+ #define CLASSB_INTMON_STATS
+#else
+ //#define CLASSB_INTMON_STATS
+#endif
+
+//! \brief Port of the TC that stamps the interrupts for the statistics, e.g. D -> TCD1.
+//!
+//! It must not be a TC of the CPU frequency test, of the scheduler or of the profiling.
+#define CLASSB_INTMON_STATS_TC_PORT		D
+
+//! \brief Module of the TC that stamps the interrupts for the statistics, e.g. 1 -> TCD1.
+#define CLASSB_INTMON_STATS_TC_MOD		1
+
+//!\brief TC prescaler for the statistics
+//!
+//! The TC runs on the system clock scaled down by this parameter.
+//! Possible values are 1, 2, 4, 8, 64, 256 or 1024. Times between executions that
+//! are longer than 65535 TC counts are not measured correctly.
+#define CLASSB_INTMON_STATS_TC_PRESCALER	64
+
+//@}
+
+//! \internal \defgroup int_mon_int_conf Internal settings
+//!
+//! \brief This constants should not be modified.
+//@{
+
+//! \internal \brief Label for the TC of the statistics
+#define CLASSB_INTMON_STATS_TC			LABEL(TC, CLASSB_INTMON_STATS_TC_PORT, CLASSB_INTMON_STATS_TC_MOD)
+
+//! \internal \brief Label for the TC prescaler group configuration
+#define CLASSB_INTMON_STATS_TC_PRESCALER_gc	LABEL(TC_CLKSEL_DIV, CLASSB_INTMON_STATS_TC_PRESCALER, _gc)
+
+//! \internal \brief Number of bins in the histograms, one for 0 and one per bit of a 16-bit value.
+#define CLASSB_INTMON_STATS_BINS		17
+
 //@}
 
 //! \defgroup int_mon_def Interrupt data interface
@@ -134,45 +211,128 @@ enum classb_int_states {ON, //!< \internal Interrupt is being monitored (should
 						DISABLE //!< Interrupt should stop being monitored (can be set by the user application).
 						};
 
-/*! 
- *  \internal \brief Data structure for the interrupts that are monitored.
- *   
- *   The main application has to register the interrupt by calling \ref classb_intmon_reg_int(). 
- *   It is that function that sets the values of the structure.
+//! \internal \brief Number of bytes in \ref classb_intmon_active.
+#define CLASSB_INTMON_MAP_SIZE	((N_INTERRUPTS + 7) / 8)
+
+//! \name Interrupt data
+//!
+//! \internal The data of the interrupts that are monitored is kept in separate arrays,
+//! indexed by the identifier. The constants are generated from \ref CLASSB_INTMON_TABLE
+//! and kept in Flash.
+//@{
+
+//! \internal \brief Expected number of interrupts in the monitor period.
+//!
+//! The monitor period is defined by \ref CLASSB_RTC_INT_PERIOD and \ref CLASSB_RTC_FREQ.
+extern const uint16_t PROGMEM_DECLARE( classb_intmon_n[N_INTERRUPTS] );
+
+//! \internal \brief Interrupt counters.
+//!
+//! This holds the number of interrupt occurrences in the current monitor period.
+extern volatile uint16_t classb_intmon_c[N_INTERRUPTS];
+
+//! \internal \brief Limits for deviation in the counters.
+extern const uint16_t PROGMEM_DECLARE( classb_intmon_l[N_INTERRUPTS] );
+
+//! \internal \brief States of the interrupts, see \ref classb_int_states.
+extern volatile uint8_t classb_intmon_s[N_INTERRUPTS];
+
+//! \internal \brief Bitmap of the interrupts that are not \c OFF.
+//!
+//! Bit <tt>i % 8</tt> of byte <tt>i / 8</tt> is set for interrupt \c i. The monitor
+//! only visits the interrupts in this set.
+extern uint8_t classb_intmon_active[CLASSB_INTMON_MAP_SIZE];
+
+//@}
+
+/*!
+ *  \brief Statistics of the rate of an interrupt.
+ *
+ *   Counters are the number of executions within an RTC period, recorded by the
+ *   monitor while the interrupt is \c ON. Gaps are the times between two executions
+ *   in counts of the TC, \ref CLASSB_INTMON_STATS_TC_PRESCALER / \c F_CPU s.
+ *
+ *   Bin 0 of a histogram counts the values 0, and bin \c k the values from 2^(k-1)
+ *   to 2^k - 1. The bins saturate at 255.
  */
-struct intmon_interrupt {
-	//! \brief Expected number of interrupts in the monitor period. 
-	//! 
-	//! The monitor period is defined by \ref CLASSB_RTC_INT_PERIOD and \ref CLASSB_RTC_FREQ.
-	uint16_t n;
-	//! \brief Interrupt counter. 
-	//! 
-	//! This holds the number of interrupt occurrences in the current monitor period. 
-	uint16_t c;
-	
-	//! \brief Limit for deviation in the counter. 
-	//! 
-	//! Limit for deviation in the counter. 
-	uint16_t l; 
-	
-	//! \brief State of the interrupt
-	//! 
-	//!  State of the interrupt
-	enum classb_int_states s; 
+struct classb_intmon_stats {
+	//! \internal \brief TC count at the last execution.
+	uint16_t last;
+	//! \internal \brief \c last holds an execution since the interrupt was turned \c ON.
+	bool stamped;
+	//! \brief Smallest counter.
+	uint16_t count_min;
+	//! \brief Largest counter.
+	uint16_t count_max;
+	//! \brief Shortest gap.
+	uint16_t gap_min;
+	//! \brief Longest gap.
+	uint16_t gap_max;
+	//! \brief Histogram of the counters.
+	uint8_t count_hist[CLASSB_INTMON_STATS_BINS];
+	//! \brief Histogram of the gaps.
+	uint8_t gap_hist[CLASSB_INTMON_STATS_BINS];
 };
 
 //@}
 
+//! \name Global variables
+//@{
+#if defined(CLASSB_INTMON_STATS) || defined(__DOXYGEN__)
+extern struct classb_intmon_stats classb_intmon_stats[N_INTERRUPTS];
+#endif
+//@}
+
 
 //! \defgroup int_mon_func Functions
 //! \brief Functions related to the interrupt monitor
 //@{			
 void classb_intmon_set_state( enum classb_int_identifiers identifier,  enum classb_int_states state);
-void classb_intmon_reg_int(enum classb_int_identifiers identifier, uint16_t interrupt_counter, uint8_t tolerance_percent) ;
-void classb_intmon_increase( enum classb_int_identifiers identifier );
 void classb_intmon_callback( void );
+void classb_intmon_stats_setup( void );
+void classb_intmon_stats_reset( void );
+void classb_intmon_stats_stamp( enum classb_int_identifiers identifier );
+void classb_intmon_stats_get( enum classb_int_identifiers identifier, struct classb_intmon_stats *stats );
+void classb_intmon_stats_dump( void (*put)(char c) );
+
+/*! \brief Increases the interrupt counter of the specified interrupt.
+ *
+ *  This is called from the interrupt routine and it will increases the counter
+ *  if the interrupt is \c ON. It is inlined, so that it only takes a few
+ *  instructions in the interrupt. If \ref CLASSB_INTMON_STATS is defined, the
+ *  execution is also stamped with \ref classb_intmon_stats_stamp().
+ *
+ *  \param identifier	Interrupt identifier. Use symbol declared in \ref classb_int_identifiers
+ */
+INLINE void classb_intmon_increase( enum classb_int_identifiers identifier )
+{
+	if (classb_intmon_s[identifier] == ON) {
+		classb_intmon_c[identifier]++;
+#ifdef CLASSB_INTMON_STATS
+		classb_intmon_stats_stamp(identifier);
+#endif
+	}
+}
 //@}
 
+/*! \brief Defines an interrupt that is monitored.
+ *
+ *  This is used instead of \c ISR(), and is followed by the body of the interrupt.
+ *  The interrupt counter is increased before the body runs, e.g.
+ *  <tt>CLASSB_INTMON_ISR(TCD0_OVF_vect, MY_INTERRUPT) { ... }</tt>
+ *
+ *  \param vector		Interrupt vector.
+ *  \param identifier	Interrupt identifier. Use symbol declared in \ref CLASSB_INTMON_TABLE.
+ */
+#define CLASSB_INTMON_ISR(vector, identifier) \
+	INLINE void classb_intmon_isr_##identifier(void); \
+	ISR(vector) \
+	{ \
+		classb_intmon_increase(identifier); \
+		classb_intmon_isr_##identifier(); \
+	} \
+	INLINE void classb_intmon_isr_##identifier(void)
+
 
 //@}
 
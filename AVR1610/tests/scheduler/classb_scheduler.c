@@ -0,0 +1,272 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Cooperative scheduler for the Class B tests.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#include "classb_scheduler.h"
+
+//! \ingroup scheduler
+//@{
+
+//! \brief Array of data structures for the tests that are scheduled.
+struct classb_sched_task classb_sched_tasks[N_SCHED_TASKS];
+
+//! \brief Time spent in the slices of all tests, in TC counts.
+uint32_t classb_sched_busy = 0;
+
+//! \brief Time the CPU slept in \ref classb_sched_idle(), in TC counts.
+uint32_t classb_sched_sleep = 0;
+
+//! \internal \brief Number of RTC compare interrupts since the RTC was started.
+static volatile uint32_t sched_ticks = 0;
+
+
+/*! \brief Sets up the TC that times the slices.
+ *
+ * The TC runs freely over its whole 16-bit range. This should be called from the
+ * main application after \ref classb_rtc_setup() and before the tests are registered.
+ */
+void classb_sched_setup(void)
+{
+	CLASSB_SCHED_TC.CTRLA = TC_CLKSEL_OFF_gc;
+	CLASSB_SCHED_TC.PER = 0xFFFF;
+	CLASSB_SCHED_TC.CNT = 0;
+	CLASSB_SCHED_TC.CTRLA = CLASSB_SCHED_TC_PRESCALER_gc;
+}
+
+
+/** \brief Registers a test.
+ *
+ * The first pass of the test starts immediately. Registering a test again restarts
+ * it and clears its statistics.
+ *
+ *  \param identifier	Test identifier. Use symbol declared in \ref classb_sched_identifiers.
+ *  \param step			Step function of the test, or \c NULL to remove the test.
+ *  \param period		Time between the starts of two passes in RTC counts, see \ref CLASSB_SCHED_MS().
+ *  \param budget		Longest time a slice may take in TC counts, see \ref CLASSB_SCHED_US().
+ *	\callergraph
+ */
+void classb_sched_reg_task(enum classb_sched_identifiers identifier, classb_sched_step_t step, uint32_t period, uint16_t budget)
+{
+	struct classb_sched_task *task = &classb_sched_tasks[identifier];
+	uint32_t now = classb_sched_time();
+
+	task->step = step;
+	task->period = period;
+	task->budget = budget;
+	task->release = now;
+	task->last_end = now;
+	task->interval = 0;
+	task->max_interval = 0;
+	task->cost = 0;
+	task->pass_cost = 0;
+	task->max_slice = 0;
+	task->passes = 0;
+	task->overruns = 0;
+	task->misses = 0;
+}
+
+
+/*! \brief Returns the time since the RTC was started, in RTC counts.
+ *
+ * The RTC interrupt resets the counter every \ref CLASSB_RTC_INT_PERIOD counts, so
+ * the time is made of the number of interrupts and the counter.
+ *
+ * From the compare match until the interrupt has run, e.g. while interrupts are
+ * disabled, the counter goes on past the period but the interrupt is not counted
+ * yet. The time stays at the next tick meanwhile, so that it never goes backwards
+ * when the interrupt sets the counter back to 0.
+ */
+uint32_t classb_sched_time(void)
+{
+	uint32_t time, cnt;
+
+	ENTER_CRITICAL_REGION();
+	#ifdef RTC32
+		// The counter of the RTC32 has to be synchronized before it is read.
+		RTC32.SYNCCTRL |= RTC32_SYNCCNT_bm;
+		while (RTC32.SYNCCTRL & RTC32_SYNCCNT_bm);
+	#endif
+	cnt = RTC_TEST.CNT;
+	if ((RTC_TEST.INTFLAGS & RTC_TEST_COMPIF_bm) || (cnt > CLASSB_RTC_INT_PERIOD))
+		cnt = CLASSB_RTC_INT_PERIOD;
+	time = sched_ticks * CLASSB_RTC_INT_PERIOD + cnt;
+	LEAVE_CRITICAL_REGION();
+
+	return time;
+}
+
+
+/*! \brief Counts the RTC compare interrupts.
+ *
+ * \note This should be called back from the RTC interrupt. See \ref rtc_driver.
+ */
+void classb_sched_tick(void)
+{
+	sched_ticks++;
+}
+
+
+/*! \internal \brief Records the end of a pass and starts the next one.
+ *
+ * \param task	The test.
+ * \param now	Current time.
+ */
+static void sched_end_pass(struct classb_sched_task *task, uint32_t now)
+{
+	task->interval = now - task->last_end;
+	if (task->interval > task->max_interval)
+		task->max_interval = task->interval;
+	task->last_end = now;
+	task->pass_cost = task->cost;
+	task->cost = 0;
+	task->passes++;
+
+	// The next pass starts one period after this one, or now if that is already past.
+	task->release += task->period;
+	if ((int32_t)(now - task->release) > 0)
+		task->release = now;
+}
+
+
+/*! \brief Runs the slices of the tests that are due.
+ *
+ * The pass of a test is due from its start until it is completed. Of the tests
+ * that are due, the one with the earliest deadline runs first, and slices are run
+ * as long as the budget of the next slice fits in the time that is left. A pass
+ * that has not been completed by its deadline calls the error handler
+ * \ref CLASSB_ERROR_HANDLER_SCHED(), and gets a new deadline one period later.
+ *
+ * \param budget	Time that can be spent in this call, in TC counts, see \ref CLASSB_SCHED_US().
+ *
+ *	\callergraph
+ */
+void classb_sched_run(uint16_t budget)
+{
+	uint16_t start = CLASSB_SCHED_TC.CNT;
+	uint16_t slice, elapsed, left;
+	uint32_t now, deadline = 0;
+	struct classb_sched_task *task, *next;
+	bool done;
+
+	for (;;)
+	{
+		now = classb_sched_time();
+		elapsed = CLASSB_SCHED_TC.CNT - start;
+		left = (elapsed < budget) ? budget - elapsed : 0;
+		next = NULL;
+
+		for (task = classb_sched_tasks; task < classb_sched_tasks + N_SCHED_TASKS; task++)
+		{
+			if (task->step == NULL || (int32_t)(now - task->release) < 0)
+				continue;
+
+			if (now - task->release >= task->period) {
+				task->misses++;
+				task->release += task->period;
+				CLASSB_ERROR_HANDLER_SCHED();
+			}
+
+			if (task->budget <= left && (next == NULL || (int32_t)(task->release + task->period - deadline) < 0)) {
+				next = task;
+				deadline = task->release + task->period;
+			}
+		}
+
+		if (next == NULL || left == 0)
+			break;
+
+		slice = CLASSB_SCHED_TC.CNT;
+		done = next->step();
+		slice = CLASSB_SCHED_TC.CNT - slice;
+
+		next->cost += slice;
+		classb_sched_busy += slice;
+		if (slice > next->max_slice)
+			next->max_slice = slice;
+		if (slice > next->budget) {
+			next->overruns++;
+			CLASSB_ACTIONS_SCHED_OVERRUN();
+		}
+
+		if (done)
+			sched_end_pass(next, classb_sched_time());
+	}
+}
+
+
+/*! \brief Runs the tests and sleeps while the application is idle.
+ *
+ * This is called by the application when it has nothing to do. The slices that
+ * are due are run as in \ref classb_sched_run(). If no test is due afterwards,
+ * the CPU is put in IDLE sleep until the next interrupt, and the compare A
+ * interrupt of the TC is set to wake it up when the next pass starts. If tests
+ * are still due, i.e. the budget ran out, the function returns at once so that
+ * the application can decide whether to call it again.
+ *
+ * \param budget	Time that can be spent running the tests, in TC counts, see \ref CLASSB_SCHED_US().
+ *
+ *	\callergraph
+ */
+void classb_sched_idle(uint16_t budget)
+{
+	uint32_t now, wait = CLASSB_SCHED_MAX_SLEEP;
+	uint16_t start;
+	struct classb_sched_task *task;
+
+	classb_sched_run(budget);
+
+	// Interrupts are disabled until the sleep instruction, so that an interrupt
+	// that makes work for the application cannot be missed.
+	cli();
+	now = classb_sched_time();
+
+	for (task = classb_sched_tasks; task < classb_sched_tasks + N_SCHED_TASKS; task++)
+	{
+		if (task->step == NULL)
+			continue;
+		if ((int32_t)(task->release - now) <= 0) {
+			sei();
+			return;
+		}
+		if (task->release - now < wait)
+			wait = task->release - now;
+	}
+
+	// Wake up when the next pass starts.
+	start = CLASSB_SCHED_TC.CNT;
+	CLASSB_SCHED_TC.CCA = start + (uint16_t) ((wait * CLASSB_SCHED_TC_FREQ) / CLASSB_RTC_FREQ);
+	CLASSB_SCHED_TC.INTFLAGS = CLASSB_SCHED_TC_CCAIF_bm;
+	CLASSB_SCHED_TC.INTCTRLB = TC_CCAINTLVL_LO_gc;
+
+	SLEEP.CTRL = SLEEP_SMODE_IDLE_gc | SLEEP_SEN_bm;
+	// The instruction after sei() is executed before any pending interrupt.
+	sei();
+	cpu_sleep();
+	SLEEP.CTRL = 0;
+
+	CLASSB_SCHED_TC.INTCTRLB = TC_CCAINTLVL_OFF_gc;
+	classb_sched_sleep += (uint16_t) (CLASSB_SCHED_TC.CNT - start);
+}
+
+
+/*! \brief Compare A interrupt of the TC.
+ *
+ * This only wakes the CPU up from \ref classb_sched_idle().
+ */
+ISR(CLASSB_SCHED_TC_CCA_vect)
+{
+	CLASSB_SCHED_TC.INTCTRLB = TC_CCAINTLVL_OFF_gc;
+}
+
+//@}
@@ -0,0 +1,219 @@
+/* This file has been prepared for Doxygen automatic documentation generation.*/
+/**
+ * \file
+ *
+ * \brief
+ *		Settings and definitions for the scheduler of the Class B tests.
+ *
+ * \par Application note:
+ *      AVR1610: Guide to IEC60730 Class B compliance with XMEGA
+ *
+ * \par Documentation
+ *      For comprehensive code documentation, supported compilers, compiler
+ *      settings and supported devices see readme.html
+ */
+
+#ifndef CLASSB_SCHEDULER_H_
+#define CLASSB_SCHEDULER_H_
+
+#include "avr_compiler.h"
+#include "classb_rtc_common.h"
+#include "error_handler.h"
+
+
+//! \defgroup scheduler Class B Scheduler
+//!
+//! \brief A cooperative scheduler for the periodic self-diagnostic routines.
+//!
+//! Instead of calling each test by hand from the main loop or from an interrupt,
+//! the application registers the tests with the scheduler, which decides when
+//! they run. Each test is run in slices: a step function does a bounded amount of
+//! work, e.g. one SRAM section with \ref classb_sram_test() or one Flash page with
+//! \ref CLASSB_CRC32_Flash_Page(), and returns \c true when it has completed a pass
+//! over everything it tests.
+//!
+//! In order to schedule a test, the following steps should be followed:
+//!   -# Add an identifier for the test in \ref classb_sched_identifiers.
+//!   -# \ref CLASSB_SCHEDULER is defined, so that the RTC interrupt keeps the time of
+//!   the scheduler. See \ref rtc_driver.
+//!   -# The main application calls \ref classb_rtc_setup() and \ref classb_sched_setup(),
+//!   and then registers the test with \ref classb_sched_reg_task(). This gives the
+//!   scheduler the step function, the period and the budget of the test.
+//!   -# The main application calls \ref classb_sched_run() whenever it has time to
+//!   spare, e.g. from the main loop, with the time it can give to the tests. When it
+//!   has nothing else to do it calls \ref classb_sched_idle() instead, which also puts
+//!   the CPU to sleep until the next interrupt. Otherwise \ref CLASSB_SCHED_RTC can
+//!   be defined so that the RTC interrupt runs the tests.
+//!
+//! A new pass of a test is started every period. The period is also the deadline
+//! of the pass: if the pass has not been completed when the next one should start,
+//! the error handler \ref CLASSB_ERROR_HANDLER_SCHED() is called. A fault is therefore
+//! detected within two periods of the test.
+//!
+//! \ref classb_sched_run() runs the slices of the passes that have been started,
+//! earliest deadline first, as long as the budget of the next slice fits in the
+//! time that is left. The budget of a test is the longest time one of its slices
+//! may take. Slices are timed with a TC, \ref CLASSB_SCHED_TC_MOD, and a slice that
+//! takes longer than its budget is counted as an overrun.
+//!
+//! For each test the scheduler keeps the achieved diagnostic interval, i.e. the time
+//! between the ends of the last two passes, and the time spent in the slices of the
+//! last pass. Together they give the CPU load of the test. See \ref classb_sched_task.
+//!
+//! \ref classb_sched_busy and \ref classb_sched_sleep add up the time spent in the
+//! slices and the time the CPU slept in \ref classb_sched_idle(), so that the active
+//! time taken by the tests can be compared with the idle time that was available.
+//!
+//! \note The scheduler does not disable interrupts while a slice runs. Step functions
+//! for tests that need it, e.g. the SRAM test, should do it themselves.
+//!
+//@{
+
+//! \defgroup sched_conf Settings
+//! \brief Settings for the scheduler
+//@{
+
+//! \brief Enumeration of test identifiers.
+//!
+//! This enumeration holds the identifiers of the tests that should be scheduled.
+//! Test identifiers are included before \ref N_SCHED_TASKS, so that it will hold
+//! the total number of tests. Tests that are not registered are skipped.
+enum classb_sched_identifiers { SCHED_SRAM, //!< Identifier of the SRAM test
+								SCHED_REGISTERS, //!< Identifier of the CPU registers test
+								SCHED_CRC_RAM, //!< Identifier of the CRC test of SRAM regions
+								N_SCHED_TASKS //!< This will keep the number of tests
+							  };
+
+//! \brief TC module selection
+//!
+//!	This is the number of the TC module that times the slices, e.g. 1 -> TCC1.
+//!	It must not be the TC of the CPU frequency test, see \ref CLASSB_TC_MOD.
+#define CLASSB_SCHED_TC_MOD			1
+
+//!\brief TC prescaler
+//!
+//! The TC runs on the system clock scaled down by this parameter.
+//! Possible values are 1, 2, 4, 8, 64, 256 or 1024. The longest budget is
+//! 65535 TC counts.
+#define CLASSB_SCHED_TC_PRESCALER	64
+
+#ifdef __DOXYGEN__
+ //! \brief Run the tests from the RTC interrupt.
+ //!
+ //! If this is defined the RTC interrupt calls \ref classb_sched_run() with
+ //! \ref CLASSB_SCHED_RTC_BUDGET. This symbol can be defined at the compiler level
+ //! or in this file.
+ #define CLASSB_SCHED_RTC
+#else
+ //#define CLASSB_SCHED_RTC
+#endif
+
+//! \brief Time given to the tests in each RTC interrupt, in TC counts.
+#define CLASSB_SCHED_RTC_BUDGET		CLASSB_SCHED_US(2000UL)
+
+//@}
+
+//! \internal \defgroup sched_int_conf Internal settings
+//!
+//! \brief This constants should not be modified.
+//@{
+
+//! \internal \brief Label for the TC module
+#define CLASSB_SCHED_TC				LABEL(TCC, CLASSB_SCHED_TC_MOD,)
+
+//! \internal \brief Label for the TC prescaler group configuration
+#define CLASSB_SCHED_TC_PRESCALER_gc	LABEL(TC_CLKSEL_DIV, CLASSB_SCHED_TC_PRESCALER, _gc)
+
+//! \internal \brief Label for the compare A interrupt vector of the TC
+#define CLASSB_SCHED_TC_CCA_vect	LABEL(TCC, CLASSB_SCHED_TC_MOD, _CCA_vect)
+
+//! \internal \brief Label for the compare A interrupt flag of the TC
+#define CLASSB_SCHED_TC_CCAIF_bm	LABEL(TC, CLASSB_SCHED_TC_MOD, _CCAIF_bm)
+
+//! \internal \brief Frequency of the TC (Hz).
+#define CLASSB_SCHED_TC_FREQ		(F_CPU / CLASSB_SCHED_TC_PRESCALER)
+
+//! \internal \brief Longest sleep in \ref classb_sched_idle() in RTC counts, i.e. 0xFFFF TC counts.
+#define CLASSB_SCHED_MAX_SLEEP		((0xFFFFUL * CLASSB_RTC_FREQ) / CLASSB_SCHED_TC_FREQ)
+
+//! \brief Convert microseconds to TC counts, e.g. for the budget of a test.
+//!
+//! \note \c F_CPU is assumed to be a multiple of 1 MHz.
+#define CLASSB_SCHED_US(us)			((uint16_t) (((us) * (F_CPU / 1000000UL)) / CLASSB_SCHED_TC_PRESCALER))
+
+//! \brief Convert milliseconds to RTC counts, e.g. for the period of a test.
+#define CLASSB_SCHED_MS(ms)			((uint32_t) (((ms) * CLASSB_RTC_FREQ) / 1000UL))
+
+//@}
+
+//! \defgroup sched_def Test data interface
+//! \brief Definition of data structures used by the scheduler.
+//@{
+
+//! \brief Step function of a test.
+//!
+//! \retval true  a pass of the test has been completed.
+//! \retval false there is work left in this pass.
+typedef bool (*classb_sched_step_t)(void);
+
+/*!
+ *  \brief Data structure for the tests that are scheduled.
+ *
+ *   The main application has to register the test by calling \ref classb_sched_reg_task().
+ *   The settings are set by that function, the remaining members are kept by the
+ *   scheduler and can be read by the application.
+ *   Times are in RTC counts (1/\ref CLASSB_RTC_FREQ s) and durations of slices in TC
+ *   counts (\ref CLASSB_SCHED_TC_PRESCALER / \c F_CPU s).
+ */
+struct classb_sched_task {
+	//! \brief Step function, \c NULL if the test is not registered.
+	classb_sched_step_t step;
+	//! \brief Time between the starts of two passes, and deadline of a pass.
+	uint32_t period;
+	//! \brief Longest time a slice may take.
+	uint16_t budget;
+	//! \brief Start of the current pass.
+	uint32_t release;
+	//! \brief End of the last pass.
+	uint32_t last_end;
+	//! \brief Time between the ends of the last two passes.
+	uint32_t interval;
+	//! \brief Longest time between the ends of two passes.
+	uint32_t max_interval;
+	//! \brief Time spent in the slices of the current pass.
+	uint32_t cost;
+	//! \brief Time spent in the slices of the last pass.
+	uint32_t pass_cost;
+	//! \brief Longest slice.
+	uint16_t max_slice;
+	//! \brief Number of completed passes.
+	uint16_t passes;
+	//! \brief Number of slices that took longer than the budget.
+	uint8_t overruns;
+	//! \brief Number of passes that missed their deadline.
+	uint8_t misses;
+};
+
+//@}
+
+//! \name Global variables
+//@{
+extern struct classb_sched_task classb_sched_tasks[N_SCHED_TASKS];
+extern uint32_t classb_sched_busy;
+extern uint32_t classb_sched_sleep;
+//@}
+
+//! \defgroup sched_func Functions
+//! \brief Functions related to the scheduler
+//@{
+void classb_sched_setup( void );
+void classb_sched_reg_task( enum classb_sched_identifiers identifier, classb_sched_step_t step, uint32_t period, uint16_t budget );
+void classb_sched_run( uint16_t budget );
+void classb_sched_idle( uint16_t budget );
+void classb_sched_tick( void );
+uint32_t classb_sched_time( void );
+//@}
+
+//@}
+
+#endif /* CLASSB_SCHEDULER_H_ */
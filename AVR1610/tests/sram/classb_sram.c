@@ -52,6 +52,7 @@
 #include "avr_compiler.h"
 #include "classb_sram.h"
 #include "error_handler.h"
+#include "classb_profile.h"
 
 //!\ingroup classb_sram
 //@{
@@ -125,6 +126,8 @@ void classb_sram_test()
 	// This variable keeps track of the section to test. 
 	static uint8_t current_section = 0;
 	
+	CLASSB_PROFILE_BEGIN(PROFILE_SRAM_TEST);
+	
 	switch (current_section) 
 	{
 	case 0:
@@ -152,6 +155,7 @@ void classb_sram_test()
 	if (current_section > CLASSB_NSEC_TOTAL-1) 
 		current_section = 0;
 	
+	CLASSB_PROFILE_END(PROFILE_SRAM_TEST);
 }
 
 
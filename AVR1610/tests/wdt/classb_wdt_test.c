@@ -69,8 +69,22 @@ NO_INIT volatile classb_preinit_teststate_t classb_wdt_teststate;
 NO_INIT volatile uint16_t  classb_rtc_count;
 //@}
 
+#ifdef CLASSB_WDT_FAST
+//! \internal \brief Fails to compile if the wait does not end within the open period, or if
+//! the second reset of the WDT is not within the closed period after the synchronization of the first one.
+typedef char classb_wdt_fast_fits[( (CLASSB_WDT_FAST_WAIT * (CLASSB_WDT_RTC_PER + 1) >= CLASSB_WDT_FAST_CLOSED_MAX) && 
+		(CLASSB_WDT_FAST_WAIT * (CLASSB_WDT_RTC_PER + 1) + CLASSB_WDT_FAST_SYNC <= CLASSB_WDT_FAST_OPEN_MIN) &&
+		(CLASSB_WDT_FAST_WDR_WAIT * (CLASSB_WDT_RTC_PER + 1) >= CLASSB_WDT_FAST_WDR_SYNC) &&
+		(CLASSB_WDT_FAST_WDR_WAIT * (CLASSB_WDT_RTC_PER + 1) < CLASSB_WDT_FAST_CLOSED_MIN) ) ? 1 : -1];
+#endif
+
 //! \endcond
 
+//! \brief Number of RTC periods spent waiting in the test since the last power-on or 
+//! external reset.
+//! This variable is not initialized and, therefore, can be used across resets. 
+NO_INIT volatile uint16_t classb_wdt_boot_time;
+
 //@}
 
 
@@ -118,8 +132,15 @@ classb_wdt_test (void)
 	    
 		// Firstly clear reset flags
 		RST.STATUS = (RST_PORF_bm | RST_EXTRF_bm | RST_PDIRF_bm);        
+		// Start measuring the time spent in the test.
+		classb_wdt_boot_time = 0;
+#ifdef CLASSB_WDT_FAST
+		// Assume watchdog fault until the WDT is reset in the closed period.
+		classb_wdt_teststate = FAULT_WDT;
+#else
         // Set the next state of the test 
         classb_wdt_teststate = TEST_WDT_1;
+#endif
                 
 		// Configure the RTC, which is used as an independent time source.
 		// In this section we are going to measure the number of RTC periods
@@ -142,6 +163,68 @@ classb_wdt_test (void)
 		// Start RTC timer
         RTC_TEST.CTRL = RTC_TEST_START_bm;
         
+#ifdef CLASSB_WDT_FAST
+		// Enable WDT with window mode enabled and short periods.
+		CCP = CCP_IOREG_gc;
+		WDT.CTRL = WDT_ENABLE_bm | CLASSB_WDT_FAST_PER | WDT_CEN_bm;
+		// Wait until WDT Synchronized
+		while( WDT.STATUS & WDT_SYNCBUSY_bm );
+		CCP = CCP_IOREG_gc;
+		WDT.WINCTRL = WDT_WEN_bm | CLASSB_WDT_FAST_WPER | WDT_WCEN_bm;
+		// Wait until WDT Synchronized
+		while( WDT.STATUS & WDT_SYNCBUSY_bm );
+
+		// Start the TC at the beginning of an RTC period, so that it measures 
+		// whole RTC periods with the CPU clock.
+		while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
+			RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;
+		classb_wdt_boot_time++;
+		CLASSB_WDT_FAST_TC.CTRLA = TC_CLKSEL_DIV64_gc;
+
+		// Wait until the middle of the open period. A system reset before this 
+		// point means that the WDT timeout is too short.
+		counter = CLASSB_WDT_FAST_WAIT;
+		while(counter--){
+			while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
+				RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;
+			classb_wdt_boot_time++;
+		}
+		counter = CLASSB_WDT_FAST_TC.CNT;
+		// This should not issue a system reset, unless the closed period is too long.
+		watchdog_reset();
+
+		// Leave the TC in its reset state.
+		CLASSB_WDT_FAST_TC.CTRLA = TC_CLKSEL_OFF_gc;
+		CLASSB_WDT_FAST_TC.CTRLFSET = TC_CMD_RESET_gc;
+
+		// Check the RTC against the CPU clock. 
+		if ( (counter > CLASSB_WDT_FAST_TC_COUNT - CLASSB_WDT_FAST_TC_LIMIT) && 
+			 (counter < CLASSB_WDT_FAST_TC_COUNT + CLASSB_WDT_FAST_TC_LIMIT) ) {
+
+			// Wait until the last reset of the WDT has been synchronized and the 
+			// WDT is in a new closed period.
+			counter = CLASSB_WDT_FAST_WDR_WAIT;
+			while(counter--){
+				while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
+					RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;
+				classb_wdt_boot_time++;
+			}
+
+			// Set next test state and reset the WDT in the closed period. 
+			// This should issue a system reset.
+			classb_wdt_teststate = TEST_WDT_FAST;
+			watchdog_reset();
+
+			// Wait for a few RTC periods, which is longer than the synchronization 
+			// of the reset of the WDT.
+			counter = 3;
+			while(counter--){
+				while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
+					RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;
+				classb_wdt_boot_time++;
+			}
+		}
+#else
 		// WDT Configuration: 
 		// First write to Configuration Change Protection register
 		CCP = CCP_IOREG_gc;
@@ -161,10 +244,13 @@ classb_wdt_test (void)
 			classb_rtc_count ++;
 			while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
 				RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;			
+			classb_wdt_boot_time++;
 		}
+#endif
 		// This should only be executed if there is an error in the WDT, 
 		// i.e. if the WDT did not timeout before the maximum number of 
-		// RTC periods was exceeded. 
+		// RTC periods was exceeded, or the WDT did not issue a system reset 
+		// in the closed period of the single-reset test.
 		classb_wdt_teststate = FAULT_WDT;		      				    
     }  
     
@@ -220,6 +306,7 @@ classb_wdt_test (void)
 					while(counter--){
 						while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
 							RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;
+						classb_wdt_boot_time++;
 					}				
 					watchdog_reset();
 					// Wait again approximately 0.75 * T_WDT
@@ -229,6 +316,7 @@ classb_wdt_test (void)
 					while(counter--){
 						while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
 							RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;
+						classb_wdt_boot_time++;
 					}				
         
 					// This should only occur if WDT reset worked, otherwise there would 
@@ -243,6 +331,7 @@ classb_wdt_test (void)
 					while(counter--){
 						while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
 							RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;
+						classb_wdt_boot_time++;
 					}
 				}
 				// Set error flag if WDT has not issued a reset.								
@@ -296,12 +385,17 @@ classb_wdt_test (void)
 				while(counter--){
 					while( !(RTC_TEST.INTFLAGS & RTC_TEST_OVFIF_bm) );
 						RTC_TEST.INTFLAGS = RTC_TEST_OVFIF_bm;
+					classb_wdt_boot_time++;
 				}
 				// Set error flag if WDT has not issued a reset.								
 				classb_wdt_teststate = FAULT_WDT;	
 				break;    
 
             // After the test the WDT should be left enabled for the main application.
+#ifdef CLASSB_WDT_FAST
+            // The single-reset test ends in the same way as the full test.
+            case TEST_WDT_FAST:
+#endif
             case TEST_WDT_3:			
 				/* WDT configuration for the main application: WDT in normal mode */ 
 				CCP = CCP_IOREG_gc;
@@ -345,6 +439,7 @@ classb_wdt_test (void)
 	// Actions to take if there was an error.
 	// The test would be on fault state because:
     // - WDT could not be reset
+    // - the RTC does not match the CPU clock, in the single-reset test
     // - WDT did not issue a system reset on either timeout or untimely reset (window mode)
 	if (classb_wdt_teststate == FAULT_WDT)
 	{				
@@ -84,6 +84,20 @@
 //!   In addition to error handler and configurable actions, the user should configure the 
 //!   WDT periods \ref CLASSB_WDT_WPER and \ref CLASSB_WDT_PER.
 //!   
+//!   If \ref CLASSB_WDT_FAST is defined, a shorter test is done instead, with a single 
+//!   system reset. The WDT is set up in window mode with the short periods 
+//!   \ref CLASSB_WDT_FAST_WPER and \ref CLASSB_WDT_FAST_PER. It is first reset in the middle 
+//!   of the open period, which checks that the closed period is not too long and that the  
+//!   timeout is not too short. It is then reset again in the closed period, which should 
+//!   issue a system reset. The RTC is checked against the CPU clock while it times the 
+//!   open period. The test does not wait for a timeout, so it does not check that the WDT 
+//!   issues a system reset on timeout, only that it issues a reset at all.
+//!   
+//!   The time spent waiting in the test since the last power-on or external reset is 
+//!   kept in \ref classb_wdt_boot_time. With the default settings, the nominal value 
+//!   is about 230 RTC periods (700 ms) for the full test and 13 RTC periods (38 ms) for 
+//!   the short one. The synchronization of the WDT settings adds a few ms in both cases.
+//!   
 //!   \note The WDT should be left enabled by this test and be active at all times. There 
 //!   are a number of Class B tests that can potentially take longer time than a WDT, see 
 //!   for example \ref classb_crc. If this was the case, a possible solution would be to 
@@ -112,6 +126,38 @@
 #define CLASSB_WDT_PER			WDT_PER_250CLK_gc
 //@} 
 
+//! \name Settings for the single-reset test
+//@{
+#if defined(__DOXYGEN__)
+ //! \brief Do the single-reset test instead of the full test.
+ #define CLASSB_WDT_FAST
+#else
+ //#define CLASSB_WDT_FAST
+#endif
+
+//! \brief Closed period of the WDT during the single-reset test.
+//!
+//!  This should be given as one of the group configuration settings. The period should be 
+//!  long enough for the second reset of the WDT to be in the closed period.
+#define CLASSB_WDT_FAST_WPER		WDT_WPER_16CLK_gc
+
+//! \brief Open period of the WDT during the single-reset test.
+//!
+//!  This should be given as one of the group configuration settings. The open period has to 
+//!  start before the end of the closed period with the maximum deviation of the WDT 
+//!  oscillator, see \ref CLASSB_WDT_FAST_CLOSED_MAX, and end after it with the minimum 
+//!  deviation, see \ref CLASSB_WDT_FAST_OPEN_MIN. This is checked at compile time.
+#define CLASSB_WDT_FAST_PER			WDT_PER_64CLK_gc
+
+//! \brief TC that measures the RTC against the CPU clock.
+//!
+//!  The TC is stopped and left in its reset state after the test.
+#define CLASSB_WDT_FAST_TC			TCC0
+
+//! \brief Allowed deviation (%) of the RTC with respect to the CPU clock.
+#define CLASSB_WDT_FAST_CPU_TOL		10
+//@}
+
 //! \internal \name Settings that should not be modified
 //@{
 
@@ -150,6 +196,57 @@
 //! which starts at 0, so the real period will be <tt>CLASSB_WDT_RTC_PER+1</tt>.
 #define CLASSB_WDT_RTC_PER			2
 
+//! \internal \brief Closed period of the single-reset test in cycles.
+#define CLASSB_WDT_FAST_WPER_CYCLES	(8 * (1 << ( CLASSB_WDT_FAST_WPER >> 2) ) )
+
+//! \internal \brief Open period of the single-reset test in cycles.
+#define CLASSB_WDT_FAST_PER_CYCLES	(8 * (1 << ( CLASSB_WDT_FAST_PER >> 2) ) )
+
+//! \internal \brief Latest end of the closed period, with a +50% deviation of the WDT oscillator.
+#define CLASSB_WDT_FAST_CLOSED_MAX	( CLASSB_WDT_FAST_WPER_CYCLES + (CLASSB_WDT_FAST_WPER_CYCLES >> 1) )
+
+//! \internal \brief Earliest end of the open period, with a -50% deviation of the WDT oscillator.
+#define CLASSB_WDT_FAST_OPEN_MIN	( (CLASSB_WDT_FAST_WPER_CYCLES + CLASSB_WDT_FAST_PER_CYCLES) >> 1 )
+
+//! \internal \brief Uncertainty on the start of the WDT periods, in cycles.
+//! 
+//! The WDT starts counting before the settings are synchronized, and the wait starts 
+//! at the end of the current RTC period.
+#define CLASSB_WDT_FAST_SYNC		6
+
+//! \internal \brief Number of RTC periods to wait before the WDT is reset in the open period.
+//! 
+//! This is the middle of the open period, considering the deviation of the WDT oscillator 
+//! and the uncertainty on the start.
+#define CLASSB_WDT_FAST_WAIT		( ( (CLASSB_WDT_FAST_CLOSED_MAX + CLASSB_WDT_FAST_OPEN_MIN - CLASSB_WDT_FAST_SYNC) >> 1 ) \
+									/ (CLASSB_WDT_RTC_PER + 1) )
+
+//! \internal \brief Earliest end of the closed period, with a -50% deviation of the WDT oscillator.
+#define CLASSB_WDT_FAST_CLOSED_MIN	( CLASSB_WDT_FAST_WPER_CYCLES - (CLASSB_WDT_FAST_WPER_CYCLES >> 1) )
+
+//! \internal \brief Longest synchronization of a reset of the WDT, in cycles.
+//! 
+//! The reset takes up to 3 WDT cycles to be synchronized, i.e. 4.5 cycles with a +50% 
+//! deviation of the WDT oscillator, rounded up.
+#define CLASSB_WDT_FAST_WDR_SYNC	5
+
+//! \internal \brief Number of RTC periods between the two resets of the WDT.
+//! 
+//! The first reset has to be synchronized before the second one, and the second one 
+//! has to be in the closed period that the first one started. This is checked at 
+//! compile time.
+#define CLASSB_WDT_FAST_WDR_WAIT	2
+
+//! \internal \brief Frequency of the CPU after reset (Hz), i.e. the 2 MHz internal oscillator.
+#define CLASSB_WDT_FAST_CPU_FREQ	2000000UL
+
+//! \internal \brief Expected count of the TC, clocked by the CPU divided by 64, during the wait.
+#define CLASSB_WDT_FAST_TC_COUNT	( (1UL * CLASSB_WDT_FAST_WAIT * (CLASSB_WDT_RTC_PER + 1) * CLASSB_WDT_FAST_CPU_FREQ) \
+									/ (64UL * CLASSB_RTC_FREQ) )
+
+//! \internal \brief Limit for the deviation of the count of the TC.
+#define CLASSB_WDT_FAST_TC_LIMIT	( (CLASSB_WDT_FAST_TC_COUNT * CLASSB_WDT_FAST_CPU_TOL) / 100UL )
+
 //@}
 
 
@@ -160,8 +257,14 @@ typedef enum classb_preinit_teststate {
 	TEST_WDT_2,
 	TEST_WDT_3,
 	TEST_WDT_OK,
+	TEST_WDT_FAST,
 } classb_preinit_teststate_t;
 
+//! \name Global variables
+//@{
+NO_INIT extern volatile uint16_t classb_wdt_boot_time;
+//@}
+
 
 #if defined(__DOXYGEN__)
 	//! \name Class B Test
@@ -0,0 +1,1037 @@
+/*
+ * avr_cpu.c - AVRxm (XMEGA) CPU core for the host simulator.
+ */
+
+#include "avr_cpu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BIT(x, n)   (((x) >> (n)) & 1)
+#define FLAG(cpu, f) BIT((cpu)->sreg, f)
+
+static inline void set_flag(struct avr_cpu *cpu, unsigned f, unsigned v)
+{
+	cpu->sreg = (uint8_t)((cpu->sreg & ~(1u << f)) | ((v & 1u) << f));
+}
+
+static inline void set_zns(struct avr_cpu *cpu, uint8_t res)
+{
+	set_flag(cpu, SREG_Z, res == 0);
+	set_flag(cpu, SREG_N, BIT(res, 7));
+	set_flag(cpu, SREG_S, FLAG(cpu, SREG_N) ^ FLAG(cpu, SREG_V));
+}
+
+static void flags_add(struct avr_cpu *cpu, uint8_t d, uint8_t r, uint8_t res)
+{
+	unsigned c = (d & r) | (r & ~res) | (~res & d);
+	set_flag(cpu, SREG_H, BIT(c, 3));
+	set_flag(cpu, SREG_C, BIT(c, 7));
+	set_flag(cpu, SREG_V, BIT((d & r & ~res) | (~d & ~r & res), 7));
+	set_zns(cpu, res);
+}
+
+/* keep_z: SBC, SBCI and CPC only clear Z, they never set it. */
+static void flags_sub(struct avr_cpu *cpu, uint8_t d, uint8_t r, uint8_t res, int keep_z)
+{
+	unsigned b = (~d & r) | (r & res) | (res & ~d);
+	unsigned z = keep_z ? (res == 0 && FLAG(cpu, SREG_Z)) : (res == 0);
+	set_flag(cpu, SREG_H, BIT(b, 3));
+	set_flag(cpu, SREG_C, BIT(b, 7));
+	set_flag(cpu, SREG_V, BIT((d & ~r & ~res) | (~d & r & res), 7));
+	set_zns(cpu, res);
+	set_flag(cpu, SREG_Z, z);
+}
+
+static void flags_logic(struct avr_cpu *cpu, uint8_t res)
+{
+	set_flag(cpu, SREG_V, 0);
+	set_zns(cpu, res);
+}
+
+/* ---------------------------------------------------------------- memory */
+
+static inline int is_sram(const struct avr_cpu *cpu, uint32_t addr)
+{
+	return addr >= XMEGA_INTERNAL_SRAM_START && addr < XMEGA_INTERNAL_SRAM_START + cpu->dev->sram_size;
+}
+
+static void sp_changed(struct avr_cpu *cpu)
+{
+	if (cpu->hooks.sp_change)
+		cpu->hooks.sp_change(cpu, cpu->hooks.ctx);
+}
+
+static uint8_t io_read(struct avr_cpu *cpu, uint16_t a)
+{
+	int p;
+
+	switch (a) {
+	case IO_CCP:
+		return 0;
+	case IO_RAMPD: return cpu->rampd;
+	case IO_RAMPX: return cpu->rampx;
+	case IO_RAMPY: return cpu->rampy;
+	case IO_RAMPZ: return cpu->rampz;
+	case IO_EIND:  return cpu->eind;
+	case IO_SPL:   return (uint8_t)cpu->sp;
+	case IO_SPH:   return (uint8_t)(cpu->sp >> 8);
+	case IO_SREG:  return cpu->sreg;
+	case IO_SLEEP_CTRL: return cpu->sleep_ctrl;
+	case IO_PMIC_STATUS: return cpu->pmic_status;
+	case IO_PMIC_INTPRI: return cpu->pmic_intpri;
+	case IO_PMIC_CTRL:   return cpu->pmic_ctrl;
+	}
+	p = cpu->io_map[a];
+	if (p >= 0 && cpu->periph[p].read)
+		return cpu->periph[p].read(cpu, cpu->periph[p].ctx, (uint16_t)(a - cpu->periph[p].base));
+	return cpu->data[a];
+}
+
+static void io_write(struct avr_cpu *cpu, uint16_t a, uint8_t v)
+{
+	int p;
+
+	switch (a) {
+	case IO_CCP:
+		/* The protected write has to follow within four instructions. */
+		if (v == CCP_IOREG_KEY)
+			cpu->ccp_ioreg_until = cpu->cycles + 4 + 2;
+		else if (v == CCP_SPM_KEY)
+			cpu->ccp_spm_until = cpu->cycles + 4 + 2;
+		return;
+	case IO_RAMPD: cpu->rampd = v; return;
+	case IO_RAMPX: cpu->rampx = v; return;
+	case IO_RAMPY: cpu->rampy = v; return;
+	case IO_RAMPZ: cpu->rampz = v; return;
+	case IO_EIND:  cpu->eind = v; return;
+	case IO_SPL:
+		cpu->sp = (uint16_t)((cpu->sp & 0xFF00) | v);
+		sp_changed(cpu);
+		return;
+	case IO_SPH:
+		cpu->sp = (uint16_t)((cpu->sp & 0x00FF) | (v << 8));
+		sp_changed(cpu);
+		return;
+	case IO_SREG:  cpu->sreg = v; return;
+	case IO_SLEEP_CTRL: cpu->sleep_ctrl = v & 0x0F; return;
+	case IO_PMIC_STATUS: return;
+	case IO_PMIC_INTPRI: cpu->pmic_intpri = v; return;
+	case IO_PMIC_CTRL:
+		/* IVSEL and RREN are only changed after a CCP key, like on the device. */
+		if (!avr_ccp_ioreg_ok(cpu))
+			v = (uint8_t)((v & 0x07) | (cpu->pmic_ctrl & 0xC0));
+		cpu->pmic_ctrl = v & 0xC7;
+		return;
+	}
+	p = cpu->io_map[a];
+	if (p >= 0 && cpu->periph[p].write) {
+		cpu->periph[p].write(cpu, cpu->periph[p].ctx, (uint16_t)(a - cpu->periph[p].base), v);
+		return;
+	}
+	cpu->data[a] = v;
+}
+
+uint8_t avr_read(struct avr_cpu *cpu, uint32_t addr)
+{
+	if (addr < XMEGA_IO_SIZE)
+		return io_read(cpu, (uint16_t)addr);
+	if (is_sram(cpu, addr))
+		return cpu->sram.read ? cpu->sram.read(cpu, cpu->sram.ctx, (uint16_t)addr) : cpu->data[addr];
+	if (addr >= XMEGA_MAPPED_EEPROM_START && addr < XMEGA_MAPPED_EEPROM_START + cpu->dev->eeprom_size
+			&& cpu->eeprom_mapped)
+		return cpu->eeprom[addr - XMEGA_MAPPED_EEPROM_START];
+	cpu->unmapped_accesses++;
+	return 0;
+}
+
+void avr_write(struct avr_cpu *cpu, uint32_t addr, uint8_t value)
+{
+	if (addr < XMEGA_IO_SIZE) {
+		io_write(cpu, (uint16_t)addr, value);
+		return;
+	}
+	if (is_sram(cpu, addr)) {
+		if (cpu->sram.write)
+			cpu->sram.write(cpu, cpu->sram.ctx, (uint16_t)addr, value);
+		else
+			cpu->data[addr] = value;
+		return;
+	}
+	/* Mapped EEPROM is written through the NVM page buffer, which the NVM model handles. */
+	if (addr >= XMEGA_MAPPED_EEPROM_START && addr < XMEGA_MAPPED_EEPROM_START + cpu->dev->eeprom_size
+			&& cpu->eeprom_mapped) {
+		unsigned i;
+
+		for (i = 0; i < cpu->nperiph; i++)
+			if (cpu->periph[i].eeprom_write) {
+				cpu->periph[i].eeprom_write(cpu, cpu->periph[i].ctx,
+						(uint16_t)(addr - XMEGA_MAPPED_EEPROM_START), value);
+				return;
+			}
+	}
+	cpu->unmapped_accesses++;
+}
+
+static inline void push8(struct avr_cpu *cpu, uint8_t v)
+{
+	avr_write(cpu, cpu->sp, v);
+	cpu->sp--;
+}
+
+static inline uint8_t pop8(struct avr_cpu *cpu)
+{
+	cpu->sp++;
+	return avr_read(cpu, cpu->sp);
+}
+
+static void push_pc(struct avr_cpu *cpu, uint32_t pc)
+{
+	unsigned i;
+
+	for (i = 0; i < cpu->pc_bytes; i++) {
+		push8(cpu, (uint8_t)pc);
+		pc >>= 8;
+	}
+	sp_changed(cpu);
+}
+
+static uint32_t pop_pc(struct avr_cpu *cpu)
+{
+	uint32_t pc = 0;
+	unsigned i;
+
+	for (i = 0; i < cpu->pc_bytes; i++)
+		pc = (pc << 8) | pop8(cpu);
+	return pc;
+}
+
+static inline uint8_t flash_byte(const struct avr_cpu *cpu, uint32_t byteaddr)
+{
+	uint32_t w = byteaddr >> 1;
+
+	if (w >= cpu->flash_words)
+		return 0xFF;
+	return (byteaddr & 1) ? (uint8_t)(cpu->flash[w] >> 8) : (uint8_t)cpu->flash[w];
+}
+
+/* ---------------------------------------------------------------- setup */
+
+struct avr_cpu *avr_create(const struct xmega_device *dev)
+{
+	struct avr_cpu *cpu = calloc(1, sizeof(*cpu));
+
+	if (!cpu)
+		return NULL;
+	cpu->dev = dev;
+	cpu->flash_words = (dev->app_size + dev->boot_size) / 2;
+	cpu->flash = malloc(cpu->flash_words * sizeof(uint16_t));
+	cpu->data = calloc(1, 0x10000);
+	cpu->eeprom = malloc(dev->eeprom_size);
+	if (!cpu->flash || !cpu->data || !cpu->eeprom) {
+		avr_destroy(cpu);
+		return NULL;
+	}
+	memset(cpu->flash, 0xFF, cpu->flash_words * sizeof(uint16_t));
+	memset(cpu->eeprom, 0xFF, dev->eeprom_size);
+	memset(cpu->io_map, -1, sizeof(cpu->io_map));
+	cpu->pc_bytes = xmega_pc_bytes(dev);
+	cpu->eeprom_mapped = 1;
+	cpu->f_cpu = 2000000;
+	return cpu;
+}
+
+void avr_destroy(struct avr_cpu *cpu)
+{
+	if (!cpu)
+		return;
+	free(cpu->flash);
+	free(cpu->data);
+	free(cpu->eeprom);
+	free(cpu);
+}
+
+int avr_add_periph(struct avr_cpu *cpu, const struct avr_periph *p)
+{
+	unsigned i;
+	int idx;
+
+	if (cpu->nperiph >= AVR_MAX_PERIPHS || (uint32_t)p->base + p->size > XMEGA_IO_SIZE)
+		return -1;
+	idx = (int)cpu->nperiph++;
+	cpu->periph[idx] = *p;
+	for (i = 0; i < p->size; i++)
+		cpu->io_map[p->base + i] = (int8_t)idx;
+	return idx;
+}
+
+void avr_reset(struct avr_cpu *cpu, uint8_t cause)
+{
+	unsigned i;
+
+	memset(cpu->r, 0, sizeof(cpu->r));
+	memset(cpu->data, 0, XMEGA_IO_SIZE);
+	cpu->pc = 0;
+	cpu->sreg = 0;
+	cpu->sp = (uint16_t)(XMEGA_INTERNAL_SRAM_START + cpu->dev->sram_size - 1);
+	cpu->rampd = cpu->rampx = cpu->rampy = cpu->rampz = cpu->eind = 0;
+	cpu->pmic_status = cpu->pmic_intpri = cpu->pmic_ctrl = 0;
+	memset(cpu->irq_pending, 0, sizeof(cpu->irq_pending));
+	memset(cpu->irq_owner, -1, sizeof(cpu->irq_owner));
+	cpu->irq_count = 0;
+	cpu->sleep_ctrl = 0;
+	cpu->ccp_ioreg_until = cpu->ccp_spm_until = 0;
+	cpu->f_cpu = 2000000;
+	cpu->stall = 0;
+	cpu->reset_request = 0;
+	cpu->state = AVR_RUNNING;
+	cpu->reset_flags |= cause;
+	if (cause != AVR_RESET_POWERON)
+		cpu->resets++;
+
+	for (i = 0; i < cpu->nperiph; i++)
+		if (cpu->periph[i].reset)
+			cpu->periph[i].reset(cpu, cpu->periph[i].ctx, cause);
+	sp_changed(cpu);
+}
+
+/* ---------------------------------------------------------------- interrupts */
+
+void avr_irq_raise(struct avr_cpu *cpu, unsigned vector, enum avr_irq_level level, int periph)
+{
+	if (vector >= AVR_MAX_VECTORS || level == IRQ_NONE)
+		return;
+	if (!cpu->irq_pending[vector])
+		cpu->irq_count++;
+	cpu->irq_pending[vector] = (uint8_t)level;
+	cpu->irq_owner[vector] = (int8_t)periph;
+}
+
+void avr_irq_clear(struct avr_cpu *cpu, unsigned vector)
+{
+	if (vector >= AVR_MAX_VECTORS || !cpu->irq_pending[vector])
+		return;
+	cpu->irq_pending[vector] = 0;
+	cpu->irq_count--;
+}
+
+/* Highest priority request that may interrupt now, or -1. */
+static int irq_select(struct avr_cpu *cpu)
+{
+	int level;
+
+	if (!cpu->irq_count || !FLAG(cpu, SREG_I))
+		return -1;
+
+	for (level = IRQ_HI; level >= IRQ_LO; level--) {
+		unsigned v, n;
+
+		if (!(cpu->pmic_ctrl & (1u << (level - 1))))
+			continue;
+		/* A level can only interrupt lower levels. */
+		if (cpu->pmic_status >> (level - 1))
+			return -1;
+		/* Round-robin scheduling for the low level starts after the last served vector. */
+		if (level == IRQ_LO && (cpu->pmic_ctrl & 0x80)) {
+			for (n = 1; n <= AVR_MAX_VECTORS; n++) {
+				v = (cpu->pmic_intpri + n) % AVR_MAX_VECTORS;
+				if (cpu->irq_pending[v] == level)
+					return (int)v;
+			}
+			continue;
+		}
+		for (v = 0; v < AVR_MAX_VECTORS; v++)
+			if (cpu->irq_pending[v] == level)
+				return (int)v;
+	}
+	return -1;
+}
+
+static uint32_t irq_enter(struct avr_cpu *cpu, unsigned vector)
+{
+	unsigned level = cpu->irq_pending[vector];
+	uint16_t sp = cpu->sp;
+	int owner = cpu->irq_owner[vector];
+	uint32_t base = (cpu->pmic_ctrl & 0x40) ? cpu->dev->app_size / 2 : 0;
+
+	cpu->pmic_status |= (uint8_t)(1u << (level - 1));
+	if (level == IRQ_LO && (cpu->pmic_ctrl & 0x80))
+		cpu->pmic_intpri = (uint8_t)vector;
+
+	push_pc(cpu, cpu->pc);
+	cpu->pc = base + vector * 2;
+
+	if (owner >= 0 && cpu->periph[owner].irq_ack)
+		cpu->periph[owner].irq_ack(cpu, cpu->periph[owner].ctx, vector);
+
+	if (cpu->hooks.call)
+		cpu->hooks.call(cpu, cpu->hooks.ctx, cpu->pc, 1, sp);
+	return 5;
+}
+
+/* ---------------------------------------------------------------- execution */
+
+static void clock_periphs(struct avr_cpu *cpu, uint32_t cycles)
+{
+	unsigned i;
+
+	for (i = 0; i < cpu->nperiph; i++)
+		if (cpu->periph[i].clock)
+			cpu->periph[i].clock(cpu, cpu->periph[i].ctx, cycles);
+}
+
+/* True if an endless loop or sleep can still be left by an interrupt or a reset. */
+static int can_wake(struct avr_cpu *cpu)
+{
+	unsigned i, wake = 0;
+
+	for (i = 0; i < cpu->nperiph; i++)
+		if (cpu->periph[i].pending)
+			wake |= cpu->periph[i].pending(cpu, cpu->periph[i].ctx);
+	if (!FLAG(cpu, SREG_I))
+		return (wake & AVR_WAKE_RESET) != 0;
+	return wake != 0 || cpu->irq_count != 0;
+}
+
+static inline uint16_t reg16(const struct avr_cpu *cpu, unsigned r)
+{
+	return (uint16_t)(cpu->r[r] | (cpu->r[r + 1] << 8));
+}
+
+static inline void set_reg16(struct avr_cpu *cpu, unsigned r, uint16_t v)
+{
+	cpu->r[r] = (uint8_t)v;
+	cpu->r[r + 1] = (uint8_t)(v >> 8);
+}
+
+/* Indirect data address from a pointer register pair and its RAMP register. */
+static inline uint32_t ptr_addr(const struct avr_cpu *cpu, unsigned r, uint8_t ramp)
+{
+	return ((uint32_t)ramp << 16) | reg16(cpu, r);
+}
+
+/* Load from data space; returns the extra cycle for internal SRAM. */
+static inline uint32_t load(struct avr_cpu *cpu, uint32_t addr, unsigned d)
+{
+	cpu->r[d] = avr_read(cpu, addr);
+	return is_sram(cpu, addr) ? 1 : 0;
+}
+
+static uint32_t skip_next(struct avr_cpu *cpu)
+{
+	unsigned n = cpu->pc < cpu->flash_words ? avr_insn_words(cpu->flash[cpu->pc]) : 1;
+
+	cpu->pc += n;
+	return n;
+}
+
+static void do_call(struct avr_cpu *cpu, uint32_t target, uint32_t ret)
+{
+	uint16_t sp = cpu->sp;
+
+	push_pc(cpu, ret);
+	cpu->pc = target;
+	if (cpu->hooks.call)
+		cpu->hooks.call(cpu, cpu->hooks.ctx, target, 0, sp);
+}
+
+static void do_ret(struct avr_cpu *cpu, int reti)
+{
+	cpu->pc = pop_pc(cpu);
+	if (reti) {
+		/* Clear the highest level in service. The I flag is not changed on XMEGA. */
+		if (cpu->pmic_status & 0x04)
+			cpu->pmic_status &= (uint8_t)~0x04;
+		else if (cpu->pmic_status & 0x02)
+			cpu->pmic_status &= (uint8_t)~0x02;
+		else
+			cpu->pmic_status &= (uint8_t)~0x01;
+	}
+	if (cpu->hooks.ret)
+		cpu->hooks.ret(cpu, cpu->hooks.ctx, reti);
+}
+
+/* Execute the instruction at PC; returns its cycles. */
+static uint32_t execute(struct avr_cpu *cpu)
+{
+	uint32_t pc = cpu->pc;
+	uint16_t op = cpu->flash[pc];
+	unsigned d = (op >> 4) & 0x1F;
+	unsigned r = (op & 0x0F) | ((op >> 5) & 0x10);
+	uint8_t K = (uint8_t)(((op >> 4) & 0xF0) | (op & 0x0F));
+	unsigned dh = 16 + ((op >> 4) & 0x0F);     /* d for immediate instructions */
+	uint8_t rd, rr, res;
+	uint32_t cyc = 1;
+	unsigned i;
+
+	cpu->pc = pc + 1;
+
+	switch (op >> 12) {
+	case 0x0:
+		switch ((op >> 10) & 3) {
+		case 0:
+			switch ((op >> 8) & 3) {
+			case 0:         /* NOP */
+				if (op != 0)
+					goto invalid;
+				break;
+			case 1:         /* MOVW */
+				cpu->r[((op >> 4) & 0xF) * 2] = cpu->r[(op & 0xF) * 2];
+				cpu->r[((op >> 4) & 0xF) * 2 + 1] = cpu->r[(op & 0xF) * 2 + 1];
+				break;
+			case 2: {       /* MULS */
+				int16_t p = (int16_t)((int8_t)cpu->r[dh] * (int8_t)cpu->r[16 + (op & 0xF)]);
+				set_reg16(cpu, 0, (uint16_t)p);
+				set_flag(cpu, SREG_C, BIT((uint16_t)p, 15));
+				set_flag(cpu, SREG_Z, p == 0);
+				cyc = 2;
+				break;
+			}
+			case 3: {       /* MULSU, FMUL, FMULS, FMULSU */
+				unsigned a = 16 + ((op >> 4) & 7), b = 16 + (op & 7);
+				int32_t p;
+				int frac = 0;
+
+				switch (op & 0x88) {
+				case 0x00: p = (int8_t)cpu->r[a] * (int32_t)cpu->r[b]; break;
+				case 0x08: p = (int32_t)cpu->r[a] * cpu->r[b]; frac = 1; break;
+				case 0x80: p = (int8_t)cpu->r[a] * (int8_t)cpu->r[b]; frac = 1; break;
+				default:   p = (int8_t)cpu->r[a] * (int32_t)cpu->r[b]; frac = 1; break;
+				}
+				set_flag(cpu, SREG_C, BIT((uint32_t)p, 15));
+				if (frac)
+					p <<= 1;
+				set_reg16(cpu, 0, (uint16_t)p);
+				set_flag(cpu, SREG_Z, (uint16_t)p == 0);
+				cyc = 2;
+				break;
+			}
+			}
+			break;
+		case 1:             /* CPC */
+			rd = cpu->r[d]; rr = cpu->r[r];
+			res = (uint8_t)(rd - rr - FLAG(cpu, SREG_C));
+			flags_sub(cpu, rd, rr, res, 1);
+			break;
+		case 2:             /* SBC */
+			rd = cpu->r[d]; rr = cpu->r[r];
+			res = (uint8_t)(rd - rr - FLAG(cpu, SREG_C));
+			flags_sub(cpu, rd, rr, res, 1);
+			cpu->r[d] = res;
+			break;
+		case 3:             /* ADD */
+			rd = cpu->r[d]; rr = cpu->r[r];
+			res = (uint8_t)(rd + rr);
+			flags_add(cpu, rd, rr, res);
+			cpu->r[d] = res;
+			break;
+		}
+		break;
+	case 0x1:
+		switch ((op >> 10) & 3) {
+		case 0:             /* CPSE */
+			if (cpu->r[d] == cpu->r[r])
+				cyc += skip_next(cpu);
+			break;
+		case 1:             /* CP */
+			rd = cpu->r[d]; rr = cpu->r[r];
+			flags_sub(cpu, rd, rr, (uint8_t)(rd - rr), 0);
+			break;
+		case 2:             /* SUB */
+			rd = cpu->r[d]; rr = cpu->r[r];
+			res = (uint8_t)(rd - rr);
+			flags_sub(cpu, rd, rr, res, 0);
+			cpu->r[d] = res;
+			break;
+		case 3:             /* ADC */
+			rd = cpu->r[d]; rr = cpu->r[r];
+			res = (uint8_t)(rd + rr + FLAG(cpu, SREG_C));
+			flags_add(cpu, rd, rr, res);
+			cpu->r[d] = res;
+			break;
+		}
+		break;
+	case 0x2:
+		rd = cpu->r[d]; rr = cpu->r[r];
+		switch ((op >> 10) & 3) {
+		case 0: res = rd & rr; flags_logic(cpu, res); cpu->r[d] = res; break;   /* AND */
+		case 1: res = rd ^ rr; flags_logic(cpu, res); cpu->r[d] = res; break;   /* EOR */
+		case 2: res = rd | rr; flags_logic(cpu, res); cpu->r[d] = res; break;   /* OR */
+		case 3: cpu->r[d] = rr; break;                                          /* MOV */
+		}
+		break;
+	case 0x3:               /* CPI */
+		rd = cpu->r[dh];
+		flags_sub(cpu, rd, K, (uint8_t)(rd - K), 0);
+		break;
+	case 0x4:               /* SBCI */
+		rd = cpu->r[dh];
+		res = (uint8_t)(rd - K - FLAG(cpu, SREG_C));
+		flags_sub(cpu, rd, K, res, 1);
+		cpu->r[dh] = res;
+		break;
+	case 0x5:               /* SUBI */
+		rd = cpu->r[dh];
+		res = (uint8_t)(rd - K);
+		flags_sub(cpu, rd, K, res, 0);
+		cpu->r[dh] = res;
+		break;
+	case 0x6:               /* ORI */
+		res = cpu->r[dh] | K;
+		flags_logic(cpu, res);
+		cpu->r[dh] = res;
+		break;
+	case 0x7:               /* ANDI */
+		res = cpu->r[dh] & K;
+		flags_logic(cpu, res);
+		cpu->r[dh] = res;
+		break;
+	case 0x8:
+	case 0xA: {             /* LDD/STD Y+q, Z+q */
+		unsigned q = (op & 7) | ((op >> 7) & 0x18) | ((op >> 8) & 0x20);
+		unsigned ptr = (op & 0x08) ? 28 : 30;
+		uint32_t addr = ptr_addr(cpu, ptr, ptr == 28 ? cpu->rampy : cpu->rampz) + q;
+
+		if (op & 0x0200) {
+			avr_write(cpu, addr, cpu->r[d]);
+			cyc = q ? 2 : 1;
+		} else {
+			cyc = (q ? 2 : 1) + load(cpu, addr, d);
+		}
+		break;
+	}
+	case 0x9:
+		switch ((op >> 8) & 0xF) {
+		case 0x0:
+		case 0x1: {         /* loads */
+			uint32_t addr;
+
+			switch (op & 0xF) {
+			case 0x0:       /* LDS */
+				addr = ((uint32_t)cpu->rampd << 16) | cpu->flash[cpu->pc % cpu->flash_words];
+				cpu->pc++;
+				cyc = 2 + load(cpu, addr, d);
+				break;
+			case 0x1:       /* LD Z+ */
+				addr = ptr_addr(cpu, 30, cpu->rampz);
+				cyc = 1 + load(cpu, addr, d);
+				set_reg16(cpu, 30, (uint16_t)(reg16(cpu, 30) + 1));
+				break;
+			case 0x2:       /* LD -Z */
+				set_reg16(cpu, 30, (uint16_t)(reg16(cpu, 30) - 1));
+				cyc = 2 + load(cpu, ptr_addr(cpu, 30, cpu->rampz), d);
+				break;
+			case 0x4:       /* LPM Rd, Z */
+			case 0x5:       /* LPM Rd, Z+ */
+				cpu->r[d] = flash_byte(cpu, reg16(cpu, 30));
+				if (op & 1)
+					set_reg16(cpu, 30, (uint16_t)(reg16(cpu, 30) + 1));
+				cyc = 3;
+				break;
+			case 0x6:       /* ELPM Rd, Z */
+			case 0x7: {     /* ELPM Rd, Z+ */
+				uint32_t z = ((uint32_t)cpu->rampz << 16) | reg16(cpu, 30);
+
+				cpu->r[d] = flash_byte(cpu, z);
+				if (op & 1) {
+					z++;
+					set_reg16(cpu, 30, (uint16_t)z);
+					cpu->rampz = (uint8_t)(z >> 16);
+				}
+				cyc = 3;
+				break;
+			}
+			case 0x9:       /* LD Y+ */
+				addr = ptr_addr(cpu, 28, cpu->rampy);
+				cyc = 1 + load(cpu, addr, d);
+				set_reg16(cpu, 28, (uint16_t)(reg16(cpu, 28) + 1));
+				break;
+			case 0xA:       /* LD -Y */
+				set_reg16(cpu, 28, (uint16_t)(reg16(cpu, 28) - 1));
+				cyc = 2 + load(cpu, ptr_addr(cpu, 28, cpu->rampy), d);
+				break;
+			case 0xC:       /* LD X */
+				cyc = 1 + load(cpu, ptr_addr(cpu, 26, cpu->rampx), d);
+				break;
+			case 0xD:       /* LD X+ */
+				addr = ptr_addr(cpu, 26, cpu->rampx);
+				cyc = 1 + load(cpu, addr, d);
+				set_reg16(cpu, 26, (uint16_t)(reg16(cpu, 26) + 1));
+				break;
+			case 0xE:       /* LD -X */
+				set_reg16(cpu, 26, (uint16_t)(reg16(cpu, 26) - 1));
+				cyc = 2 + load(cpu, ptr_addr(cpu, 26, cpu->rampx), d);
+				break;
+			case 0xF:       /* POP */
+				cpu->r[d] = pop8(cpu);
+				cyc = 2;
+				break;
+			default:
+				goto invalid;
+			}
+			break;
+		}
+		case 0x2:
+		case 0x3: {         /* stores */
+			uint32_t addr;
+			uint8_t m;
+
+			switch (op & 0xF) {
+			case 0x0:       /* STS */
+				addr = ((uint32_t)cpu->rampd << 16) | cpu->flash[cpu->pc % cpu->flash_words];
+				cpu->pc++;
+				avr_write(cpu, addr, cpu->r[d]);
+				cyc = 2;
+				break;
+			case 0x1:       /* ST Z+ */
+				avr_write(cpu, ptr_addr(cpu, 30, cpu->rampz), cpu->r[d]);
+				set_reg16(cpu, 30, (uint16_t)(reg16(cpu, 30) + 1));
+				break;
+			case 0x2:       /* ST -Z */
+				set_reg16(cpu, 30, (uint16_t)(reg16(cpu, 30) - 1));
+				avr_write(cpu, ptr_addr(cpu, 30, cpu->rampz), cpu->r[d]);
+				cyc = 2;
+				break;
+			case 0x4:       /* XCH */
+			case 0x5:       /* LAS */
+			case 0x6:       /* LAC */
+			case 0x7:       /* LAT */
+				addr = ptr_addr(cpu, 30, cpu->rampz);
+				m = avr_read(cpu, addr);
+				switch (op & 0xF) {
+				case 0x4: avr_write(cpu, addr, cpu->r[d]); break;
+				case 0x5: avr_write(cpu, addr, (uint8_t)(m | cpu->r[d])); break;
+				case 0x6: avr_write(cpu, addr, (uint8_t)(m & ~cpu->r[d])); break;
+				case 0x7: avr_write(cpu, addr, (uint8_t)(m ^ cpu->r[d])); break;
+				}
+				cpu->r[d] = m;
+				cyc = 2;
+				break;
+			case 0x9:       /* ST Y+ */
+				avr_write(cpu, ptr_addr(cpu, 28, cpu->rampy), cpu->r[d]);
+				set_reg16(cpu, 28, (uint16_t)(reg16(cpu, 28) + 1));
+				break;
+			case 0xA:       /* ST -Y */
+				set_reg16(cpu, 28, (uint16_t)(reg16(cpu, 28) - 1));
+				avr_write(cpu, ptr_addr(cpu, 28, cpu->rampy), cpu->r[d]);
+				cyc = 2;
+				break;
+			case 0xC:       /* ST X */
+				avr_write(cpu, ptr_addr(cpu, 26, cpu->rampx), cpu->r[d]);
+				break;
+			case 0xD:       /* ST X+ */
+				avr_write(cpu, ptr_addr(cpu, 26, cpu->rampx), cpu->r[d]);
+				set_reg16(cpu, 26, (uint16_t)(reg16(cpu, 26) + 1));
+				break;
+			case 0xE:       /* ST -X */
+				set_reg16(cpu, 26, (uint16_t)(reg16(cpu, 26) - 1));
+				avr_write(cpu, ptr_addr(cpu, 26, cpu->rampx), cpu->r[d]);
+				cyc = 2;
+				break;
+			case 0xF:       /* PUSH */
+				push8(cpu, cpu->r[d]);
+				sp_changed(cpu);
+				break;
+			default:
+				goto invalid;
+			}
+			break;
+		}
+		case 0x4:
+		case 0x5:
+			if ((op & 0x0E) == 0x0C || (op & 0x0E) == 0x0E) {     /* JMP, CALL */
+				uint32_t k = ((uint32_t)(((op >> 3) & 0x3E) | (op & 1)) << 16) | cpu->flash[cpu->pc % cpu->flash_words];
+
+				if (op & 2) {
+					do_call(cpu, k, cpu->pc + 1);
+					cyc = cpu->pc_bytes == 3 ? 4 : 3;
+				} else {
+					cpu->pc = k;
+					cyc = 3;
+				}
+				break;
+			}
+			switch (op & 0xF) {
+			case 0x0: cpu->r[d] = (uint8_t)~cpu->r[d];                      /* COM */
+				flags_logic(cpu, cpu->r[d]);
+				set_flag(cpu, SREG_C, 1);
+				break;
+			case 0x1:                                                       /* NEG */
+				rd = cpu->r[d];
+				res = (uint8_t)(0 - rd);
+				cpu->r[d] = res;
+				set_flag(cpu, SREG_H, BIT(res | rd, 3));
+				set_flag(cpu, SREG_V, res == 0x80);
+				set_flag(cpu, SREG_C, res != 0);
+				set_zns(cpu, res);
+				break;
+			case 0x2: cpu->r[d] = (uint8_t)((cpu->r[d] << 4) | (cpu->r[d] >> 4)); break;   /* SWAP */
+			case 0x3:                                                       /* INC */
+				res = (uint8_t)(cpu->r[d] + 1);
+				set_flag(cpu, SREG_V, res == 0x80);
+				set_zns(cpu, res);
+				cpu->r[d] = res;
+				break;
+			case 0x5:                                                       /* ASR */
+			case 0x6:                                                       /* LSR */
+			case 0x7:                                                       /* ROR */
+				rd = cpu->r[d];
+				if ((op & 0xF) == 0x5)
+					res = (uint8_t)((rd >> 1) | (rd & 0x80));
+				else if ((op & 0xF) == 0x6)
+					res = (uint8_t)(rd >> 1);
+				else
+					res = (uint8_t)((rd >> 1) | (FLAG(cpu, SREG_C) << 7));
+				set_flag(cpu, SREG_C, rd & 1);
+				set_flag(cpu, SREG_N, BIT(res, 7));
+				set_flag(cpu, SREG_V, FLAG(cpu, SREG_N) ^ FLAG(cpu, SREG_C));
+				set_flag(cpu, SREG_S, FLAG(cpu, SREG_N) ^ FLAG(cpu, SREG_V));
+				set_flag(cpu, SREG_Z, res == 0);
+				cpu->r[d] = res;
+				break;
+			case 0x8:
+				if (op & 0x0100) {
+					switch ((op >> 4) & 0xF) {
+					case 0x0:                                               /* RET */
+					case 0x1:                                               /* RETI */
+						do_ret(cpu, (op >> 4) & 1);
+						cyc = cpu->pc_bytes == 3 ? 5 : 4;
+						break;
+					case 0x8:                                               /* SLEEP */
+						if (cpu->sleep_ctrl & 1)
+							cpu->state = AVR_SLEEPING;
+						break;
+					case 0x9:                                               /* BREAK */
+						cpu->state = AVR_BREAK;
+						break;
+					case 0xA:                                               /* WDR */
+						for (i = 0; i < cpu->nperiph; i++)
+							if (cpu->periph[i].wdr)
+								cpu->periph[i].wdr(cpu, cpu->periph[i].ctx);
+						break;
+					case 0xC:                                               /* LPM */
+						cpu->r[0] = flash_byte(cpu, reg16(cpu, 30));
+						cyc = 3;
+						break;
+					case 0xD:                                               /* ELPM */
+						cpu->r[0] = flash_byte(cpu, ((uint32_t)cpu->rampz << 16) | reg16(cpu, 30));
+						cyc = 3;
+						break;
+					case 0xE:                                               /* SPM */
+					case 0xF: {                                             /* SPM Z+ */
+						uint32_t z = ((uint32_t)cpu->rampz << 16) | reg16(cpu, 30);
+
+						for (i = 0; i < cpu->nperiph; i++)
+							if (cpu->periph[i].spm)
+								cyc += cpu->periph[i].spm(cpu, cpu->periph[i].ctx, z);
+						if (op & 0x10) {
+							z += 2;
+							set_reg16(cpu, 30, (uint16_t)z);
+							cpu->rampz = (uint8_t)(z >> 16);
+						}
+						break;
+					}
+					default:
+						goto invalid;
+					}
+				} else {                                                    /* BSET, BCLR */
+					set_flag(cpu, (op >> 4) & 7, !((op >> 7) & 1));
+				}
+				break;
+			case 0x9:
+				switch (op & 0x01F0) {
+				case 0x0000: cpu->pc = reg16(cpu, 30); cyc = 2; break;                      /* IJMP */
+				case 0x0010: cpu->pc = ((uint32_t)cpu->eind << 16) | reg16(cpu, 30); cyc = 2; break;  /* EIJMP */
+				case 0x0100:                                                                /* ICALL */
+					do_call(cpu, reg16(cpu, 30), cpu->pc);
+					cyc = cpu->pc_bytes == 3 ? 3 : 2;
+					break;
+				case 0x0110:                                                                /* EICALL */
+					do_call(cpu, ((uint32_t)cpu->eind << 16) | reg16(cpu, 30), cpu->pc);
+					cyc = 3;
+					break;
+				default:
+					goto invalid;
+				}
+				break;
+			case 0xA:                                                       /* DEC */
+				res = (uint8_t)(cpu->r[d] - 1);
+				set_flag(cpu, SREG_V, res == 0x7F);
+				set_zns(cpu, res);
+				cpu->r[d] = res;
+				break;
+			default:
+				/* DES is only on devices with the crypto engine; not modelled. */
+				goto invalid;
+			}
+			break;
+		case 0x6:
+		case 0x7: {         /* ADIW, SBIW */
+			unsigned rp = 24 + ((op >> 3) & 6);
+			uint16_t v = reg16(cpu, rp);
+			uint16_t k = (uint16_t)(((op >> 2) & 0x30) | (op & 0xF));
+			uint16_t res16 = (op & 0x0100) ? (uint16_t)(v - k) : (uint16_t)(v + k);
+
+			set_reg16(cpu, rp, res16);
+			if (op & 0x0100) {
+				set_flag(cpu, SREG_V, BIT(v & ~res16, 15));
+				set_flag(cpu, SREG_C, BIT(res16 & ~v, 15));
+			} else {
+				set_flag(cpu, SREG_V, BIT(~v & res16, 15));
+				set_flag(cpu, SREG_C, BIT(~res16 & v, 15));
+			}
+			set_flag(cpu, SREG_N, BIT(res16, 15));
+			set_flag(cpu, SREG_Z, res16 == 0);
+			set_flag(cpu, SREG_S, FLAG(cpu, SREG_N) ^ FLAG(cpu, SREG_V));
+			cyc = 2;
+			break;
+		}
+		case 0x8:
+		case 0x9:
+		case 0xA:
+		case 0xB: {         /* CBI, SBIC, SBI, SBIS */
+			uint16_t a = (op >> 3) & 0x1F;
+			unsigned b = op & 7;
+			uint8_t v = io_read(cpu, a);
+
+			switch ((op >> 8) & 3) {
+			case 0: io_write(cpu, a, (uint8_t)(v & ~(1u << b))); break;
+			case 2: io_write(cpu, a, (uint8_t)(v | (1u << b))); break;
+			case 1:
+			case 3:
+				cyc = 2;
+				if (BIT(v, b) == ((op >> 9) & 1))
+					cyc += skip_next(cpu);
+				break;
+			}
+			break;
+		}
+		default: {          /* MUL */
+			uint16_t p = (uint16_t)(cpu->r[d] * cpu->r[r]);
+
+			set_reg16(cpu, 0, p);
+			set_flag(cpu, SREG_C, BIT(p, 15));
+			set_flag(cpu, SREG_Z, p == 0);
+			cyc = 2;
+			break;
+		}
+		}
+		break;
+	case 0xB: {             /* IN, OUT */
+		uint16_t a = (uint16_t)(((op >> 5) & 0x30) | (op & 0xF));
+
+		if (op & 0x0800)
+			io_write(cpu, a, cpu->r[d]);
+		else
+			cpu->r[d] = io_read(cpu, a);
+		break;
+	}
+	case 0xC: {             /* RJMP */
+		int32_t k = (int32_t)((int16_t)(op << 4) >> 4);
+
+		/* An endless loop that nothing can interrupt, e.g. avr-libc _exit. */
+		if (k == -1 && !can_wake(cpu))
+			cpu->state = AVR_HALTED;
+		cpu->pc = (uint32_t)((int32_t)cpu->pc + k) % cpu->flash_words;
+		cyc = 2;
+		break;
+	}
+	case 0xD: {             /* RCALL */
+		int32_t k = (int32_t)((int16_t)(op << 4) >> 4);
+
+		do_call(cpu, (uint32_t)((int32_t)cpu->pc + k) % cpu->flash_words, cpu->pc);
+		cyc = cpu->pc_bytes == 3 ? 3 : 2;
+		break;
+	}
+	case 0xE:               /* LDI */
+		cpu->r[dh] = K;
+		break;
+	case 0xF:
+		if (!(op & 0x0800)) {   /* BRBS, BRBC */
+			unsigned s = op & 7;
+			int32_t k = (int32_t)((int16_t)(op << 6) >> 9);
+
+			if (FLAG(cpu, s) == !((op >> 10) & 1)) {
+				cpu->pc = (uint32_t)((int32_t)cpu->pc + k) % cpu->flash_words;
+				cyc = 2;
+			}
+		} else if (op & 0x0008) {
+			goto invalid;
+		} else {
+			unsigned b = op & 7;
+
+			switch ((op >> 9) & 3) {
+			case 0: /* BLD */
+				cpu->r[d] = (uint8_t)((cpu->r[d] & ~(1u << b)) | (FLAG(cpu, SREG_T) << b));
+				break;
+			case 1: /* BST */
+				set_flag(cpu, SREG_T, BIT(cpu->r[d], b));
+				break;
+			case 2: /* SBRC */
+			case 3: /* SBRS */
+				if (BIT(cpu->r[d], b) == ((op >> 9) & 1))
+					cyc += skip_next(cpu);
+				break;
+			}
+		}
+		break;
+	}
+	return cyc;
+
+invalid:
+	cpu->pc = pc;
+	cpu->state = AVR_CRASHED;
+	return 0;
+}
+
+void avr_step(struct avr_cpu *cpu)
+{
+	uint32_t cyc = 0;
+	int v;
+
+	if (cpu->state != AVR_RUNNING && cpu->state != AVR_SLEEPING)
+		return;
+
+	v = irq_select(cpu);
+	if (v >= 0) {
+		/* Waking up from sleep adds five cycles to the response time. */
+		if (cpu->state == AVR_SLEEPING) {
+			cyc += 5;
+			cpu->state = AVR_RUNNING;
+		}
+		cyc += irq_enter(cpu, (unsigned)v);
+		cpu->last_pc = cpu->pc;
+	} else if (cpu->state == AVR_SLEEPING) {
+		if (!can_wake(cpu)) {
+			cpu->state = AVR_HALTED;
+			return;
+		}
+		cpu->sleep_cycles++;
+		cyc = 1;
+	} else {
+		if (cpu->pc >= cpu->flash_words) {
+			cpu->state = AVR_CRASHED;
+			return;
+		}
+		cpu->last_pc = cpu->pc;
+		cyc = execute(cpu);
+		if (cpu->state == AVR_CRASHED)
+			return;
+		cpu->instructions++;
+	}
+
+	/* The CPU is halted while e.g. a Flash CRC or page write runs, the peripherals are not. */
+	if (cpu->stall) {
+		cyc += cpu->stall;
+		cpu->stall = 0;
+	}
+
+	cpu->last_cycles = cyc;
+	cpu->cycles += cyc;
+	cpu->seconds += (double)cyc / cpu->f_cpu;
+	clock_periphs(cpu, cyc);
+
+	if (cpu->reset_request)
+		avr_reset(cpu, cpu->reset_request);
+}
@@ -0,0 +1,216 @@
+/*
+ * avr_cpu.h - AVRxm (XMEGA) CPU core for the host simulator.
+ *
+ * The core executes one instruction per avr_step() and charges the cycle
+ * counts of the XMEGA column of the AVR instruction set manual:
+ *   - LD/LDD/LDS take one extra cycle when they read internal SRAM,
+ *   - ST/STD/STS and PUSH take 1 (2 for pre-decrement, displacement and STS),
+ *   - POP 2, CALL 3/4, RCALL/ICALL 2/3, RET/RETI 4/5 (2/3 byte PC),
+ *   - interrupt entry 5.
+ *
+ * Peripherals attach through struct avr_periph: they own a range of the I/O
+ * space, are clocked with the cycles of every instruction, and raise
+ * interrupts through avr_irq_raise(). The PMIC (interrupt levels, RETI
+ * bookkeeping, IVSEL), SLEEP.CTRL and the CPU registers (CCP, RAMPx, EIND,
+ * SP, SREG) are part of the core. I/O addresses without a peripheral
+ * behave like plain registers.
+ */
+
+#ifndef AVRSIM_AVR_CPU_H
+#define AVRSIM_AVR_CPU_H
+
+#include <stdint.h>
+
+#include "xmega_devices.h"
+
+/* SREG bits. */
+#define SREG_C 0
+#define SREG_Z 1
+#define SREG_N 2
+#define SREG_V 3
+#define SREG_S 4
+#define SREG_H 5
+#define SREG_T 6
+#define SREG_I 7
+
+/* CPU and PMIC register addresses in the I/O space. */
+#define IO_GPIOR0     0x0000
+#define IO_CCP        0x0034
+#define IO_RAMPD      0x0038
+#define IO_RAMPX      0x0039
+#define IO_RAMPY      0x003A
+#define IO_RAMPZ      0x003B
+#define IO_EIND       0x003C
+#define IO_SPL        0x003D
+#define IO_SPH        0x003E
+#define IO_SREG       0x003F
+#define IO_SLEEP_CTRL 0x0048
+#define IO_PMIC_STATUS 0x00A0
+#define IO_PMIC_INTPRI 0x00A1
+#define IO_PMIC_CTRL   0x00A2
+
+#define CCP_SPM_KEY   0x9D
+#define CCP_IOREG_KEY 0xD8
+
+#define AVR_MAX_VECTORS 128
+#define AVR_MAX_PERIPHS 32
+
+/* Interrupt levels, as in PMIC.STATUS/CTRL (NMI is not modelled). */
+enum avr_irq_level { IRQ_NONE = 0, IRQ_LO = 1, IRQ_MED = 2, IRQ_HI = 3 };
+
+/* Why avr_step()/avr_run() stopped. */
+enum avr_state {
+	AVR_RUNNING,
+	AVR_SLEEPING,
+	AVR_HALTED,     /* endless loop or sleep that nothing can end, e.g. avr-libc _exit */
+	AVR_BREAK,      /* BREAK instruction */
+	AVR_STOPPED,    /* stop address reached */
+	AVR_LIMIT,      /* cycle limit reached */
+	AVR_CRASHED,    /* invalid opcode or PC outside of Flash */
+};
+
+/* Reset sources, as in RST.STATUS. */
+#define AVR_RESET_POWERON  0x01
+#define AVR_RESET_EXTERNAL 0x02
+#define AVR_RESET_BROWNOUT 0x04
+#define AVR_RESET_WDT      0x08
+#define AVR_RESET_PDI      0x10
+#define AVR_RESET_SOFTWARE 0x20
+
+/* Results of avr_periph.pending(): a peripheral will raise an interrupt or a reset. */
+#define AVR_WAKE_IRQ   0x01
+#define AVR_WAKE_RESET 0x02
+
+struct avr_cpu;
+
+struct avr_periph {
+	const char *name;
+	uint16_t base;      /* first I/O address */
+	uint16_t size;      /* number of I/O addresses, 0 for none */
+	void *ctx;
+	uint8_t (*read)(struct avr_cpu *cpu, void *ctx, uint16_t offset);
+	void (*write)(struct avr_cpu *cpu, void *ctx, uint16_t offset, uint8_t value);
+	/* Called after every instruction (and while sleeping) with the elapsed CPU cycles. */
+	void (*clock)(struct avr_cpu *cpu, void *ctx, uint32_t cycles);
+	/* Called on every reset with the RST.STATUS bits of the reset source. */
+	void (*reset)(struct avr_cpu *cpu, void *ctx, uint8_t cause);
+	/* Called when an interrupt of this peripheral is accepted, e.g. to clear its flag. */
+	void (*irq_ack)(struct avr_cpu *cpu, void *ctx, unsigned vector);
+	/* WDR executed. */
+	void (*wdr)(struct avr_cpu *cpu, void *ctx);
+	/* SPM executed with the given Z/RAMPZ address. Returns extra cycles. */
+	uint32_t (*spm)(struct avr_cpu *cpu, void *ctx, uint32_t zaddr);
+	/* AVR_WAKE_* bits of what this peripheral can still do without the CPU. */
+	unsigned (*pending)(struct avr_cpu *cpu, void *ctx);
+	/* Data space write to the mapped EEPROM, at this EEPROM offset. */
+	void (*eeprom_write)(struct avr_cpu *cpu, void *ctx, uint16_t offset, uint8_t value);
+};
+
+/* Hooks that tools can install, e.g. the profiler. All are optional. */
+struct avr_hooks {
+	void *ctx;
+	/* A call (CALL, RCALL, ICALL, EICALL) or interrupt went to target (word address). */
+	void (*call)(struct avr_cpu *cpu, void *ctx, uint32_t target, int is_irq, uint16_t sp_before);
+	/* A RET or RETI was executed. */
+	void (*ret)(struct avr_cpu *cpu, void *ctx, int is_reti);
+	/* SP decreased (PUSH, call, interrupt, or a write to SPL/SPH). */
+	void (*sp_change)(struct avr_cpu *cpu, void *ctx);
+};
+
+/* Interposer for the internal SRAM accesses, e.g. a fault model. Both or none. */
+struct avr_sram_hooks {
+	void *ctx;
+	uint8_t (*read)(struct avr_cpu *cpu, void *ctx, uint16_t addr);
+	void (*write)(struct avr_cpu *cpu, void *ctx, uint16_t addr, uint8_t value);
+};
+
+struct avr_cpu {
+	const struct xmega_device *dev;
+	uint16_t *flash;            /* words */
+	uint32_t flash_words;
+	uint8_t *data;              /* 64 KB data space, backing store for I/O without a peripheral */
+	uint8_t *eeprom;            /* EEPROM contents, mapped at 0x1000 when enabled */
+	int eeprom_mapped;          /* controlled by the NVM model, 1 if there is none */
+
+	uint8_t r[32];
+	uint32_t pc;                /* word address */
+	uint8_t sreg;
+	uint16_t sp;
+	uint8_t rampd, rampx, rampy, rampz, eind;
+	unsigned pc_bytes;
+
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t sleep_cycles;
+	uint32_t f_cpu;             /* Hz, set by the clock model; for peripherals that need real time */
+	double seconds;             /* simulated time, following f_cpu changes */
+	uint64_t ccp_ioreg_until;   /* protected I/O writes allowed up to this cycle */
+	uint64_t ccp_spm_until;
+
+	uint32_t stall;             /* cycles the CPU is halted after this step, e.g. by the NVM */
+	uint8_t reset_request;      /* reset source to apply after this step, 0 for none */
+	unsigned resets;            /* resets since power-on */
+
+	enum avr_state state;
+	uint32_t last_cycles;       /* cycles of the last step */
+	uint32_t last_pc;           /* instruction (or interrupt vector) of the last step */
+
+	/* PMIC */
+	uint8_t pmic_status;
+	uint8_t pmic_intpri;
+	uint8_t pmic_ctrl;
+	uint8_t irq_pending[AVR_MAX_VECTORS];   /* level of a pending request, 0 for none */
+	int8_t irq_owner[AVR_MAX_VECTORS];      /* peripheral that raised it, -1 if none */
+	unsigned irq_count;
+	uint8_t sleep_ctrl;
+
+	struct avr_periph periph[AVR_MAX_PERIPHS];
+	unsigned nperiph;
+	int8_t io_map[XMEGA_IO_SIZE];           /* peripheral index per I/O address, -1 if none */
+
+	struct avr_hooks hooks;
+	struct avr_sram_hooks sram;
+
+	uint64_t unmapped_accesses;
+	uint8_t reset_flags;        /* accumulated reset causes, for RST.STATUS */
+};
+
+/* Create a CPU for a device. The Flash and EEPROM are erased (0xFF). */
+struct avr_cpu *avr_create(const struct xmega_device *dev);
+void avr_destroy(struct avr_cpu *cpu);
+
+/* Add a peripheral; returns its index or -1. */
+int avr_add_periph(struct avr_cpu *cpu, const struct avr_periph *p);
+
+/* Reset the CPU and all peripherals. SRAM keeps its contents.
+ * Peripherals request a reset through cpu->reset_request instead. */
+void avr_reset(struct avr_cpu *cpu, uint8_t cause);
+
+/* Execute one instruction, or one cycle of sleep, then any stall and reset request. */
+void avr_step(struct avr_cpu *cpu);
+
+/* Raise or withdraw an interrupt request. periph is the caller's index or -1. */
+void avr_irq_raise(struct avr_cpu *cpu, unsigned vector, enum avr_irq_level level, int periph);
+void avr_irq_clear(struct avr_cpu *cpu, unsigned vector);
+
+/* Data space access as seen by the CPU (I/O side effects included). */
+uint8_t avr_read(struct avr_cpu *cpu, uint32_t addr);
+void avr_write(struct avr_cpu *cpu, uint32_t addr, uint8_t value);
+
+/* True if a write to a CCP protected I/O register is allowed now. */
+static inline int avr_ccp_ioreg_ok(const struct avr_cpu *cpu)
+{
+	return cpu->cycles <= cpu->ccp_ioreg_until;
+}
+
+/* Disassemble one instruction at word address pc into buf; returns its length in words. */
+unsigned avr_disasm(const struct avr_cpu *cpu, uint32_t pc, char *buf, unsigned size);
+
+/* Length in words of the instruction with this first word. */
+static inline unsigned avr_insn_words(uint16_t op)
+{
+	return ((op & 0xFC0F) == 0x9000 ||      /* LDS, STS */
+			(op & 0xFE0C) == 0x940C) ? 2 : 1; /* JMP, CALL */
+}
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * avr_disasm.c - AVRxm disassembler for traces and error messages.
+ */
+
+#include "avr_cpu.h"
+
+#include <stdio.h>
+
+static const char *const ptr_ops[16] = {
+	NULL, "Z+", "-Z", NULL, NULL, NULL, NULL, NULL,
+	NULL, "Y+", "-Y", NULL, "X", "X+", "-X", NULL,
+};
+
+unsigned avr_disasm(const struct avr_cpu *cpu, uint32_t pc, char *buf, unsigned size)
+{
+	uint16_t op = pc < cpu->flash_words ? cpu->flash[pc] : 0xFFFF;
+	uint16_t next = pc + 1 < cpu->flash_words ? cpu->flash[pc + 1] : 0xFFFF;
+	unsigned d = (op >> 4) & 0x1F;
+	unsigned r = (op & 0x0F) | ((op >> 5) & 0x10);
+	unsigned K = ((op >> 4) & 0xF0) | (op & 0x0F);
+	unsigned dh = 16 + ((op >> 4) & 0x0F);
+	static const char *const rr_ops[16] = {
+		NULL, "cpc", "sbc", "add", "cpse", "cp", "sub", "adc",
+		"and", "eor", "or", "mov", NULL, NULL, NULL, NULL,
+	};
+	static const char *const imm_ops[8] = {
+		NULL, NULL, NULL, "cpi", "sbci", "subi", "ori", "andi",
+	};
+	static const char *const one_ops[16] = {
+		"com", "neg", "swap", "inc", NULL, "asr", "lsr", "ror",
+		NULL, NULL, "dec", NULL, NULL, NULL, NULL, NULL,
+	};
+	static const char *const misc_ops[16] = {
+		"ret", "reti", NULL, NULL, NULL, NULL, NULL, NULL,
+		"sleep", "break", "wdr", NULL, "lpm", "elpm", "spm", "spm Z+",
+	};
+	static const char *const brbs[8] = { "brcs", "breq", "brmi", "brvs", "brlt", "brhs", "brts", "brie" };
+	static const char *const brbc[8] = { "brcc", "brne", "brpl", "brvc", "brge", "brhc", "brtc", "brid" };
+	static const char flags[] = "CZNVSHTI";
+
+	if (op == 0x0000)
+		snprintf(buf, size, "nop");
+	else if ((op & 0xFF00) == 0x0100)
+		snprintf(buf, size, "movw r%u, r%u", ((op >> 4) & 0xF) * 2, (op & 0xF) * 2);
+	else if ((op & 0xFF00) == 0x0200)
+		snprintf(buf, size, "muls r%u, r%u", dh, 16 + (op & 0xF));
+	else if ((op & 0xFF00) == 0x0300) {
+		static const char *const m[4] = { "mulsu", "fmul", "fmuls", "fmulsu" };
+		snprintf(buf, size, "%s r%u, r%u", m[((op >> 6) & 2) | ((op >> 3) & 1)],
+				16 + ((op >> 4) & 7), 16 + (op & 7));
+	} else if (op < 0x3000 && rr_ops[op >> 10])
+		snprintf(buf, size, "%s r%u, r%u", rr_ops[op >> 10], d, r);
+	else if (op >= 0x3000 && op < 0x8000)
+		snprintf(buf, size, "%s r%u, 0x%02X", imm_ops[op >> 12], dh, K);
+	else if ((op & 0xD000) == 0x8000) {
+		unsigned q = (op & 7) | ((op >> 7) & 0x18) | ((op >> 8) & 0x20);
+		char p = (op & 8) ? 'Y' : 'Z';
+
+		if (op & 0x0200)
+			snprintf(buf, size, "std %c+%u, r%u", p, q, d);
+		else
+			snprintf(buf, size, "ldd r%u, %c+%u", d, p, q);
+	} else if ((op & 0xFC00) == 0x9000) {
+		int st = op & 0x0200;
+
+		switch (op & 0xF) {
+		case 0x0:
+			if (st)
+				snprintf(buf, size, "sts 0x%04X, r%u", next, d);
+			else
+				snprintf(buf, size, "lds r%u, 0x%04X", d, next);
+			break;
+		case 0x4: case 0x5: case 0x6: case 0x7:
+			if (st) {
+				static const char *const m[4] = { "xch", "las", "lac", "lat" };
+				snprintf(buf, size, "%s Z, r%u", m[op & 3], d);
+			} else {
+				snprintf(buf, size, "%s r%u, Z%s", (op & 2) ? "elpm" : "lpm", d, (op & 1) ? "+" : "");
+			}
+			break;
+		case 0xF:
+			snprintf(buf, size, "%s r%u", st ? "push" : "pop", d);
+			break;
+		default:
+			if (!ptr_ops[op & 0xF])
+				snprintf(buf, size, ".word 0x%04X", op);
+			else if (st)
+				snprintf(buf, size, "st %s, r%u", ptr_ops[op & 0xF], d);
+			else
+				snprintf(buf, size, "ld r%u, %s", d, ptr_ops[op & 0xF]);
+			break;
+		}
+	} else if ((op & 0xFE0C) == 0x940C) {
+		uint32_t k = ((uint32_t)(((op >> 3) & 0x3E) | (op & 1)) << 16) | next;
+		snprintf(buf, size, "%s 0x%X", (op & 2) ? "call" : "jmp", k * 2);
+	} else if ((op & 0xFE00) == 0x9400 && one_ops[op & 0xF])
+		snprintf(buf, size, "%s r%u", one_ops[op & 0xF], d);
+	else if ((op & 0xFF8F) == 0x9408)
+		snprintf(buf, size, "se%c", flags[(op >> 4) & 7] + 'a' - 'A');
+	else if ((op & 0xFF8F) == 0x9488)
+		snprintf(buf, size, "cl%c", flags[(op >> 4) & 7] + 'a' - 'A');
+	else if ((op & 0xFF0F) == 0x9508 && misc_ops[(op >> 4) & 0xF])
+		snprintf(buf, size, "%s", misc_ops[(op >> 4) & 0xF]);
+	else if (op == 0x9409 || op == 0x9419 || op == 0x9509 || op == 0x9519) {
+		static const char *const m[4] = { "ijmp", "eijmp", "icall", "eicall" };
+		snprintf(buf, size, "%s", m[((op >> 7) & 2) | ((op >> 4) & 1)]);
+	} else if ((op & 0xFE00) == 0x9600)
+		snprintf(buf, size, "%s r%u, %u", (op & 0x0100) ? "sbiw" : "adiw",
+				24 + ((op >> 3) & 6), ((op >> 2) & 0x30) | (op & 0xF));
+	else if ((op & 0xFC00) == 0x9800) {
+		static const char *const m[4] = { "cbi", "sbic", "sbi", "sbis" };
+		snprintf(buf, size, "%s 0x%02X, %u", m[(op >> 8) & 3], (op >> 3) & 0x1F, op & 7);
+	} else if ((op & 0xFC00) == 0x9C00)
+		snprintf(buf, size, "mul r%u, r%u", d, r);
+	else if ((op & 0xF000) == 0xB000) {
+		unsigned a = ((op >> 5) & 0x30) | (op & 0xF);
+
+		if (op & 0x0800)
+			snprintf(buf, size, "out 0x%02X, r%u", a, d);
+		else
+			snprintf(buf, size, "in r%u, 0x%02X", d, a);
+	} else if ((op & 0xE000) == 0xC000) {
+		int32_t k = (int16_t)(op << 4) >> 4;
+		snprintf(buf, size, "%s .%+d ; 0x%X", (op & 0x1000) ? "rcall" : "rjmp", (int)(k * 2),
+				(unsigned)(((pc + 1 + k) % cpu->flash_words) * 2));
+	} else if ((op & 0xF000) == 0xE000)
+		snprintf(buf, size, "ldi r%u, 0x%02X", dh, K);
+	else if ((op & 0xF800) == 0xF000) {
+		int32_t k = (int16_t)(op << 6) >> 9;
+		snprintf(buf, size, "%s .%+d ; 0x%X", ((op & 0x0400) ? brbc : brbs)[op & 7], (int)(k * 2),
+				(unsigned)(((pc + 1 + k) % cpu->flash_words) * 2));
+	} else if ((op & 0xF808) == 0xF800) {
+		static const char *const m[4] = { "bld", "bst", "sbrc", "sbrs" };
+		snprintf(buf, size, "%s r%u, %u", m[(op >> 9) & 3], d, op & 7);
+	} else
+		snprintf(buf, size, ".word 0x%04X", op);
+
+	return avr_insn_words(op);
+}
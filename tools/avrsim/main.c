@@ -0,0 +1,661 @@
+/*
+ * avrsim - cycle counting XMEGA simulator for the Class B tests.
+ *
+ * Loads an avr-gcc ELF file, runs it from reset (the .init1 RAM test and the
+ * C start-up code included) and reports the exact cycle counts of the AVRxm
+ * core: in total, when marks are reached, per function and per address
+ * range. The run ends when the program halts (the endless loop of _exit with
+ * interrupts disabled), executes BREAK, sleeps with nothing left to wake it,
+ * reaches a stop address or exceeds the cycle limit.
+ *
+ * The peripherals of the Class B tests are modelled (see xmega_periph.h),
+ * so the tests run as on the device: the CPU clock follows the CLK
+ * registers and the watchdog and software resets restart the program.
+ *
+ * Faults can be injected into the SRAM (see memfault.h) to measure whether
+ * and after how many cycles a test detects them.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "avr_cpu.h"
+#include "elf32.h"
+#include "memfault.h"
+#include "profile.h"
+#include "xmega_devices.h"
+#include "xmega_periph.h"
+
+#define MAX_MARKS  32
+#define MAX_RANGES 32
+#define MAX_FAULTS 32
+#define MAX_CALLS  32
+#define MAX_CALL_RECORDS 4096
+
+struct mark {
+	const char *name;
+	uint32_t pc;                /* word address */
+	int hit;
+	uint64_t cycles;
+};
+
+struct range {
+	const char *name;
+	uint32_t start, end;        /* word addresses */
+};
+
+static const char *const state_names[] = {
+	[AVR_RUNNING] = "running",
+	[AVR_SLEEPING] = "sleeping",
+	[AVR_HALTED] = "halted",
+	[AVR_BREAK] = "break",
+	[AVR_STOPPED] = "stopped",
+	[AVR_LIMIT] = "cycle limit",
+	[AVR_CRASHED] = "crashed",
+};
+
+static int parse_u64(const char *s, uint64_t *v)
+{
+	char *end;
+
+	if (!*s)
+		return -1;
+	*v = strtoull(s, &end, 0);
+	/* Allow 1e6 style limits and frequencies. */
+	if (*end == 'e' || *end == 'E') {
+		long e = strtol(end + 1, &end, 10);
+
+		while (e-- > 0)
+			*v *= 10;
+	}
+	return *end ? -1 : 0;
+}
+
+/* Byte address of a symbol or number; *size gets the symbol size (0 for numbers). */
+static int parse_addr(const struct elf_file *ef, const char *s, uint32_t *addr, uint32_t *size)
+{
+	const struct elf_symbol *sym = elf_find_symbol(ef, s);
+	uint64_t v;
+
+	*size = 0;
+	if (sym) {
+		*addr = sym->value;
+		*size = sym->size;
+		return 0;
+	}
+	if (parse_u64(s, &v) || v >= AVR_SRAM_BASE) {
+		fprintf(stderr, "avrsim: '%s' is not a Flash symbol or address\n", s);
+		return -1;
+	}
+	*addr = (uint32_t)v;
+	return 0;
+}
+
+/* START:END or a symbol, for its whole size. */
+static int parse_range(const struct elf_file *ef, char *s, struct range *r)
+{
+	char *colon = strchr(s, ':');
+	uint32_t a, b, size;
+
+	r->name = s;
+	if (!colon) {
+		if (parse_addr(ef, s, &a, &size))
+			return -1;
+		if (!size) {
+			fprintf(stderr, "avrsim: symbol '%s' has no size, give START:END\n", s);
+			return -1;
+		}
+		b = a + size;
+	} else {
+		char *name = strdup(s);
+
+		if (!name)
+			return -1;
+		*colon = '\0';
+		if (parse_addr(ef, s, &a, &size) || parse_addr(ef, colon + 1, &b, &size))
+			return free(name), -1;
+		r->name = name;
+	}
+	r->start = a / 2;
+	r->end = (b + 1) / 2;
+	return 0;
+}
+
+static const char *pc_name(const struct profile *p, uint32_t pc, char *buf, size_t size)
+{
+	int f = profile_find_func(p, pc);
+
+	if (f < 0)
+		snprintf(buf, size, "0x%05X", (unsigned)pc * 2);
+	else if (pc == p->funcs[f].start)
+		snprintf(buf, size, "0x%05X <%s>", (unsigned)pc * 2, p->funcs[f].name);
+	else
+		snprintf(buf, size, "0x%05X <%s+0x%X>", (unsigned)pc * 2, p->funcs[f].name,
+				(unsigned)(pc - p->funcs[f].start) * 2);
+	return buf;
+}
+
+static void json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fputc('\\', f);
+		fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static uint8_t fault_read(struct avr_cpu *cpu, void *ctx, uint16_t addr)
+{
+	struct mf_memory *m = ctx;
+
+	m->now = cpu->cycles;
+	return mf_read(m, addr);
+}
+
+static void fault_write(struct avr_cpu *cpu, void *ctx, uint16_t addr, uint8_t value)
+{
+	struct mf_memory *m = ctx;
+
+	m->now = cpu->cycles;
+	mf_write(m, addr, value);
+}
+
+static int write_json(const char *path, const char *image, const struct avr_cpu *cpu, const struct profile *p,
+		const struct mark *marks, unsigned nmarks, const struct range *ranges, unsigned nranges,
+		const struct mf_memory *faults, const struct mark *detect)
+{
+	char spec[96];
+	FILE *f = fopen(path, "w");
+	unsigned i, first = 1;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "{\n  \"image\": ");
+	json_string(f, image);
+	fprintf(f, ",\n  \"device\": \"%s\",\n  \"f_cpu\": %lu,\n", cpu->dev->name, (unsigned long)cpu->f_cpu);
+	fprintf(f, "  \"state\": \"%s\",\n  \"pc\": %lu,\n", state_names[cpu->state], (unsigned long)cpu->pc * 2);
+	fprintf(f, "  \"cycles\": %llu,\n  \"instructions\": %llu,\n  \"sleep_cycles\": %llu,\n",
+			(unsigned long long)cpu->cycles, (unsigned long long)cpu->instructions,
+			(unsigned long long)cpu->sleep_cycles);
+	fprintf(f, "  \"seconds\": %.9f,\n  \"resets\": %u,\n", cpu->seconds, cpu->resets);
+	fprintf(f, "  \"max_stack\": %u,\n  \"faults\": [", profile_max_stack(p));
+	for (i = 0; i < faults->nfaults; i++) {
+		mf_format(&faults->faults[i], spec, sizeof(spec));
+		fprintf(f, "%s\"%s\"", i ? ", " : "", spec);
+	}
+	fprintf(f, "],\n");
+	if (detect && detect->hit)
+		fprintf(f, "  \"detected\": %llu,\n", (unsigned long long)detect->cycles);
+	else if (detect)
+		fprintf(f, "  \"detected\": null,\n");
+	fprintf(f, "  \"marks\": [");
+	for (i = 0; i < nmarks; i++) {
+		fprintf(f, "%s\n    { \"name\": ", i ? "," : "");
+		json_string(f, marks[i].name);
+		if (marks[i].hit)
+			fprintf(f, ", \"cycles\": %llu }", (unsigned long long)marks[i].cycles);
+		else
+			fprintf(f, ", \"cycles\": null }");
+	}
+	fprintf(f, "%s],\n  \"ranges\": [", nmarks ? "\n  " : "");
+	for (i = 0; i < nranges; i++) {
+		fprintf(f, "%s\n    { \"name\": ", i ? "," : "");
+		json_string(f, ranges[i].name);
+		fprintf(f, ", \"start\": %lu, \"end\": %lu, \"cycles\": %llu }",
+				(unsigned long)ranges[i].start * 2, (unsigned long)ranges[i].end * 2,
+				(unsigned long long)profile_range_cycles(p, ranges[i].start, ranges[i].end));
+	}
+	fprintf(f, "%s],\n  \"functions\": [", nranges ? "\n  " : "");
+	for (i = 0; i < p->nfuncs; i++) {
+		const struct prof_func *fn = &p->funcs[i];
+		uint64_t self = profile_range_cycles(p, fn->start, fn->end);
+
+		if (!self && !fn->calls)
+			continue;
+		fprintf(f, "%s\n    { \"name\": ", first ? "" : ",");
+		json_string(f, fn->name);
+		fprintf(f, ", \"address\": %lu, \"self\": %llu, \"calls\": %llu", (unsigned long)fn->start * 2,
+				(unsigned long long)self, (unsigned long long)fn->calls);
+		if (fn->calls)
+			fprintf(f, ", \"inclusive\": %llu, \"min\": %llu, \"max\": %llu, \"stack\": %u",
+					(unsigned long long)fn->incl, (unsigned long long)fn->min,
+					(unsigned long long)fn->max, fn->max_stack);
+		fprintf(f, ", \"irq\": %s", fn->irq ? "true" : "false");
+		if (fn->each) {
+			unsigned j;
+
+			fprintf(f, ", \"each\": [");
+			for (j = 0; j < fn->neach; j++)
+				fprintf(f, "%s{ \"cycles\": %llu, \"stack\": %u }", j ? ", " : "",
+						(unsigned long long)fn->each[j].cycles, fn->each[j].stack);
+			fprintf(f, "]");
+		}
+		fprintf(f, " }");
+		first = 0;
+	}
+	fprintf(f, "%s]\n}\n", first ? "" : "\n  ");
+	return fclose(f) == 0 ? 0 : -1;
+}
+
+/* NAME=HZ for --osc. */
+static int parse_osc(const char *s, struct xmega_periph_conf *conf)
+{
+	static const struct {
+		const char *name;
+		size_t offset;
+	} oscs[] = {
+		{ "rc2m", offsetof(struct xmega_periph_conf, rc2m_hz) },
+		{ "rc32m", offsetof(struct xmega_periph_conf, rc32m_hz) },
+		{ "rc32k", offsetof(struct xmega_periph_conf, rc32k_hz) },
+		{ "ulp", offsetof(struct xmega_periph_conf, ulp_hz) },
+		{ "xosc", offsetof(struct xmega_periph_conf, xosc_hz) },
+	};
+	const char *eq = strchr(s, '=');
+	uint64_t hz;
+	unsigned i;
+
+	for (i = 0; eq && i < sizeof(oscs) / sizeof(oscs[0]); i++)
+		if (strlen(oscs[i].name) == (size_t)(eq - s) && !strncmp(s, oscs[i].name, eq - s)) {
+			if (parse_u64(eq + 1, &hz) || !hz || hz > UINT32_MAX)
+				break;
+			*(uint32_t *)((char *)conf + oscs[i].offset) = (uint32_t)hz;
+			return 0;
+		}
+	fprintf(stderr, "avrsim: bad oscillator '%s', give rc2m, rc32m, rc32k, ulp or xosc=HZ\n", s);
+	return -1;
+}
+
+static void usage(FILE *f)
+{
+	unsigned i;
+
+	fprintf(f,
+		"Usage: avrsim [options] IMAGE.elf\n"
+		"\n"
+		"Run an XMEGA program from reset and report its exact cycle counts.\n"
+		"\n"
+		"  -d, --device NAME        device (default: from the ELF device info)\n"
+		"  -f, --freq HZ            CPU clock with --no-periph (default 2000000)\n"
+		"  -o, --osc NAME=HZ        frequency of an oscillator: rc2m, rc32m, rc32k, ulp\n"
+		"                           or xosc (default nominal, no crystal; repeatable)\n"
+		"  -P, --no-periph          no peripheral models, plain registers only\n"
+		"  -s, --stop SYM|ADDR      stop when this address is reached\n"
+		"  -m, --mark SYM|ADDR      report the cycle count when this address is first\n"
+		"                           reached (repeatable)\n"
+		"  -r, --range R            report the cycles spent in R: a symbol or START:END,\n"
+		"                           each a symbol or byte address (repeatable)\n"
+		"  -C, --calls SYM          report the cycles and stack of each call of this\n"
+		"                           function, up to 4096 calls (repeatable)\n"
+		"  -c, --max-cycles N       cycle limit (default 1e9)\n"
+		"  -t, --top N              functions in the profile (default 20, 0 for all)\n"
+		"  -F, --fault SPEC         inject a fault into the SRAM, see memfault.h\n"
+		"                           (repeatable)\n"
+		"  -D, --detect SYM|ADDR    the test detected the faults when this address is\n"
+		"                           reached, e.g. its error handler; the run stops there\n"
+		"  -T, --trace N            print the first N instructions\n"
+		"  -j, --json FILE          also write the results as JSON\n"
+		"  -q, --quiet              no profile table\n"
+		"  -h, --help               show this help\n"
+		"\n"
+		"Exit status: 0 if the program halted, stopped or hit BREAK, 1 if it crashed,\n"
+		"2 for usage errors, 3 if the cycle limit was reached.\n"
+		"\n"
+		"Devices:");
+	for (i = 0; i < xmega_ndevices; i++)
+		fprintf(f, " %s", xmega_devices[i].name);
+	fprintf(f, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "device", required_argument, NULL, 'd' },
+		{ "freq", required_argument, NULL, 'f' },
+		{ "osc", required_argument, NULL, 'o' },
+		{ "no-periph", no_argument, NULL, 'P' },
+		{ "stop", required_argument, NULL, 's' },
+		{ "mark", required_argument, NULL, 'm' },
+		{ "range", required_argument, NULL, 'r' },
+		{ "calls", required_argument, NULL, 'C' },
+		{ "max-cycles", required_argument, NULL, 'c' },
+		{ "top", required_argument, NULL, 't' },
+		{ "fault", required_argument, NULL, 'F' },
+		{ "detect", required_argument, NULL, 'D' },
+		{ "trace", required_argument, NULL, 'T' },
+		{ "json", required_argument, NULL, 'j' },
+		{ "quiet", no_argument, NULL, 'q' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	const char *device = NULL, *stop = NULL, *json = NULL, *detect_arg = NULL;
+	const char *mark_args[MAX_MARKS];
+	char *range_args[MAX_RANGES];
+	const char *call_args[MAX_CALLS];
+	int calls[MAX_CALLS];
+	unsigned nmarks = 0, nranges = 0, ncalls = 0, nfaults = 0, i;
+	uint64_t max_cycles = 1000000000ULL, freq = 0, top = 20, trace = 0, v;
+	int quiet = 0, periph = 1, c, status;
+	const struct xmega_device *dev;
+	struct mark marks[MAX_MARKS];
+	struct range ranges[MAX_RANGES];
+	struct mf_fault faults[MAX_FAULTS];
+	struct mf_memory fmem;
+	struct mark detect = { NULL, UINT32_MAX, 0, 0 };
+	uint32_t stop_pc = UINT32_MAX, size;
+	struct elf_file ef;
+	struct avr_cpu *cpu;
+	struct profile prof;
+	struct xmega_periph_conf conf = { 0 };
+	struct xmega_periph *x = NULL;
+	unsigned resets = 0;
+	uint8_t *image;
+	char where[128];
+
+	while ((c = getopt_long(argc, argv, "d:f:o:Ps:m:r:C:c:t:F:D:T:j:qh", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'd':
+			device = optarg;
+			break;
+		case 'f':
+		case 'c':
+		case 't':
+		case 'T':
+			if (parse_u64(optarg, &v)) {
+				fprintf(stderr, "avrsim: bad number '%s'\n", optarg);
+				return 2;
+			}
+			if (c == 'f')
+				freq = v;
+			else if (c == 'c')
+				max_cycles = v;
+			else if (c == 't')
+				top = v;
+			else
+				trace = v;
+			break;
+		case 'o':
+			if (parse_osc(optarg, &conf))
+				return 2;
+			break;
+		case 'P':
+			periph = 0;
+			break;
+		case 's':
+			stop = optarg;
+			break;
+		case 'm':
+			if (nmarks == MAX_MARKS) {
+				fprintf(stderr, "avrsim: too many marks\n");
+				return 2;
+			}
+			mark_args[nmarks++] = optarg;
+			break;
+		case 'r':
+			if (nranges == MAX_RANGES) {
+				fprintf(stderr, "avrsim: too many ranges\n");
+				return 2;
+			}
+			range_args[nranges++] = optarg;
+			break;
+		case 'C':
+			if (ncalls == MAX_CALLS) {
+				fprintf(stderr, "avrsim: too many functions for --calls\n");
+				return 2;
+			}
+			call_args[ncalls++] = optarg;
+			break;
+		case 'F':
+			if (nfaults == MAX_FAULTS) {
+				fprintf(stderr, "avrsim: too many faults\n");
+				return 2;
+			}
+			if (mf_parse(optarg, &faults[nfaults++]))
+				return 2;
+			break;
+		case 'D':
+			detect_arg = optarg;
+			break;
+		case 'j':
+			json = optarg;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+	if (optind + 1 != argc) {
+		usage(stderr);
+		return 2;
+	}
+	if (freq && periph) {
+		fprintf(stderr, "avrsim: the CPU clock follows the clock model, --freq needs --no-periph\n");
+		return 2;
+	}
+
+	if (elf_load(argv[optind], &ef))
+		return 1;
+
+	dev = device ? xmega_find_device(device) : xmega_detect_device(&ef);
+	if (!dev) {
+		if (device)
+			fprintf(stderr, "avrsim: unknown device '%s'\n", device);
+		else
+			fprintf(stderr, "avrsim: %s: no known device in the ELF file, use -d\n", argv[optind]);
+		return 2;
+	}
+
+	for (i = 0; i < nmarks; i++) {
+		uint32_t a;
+
+		if (parse_addr(&ef, mark_args[i], &a, &size))
+			return 2;
+		marks[i].name = mark_args[i];
+		marks[i].pc = a / 2;
+		marks[i].hit = 0;
+	}
+	for (i = 0; i < nranges; i++)
+		if (parse_range(&ef, range_args[i], &ranges[i]))
+			return 2;
+	if (stop) {
+		if (parse_addr(&ef, stop, &stop_pc, &size))
+			return 2;
+		stop_pc /= 2;
+	}
+	if (detect_arg) {
+		if (parse_addr(&ef, detect_arg, &detect.pc, &size))
+			return 2;
+		detect.name = detect_arg;
+		detect.pc /= 2;
+	}
+
+	cpu = avr_create(dev);
+	image = malloc(dev->app_size + dev->boot_size);
+	if (!cpu || !image) {
+		fprintf(stderr, "avrsim: out of memory\n");
+		return 1;
+	}
+	memset(image, 0xFF, dev->app_size + dev->boot_size);
+	elf_load_image(&ef, AVR_FLASH_BASE, image, dev->app_size + dev->boot_size);
+	for (i = 0; i < cpu->flash_words; i++)
+		cpu->flash[i] = (uint16_t)(image[2 * i] | (image[2 * i + 1] << 8));
+	elf_load_image(&ef, AVR_EEPROM_BASE, cpu->eeprom, dev->eeprom_size);
+	free(image);
+
+	if (periph) {
+		x = malloc(sizeof(*x));
+		if (!x || xmega_periph_attach(x, cpu, &conf)) {
+			fprintf(stderr, "avrsim: out of memory\n");
+			return 1;
+		}
+	}
+	if (mf_init(&fmem, cpu->data + XMEGA_INTERNAL_SRAM_START, XMEGA_INTERNAL_SRAM_START, dev->sram_size)) {
+		fprintf(stderr, "avrsim: out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < nfaults; i++) {
+		if (mf_add(&fmem, &faults[i])) {
+			char spec[96];
+
+			mf_format(&faults[i], spec, sizeof(spec));
+			fprintf(stderr, "avrsim: fault '%s' is outside the SRAM of %s\n", spec, dev->name);
+			return 2;
+		}
+	}
+	if (nfaults) {
+		cpu->sram.ctx = &fmem;
+		cpu->sram.read = fault_read;
+		cpu->sram.write = fault_write;
+	}
+
+	avr_reset(cpu, AVR_RESET_POWERON);
+	if (profile_init(&prof, cpu, &ef)) {
+		fprintf(stderr, "avrsim: out of memory\n");
+		return 1;
+	}
+	if (freq)
+		cpu->f_cpu = (uint32_t)freq;
+	for (i = 0; i < ncalls; i++) {
+		uint32_t a;
+
+		if (parse_addr(&ef, call_args[i], &a, &size))
+			return 2;
+		calls[i] = profile_find_func(&prof, a / 2);
+		if (calls[i] < 0) {
+			fprintf(stderr, "avrsim: '%s' is not in a function\n", call_args[i]);
+			return 2;
+		}
+		if (profile_record_calls(&prof, calls[i], MAX_CALL_RECORDS)) {
+			fprintf(stderr, "avrsim: out of memory\n");
+			return 1;
+		}
+	}
+
+	while (cpu->state == AVR_RUNNING || cpu->state == AVR_SLEEPING) {
+		if (cpu->state == AVR_RUNNING) {
+			for (i = 0; i < nmarks; i++)
+				if (!marks[i].hit && marks[i].pc == cpu->pc) {
+					marks[i].hit = 1;
+					marks[i].cycles = cpu->cycles;
+				}
+			if (cpu->pc == detect.pc) {
+				detect.hit = 1;
+				detect.cycles = cpu->cycles;
+				cpu->state = AVR_STOPPED;
+				break;
+			}
+			if (cpu->pc == stop_pc) {
+				cpu->state = AVR_STOPPED;
+				break;
+			}
+			if (trace) {
+				char insn[64];
+
+				avr_disasm(cpu, cpu->pc, insn, sizeof(insn));
+				fprintf(stderr, "%10llu  %-32s %s\n", (unsigned long long)cpu->cycles,
+						pc_name(&prof, cpu->pc, where, sizeof(where)), insn);
+				trace--;
+			}
+		}
+		if (cpu->cycles >= max_cycles) {
+			cpu->state = AVR_LIMIT;
+			break;
+		}
+		avr_step(cpu);
+		profile_step(&prof);
+		if (cpu->resets != resets) {
+			/* The program starts over: the frames of the calls before the reset stay open. */
+			resets = cpu->resets;
+			profile_reset_frames(&prof);
+		}
+	}
+
+	printf("%s: %s, %s at %s\n", argv[optind], dev->name, state_names[cpu->state],
+			pc_name(&prof, cpu->pc, where, sizeof(where)));
+	printf("%llu cycles (%.3f ms, %lu Hz at the end), %llu instructions, %llu cycles asleep, %u bytes of stack\n",
+			(unsigned long long)cpu->cycles, cpu->seconds * 1000.0, (unsigned long)cpu->f_cpu,
+			(unsigned long long)cpu->instructions, (unsigned long long)cpu->sleep_cycles,
+			profile_max_stack(&prof));
+	if (cpu->resets)
+		printf("%u resets, RST.STATUS 0x%02X\n", cpu->resets, cpu->reset_flags);
+	if (cpu->unmapped_accesses)
+		printf("warning: %llu accesses outside of the data memory\n",
+				(unsigned long long)cpu->unmapped_accesses);
+
+	for (i = 0; i < nmarks; i++) {
+		if (marks[i].hit)
+			printf("mark  %-24s %12llu cycles\n", marks[i].name, (unsigned long long)marks[i].cycles);
+		else
+			printf("mark  %-24s %12s\n", marks[i].name, "not reached");
+	}
+	for (i = 0; i < fmem.nfaults; i++) {
+		char spec[96];
+
+		mf_format(&fmem.faults[i], spec, sizeof(spec));
+		printf("fault %s\n", spec);
+	}
+	if (detect_arg) {
+		if (detect.hit)
+			printf("detect %-23s %12llu cycles\n", detect.name, (unsigned long long)detect.cycles);
+		else
+			printf("detect %-23s %12s\n", detect.name, "not reached");
+	}
+	for (i = 0; i < nranges; i++)
+		printf("range %-24s %12llu cycles\n", ranges[i].name,
+				(unsigned long long)profile_range_cycles(&prof, ranges[i].start, ranges[i].end));
+	for (i = 0; i < ncalls; i++) {
+		const struct prof_func *fn = &prof.funcs[calls[i]];
+		unsigned j;
+
+		for (j = 0; j < fn->neach; j++) {
+			snprintf(where, sizeof(where), "%s#%u", fn->name, j);
+			printf("call  %-24s %12llu cycles %6u bytes of stack\n", where,
+					(unsigned long long)fn->each[j].cycles, fn->each[j].stack);
+		}
+		if (!fn->neach)
+			printf("call  %-24s %12s\n", fn->name, "not called");
+	}
+	if (!quiet) {
+		printf("\n");
+		profile_print(&prof, stdout, (unsigned)top);
+	}
+
+	status = 0;
+	if (cpu->state == AVR_CRASHED) {
+		char insn[64];
+
+		avr_disasm(cpu, cpu->pc, insn, sizeof(insn));
+		fprintf(stderr, "avrsim: invalid instruction '%s' at %s\n", insn,
+				pc_name(&prof, cpu->pc, where, sizeof(where)));
+		status = 1;
+	} else if (cpu->state == AVR_LIMIT) {
+		status = 3;
+	}
+	if (json && write_json(json, argv[optind], cpu, &prof, marks, nmarks, ranges, nranges, &fmem,
+			detect_arg ? &detect : NULL))
+		status = 1;
+
+	profile_free(&prof);
+	mf_free(&fmem);
+	if (x) {
+		xmega_periph_free(x);
+		free(x);
+	}
+	avr_destroy(cpu);
+	elf_free(&ef);
+	return status;
+}
@@ -0,0 +1,209 @@
+/*
+ * periph_clk.c - OSC and CLK models.
+ *
+ * Oscillators become ready a start-up time after they are enabled. The
+ * system clock can only be switched to a ready oscillator, and CLK.CTRL,
+ * CLK.PSCTRL and CLK.LOCK need the CCP key. Every change recomputes
+ * cpu->f_cpu = source / (A * B * C); the peripherals run on clkPER, which
+ * is the CPU clock.
+ */
+
+#include "xmega_periph.h"
+
+#define OSC_BASE 0x0050
+#define CLK_BASE 0x0040
+
+/* OSC registers and bits, the same in CTRL and STATUS. */
+#define OSC_CTRL     0
+#define OSC_STATUS   1
+#define OSC_PLLCTRL  5
+#define OSC_RC2M     0
+#define OSC_RC32M    1
+#define OSC_RC32K    2
+#define OSC_XOSC     3
+#define OSC_PLL      4
+
+#define CLK_CTRL     0
+#define CLK_PSCTRL   1
+#define CLK_LOCK     2
+#define CLK_RTCCTRL  3
+
+/* Typical start-up times, in seconds. */
+static const double osc_startup[5] = {
+	0.0,        /* RC2M, running after reset */
+	10e-6,      /* RC32M */
+	1e-3,       /* RC32K */
+	1e-3,       /* XOSC */
+	64e-6,      /* PLL lock */
+};
+
+static uint32_t osc_hz(const struct xmega_periph *x, unsigned osc)
+{
+	const struct clk_model *c = &x->clk;
+
+	switch (osc) {
+	case OSC_RC2M:  return x->conf.rc2m_hz;
+	case OSC_RC32M: return x->conf.rc32m_hz;
+	case OSC_RC32K: return x->conf.rc32k_hz;
+	case OSC_XOSC:  return x->conf.xosc_hz;
+	case OSC_PLL: {
+		uint32_t fac = c->osc[OSC_PLLCTRL] & 0x1F;
+
+		switch (c->osc[OSC_PLLCTRL] >> 6) {
+		case 0: return x->conf.rc2m_hz * fac;
+		case 2: return x->conf.rc32m_hz / 4 * fac;
+		case 3: return x->conf.xosc_hz * fac;
+		}
+		return 0;
+	}
+	}
+	return 0;
+}
+
+static int osc_ready(const struct xmega_periph *x, unsigned osc)
+{
+	const struct clk_model *c = &x->clk;
+
+	if (!(c->osc[OSC_CTRL] & (1u << osc)) || !osc_hz(x, osc))
+		return 0;
+	return x->cpu->seconds >= c->enabled_at[osc] + osc_startup[osc];
+}
+
+/* The system clock source of each CLK.CTRL SCLKSEL value. */
+static const int sclk_osc[8] = { OSC_RC2M, OSC_RC32M, OSC_RC32K, OSC_XOSC, OSC_PLL, -1, -1, -1 };
+
+static void update_f_cpu(struct xmega_periph *x)
+{
+	static const uint16_t psa[32] = {
+		1, 2, 0, 4, 0, 8, 0, 16, 0, 32, 0, 64, 0, 128, 0, 256, 0, 512,
+	};
+	static const uint8_t psbc[4] = { 1, 2, 4, 4 };
+	struct clk_model *c = &x->clk;
+	int osc = sclk_osc[c->clk[CLK_CTRL] & 7];
+	uint32_t a = psa[(c->clk[CLK_PSCTRL] >> 2) & 0x1F];
+	uint32_t hz;
+
+	if (osc < 0 || !a)
+		return;
+	hz = osc_hz(x, (unsigned)osc) / a / psbc[c->clk[CLK_PSCTRL] & 3];
+	if (hz)
+		x->cpu->f_cpu = hz;
+}
+
+uint32_t clk_ulp_hz(const struct xmega_periph *x)
+{
+	return x->conf.ulp_hz;
+}
+
+uint32_t clk_rtc_hz(const struct xmega_periph *x)
+{
+	const struct clk_model *c = &x->clk;
+
+	if (!(c->clk[CLK_RTCCTRL] & 1))
+		return 0;
+	switch ((c->clk[CLK_RTCCTRL] >> 1) & 7) {
+	case 0: return x->conf.ulp_hz;                                  /* ULP, 1 kHz */
+	case 1: return osc_ready(x, OSC_XOSC) ? x->conf.xosc_hz / 32 : 0;   /* TOSC, 1.024 kHz */
+	case 2: return osc_ready(x, OSC_RC32K) ? x->conf.rc32k_hz / 32 : 0; /* RCOSC, 1.024 kHz */
+	case 5: return osc_ready(x, OSC_XOSC) ? x->conf.xosc_hz : 0;        /* TOSC, 32.768 kHz */
+	case 6: return osc_ready(x, OSC_RC32K) ? x->conf.rc32k_hz : 0;      /* RCOSC, 32.768 kHz */
+	}
+	return 0;
+}
+
+static uint8_t osc_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct xmega_periph *x = ctx;
+	uint8_t v = 0;
+	unsigned i;
+
+	(void)cpu;
+	if (off != OSC_STATUS)
+		return x->clk.osc[off];
+	for (i = 0; i < 5; i++)
+		if (osc_ready(x, i))
+			v |= (uint8_t)(1u << i);
+	return v;
+}
+
+static void osc_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct xmega_periph *x = ctx;
+	struct clk_model *c = &x->clk;
+	int sys = sclk_osc[c->clk[CLK_CTRL] & 7];
+	unsigned i;
+
+	if (off == OSC_STATUS)
+		return;
+	if (off == OSC_CTRL) {
+		v &= 0x1F;
+		/* The oscillator of the system clock cannot be disabled. */
+		if (sys >= 0)
+			v |= (uint8_t)(1u << sys);
+		for (i = 0; i < 5; i++)
+			if ((v & ~c->osc[OSC_CTRL]) & (1u << i))
+				c->enabled_at[i] = cpu->seconds;
+	}
+	c->osc[off] = v;
+}
+
+static uint8_t clk_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct xmega_periph *x = ctx;
+
+	(void)cpu;
+	return x->clk.clk[off];
+}
+
+static void clk_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct xmega_periph *x = ctx;
+	struct clk_model *c = &x->clk;
+
+	if (off <= CLK_LOCK && !avr_ccp_ioreg_ok(cpu))
+		return;
+	if (c->clk[CLK_LOCK] & 1 && off <= CLK_PSCTRL)
+		return;
+	if (off == CLK_CTRL) {
+		int osc = sclk_osc[v & 7];
+
+		/* Switching to an oscillator that is not ready is ignored. */
+		if (osc < 0 || !osc_ready(x, (unsigned)osc))
+			return;
+		v &= 7;
+	}
+	c->clk[off] = v;
+	if (off == CLK_CTRL || off == CLK_PSCTRL)
+		update_f_cpu(x);
+}
+
+static void clk_reset(struct avr_cpu *cpu, void *ctx, uint8_t cause)
+{
+	struct xmega_periph *x = ctx;
+	unsigned i;
+
+	(void)cause;
+	for (i = 0; i < 8; i++)
+		x->clk.osc[i] = x->clk.clk[i] = 0;
+	x->clk.osc[OSC_CTRL] = 1 << OSC_RC2M;
+	x->clk.enabled_at[OSC_RC2M] = cpu->seconds;
+	update_f_cpu(x);
+}
+
+int clk_attach(struct xmega_periph *x)
+{
+	struct avr_periph osc = {
+		.name = "OSC", .base = OSC_BASE, .size = 8, .ctx = x,
+		.read = osc_read, .write = osc_write,
+	};
+	struct avr_periph clk = {
+		.name = "CLK", .base = CLK_BASE, .size = 8, .ctx = x,
+		.read = clk_read, .write = clk_write, .reset = clk_reset,
+	};
+
+	x->clk.x = x;
+	if (avr_add_periph(x->cpu, &osc) < 0 || avr_add_periph(x->cpu, &clk) < 0)
+		return -1;
+	clk_reset(x->cpu, x, AVR_RESET_POWERON);
+	return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * periph_crc.c - CRC module model.
+ *
+ * CTRL selects the source (I/O, Flash or a DMA channel) and the polynomial.
+ * Selecting a source sets STATUS.BUSY. For the I/O source every DATAIN
+ * write is added at once and writing one to BUSY ends the calculation; for
+ * the Flash and DMA sources the NVM and DMA models feed the data and end
+ * it. The checksum register holds the CRC-16 as is. In CRC-32 mode it
+ * holds the complemented remainder while busy and the final IEEE 802.3
+ * checksum afterwards, as the library reads it.
+ */
+
+#include "crc.h"
+#include "xmega_periph.h"
+
+#define CRC_BASE     0x00D0
+#define CRC_CTRL     0
+#define CRC_STATUS   1
+#define CRC_DATAIN   3
+#define CRC_CHECKSUM 4
+
+#define CRC_CRC32    0x20
+#define CRC_BUSY     0x01
+#define CRC_ZERO     0x02
+
+static int crc32_mode(const struct crc_model *c)
+{
+	return (c->ctrl & CRC_CRC32) != 0;
+}
+
+/* Checksum as read by the CPU. */
+static uint32_t checksum(const struct crc_model *c)
+{
+	if (crc32_mode(c) && !(c->status & CRC_BUSY))
+		return ~c->raw;
+	return crc32_mode(c) ? c->raw : (c->raw & 0xFFFF);
+}
+
+int crc_source_is(const struct crc_model *c, uint8_t source)
+{
+	return (c->status & CRC_BUSY) && (c->ctrl & 0x0F) == source;
+}
+
+void crc_feed(struct crc_model *c, const uint8_t *buf, uint32_t len)
+{
+	if (crc32_mode(c))
+		c->raw = ~crc32_ieee(~c->raw, buf, len);
+	else
+		c->raw = crc16_ccitt((uint16_t)c->raw, buf, len);
+}
+
+void crc_complete(struct crc_model *c)
+{
+	c->status &= (uint8_t)~CRC_BUSY;
+	if (checksum(c) == 0)
+		c->status |= CRC_ZERO;
+	else
+		c->status &= (uint8_t)~CRC_ZERO;
+}
+
+static uint8_t crc_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct crc_model *c = &((struct xmega_periph *)ctx)->crc;
+
+	(void)cpu;
+	switch (off) {
+	case CRC_CTRL:   return c->ctrl;
+	case CRC_STATUS: return c->status;
+	case CRC_DATAIN: return 0;
+	}
+	if (off >= CRC_CHECKSUM && off < CRC_CHECKSUM + 4)
+		return (uint8_t)(checksum(c) >> (8 * (off - CRC_CHECKSUM)));
+	return 0;
+}
+
+static void crc_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct crc_model *c = &((struct xmega_periph *)ctx)->crc;
+
+	(void)cpu;
+	switch (off) {
+	case CRC_CTRL:
+		/* RESET0 clears the checksum, RESET1 sets all bits; both restart the calculation. */
+		if (v & 0xC0) {
+			c->raw = (v & 0xC0) == 0xC0 ? 0xFFFFFFFF : 0;
+			c->status = 0;
+		}
+		/* The polynomial cannot be changed while busy. */
+		if (c->status & CRC_BUSY)
+			v = (uint8_t)((v & ~CRC_CRC32) | (c->ctrl & CRC_CRC32));
+		if ((v & 0x0F) && ((v & 0xC0) || (v & 0x0F) != (c->ctrl & 0x0F)))
+			c->status |= CRC_BUSY;
+		c->ctrl = v & 0x2F;
+		break;
+	case CRC_STATUS:
+		if ((v & CRC_BUSY) && (c->status & CRC_BUSY) && (c->ctrl & 0x0F) == CRC_SOURCE_IO)
+			crc_complete(c);
+		break;
+	case CRC_DATAIN:
+		if (crc_source_is(c, CRC_SOURCE_IO))
+			crc_feed(c, &v, 1);
+		break;
+	default:
+		if (off >= CRC_CHECKSUM && off < CRC_CHECKSUM + 4) {
+			unsigned sh = 8 * (off - CRC_CHECKSUM);
+
+			c->raw = (c->raw & ~(0xFFu << sh)) | ((uint32_t)v << sh);
+		}
+		break;
+	}
+}
+
+static void crc_reset(struct avr_cpu *cpu, void *ctx, uint8_t cause)
+{
+	struct crc_model *c = &((struct xmega_periph *)ctx)->crc;
+
+	(void)cpu;
+	(void)cause;
+	c->ctrl = c->status = 0;
+	c->raw = 0;
+}
+
+int crc_attach(struct xmega_periph *x)
+{
+	struct avr_periph p = {
+		.name = "CRC", .base = CRC_BASE, .size = 8, .ctx = x,
+		.read = crc_read, .write = crc_write, .reset = crc_reset,
+	};
+
+	crc_init();
+	x->crc.x = x;
+	return avr_add_periph(x->cpu, &p) < 0 ? -1 : 0;
+}
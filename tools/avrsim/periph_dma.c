@@ -0,0 +1,420 @@
+/*
+ * periph_dma.c - DMA controller model.
+ *
+ * A request (CTRLA.TRFREQ or an event on the channel's EVSYS trigger)
+ * starts a burst, or the rest of the block if CTRLA.SINGLE is clear; a
+ * request arriving while the channel is busy is kept pending. Bytes move
+ * through the data space as the CPU would access them, two cycles each;
+ * the CPU is not stalled, bus contention is not modelled. Channels are
+ * served in fixed priority, channel 0 first.
+ *
+ * The bytes of a channel that is the source of the CRC module are also
+ * fed to it, and the CRC is completed at the end of the transaction.
+ * An access outside the I/O, the internal SRAM or the mapped EEPROM is an
+ * error: the channel is disabled and ERRIF set. The transaction complete
+ * and error interrupts are level interrupts that last until the flags are
+ * cleared.
+ */
+
+#include <string.h>
+
+#include "xmega_periph.h"
+
+#define DMA_BASE       0x0100
+#define DMA_CTRL       0x00
+#define DMA_INTFLAGS   0x03
+#define DMA_STATUS     0x04
+#define DMA_TEMPL      0x06
+#define DMA_TEMPH      0x07
+#define DMA_CH_BASE    0x10
+
+#define DMA_ENABLE     0x80
+#define DMA_RESET      0x40
+
+/* Channel registers. */
+#define CH_CTRLA       0x00
+#define CH_CTRLB       0x01
+#define CH_ADDRCTRL    0x02
+#define CH_TRIGSRC     0x03
+#define CH_TRFCNTL     0x04
+#define CH_TRFCNTH     0x05
+#define CH_REPCNT      0x06
+#define CH_SRCADDR0    0x08
+#define CH_DESTADDR0   0x0C
+
+#define CH_ENABLE      0x80
+#define CH_RESET       0x40
+#define CH_REPEAT      0x20
+#define CH_TRFREQ      0x10
+#define CH_SINGLE      0x04
+
+#define CH_CHBUSY      0x80
+#define CH_CHPEND      0x40
+#define CH_ERRIF       0x20
+#define CH_TRNIF       0x10
+
+/* ADDRCTRL reload and direction fields. */
+#define RELOAD_BLOCK   1
+#define RELOAD_BURST   2
+#define RELOAD_TRANSACTION 3
+#define DIR_INC        1
+#define DIR_DEC        2
+
+#define CYCLES_PER_BYTE 2
+
+static void ch_irq(struct dma_model *d, unsigned n)
+{
+	struct dma_channel *c = &d->ch[n];
+	unsigned level = 0;
+
+	if ((c->ctrlb & CH_ERRIF) && ((c->ctrlb >> 2) & 3) > level)
+		level = (c->ctrlb >> 2) & 3;
+	if ((c->ctrlb & CH_TRNIF) && (c->ctrlb & 3) > level)
+		level = c->ctrlb & 3;
+	if (level)
+		avr_irq_raise(d->x->cpu, VECT_DMA_CH0 + n, (enum avr_irq_level)level, d->idx);
+	else
+		avr_irq_clear(d->x->cpu, VECT_DMA_CH0 + n);
+}
+
+static void ch_reset(struct dma_model *d, unsigned n)
+{
+	memset(&d->ch[n], 0, sizeof(d->ch[n]));
+	ch_irq(d, n);
+}
+
+static unsigned burst_len(const struct dma_channel *c)
+{
+	static const uint8_t len[4] = { 1, 2, 4, 8 };
+
+	return len[c->ctrla & 3];
+}
+
+static uint32_t block_bytes(uint16_t trfcnt)
+{
+	return trfcnt ? trfcnt : 0x10000UL;
+}
+
+static void start_request(struct dma_model *d, unsigned n)
+{
+	struct dma_channel *c = &d->ch[n];
+
+	if (!(d->ctrl & DMA_ENABLE) || !(c->ctrla & CH_ENABLE))
+		return;
+	if (c->active) {
+		c->ctrlb |= CH_CHPEND;
+		return;
+	}
+	c->active = 1;
+	c->ctrlb = (uint8_t)((c->ctrlb & ~CH_CHPEND) | CH_CHBUSY);
+	c->left = (c->ctrla & CH_SINGLE) ? burst_len(c) : block_bytes(c->trfcnt);
+}
+
+void dma_event(struct dma_model *d, unsigned ch)
+{
+	unsigned n;
+
+	/* Triggers 1 to 3 are the event channels 0 to 2. */
+	for (n = 0; n < XMEGA_NUM_DMA; n++)
+		if (d->ch[n].trigsrc == ch + 1 && ch < 3)
+			start_request(d, n);
+}
+
+static int valid_addr(const struct avr_cpu *cpu, uint32_t a)
+{
+	if (a < XMEGA_IO_SIZE)
+		return 1;
+	if (a >= XMEGA_INTERNAL_SRAM_START && a < XMEGA_INTERNAL_SRAM_START + cpu->dev->sram_size)
+		return 1;
+	return cpu->eeprom_mapped && a >= XMEGA_MAPPED_EEPROM_START
+			&& a < XMEGA_MAPPED_EEPROM_START + cpu->dev->eeprom_size;
+}
+
+static void step_addr(uint32_t *a, unsigned dir)
+{
+	if (dir == DIR_INC)
+		*a = (*a + 1) & 0xFFFFFF;
+	else if (dir == DIR_DEC)
+		*a = (*a - 1) & 0xFFFFFF;
+}
+
+static void ch_error(struct dma_model *d, unsigned n)
+{
+	struct dma_channel *c = &d->ch[n];
+
+	c->active = 0;
+	c->left = 0;
+	c->ctrla &= (uint8_t)~CH_ENABLE;
+	c->ctrlb = (uint8_t)((c->ctrlb & ~(CH_CHBUSY | CH_CHPEND)) | CH_ERRIF);
+	ch_irq(d, n);
+}
+
+/* End of a block; returns 1 if the transaction is complete. */
+static int block_done(struct dma_channel *c)
+{
+	unsigned src_reload = c->addrctrl >> 6, dest_reload = (c->addrctrl >> 2) & 3;
+
+	c->trfcnt = c->block;
+	if (src_reload == RELOAD_BLOCK)
+		c->src = c->src0;
+	if (dest_reload == RELOAD_BLOCK)
+		c->dest = c->dest0;
+	if (c->ctrla & CH_REPEAT) {
+		/* REPCNT 0 repeats forever. */
+		if (c->repcnt == 0)
+			return 0;
+		if (--c->repcnt != 0)
+			return 0;
+	}
+	if (src_reload == RELOAD_TRANSACTION)
+		c->src = c->src0;
+	if (dest_reload == RELOAD_TRANSACTION)
+		c->dest = c->dest0;
+	return 1;
+}
+
+static void transfer_byte(struct dma_model *d, unsigned n)
+{
+	struct avr_cpu *cpu = d->x->cpu;
+	struct dma_channel *c = &d->ch[n];
+	uint8_t v;
+
+	if (!valid_addr(cpu, c->src) || !valid_addr(cpu, c->dest)) {
+		ch_error(d, n);
+		return;
+	}
+	v = avr_read(cpu, c->src);
+	avr_write(cpu, c->dest, v);
+	if (crc_source_is(&d->x->crc, (uint8_t)(CRC_SOURCE_DMAC0 + n)))
+		crc_feed(&d->x->crc, &v, 1);
+	step_addr(&c->src, (c->addrctrl >> 4) & 3);
+	step_addr(&c->dest, c->addrctrl & 3);
+	c->left--;
+	c->trfcnt--;
+
+	if ((block_bytes(c->block) - c->trfcnt) % burst_len(c) == 0) {
+		if ((c->addrctrl >> 6) == RELOAD_BURST)
+			c->src = c->src0;
+		if (((c->addrctrl >> 2) & 3) == RELOAD_BURST)
+			c->dest = c->dest0;
+	}
+	if (c->trfcnt == 0 && block_done(c)) {
+		/* Transaction complete. */
+		c->active = 0;
+		c->left = 0;
+		c->ctrla &= (uint8_t)~CH_ENABLE;
+		c->ctrlb = (uint8_t)((c->ctrlb & ~(CH_CHBUSY | CH_CHPEND)) | CH_TRNIF);
+		if (crc_source_is(&d->x->crc, (uint8_t)(CRC_SOURCE_DMAC0 + n)))
+			crc_complete(&d->x->crc);
+		ch_irq(d, n);
+		return;
+	}
+	if (c->left == 0 || c->trfcnt == c->block) {
+		c->active = 0;
+		c->left = 0;
+		c->ctrlb &= (uint8_t)~CH_CHBUSY;
+		if (c->ctrlb & CH_CHPEND)
+			start_request(d, n);
+	}
+}
+
+static void dma_clock(struct avr_cpu *cpu, void *ctx, uint32_t cycles)
+{
+	struct dma_model *d = &((struct xmega_periph *)ctx)->dma;
+	unsigned n;
+	int any = 0;
+
+	(void)cpu;
+	for (n = 0; n < XMEGA_NUM_DMA; n++)
+		any |= d->ch[n].active;
+	if (!any || !(d->ctrl & DMA_ENABLE)) {
+		d->budget = 0;
+		return;
+	}
+	d->budget += cycles;
+	while (d->budget >= CYCLES_PER_BYTE) {
+		for (n = 0; n < XMEGA_NUM_DMA && !d->ch[n].active; n++)
+			;
+		if (n == XMEGA_NUM_DMA)
+			break;
+		d->budget -= CYCLES_PER_BYTE;
+		transfer_byte(d, n);
+	}
+}
+
+static uint8_t ch_read(struct dma_model *d, unsigned n, uint16_t off)
+{
+	const struct dma_channel *c = &d->ch[n];
+
+	switch (off) {
+	case CH_CTRLA:    return c->ctrla & (uint8_t)~CH_TRFREQ;
+	case CH_CTRLB:    return c->ctrlb;
+	case CH_ADDRCTRL: return c->addrctrl;
+	case CH_TRIGSRC:  return c->trigsrc;
+	case CH_TRFCNTL:
+		d->temp = (uint8_t)(c->trfcnt >> 8);
+		return (uint8_t)c->trfcnt;
+	case CH_TRFCNTH:  return d->temp;
+	case CH_REPCNT:   return c->repcnt;
+	}
+	if (off >= CH_SRCADDR0 && off < CH_SRCADDR0 + 3)
+		return (uint8_t)(c->src >> (8 * (off - CH_SRCADDR0)));
+	if (off >= CH_DESTADDR0 && off < CH_DESTADDR0 + 3)
+		return (uint8_t)(c->dest >> (8 * (off - CH_DESTADDR0)));
+	return 0;
+}
+
+static void set_byte(uint32_t *r, unsigned i, uint8_t v)
+{
+	*r = (*r & ~(0xFFUL << (8 * i))) | ((uint32_t)v << (8 * i));
+}
+
+static void ch_write(struct dma_model *d, unsigned n, uint16_t off, uint8_t v)
+{
+	struct dma_channel *c = &d->ch[n];
+
+	switch (off) {
+	case CH_CTRLA:
+		if (!(v & CH_ENABLE)) {
+			c->active = 0;
+			c->left = 0;
+			c->ctrlb &= (uint8_t)~(CH_CHBUSY | CH_CHPEND);
+			if (v & CH_RESET) {
+				ch_reset(d, n);
+				return;
+			}
+		} else if (!(c->ctrla & CH_ENABLE)) {
+			c->src0 = c->src;
+			c->dest0 = c->dest;
+			c->block = c->trfcnt;
+		}
+		c->ctrla = v & (uint8_t)~(CH_RESET | CH_TRFREQ);
+		if (v & CH_TRFREQ)
+			start_request(d, n);
+		return;
+	case CH_CTRLB:
+		c->ctrlb = (uint8_t)((c->ctrlb & (CH_CHBUSY | CH_CHPEND)) | (c->ctrlb & ~v & (CH_ERRIF | CH_TRNIF))
+				| (v & 0x0F));
+		ch_irq(d, n);
+		return;
+	case CH_ADDRCTRL: c->addrctrl = v; return;
+	case CH_TRIGSRC:  c->trigsrc = v; return;
+	case CH_TRFCNTL:  d->temp = v; return;
+	case CH_TRFCNTH:
+		c->trfcnt = (uint16_t)(d->temp | (v << 8));
+		if (!(c->ctrla & CH_ENABLE))
+			c->block = c->trfcnt;
+		return;
+	case CH_REPCNT:   c->repcnt = v; return;
+	}
+	if (off >= CH_SRCADDR0 && off < CH_SRCADDR0 + 3)
+		set_byte(&c->src, off - CH_SRCADDR0, v);
+	else if (off >= CH_DESTADDR0 && off < CH_DESTADDR0 + 3)
+		set_byte(&c->dest, off - CH_DESTADDR0, v);
+}
+
+static uint8_t dma_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct dma_model *d = &((struct xmega_periph *)ctx)->dma;
+	uint8_t v = 0;
+	unsigned n;
+
+	(void)cpu;
+	if (off >= DMA_CH_BASE)
+		return ch_read(d, (off - DMA_CH_BASE) / 0x10, (off - DMA_CH_BASE) % 0x10);
+	switch (off) {
+	case DMA_CTRL:
+		return d->ctrl;
+	case DMA_INTFLAGS:
+		for (n = 0; n < XMEGA_NUM_DMA; n++) {
+			if (d->ch[n].ctrlb & CH_TRNIF)
+				v |= (uint8_t)(1u << n);
+			if (d->ch[n].ctrlb & CH_ERRIF)
+				v |= (uint8_t)(0x10u << n);
+		}
+		return v;
+	case DMA_STATUS:
+		for (n = 0; n < XMEGA_NUM_DMA; n++) {
+			if (d->ch[n].ctrlb & CH_CHBUSY)
+				v |= (uint8_t)(0x10u << n);
+			if (d->ch[n].ctrlb & CH_CHPEND)
+				v |= (uint8_t)(1u << n);
+		}
+		return v;
+	case DMA_TEMPL:
+		return d->temp;
+	}
+	return 0;
+}
+
+static void dma_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct dma_model *d = &((struct xmega_periph *)ctx)->dma;
+	unsigned n;
+
+	(void)cpu;
+	if (off >= DMA_CH_BASE) {
+		ch_write(d, (off - DMA_CH_BASE) / 0x10, (off - DMA_CH_BASE) % 0x10, v);
+		return;
+	}
+	switch (off) {
+	case DMA_CTRL:
+		if ((v & DMA_RESET) && !(v & DMA_ENABLE)) {
+			for (n = 0; n < XMEGA_NUM_DMA; n++)
+				ch_reset(d, n);
+			v = 0;
+		}
+		d->ctrl = v & (uint8_t)~DMA_RESET;
+		break;
+	case DMA_INTFLAGS:
+		for (n = 0; n < XMEGA_NUM_DMA; n++) {
+			if (v & (1u << n))
+				d->ch[n].ctrlb &= (uint8_t)~CH_TRNIF;
+			if (v & (0x10u << n))
+				d->ch[n].ctrlb &= (uint8_t)~CH_ERRIF;
+			ch_irq(d, n);
+		}
+		break;
+	case DMA_TEMPL:
+		d->temp = v;
+		break;
+	}
+}
+
+static void dma_reset(struct avr_cpu *cpu, void *ctx, uint8_t cause)
+{
+	struct dma_model *d = &((struct xmega_periph *)ctx)->dma;
+
+	(void)cpu;
+	(void)cause;
+	d->ctrl = d->temp = 0;
+	d->budget = 0;
+	memset(d->ch, 0, sizeof(d->ch));
+}
+
+static unsigned dma_pending(struct avr_cpu *cpu, void *ctx)
+{
+	struct dma_model *d = &((struct xmega_periph *)ctx)->dma;
+	unsigned n;
+
+	(void)cpu;
+	if (!(d->ctrl & DMA_ENABLE))
+		return 0;
+	for (n = 0; n < XMEGA_NUM_DMA; n++)
+		if (d->ch[n].active && (d->ch[n].ctrlb & 0x0F))
+			return AVR_WAKE_IRQ;
+	return 0;
+}
+
+int dma_attach(struct xmega_periph *x)
+{
+	struct avr_periph p = {
+		.name = "DMA", .base = DMA_BASE, .size = DMA_CH_BASE + 0x10 * XMEGA_NUM_DMA, .ctx = x,
+		.read = dma_read, .write = dma_write, .clock = dma_clock,
+		.reset = dma_reset, .pending = dma_pending,
+	};
+
+	x->dma.x = x;
+	x->dma.idx = avr_add_periph(x->cpu, &p);
+	return x->dma.idx < 0 ? -1 : 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * periph_evsys.c - event system model.
+ *
+ * CHnMUX routes an event source to channel n. Events are delivered to the
+ * TCs and the DMA at once; STROBE fires channels by software. Event
+ * filtering (CHnCTRL DIGFILT) and quadrature decoding are not modelled.
+ */
+
+#include "xmega_periph.h"
+
+#define EVSYS_BASE   0x0180
+#define EVSYS_CH0MUX 0x00
+#define EVSYS_STROBE 0x10
+
+static void evsys_fire(struct xmega_periph *x, unsigned ch)
+{
+	unsigned i;
+
+	for (i = 0; i < XMEGA_NUM_TC; i++)
+		tc_event(&x->tc[i], ch);
+	dma_event(&x->dma, ch);
+}
+
+void evsys_signal(struct xmega_periph *x, uint8_t source)
+{
+	struct evsys_model *e = &x->evsys;
+	unsigned ch;
+
+	/* A TC counting the events of another can cascade; stop feedback loops. */
+	if (e->depth > XMEGA_NUM_TC)
+		return;
+	e->depth++;
+	for (ch = 0; ch < XMEGA_NUM_EVCH; ch++)
+		if (e->regs[EVSYS_CH0MUX + ch] == source)
+			evsys_fire(x, ch);
+	e->depth--;
+}
+
+static uint8_t evsys_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct evsys_model *e = &((struct xmega_periph *)ctx)->evsys;
+
+	(void)cpu;
+	return off == EVSYS_STROBE ? 0 : e->regs[off];
+}
+
+static void evsys_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct xmega_periph *x = ctx;
+	unsigned ch;
+
+	(void)cpu;
+	if (off == EVSYS_STROBE) {
+		for (ch = 0; ch < XMEGA_NUM_EVCH; ch++)
+			if (v & (1u << ch))
+				evsys_fire(x, ch);
+		return;
+	}
+	x->evsys.regs[off] = v;
+}
+
+static void evsys_reset(struct avr_cpu *cpu, void *ctx, uint8_t cause)
+{
+	struct evsys_model *e = &((struct xmega_periph *)ctx)->evsys;
+	unsigned i;
+
+	(void)cpu;
+	(void)cause;
+	for (i = 0; i < sizeof(e->regs); i++)
+		e->regs[i] = 0;
+}
+
+int evsys_attach(struct xmega_periph *x)
+{
+	struct avr_periph p = {
+		.name = "EVSYS", .base = EVSYS_BASE, .size = 0x12, .ctx = x,
+		.read = evsys_read, .write = evsys_write, .reset = evsys_reset,
+	};
+
+	x->evsys.x = x;
+	return avr_add_periph(x->cpu, &p) < 0 ? -1 : 0;
+}
@@ -0,0 +1,342 @@
+/*
+ * periph_nvm.c - NVM controller model.
+ *
+ * EEPROM: the page buffer is loaded through DATA0 with the LOAD_EEPROM_BUFFER
+ * command or by writes to the mapped EEPROM; the erase and write commands
+ * work on the loaded bytes and keep STATUS.NVMBUSY set for the page time.
+ * CTRLB.EEMAPEN maps the EEPROM into the data space.
+ *
+ * Flash: the CRC commands feed the application section, the boot section
+ * or ADDR..DATA (rounded to whole words) to the CRC module when its source
+ * is the Flash, halting the CPU meanwhile. Page writes go through SPM with
+ * the CCP SPM key; the CPU is halted for the page time.
+ *
+ * The page times are the typical figures of the datasheet; the Flash CRC is
+ * charged one CPU cycle per byte.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "xmega_periph.h"
+
+#define NVM_BASE     0x01C0
+#define NVM_ADDR0    0x00
+#define NVM_DATA0    0x04
+#define NVM_CMD      0x0A
+#define NVM_CTRLA    0x0B
+#define NVM_CTRLB    0x0C
+#define NVM_INTCTRL  0x0D
+#define NVM_STATUS   0x0F
+
+#define NVM_NVMBUSY  0x80
+#define NVM_FBUSY    0x40
+#define NVM_EELOAD   0x02
+#define NVM_FLOAD    0x01
+#define NVM_EEMAPEN  0x08
+
+#define CMD_READ_EEPROM             0x06
+#define CMD_ERASE_APP_PAGE          0x22
+#define CMD_LOAD_FLASH_BUFFER       0x23
+#define CMD_WRITE_APP_PAGE          0x24
+#define CMD_ERASE_WRITE_APP_PAGE    0x25
+#define CMD_ERASE_FLASH_BUFFER      0x26
+#define CMD_ERASE_BOOT_PAGE         0x2A
+#define CMD_WRITE_BOOT_PAGE         0x2C
+#define CMD_ERASE_WRITE_BOOT_PAGE   0x2D
+#define CMD_ERASE_EEPROM            0x30
+#define CMD_ERASE_EEPROM_PAGE       0x32
+#define CMD_LOAD_EEPROM_BUFFER      0x33
+#define CMD_WRITE_EEPROM_PAGE       0x34
+#define CMD_ERASE_WRITE_EEPROM_PAGE 0x35
+#define CMD_ERASE_EEPROM_BUFFER     0x36
+#define CMD_APP_CRC                 0x38
+#define CMD_BOOT_CRC                0x39
+#define CMD_FLASH_RANGE_CRC         0x3A
+
+#define EEPROM_PAGE_SIZE 32
+
+/* Page times in seconds. */
+#define T_PAGE_ERASE        4e-3
+#define T_PAGE_WRITE        4e-3
+#define T_PAGE_ERASE_WRITE  8e-3
+
+static uint32_t reg24(const struct nvm_model *n, unsigned off)
+{
+	return n->regs[off] | ((uint32_t)n->regs[off + 1] << 8) | ((uint32_t)n->regs[off + 2] << 16);
+}
+
+static int nvm_busy(const struct nvm_model *n)
+{
+	return n->x->cpu->seconds < n->busy_until;
+}
+
+static void nvm_irq(struct nvm_model *n)
+{
+	struct avr_cpu *cpu = n->x->cpu;
+	unsigned ee = n->regs[NVM_INTCTRL] & 3, spm = (n->regs[NVM_INTCTRL] >> 2) & 3;
+
+	/* The ready interrupts are level interrupts: requested as long as the NVM is ready. */
+	if (ee && !nvm_busy(n))
+		avr_irq_raise(cpu, VECT_NVM_EE, (enum avr_irq_level)ee, n->idx);
+	else
+		avr_irq_clear(cpu, VECT_NVM_EE);
+	if (spm && !nvm_busy(n))
+		avr_irq_raise(cpu, VECT_NVM_SPM, (enum avr_irq_level)spm, n->idx);
+	else
+		avr_irq_clear(cpu, VECT_NVM_SPM);
+}
+
+static void ee_load(struct nvm_model *n, uint16_t addr, uint8_t v)
+{
+	unsigned i = addr % EEPROM_PAGE_SIZE;
+
+	n->ee_buf[i] = v;
+	n->ee_loaded |= 1u << i;
+}
+
+static void ee_page(struct nvm_model *n, uint8_t cmd)
+{
+	struct avr_cpu *cpu = n->x->cpu;
+	uint32_t page = reg24(n, NVM_ADDR0) % cpu->dev->eeprom_size & ~(uint32_t)(EEPROM_PAGE_SIZE - 1);
+	unsigned i;
+
+	for (i = 0; i < EEPROM_PAGE_SIZE; i++) {
+		uint8_t *e = &cpu->eeprom[page + i];
+
+		if (!(n->ee_loaded & (1u << i)))
+			continue;
+		if (cmd == CMD_ERASE_EEPROM_PAGE)
+			*e = 0xFF;
+		else if (cmd == CMD_WRITE_EEPROM_PAGE)
+			*e &= n->ee_buf[i];
+		else
+			*e = n->ee_buf[i];
+	}
+}
+
+static void flash_crc(struct nvm_model *n, uint8_t cmd)
+{
+	struct avr_cpu *cpu = n->x->cpu;
+	const struct xmega_device *d = cpu->dev;
+	uint32_t start, end, a;
+
+	switch (cmd) {
+	case CMD_APP_CRC:
+		start = 0;
+		end = d->app_size - 1;
+		break;
+	case CMD_BOOT_CRC:
+		start = d->app_size;
+		end = d->app_size + d->boot_size - 1;
+		break;
+	default:
+		start = reg24(n, NVM_ADDR0) & ~1u;
+		end = reg24(n, NVM_DATA0) | 1u;
+		break;
+	}
+	if (end >= d->app_size + d->boot_size || start > end)
+		return;
+	if (crc_source_is(&n->x->crc, CRC_SOURCE_FLASH)) {
+		for (a = start; a <= end; a += 2) {
+			uint8_t w[2];
+
+			w[0] = (uint8_t)cpu->flash[a / 2];
+			w[1] = (uint8_t)(cpu->flash[a / 2] >> 8);
+			crc_feed(&n->x->crc, w, 2);
+		}
+		crc_complete(&n->x->crc);
+	}
+	cpu->stall += end - start + 1;
+}
+
+static void cmdex(struct nvm_model *n)
+{
+	struct avr_cpu *cpu = n->x->cpu;
+	uint8_t cmd = n->regs[NVM_CMD];
+
+	switch (cmd) {
+	case CMD_READ_EEPROM:
+		n->regs[NVM_DATA0] = cpu->eeprom[reg24(n, NVM_ADDR0) % cpu->dev->eeprom_size];
+		break;
+	case CMD_ERASE_FLASH_BUFFER:
+		memset(n->flash_buf, 0xFF, cpu->dev->page_size);
+		n->regs[NVM_STATUS] &= (uint8_t)~NVM_FLOAD;
+		break;
+	case CMD_ERASE_EEPROM_BUFFER:
+		n->ee_loaded = 0;
+		break;
+	case CMD_ERASE_EEPROM:
+		memset(cpu->eeprom, 0xFF, cpu->dev->eeprom_size);
+		n->ee_loaded = 0;
+		n->busy_until = cpu->seconds + T_PAGE_ERASE;
+		break;
+	case CMD_ERASE_EEPROM_PAGE:
+	case CMD_WRITE_EEPROM_PAGE:
+	case CMD_ERASE_WRITE_EEPROM_PAGE:
+		ee_page(n, cmd);
+		n->ee_loaded = 0;
+		n->busy_until = cpu->seconds + (cmd == CMD_ERASE_WRITE_EEPROM_PAGE ? T_PAGE_ERASE_WRITE :
+				cmd == CMD_ERASE_EEPROM_PAGE ? T_PAGE_ERASE : T_PAGE_WRITE);
+		break;
+	case CMD_APP_CRC:
+	case CMD_BOOT_CRC:
+	case CMD_FLASH_RANGE_CRC:
+		flash_crc(n, cmd);
+		break;
+	}
+	nvm_irq(n);
+}
+
+static uint8_t nvm_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct nvm_model *n = &((struct xmega_periph *)ctx)->nvm;
+
+	(void)cpu;
+	if (off == NVM_STATUS) {
+		uint8_t v = n->regs[NVM_STATUS] & NVM_FLOAD;
+
+		if (n->ee_loaded)
+			v |= NVM_EELOAD;
+		if (nvm_busy(n))
+			v |= NVM_NVMBUSY;
+		return v;
+	}
+	return n->regs[off];
+}
+
+static void nvm_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct nvm_model *n = &((struct xmega_periph *)ctx)->nvm;
+
+	switch (off) {
+	case NVM_CTRLA:
+		if ((v & 1) && avr_ccp_ioreg_ok(cpu) && !nvm_busy(n))
+			cmdex(n);
+		return;
+	case NVM_CTRLB:
+		n->regs[NVM_CTRLB] = v & 0x0F;
+		cpu->eeprom_mapped = (v & NVM_EEMAPEN) != 0;
+		return;
+	case NVM_INTCTRL:
+		n->regs[NVM_INTCTRL] = v & 0x0F;
+		nvm_irq(n);
+		return;
+	case NVM_STATUS:
+		return;
+	case NVM_DATA0:
+		n->regs[NVM_DATA0] = v;
+		if (n->regs[NVM_CMD] == CMD_LOAD_EEPROM_BUFFER)
+			ee_load(n, (uint16_t)reg24(n, NVM_ADDR0), v);
+		return;
+	}
+	n->regs[off] = v;
+}
+
+static void nvm_eeprom_write(struct avr_cpu *cpu, void *ctx, uint16_t offset, uint8_t v)
+{
+	struct nvm_model *n = &((struct xmega_periph *)ctx)->nvm;
+
+	(void)cpu;
+	n->regs[NVM_ADDR0] = (uint8_t)offset;
+	n->regs[NVM_ADDR0 + 1] = (uint8_t)(offset >> 8);
+	ee_load(n, offset, v);
+}
+
+static uint32_t nvm_spm(struct avr_cpu *cpu, void *ctx, uint32_t z)
+{
+	struct nvm_model *n = &((struct xmega_periph *)ctx)->nvm;
+	const struct xmega_device *d = cpu->dev;
+	uint8_t cmd = n->regs[NVM_CMD];
+	uint32_t page = z & ~(d->page_size - 1);
+	double t;
+	unsigned i;
+
+	if (cmd == CMD_LOAD_FLASH_BUFFER) {
+		n->flash_buf[(z % d->page_size) / 2] = (uint16_t)(cpu->r[0] | (cpu->r[1] << 8));
+		n->regs[NVM_STATUS] |= NVM_FLOAD;
+		return 0;
+	}
+	if (!(cpu->cycles <= cpu->ccp_spm_until) || page >= d->app_size + d->boot_size)
+		return 0;
+	switch (cmd) {
+	case CMD_ERASE_APP_PAGE:
+	case CMD_ERASE_BOOT_PAGE:
+		t = T_PAGE_ERASE;
+		break;
+	case CMD_WRITE_APP_PAGE:
+	case CMD_WRITE_BOOT_PAGE:
+		t = T_PAGE_WRITE;
+		break;
+	case CMD_ERASE_WRITE_APP_PAGE:
+	case CMD_ERASE_WRITE_BOOT_PAGE:
+		t = T_PAGE_ERASE_WRITE;
+		break;
+	default:
+		return 0;
+	}
+	for (i = 0; i < d->page_size / 2; i++) {
+		uint16_t *w = &cpu->flash[page / 2 + i];
+
+		if (cmd == CMD_ERASE_APP_PAGE || cmd == CMD_ERASE_BOOT_PAGE)
+			*w = 0xFFFF;
+		else if (cmd == CMD_WRITE_APP_PAGE || cmd == CMD_WRITE_BOOT_PAGE)
+			*w &= n->flash_buf[i];
+		else
+			*w = n->flash_buf[i];
+	}
+	if (cmd != CMD_ERASE_APP_PAGE && cmd != CMD_ERASE_BOOT_PAGE) {
+		memset(n->flash_buf, 0xFF, d->page_size);
+		n->regs[NVM_STATUS] &= (uint8_t)~NVM_FLOAD;
+	}
+	return (uint32_t)(t * cpu->f_cpu);
+}
+
+static void nvm_clock(struct avr_cpu *cpu, void *ctx, uint32_t cycles)
+{
+	struct nvm_model *n = &((struct xmega_periph *)ctx)->nvm;
+
+	(void)cycles;
+	if (n->regs[NVM_INTCTRL] && cpu->seconds >= n->busy_until && n->busy_until != 0) {
+		n->busy_until = 0;
+		nvm_irq(n);
+	}
+}
+
+static void nvm_reset(struct avr_cpu *cpu, void *ctx, uint8_t cause)
+{
+	struct nvm_model *n = &((struct xmega_periph *)ctx)->nvm;
+
+	(void)cause;
+	memset(n->regs, 0, sizeof(n->regs));
+	n->ee_loaded = 0;
+	memset(n->flash_buf, 0xFF, cpu->dev->page_size);
+	cpu->eeprom_mapped = 0;
+}
+
+static unsigned nvm_pending(struct avr_cpu *cpu, void *ctx)
+{
+	struct nvm_model *n = &((struct xmega_periph *)ctx)->nvm;
+
+	return (n->regs[NVM_INTCTRL] && cpu->seconds < n->busy_until) ? AVR_WAKE_IRQ : 0;
+}
+
+int nvm_attach(struct xmega_periph *x)
+{
+	struct avr_periph p = {
+		.name = "NVM", .base = NVM_BASE, .size = 0x20, .ctx = x,
+		.read = nvm_read, .write = nvm_write, .clock = nvm_clock,
+		.reset = nvm_reset, .pending = nvm_pending,
+		.spm = nvm_spm, .eeprom_write = nvm_eeprom_write,
+	};
+
+	x->nvm.x = x;
+	x->nvm.flash_buf = malloc(x->cpu->dev->page_size);
+	if (!x->nvm.flash_buf)
+		return -1;
+	x->nvm.idx = avr_add_periph(x->cpu, &p);
+	if (x->nvm.idx < 0)
+		return -1;
+	nvm_reset(x->cpu, x, AVR_RESET_POWERON);
+	return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * periph_rst.c - RST model.
+ *
+ * RST.STATUS shows the reset sources the core has accumulated since they
+ * were last cleared; writing one to a flag clears it. RST.CTRL SWRST,
+ * written with the CCP key, requests a software reset.
+ */
+
+#include "xmega_periph.h"
+
+#define RST_BASE   0x0078
+#define RST_STATUS 0
+#define RST_CTRL   1
+
+static uint8_t rst_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct xmega_periph *x = ctx;
+
+	return off == RST_STATUS ? cpu->reset_flags : x->rst.ctrl;
+}
+
+static void rst_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	(void)ctx;
+	if (off == RST_STATUS)
+		cpu->reset_flags &= (uint8_t)~v;
+	else if ((v & 1) && avr_ccp_ioreg_ok(cpu))
+		cpu->reset_request = AVR_RESET_SOFTWARE;
+}
+
+int rst_attach(struct xmega_periph *x)
+{
+	struct avr_periph p = {
+		.name = "RST", .base = RST_BASE, .size = 2, .ctx = x,
+		.read = rst_read, .write = rst_write,
+	};
+
+	x->rst.x = x;
+	return avr_add_periph(x->cpu, &p) < 0 ? -1 : 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * periph_rtc.c - 16-bit RTC model.
+ *
+ * The RTC counts its clock (CLK.RTCCTRL) through the prescaler in CTRL.
+ * CNT wraps to zero on the count after it equals PER, which sets OVFIF;
+ * COMPIF is set when CNT becomes equal to COMP. Both flags are cleared by
+ * writing one or when their vector is executed. Writes to CTRL, CNT, PER
+ * and COMP keep STATUS.SYNCBUSY set for two RTC clock periods. The 16-bit
+ * registers are accessed through TEMP, low byte first.
+ */
+
+#include <math.h>
+#include <stddef.h>
+
+#include "xmega_periph.h"
+
+#define RTC_BASE     0x0400
+#define RTC_CTRL     0x00
+#define RTC_STATUS   0x01
+#define RTC_INTCTRL  0x02
+#define RTC_INTFLAGS 0x03
+#define RTC_TEMP     0x04
+#define RTC_CNT      0x08
+#define RTC_PER      0x0A
+#define RTC_COMP     0x0C
+
+#define RTC_OVFIF    0x01
+#define RTC_COMPIF   0x02
+
+static const uint16_t rtc_div[8] = { 0, 1, 2, 8, 16, 64, 256, 1024 };
+
+static void rtc_irq(struct rtc_model *r)
+{
+	struct avr_cpu *cpu = r->x->cpu;
+	unsigned ovf = r->intctrl & 3, comp = (r->intctrl >> 2) & 3;
+
+	if ((r->intflags & RTC_OVFIF) && ovf)
+		avr_irq_raise(cpu, VECT_RTC_OVF, (enum avr_irq_level)ovf, r->idx);
+	else
+		avr_irq_clear(cpu, VECT_RTC_OVF);
+	if ((r->intflags & RTC_COMPIF) && comp)
+		avr_irq_raise(cpu, VECT_RTC_COMP, (enum avr_irq_level)comp, r->idx);
+	else
+		avr_irq_clear(cpu, VECT_RTC_COMP);
+}
+
+static uint16_t *rtc_reg16(struct rtc_model *r, uint16_t off)
+{
+	switch (off & ~1) {
+	case RTC_CNT:  return &r->cnt;
+	case RTC_PER:  return &r->per;
+	case RTC_COMP: return &r->comp;
+	}
+	return NULL;
+}
+
+static uint8_t rtc_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct rtc_model *r = &((struct xmega_periph *)ctx)->rtc;
+	uint16_t *reg = rtc_reg16(r, off);
+
+	if (reg) {
+		if (off & 1)
+			return r->temp;
+		r->temp = (uint8_t)(*reg >> 8);
+		return (uint8_t)*reg;
+	}
+	switch (off) {
+	case RTC_CTRL:     return r->ctrl;
+	case RTC_STATUS:   return cpu->seconds < r->sync_until ? 1 : 0;
+	case RTC_INTCTRL:  return r->intctrl;
+	case RTC_INTFLAGS: return r->intflags;
+	case RTC_TEMP:     return r->temp;
+	}
+	return 0;
+}
+
+static void rtc_sync(struct rtc_model *r, struct avr_cpu *cpu)
+{
+	uint32_t hz = clk_rtc_hz(r->x);
+
+	/* Without an RTC clock the synchronisation never completes. */
+	r->sync_until = hz ? cpu->seconds + 2.0 / hz : INFINITY;
+}
+
+static void rtc_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct rtc_model *r = &((struct xmega_periph *)ctx)->rtc;
+	uint16_t *reg = rtc_reg16(r, off);
+
+	if (reg) {
+		if (off & 1) {
+			*reg = (uint16_t)(r->temp | (v << 8));
+			rtc_sync(r, cpu);
+		} else {
+			r->temp = v;
+		}
+		return;
+	}
+	switch (off) {
+	case RTC_CTRL:
+		r->ctrl = v & 7;
+		rtc_sync(r, cpu);
+		break;
+	case RTC_INTCTRL:
+		r->intctrl = v & 0x0F;
+		rtc_irq(r);
+		break;
+	case RTC_INTFLAGS:
+		r->intflags &= (uint8_t)~v;
+		rtc_irq(r);
+		break;
+	case RTC_TEMP:
+		r->temp = v;
+		break;
+	}
+}
+
+static void rtc_count(struct rtc_model *r)
+{
+	if (r->cnt == r->per) {
+		r->cnt = 0;
+		r->intflags |= RTC_OVFIF;
+		evsys_signal(r->x, EVSRC_RTC_OVF);
+	} else {
+		r->cnt++;
+	}
+	if (r->cnt == r->comp) {
+		r->intflags |= RTC_COMPIF;
+		evsys_signal(r->x, EVSRC_RTC_CMP);
+	}
+}
+
+static void rtc_clock(struct avr_cpu *cpu, void *ctx, uint32_t cycles)
+{
+	struct rtc_model *r = &((struct xmega_periph *)ctx)->rtc;
+	uint16_t div = rtc_div[r->ctrl & 7];
+	uint64_t ticks = clk_acc_ticks(&r->clk, cpu, cycles, clk_rtc_hz(r->x));
+	uint8_t flags = r->intflags;
+
+	if (!div)
+		return;
+	r->presc += (uint32_t)ticks;
+	while (r->presc >= div) {
+		r->presc -= div;
+		rtc_count(r);
+	}
+	if (r->intflags != flags)
+		rtc_irq(r);
+}
+
+static void rtc_ack(struct avr_cpu *cpu, void *ctx, unsigned vector)
+{
+	struct rtc_model *r = &((struct xmega_periph *)ctx)->rtc;
+
+	(void)cpu;
+	r->intflags &= (uint8_t)~(vector == VECT_RTC_OVF ? RTC_OVFIF : RTC_COMPIF);
+	rtc_irq(r);
+}
+
+static void rtc_reset(struct avr_cpu *cpu, void *ctx, uint8_t cause)
+{
+	struct rtc_model *r = &((struct xmega_periph *)ctx)->rtc;
+
+	(void)cpu;
+	(void)cause;
+	r->ctrl = r->intctrl = r->intflags = r->temp = 0;
+	r->cnt = r->comp = 0;
+	r->per = 0xFFFF;
+	r->presc = 0;
+	r->clk.acc = 0;
+	r->sync_until = 0;
+}
+
+static unsigned rtc_pending(struct avr_cpu *cpu, void *ctx)
+{
+	struct rtc_model *r = &((struct xmega_periph *)ctx)->rtc;
+
+	(void)cpu;
+	return (rtc_div[r->ctrl & 7] && r->intctrl && clk_rtc_hz(r->x)) ? AVR_WAKE_IRQ : 0;
+}
+
+int rtc_attach(struct xmega_periph *x)
+{
+	struct avr_periph p = {
+		.name = "RTC", .base = RTC_BASE, .size = 0x10, .ctx = x,
+		.read = rtc_read, .write = rtc_write, .clock = rtc_clock,
+		.reset = rtc_reset, .irq_ack = rtc_ack, .pending = rtc_pending,
+	};
+
+	x->rtc.x = x;
+	x->rtc.idx = avr_add_periph(x->cpu, &p);
+	if (x->rtc.idx < 0)
+		return -1;
+	rtc_reset(x->cpu, x, AVR_RESET_POWERON);
+	return 0;
+}
@@ -0,0 +1,368 @@
+/*
+ * periph_tc.c - timer/counter models (TCC0 to TCF1).
+ *
+ * The counters run on clkPER through the CTRLA prescaler, or count events
+ * of an event channel. They count up to PER (CCA in frequency mode), set
+ * OVFIF and wrap to zero; CCxIF is set when CNT becomes equal to CCx.
+ * Capture (CTRLD EVACT CAPT), restart and frequency capture are modelled.
+ * PER and CCx are updated from their buffers on overflow or by the UPDATE
+ * command. Interrupt flags are cleared by writing one or when their vector
+ * is executed. Dual-slope PWM and down-counting are not modelled; the
+ * counter then counts up as in normal mode.
+ */
+
+#include <stddef.h>
+
+#include "xmega_periph.h"
+
+#define TC_CTRLA     0x00
+#define TC_CTRLB     0x01
+#define TC_CTRLD     0x03
+#define TC_INTCTRLA  0x06
+#define TC_INTCTRLB  0x07
+#define TC_CTRLFCLR  0x08
+#define TC_CTRLFSET  0x09
+#define TC_CTRLGCLR  0x0A
+#define TC_CTRLGSET  0x0B
+#define TC_INTFLAGS  0x0C
+#define TC_TEMP      0x0F
+#define TC_CNT       0x20
+#define TC_PER       0x26
+#define TC_CCA       0x28
+#define TC_PERBUF    0x36
+#define TC_CCABUF    0x38
+
+#define TC_OVFIF     0x01
+#define TC_ERRIF     0x02
+#define TC_CCAIF     0x10
+
+#define TC_EVACT_CAPT    1
+#define TC_EVACT_RESTART 4
+#define TC_EVACT_FRQ     5
+
+static const struct {
+	uint16_t base;
+	unsigned vect;
+} tc_layout[XMEGA_NUM_TC] = {
+	{ 0x0800, 14 }, { 0x0840, 20 },     /* TCC0, TCC1 */
+	{ 0x0900, 77 }, { 0x0940, 83 },     /* TCD0, TCD1 */
+	{ 0x0A00, 47 }, { 0x0A40, 53 },     /* TCE0, TCE1 */
+	{ 0x0B00, 108 }, { 0x0B40, 114 },   /* TCF0, TCF1 */
+};
+
+static const uint16_t tc_div[8] = { 0, 1, 2, 4, 8, 64, 256, 1024 };
+
+static void tc_irq(struct tc_model *t)
+{
+	struct avr_cpu *cpu = t->x->cpu;
+	uint8_t f = t->regs[TC_INTFLAGS];
+	unsigned lvl[6], i;
+
+	lvl[0] = (f & TC_OVFIF) ? t->regs[TC_INTCTRLA] & 3 : 0;
+	lvl[1] = (f & TC_ERRIF) ? (t->regs[TC_INTCTRLA] >> 2) & 3 : 0;
+	for (i = 0; i < t->nchannels; i++)
+		lvl[2 + i] = (f & (TC_CCAIF << i)) ? (t->regs[TC_INTCTRLB] >> (2 * i)) & 3 : 0;
+	for (i = 0; i < 2 + t->nchannels; i++) {
+		if (lvl[i])
+			avr_irq_raise(cpu, t->vect + i, (enum avr_irq_level)lvl[i], t->idx);
+		else
+			avr_irq_clear(cpu, t->vect + i);
+	}
+}
+
+static uint16_t top(const struct tc_model *t)
+{
+	return (t->regs[TC_CTRLB] & 7) == 1 ? t->cc[0] : t->per;
+}
+
+static void update(struct tc_model *t)
+{
+	unsigned i;
+
+	if (t->regs[TC_CTRLGSET] & 1)
+		t->per = t->perbuf;
+	for (i = 0; i < t->nchannels; i++)
+		if (t->regs[TC_CTRLGSET] & (2u << i))
+			t->cc[i] = t->ccbuf[i];
+	t->regs[TC_CTRLGSET] &= (uint8_t)~0x1F;
+}
+
+static void overflow(struct tc_model *t)
+{
+	t->regs[TC_INTFLAGS] |= TC_OVFIF;
+	if (!(t->regs[TC_CTRLFSET] & 0x02))     /* LUPD */
+		update(t);
+	evsys_signal(t->x, t->evsrc);
+}
+
+static void compare(struct tc_model *t, uint32_t from, uint32_t to)
+{
+	unsigned i;
+
+	/* Channels whose value CNT reached in (from, to]. */
+	for (i = 0; i < t->nchannels; i++)
+		if (t->cc[i] > from && t->cc[i] <= to) {
+			t->regs[TC_INTFLAGS] |= (uint8_t)(TC_CCAIF << i);
+			evsys_signal(t->x, (uint8_t)(t->evsrc + 4 + i));
+		}
+}
+
+/* Advance the counter by n counts. */
+static void tc_advance(struct tc_model *t, uint64_t n)
+{
+	unsigned i;
+
+	while (n) {
+		uint32_t limit = t->cnt <= top(t) ? top(t) : 0xFFFF;
+		uint32_t left = limit - t->cnt + 1;
+
+		if (n < left) {
+			compare(t, t->cnt, t->cnt + (uint32_t)n);
+			t->cnt = (uint16_t)(t->cnt + n);
+			return;
+		}
+		compare(t, t->cnt, limit);
+		n -= left;
+		t->cnt = 0;
+		for (i = 0; i < t->nchannels; i++)
+			if (t->cc[i] == 0)
+				t->regs[TC_INTFLAGS] |= (uint8_t)(TC_CCAIF << i);
+		overflow(t);
+	}
+}
+
+static void capture(struct tc_model *t, unsigned i)
+{
+	if (t->regs[TC_INTFLAGS] & (TC_CCAIF << i))
+		t->regs[TC_INTFLAGS] |= TC_ERRIF;       /* buffer overflow */
+	t->cc[i] = t->cnt;
+	t->regs[TC_INTFLAGS] |= (uint8_t)(TC_CCAIF << i);
+}
+
+void tc_event(struct tc_model *t, unsigned ch)
+{
+	uint8_t clksel = t->regs[TC_CTRLA] & 0x0F;
+	uint8_t evsel = t->regs[TC_CTRLD] & 0x0F;
+	unsigned evact = t->regs[TC_CTRLD] >> 5;
+	uint8_t flags = t->regs[TC_INTFLAGS];
+
+	if (clksel >= 8 && clksel - 8u == ch)
+		tc_advance(t, 1);
+
+	if (evsel >= 8 && ch >= evsel - 8u) {
+		unsigned i = ch - (evsel - 8u);
+
+		switch (evact) {
+		case TC_EVACT_CAPT:
+			if (i < t->nchannels && (t->regs[TC_CTRLB] & (0x10 << i)))
+				capture(t, i);
+			break;
+		case TC_EVACT_RESTART:
+			if (i == 0)
+				t->cnt = 0;
+			break;
+		case TC_EVACT_FRQ:
+			if (i == 0 && (t->regs[TC_CTRLB] & 0x10)) {
+				capture(t, 0);
+				t->cnt = 0;
+			}
+			break;
+		}
+	}
+	if (t->regs[TC_INTFLAGS] != flags)
+		tc_irq(t);
+}
+
+static uint16_t *tc_reg16(struct tc_model *t, uint16_t off)
+{
+	if (off == TC_CNT || off == TC_CNT + 1)
+		return &t->cnt;
+	if (off == TC_PER || off == TC_PER + 1)
+		return &t->per;
+	if (off >= TC_CCA && off < TC_CCA + 2 * t->nchannels)
+		return &t->cc[(off - TC_CCA) / 2];
+	if (off == TC_PERBUF || off == TC_PERBUF + 1)
+		return &t->perbuf;
+	if (off >= TC_CCABUF && off < TC_CCABUF + 2 * t->nchannels)
+		return &t->ccbuf[(off - TC_CCABUF) / 2];
+	return NULL;
+}
+
+static uint8_t tc_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct tc_model *t = ctx;
+	uint16_t *reg = tc_reg16(t, off);
+
+	(void)cpu;
+	if (reg) {
+		if (off & 1)
+			return t->temp;
+		t->temp = (uint8_t)(*reg >> 8);
+		return (uint8_t)*reg;
+	}
+	switch (off) {
+	case TC_CTRLFCLR:
+		return t->regs[TC_CTRLFSET];
+	case TC_CTRLGCLR:
+		return t->regs[TC_CTRLGSET];
+	case TC_TEMP:
+		return t->temp;
+	}
+	return t->regs[off];
+}
+
+static void tc_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct tc_model *t = ctx;
+	uint16_t *reg = tc_reg16(t, off);
+
+	(void)cpu;
+	if (reg) {
+		if (!(off & 1)) {
+			t->temp = v;
+			return;
+		}
+		*reg = (uint16_t)(t->temp | (v << 8));
+		if (reg == &t->perbuf)
+			t->regs[TC_CTRLGSET] |= 0x01;
+		else if (reg >= t->ccbuf && reg < t->ccbuf + 4)
+			t->regs[TC_CTRLGSET] |= (uint8_t)(2u << (reg - t->ccbuf));
+		return;
+	}
+	switch (off) {
+	case TC_CTRLFCLR:
+		t->regs[TC_CTRLFSET] &= (uint8_t)~(v & 0x03);
+		return;
+	case TC_CTRLFSET:
+		t->regs[TC_CTRLFSET] |= v & 0x03;
+		switch ((v >> 2) & 3) {
+		case 1:     /* UPDATE */
+			update(t);
+			break;
+		case 2:     /* RESTART */
+			t->cnt = 0;
+			t->presc = 0;
+			break;
+		case 3:     /* RESET, only when the counter is off */
+			if (!(t->regs[TC_CTRLA] & 0x0F)) {
+				struct xmega_periph *x = t->x;
+				uint16_t base = t->base;
+				unsigned vect = t->vect, n = t->nchannels;
+				int idx = t->idx;
+				uint8_t evsrc = t->evsrc;
+
+				*t = (struct tc_model){ .x = x, .idx = idx, .base = base, .vect = vect,
+						.nchannels = n, .evsrc = evsrc, .per = 0xFFFF };
+			}
+			break;
+		}
+		return;
+	case TC_CTRLGCLR:
+		t->regs[TC_CTRLGSET] &= (uint8_t)~v;
+		return;
+	case TC_CTRLGSET:
+		t->regs[TC_CTRLGSET] |= v;
+		return;
+	case TC_INTFLAGS:
+		t->regs[TC_INTFLAGS] &= (uint8_t)~v;
+		break;
+	case TC_TEMP:
+		t->temp = v;
+		return;
+	default:
+		t->regs[off] = v;
+		break;
+	}
+	tc_irq(t);
+}
+
+static void tc_clock(struct avr_cpu *cpu, void *ctx, uint32_t cycles)
+{
+	struct tc_model *t = ctx;
+	uint8_t clksel = t->regs[TC_CTRLA] & 0x0F;
+	uint8_t flags = t->regs[TC_INTFLAGS];
+	uint16_t div;
+
+	(void)cpu;
+	if (!clksel || clksel >= 8)
+		return;
+	div = tc_div[clksel];
+	t->presc += cycles;
+	if (t->presc < div)
+		return;
+	tc_advance(t, t->presc / div);
+	t->presc %= div;
+	if (t->regs[TC_INTFLAGS] != flags)
+		tc_irq(t);
+}
+
+static void tc_ack(struct avr_cpu *cpu, void *ctx, unsigned vector)
+{
+	struct tc_model *t = ctx;
+	unsigned i = vector - t->vect;
+
+	(void)cpu;
+	if (i == 0)
+		t->regs[TC_INTFLAGS] &= (uint8_t)~TC_OVFIF;
+	else if (i == 1)
+		t->regs[TC_INTFLAGS] &= (uint8_t)~TC_ERRIF;
+	else
+		t->regs[TC_INTFLAGS] &= (uint8_t)~(TC_CCAIF << (i - 2));
+	tc_irq(t);
+}
+
+static void tc_reset(struct avr_cpu *cpu, void *ctx, uint8_t cause)
+{
+	struct tc_model *t = ctx;
+	unsigned i;
+
+	(void)cpu;
+	(void)cause;
+	for (i = 0; i < sizeof(t->regs); i++)
+		t->regs[i] = 0;
+	t->cnt = t->perbuf = 0;
+	t->per = 0xFFFF;
+	for (i = 0; i < 4; i++)
+		t->cc[i] = t->ccbuf[i] = 0;
+	t->temp = 0;
+	t->presc = 0;
+}
+
+static unsigned tc_pending(struct avr_cpu *cpu, void *ctx)
+{
+	struct tc_model *t = ctx;
+	uint8_t clksel = t->regs[TC_CTRLA] & 0x0F;
+
+	(void)cpu;
+	if (clksel && clksel < 8 && (t->regs[TC_INTCTRLA] || t->regs[TC_INTCTRLB]))
+		return AVR_WAKE_IRQ;
+	return 0;
+}
+
+int tc_attach(struct xmega_periph *x)
+{
+	static const char *const names[XMEGA_NUM_TC] = {
+		"TCC0", "TCC1", "TCD0", "TCD1", "TCE0", "TCE1", "TCF0", "TCF1",
+	};
+	unsigned i;
+
+	for (i = 0; i < XMEGA_NUM_TC; i++) {
+		struct tc_model *t = &x->tc[i];
+		struct avr_periph p = {
+			.name = names[i], .base = tc_layout[i].base, .size = 0x40, .ctx = t,
+			.read = tc_read, .write = tc_write, .clock = tc_clock,
+			.reset = tc_reset, .irq_ack = tc_ack, .pending = tc_pending,
+		};
+
+		t->x = x;
+		t->base = tc_layout[i].base;
+		t->vect = tc_layout[i].vect;
+		t->nchannels = (i & 1) ? 2 : 4;
+		t->evsrc = (uint8_t)(EVSRC_TCC0 + 8 * i);
+		t->idx = avr_add_periph(x->cpu, &p);
+		if (t->idx < 0)
+			return -1;
+		tc_reset(x->cpu, t, AVR_RESET_POWERON);
+	}
+	return 0;
+}
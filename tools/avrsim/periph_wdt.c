@@ -0,0 +1,123 @@
+/*
+ * periph_wdt.c - WDT model.
+ *
+ * The watchdog counts ULP clock ticks. In normal mode it resets the device
+ * when the count reaches the period (PER). In window mode the count first
+ * runs through the closed period (WPER), where a WDR resets the device,
+ * and then through the open period. CTRL and WINCTRL need the CCP key and
+ * the change enable bit; a write keeps STATUS.SYNCBUSY set for two ULP
+ * clock periods. Every reset disables the watchdog (no WDT fuses).
+ */
+
+#include "xmega_periph.h"
+
+#define WDT_BASE    0x0080
+#define WDT_CTRL    0
+#define WDT_WINCTRL 1
+#define WDT_STATUS  2
+
+#define WDT_ENABLE  0x02
+#define WDT_CEN     0x01
+
+/* ULP clock ticks of a PER or WPER setting: 8 CLK to 8K CLK. */
+static uint32_t wdt_ticks(uint8_t reg)
+{
+	unsigned per = (reg >> 2) & 0x0F;
+
+	return 8u << (per > 10 ? 10 : per);
+}
+
+static void wdt_sync(struct wdt_model *w, struct avr_cpu *cpu)
+{
+	uint32_t hz = clk_ulp_hz(w->x);
+
+	w->sync_until = cpu->seconds + (hz ? 2.0 / hz : 0.0);
+}
+
+static uint8_t wdt_read(struct avr_cpu *cpu, void *ctx, uint16_t off)
+{
+	struct wdt_model *w = &((struct xmega_periph *)ctx)->wdt;
+
+	switch (off) {
+	case WDT_CTRL:    return w->ctrl;
+	case WDT_WINCTRL: return w->winctrl;
+	default:          return cpu->seconds < w->sync_until ? 1 : 0;
+	}
+}
+
+static void wdt_write(struct avr_cpu *cpu, void *ctx, uint16_t off, uint8_t v)
+{
+	struct wdt_model *w = &((struct xmega_periph *)ctx)->wdt;
+
+	if (off > WDT_WINCTRL || !avr_ccp_ioreg_ok(cpu) || !(v & WDT_CEN))
+		return;
+	if (off == WDT_CTRL) {
+		if ((v & WDT_ENABLE) && !(w->ctrl & WDT_ENABLE))
+			w->count = 0;
+		w->ctrl = v & 0x3E;
+	} else {
+		w->winctrl = v & 0x3E;
+	}
+	wdt_sync(w, cpu);
+}
+
+static void wdt_wdr(struct avr_cpu *cpu, void *ctx)
+{
+	struct wdt_model *w = &((struct xmega_periph *)ctx)->wdt;
+
+	if (!(w->ctrl & WDT_ENABLE))
+		return;
+	/* A WDR in the closed period of window mode is a watchdog failure. */
+	if ((w->winctrl & WDT_ENABLE) && w->count < wdt_ticks(w->winctrl)) {
+		cpu->reset_request = AVR_RESET_WDT;
+		return;
+	}
+	w->count = 0;
+}
+
+static void wdt_clock(struct avr_cpu *cpu, void *ctx, uint32_t cycles)
+{
+	struct wdt_model *w = &((struct xmega_periph *)ctx)->wdt;
+	uint32_t timeout;
+
+	if (!(w->ctrl & WDT_ENABLE))
+		return;
+	w->count += (uint32_t)clk_acc_ticks(&w->ulp, cpu, cycles, clk_ulp_hz(w->x));
+	timeout = wdt_ticks(w->ctrl);
+	if (w->winctrl & WDT_ENABLE)
+		timeout += wdt_ticks(w->winctrl);
+	if (w->count >= timeout)
+		cpu->reset_request = AVR_RESET_WDT;
+}
+
+static void wdt_reset(struct avr_cpu *cpu, void *ctx, uint8_t cause)
+{
+	struct wdt_model *w = &((struct xmega_periph *)ctx)->wdt;
+
+	(void)cpu;
+	(void)cause;
+	w->ctrl = w->winctrl = 0;
+	w->count = 0;
+	w->ulp.acc = 0;
+	w->sync_until = 0;
+}
+
+static unsigned wdt_pending(struct avr_cpu *cpu, void *ctx)
+{
+	struct wdt_model *w = &((struct xmega_periph *)ctx)->wdt;
+
+	(void)cpu;
+	return (w->ctrl & WDT_ENABLE) ? AVR_WAKE_RESET : 0;
+}
+
+int wdt_attach(struct xmega_periph *x)
+{
+	struct avr_periph p = {
+		.name = "WDT", .base = WDT_BASE, .size = 3, .ctx = x,
+		.read = wdt_read, .write = wdt_write, .clock = wdt_clock,
+		.reset = wdt_reset, .wdr = wdt_wdr, .pending = wdt_pending,
+	};
+
+	x->wdt.x = x;
+	return avr_add_periph(x->cpu, &p) < 0 ? -1 : 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * profile.c - cycle profile of a simulated program.
+ */
+
+#include "profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int cmp_func_addr(const void *a, const void *b)
+{
+	const struct prof_func *fa = a, *fb = b;
+
+	if (fa->start != fb->start)
+		return fa->start < fb->start ? -1 : 1;
+	return 0;
+}
+
+static int cmp_func_self(const void *a, const void *b)
+{
+	const struct prof_func *fa = *(const struct prof_func *const *)a;
+	const struct prof_func *fb = *(const struct prof_func *const *)b;
+
+	if (fa->self != fb->self)
+		return fa->self > fb->self ? -1 : 1;
+	return fa->start < fb->start ? -1 : fa->start > fb->start;
+}
+
+/* Code symbols: functions and global labels (assembler entry points such as __init). */
+static int is_code_symbol(const struct elf_file *ef, const struct elf_symbol *s)
+{
+	if (s->shndx == 0 || s->shndx >= ef->nsections || s->value >= AVR_SRAM_BASE)
+		return 0;
+	if (!(ef->sections[s->shndx].flags & ELF_SHF_EXEC))
+		return 0;
+	if (s->type == ELF_STT_FUNC)
+		return 1;
+	return s->type == ELF_STT_NOTYPE && s->bind != ELF_STB_LOCAL;
+}
+
+static void hook_call(struct avr_cpu *cpu, void *ctx, uint32_t target, int is_irq, uint16_t sp_before)
+{
+	struct profile *p = ctx;
+	struct prof_frame *fr;
+
+	if (p->depth == PROFILE_MAX_DEPTH) {
+		p->dropped++;
+		return;
+	}
+	/* Interrupt vectors hold a JMP or RJMP to the handler. */
+	if (is_irq && target < cpu->flash_words) {
+		uint16_t op = cpu->flash[target];
+
+		if ((op & 0xFE0E) == 0x940C && target + 1 < cpu->flash_words)
+			target = ((uint32_t)(((op >> 3) & 0x3E) | (op & 1)) << 16) | cpu->flash[target + 1];
+		else if ((op & 0xF000) == 0xC000)
+			target = (uint32_t)((int32_t)target + 1 + ((int16_t)(op << 4) >> 4)) % cpu->flash_words;
+	}
+	fr = &p->stack[p->depth++];
+	fr->func = profile_find_func(p, target);
+	fr->start = cpu->cycles;
+	fr->sp_before = sp_before;
+	fr->min_sp = cpu->sp;
+	fr->irq = is_irq;
+	if (fr->func >= 0 && is_irq)
+		p->funcs[fr->func].irq = 1;
+}
+
+static void hook_ret(struct avr_cpu *cpu, void *ctx, int is_reti)
+{
+	struct profile *p = ctx;
+
+	(void)cpu;
+	(void)is_reti;
+	/* The frame is closed after the cycles of the RET have been added. */
+	p->ret_pending = 1;
+}
+
+static void hook_sp(struct avr_cpu *cpu, void *ctx)
+{
+	struct profile *p = ctx;
+
+	if (cpu->sp < p->min_sp)
+		p->min_sp = cpu->sp;
+	if (p->depth && cpu->sp < p->stack[p->depth - 1].min_sp)
+		p->stack[p->depth - 1].min_sp = cpu->sp;
+}
+
+int profile_init(struct profile *p, struct avr_cpu *cpu, const struct elf_file *ef)
+{
+	unsigned i, n = 0;
+
+	memset(p, 0, sizeof(*p));
+	p->cpu = cpu;
+	p->min_sp = cpu->sp;
+	p->pc_cycles = calloc(cpu->flash_words, sizeof(uint64_t));
+	p->pc_count = calloc(cpu->flash_words, sizeof(uint64_t));
+	p->funcs = calloc(ef->nsymbols ? ef->nsymbols : 1, sizeof(struct prof_func));
+	if (!p->pc_cycles || !p->pc_count || !p->funcs) {
+		profile_free(p);
+		return -1;
+	}
+
+	for (i = 0; i < ef->nsymbols; i++) {
+		const struct elf_symbol *s = &ef->symbols[i];
+
+		if (!is_code_symbol(ef, s))
+			continue;
+		p->funcs[n].name = s->name;
+		p->funcs[n].start = s->value / 2;
+		p->funcs[n].end = s->size ? (s->value + s->size + 1) / 2 : 0;
+		p->funcs[n].min = UINT64_MAX;
+		p->funcs[n].irq = s->type == ELF_STT_FUNC ? 0 : -1;
+		n++;
+	}
+	qsort(p->funcs, n, sizeof(*p->funcs), cmp_func_addr);
+
+	/* One entry per address: prefer a function over a label of the same address. */
+	p->nfuncs = 0;
+	for (i = 0; i < n; i++) {
+		struct prof_func *last = p->nfuncs ? &p->funcs[p->nfuncs - 1] : NULL;
+
+		if (last && last->start == p->funcs[i].start) {
+			if (last->irq < 0 && p->funcs[i].irq == 0)
+				*last = p->funcs[i];
+			continue;
+		}
+		p->funcs[p->nfuncs++] = p->funcs[i];
+	}
+	/* Symbols without a size reach up to the next one. */
+	for (i = 0; i < p->nfuncs; i++) {
+		uint32_t next = i + 1 < p->nfuncs ? p->funcs[i + 1].start : cpu->flash_words;
+
+		if (!p->funcs[i].end || p->funcs[i].end > next)
+			p->funcs[i].end = next;
+		p->funcs[i].irq = 0;
+	}
+
+	cpu->hooks.ctx = p;
+	cpu->hooks.call = hook_call;
+	cpu->hooks.ret = hook_ret;
+	cpu->hooks.sp_change = hook_sp;
+	return 0;
+}
+
+int profile_record_calls(struct profile *p, int f, unsigned max)
+{
+	struct prof_func *fn = &p->funcs[f];
+
+	if (fn->each)
+		return 0;
+	fn->each = calloc(max ? max : 1, sizeof(*fn->each));
+	if (!fn->each)
+		return -1;
+	fn->max_each = max;
+	return 0;
+}
+
+void profile_free(struct profile *p)
+{
+	unsigned i;
+
+	for (i = 0; p->funcs && i < p->nfuncs; i++)
+		free(p->funcs[i].each);
+	free(p->pc_cycles);
+	free(p->pc_count);
+	free(p->funcs);
+	p->pc_cycles = p->pc_count = NULL;
+	p->funcs = NULL;
+}
+
+int profile_find_func(const struct profile *p, uint32_t pc)
+{
+	unsigned lo = 0, hi = p->nfuncs;
+
+	while (lo < hi) {
+		unsigned mid = (lo + hi) / 2;
+
+		if (p->funcs[mid].start <= pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0 || pc >= p->funcs[lo - 1].end)
+		return -1;
+	return (int)lo - 1;
+}
+
+static void close_frame(struct profile *p)
+{
+	struct prof_frame *fr = &p->stack[--p->depth];
+	uint64_t c = p->cpu->cycles - fr->start;
+
+	if (p->depth && fr->min_sp < p->stack[p->depth - 1].min_sp)
+		p->stack[p->depth - 1].min_sp = fr->min_sp;
+	if (fr->func >= 0) {
+		struct prof_func *f = &p->funcs[fr->func];
+		unsigned stack = (unsigned)(fr->sp_before - fr->min_sp);
+
+		f->incl += c;
+		f->calls++;
+		if (c < f->min)
+			f->min = c;
+		if (c > f->max)
+			f->max = c;
+		if (stack > f->max_stack)
+			f->max_stack = stack;
+		if (f->neach < f->max_each) {
+			f->each[f->neach].cycles = c;
+			f->each[f->neach++].stack = stack;
+		}
+	}
+}
+
+void profile_step(struct profile *p)
+{
+	const struct avr_cpu *cpu = p->cpu;
+
+	if (cpu->last_pc < cpu->flash_words) {
+		p->pc_cycles[cpu->last_pc] += cpu->last_cycles;
+		p->pc_count[cpu->last_pc]++;
+	}
+	if (p->ret_pending) {
+		/* Everything at or below the restored SP has returned, which also covers
+		 * frames left by code that unwinds the stack without RET. */
+		while (p->depth && p->stack[p->depth - 1].sp_before <= cpu->sp)
+			close_frame(p);
+		p->ret_pending = 0;
+	}
+}
+
+void profile_reset_frames(struct profile *p)
+{
+	p->depth = 0;
+	p->ret_pending = 0;
+}
+
+uint64_t profile_range_cycles(const struct profile *p, uint32_t start, uint32_t end)
+{
+	uint64_t sum = 0;
+	uint32_t i;
+
+	for (i = start; i < end && i < p->cpu->flash_words; i++)
+		sum += p->pc_cycles[i];
+	return sum;
+}
+
+unsigned profile_max_stack(const struct profile *p)
+{
+	return (unsigned)(XMEGA_INTERNAL_SRAM_START + p->cpu->dev->sram_size - 1 - p->min_sp);
+}
+
+void profile_print(const struct profile *p, FILE *f, unsigned top)
+{
+	const struct prof_func **order;
+	uint64_t total = p->cpu->cycles, other = 0;
+	unsigned i, n = 0;
+
+	order = malloc((p->nfuncs ? p->nfuncs : 1) * sizeof(*order));
+	if (!order)
+		return;
+	for (i = 0; i < p->nfuncs; i++) {
+		struct prof_func *fn = &p->funcs[i];
+
+		fn->self = profile_range_cycles(p, fn->start, fn->end);
+		if (fn->self || fn->calls)
+			order[n++] = fn;
+	}
+	qsort(order, n, sizeof(*order), cmp_func_self);
+
+	fprintf(f, "%12s %6s %12s %8s %10s %10s %6s  %s\n",
+			"self", "%", "inclusive", "calls", "min", "max", "stack", "function");
+	for (i = 0; i < n; i++) {
+		const struct prof_func *fn = order[i];
+
+		if (top && i >= top) {
+			other += fn->self;
+			continue;
+		}
+		fprintf(f, "%12llu %5.1f%% ", (unsigned long long)fn->self, total ? 100.0 * fn->self / total : 0.0);
+		if (fn->calls)
+			fprintf(f, "%12llu %8llu %10llu %10llu %6u  ", (unsigned long long)fn->incl,
+					(unsigned long long)fn->calls, (unsigned long long)fn->min,
+					(unsigned long long)fn->max, fn->max_stack);
+		else
+			fprintf(f, "%12s %8s %10s %10s %6s  ", "-", "-", "-", "-", "-");
+		fprintf(f, "%s%s\n", fn->name, fn->irq ? " [irq]" : "");
+	}
+	if (other)
+		fprintf(f, "%12llu %5.1f%%  (%u more functions)\n", (unsigned long long)other,
+				total ? 100.0 * other / total : 0.0, n - top);
+	free(order);
+}
@@ -0,0 +1,89 @@
+/*
+ * profile.h - cycle profile of a simulated program.
+ *
+ * Every executed instruction is charged to its word address. The flat
+ * profile is folded into the function symbols of the ELF file. Calls and
+ * interrupts open a frame, which is closed again when SP returns above it.
+ * This gives the inclusive cycles per call (the CALL and RET, or the
+ * interrupt entry and RETI, included) and the stack depth reached below it.
+ */
+
+#ifndef AVRSIM_PROFILE_H
+#define AVRSIM_PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "avr_cpu.h"
+#include "elf32.h"
+
+#define PROFILE_MAX_DEPTH 256
+
+struct prof_call {
+	uint64_t cycles;            /* inclusive */
+	unsigned stack;             /* bytes, return address included */
+};
+
+struct prof_func {
+	const char *name;
+	uint32_t start;             /* word address */
+	uint32_t end;               /* word address + 1 */
+	uint64_t self;              /* cycles spent in this function's code */
+	uint64_t incl;              /* cycles of all completed calls */
+	uint64_t calls;             /* completed calls */
+	uint64_t min, max;          /* cycles per call */
+	unsigned max_stack;         /* bytes, return address included */
+	int irq;                    /* entered as an interrupt handler */
+	struct prof_call *each;     /* the first max_each calls, if recorded */
+	unsigned neach, max_each;
+};
+
+struct prof_frame {
+	int func;                   /* index into funcs, -1 if unknown */
+	uint64_t start;             /* cycle count before the call */
+	uint16_t sp_before;
+	uint16_t min_sp;
+	int irq;
+};
+
+struct profile {
+	const struct avr_cpu *cpu;
+	uint64_t *pc_cycles;        /* per word address */
+	uint64_t *pc_count;
+
+	struct prof_func *funcs;
+	unsigned nfuncs;
+
+	struct prof_frame stack[PROFILE_MAX_DEPTH];
+	unsigned depth;
+	unsigned dropped;           /* frames not recorded because of the depth limit */
+	int ret_pending;
+	uint16_t min_sp;
+};
+
+/* Set up the profile and install its hooks in cpu. */
+int profile_init(struct profile *p, struct avr_cpu *cpu, const struct elf_file *ef);
+void profile_free(struct profile *p);
+
+/* Record the cycles and stack of each of the first max calls of function f. */
+int profile_record_calls(struct profile *p, int f, unsigned max);
+
+/* Charge the last instruction; call after every avr_step(). */
+void profile_step(struct profile *p);
+
+/* Drop the open frames, e.g. after a reset. */
+void profile_reset_frames(struct profile *p);
+
+/* Function containing a word address, or -1. */
+int profile_find_func(const struct profile *p, uint32_t pc);
+
+/* Cycles spent in [start, end) word addresses. */
+uint64_t profile_range_cycles(const struct profile *p, uint32_t start, uint32_t end);
+
+/* Stack bytes used below the initial SP. */
+unsigned profile_max_stack(const struct profile *p);
+
+/* Table of the functions by self cycles, at most top rows (0 for all). */
+void profile_print(const struct profile *p, FILE *f, unsigned top);
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * xmega_periph.c - attaches the XMEGA peripheral models to a CPU.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "xmega_periph.h"
+
+int xmega_periph_attach(struct xmega_periph *x, struct avr_cpu *cpu, const struct xmega_periph_conf *conf)
+{
+	memset(x, 0, sizeof(*x));
+	x->cpu = cpu;
+	if (conf)
+		x->conf = *conf;
+	if (!x->conf.rc2m_hz)
+		x->conf.rc2m_hz = 2000000;
+	if (!x->conf.rc32m_hz)
+		x->conf.rc32m_hz = 32000000;
+	if (!x->conf.rc32k_hz)
+		x->conf.rc32k_hz = 32768;
+	if (!x->conf.ulp_hz)
+		x->conf.ulp_hz = 1000;
+
+	/* The clock model comes first: the others read cpu->f_cpu on reset. */
+	if (clk_attach(x) < 0 || rst_attach(x) < 0 || wdt_attach(x) < 0 || rtc_attach(x) < 0
+			|| tc_attach(x) < 0 || evsys_attach(x) < 0 || crc_attach(x) < 0
+			|| nvm_attach(x) < 0 || dma_attach(x) < 0) {
+		xmega_periph_free(x);
+		return -1;
+	}
+	return 0;
+}
+
+void xmega_periph_free(struct xmega_periph *x)
+{
+	free(x->nvm.flash_buf);
+	x->nvm.flash_buf = NULL;
+}
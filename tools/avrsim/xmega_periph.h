@@ -0,0 +1,211 @@
+/*
+ * xmega_periph.h - behavioural models of the XMEGA peripherals that the
+ * Class B tests use.
+ *
+ * The models attach to the simulator core as struct avr_periph and follow
+ * the register layout of the XMEGA A manual:
+ *
+ *   OSC/CLK  oscillator enables and start-up, system clock selection and
+ *            prescalers (they set cpu->f_cpu), RTC clock source
+ *   RST/WDT  reset flags, software reset, watchdog in normal and window
+ *            mode on the ULP clock, with register synchronisation
+ *   RTC      16-bit RTC with prescaler, overflow and compare
+ *   TCxn     16-bit timer/counters with prescaler or event clock, compare
+ *            and capture channels (single slope/normal modes)
+ *   EVSYS    event routing between the RTC, TCs and DMA
+ *   CRC      I/O, Flash and DMA data sources, CRC-16 and CRC-32
+ *   NVM      EEPROM page buffer and writes, EEPROM mapping, Flash CRC
+ *            commands, Flash page writes through SPM
+ *   DMA      four channels, block transfers, repeat, reload and EVSYS
+ *            triggers
+ *
+ * The GPIO/GPIOR registers need no model: they are plain registers that
+ * are cleared by every reset, which the core does for all unmodelled I/O.
+ *
+ * Time is derived from CPU cycles and cpu->f_cpu, so clock changes are
+ * taken into account. Oscillator frequencies are nominal unless set in
+ * struct xmega_periph_conf, which is how clock faults can be simulated.
+ */
+
+#ifndef AVRSIM_XMEGA_PERIPH_H
+#define AVRSIM_XMEGA_PERIPH_H
+
+#include <stdint.h>
+
+#include "avr_cpu.h"
+
+/* Interrupt vectors, common to the XMEGA A1/A3/A4 devices. */
+#define VECT_OSC_XOSCF  1
+#define VECT_DMA_CH0    6
+#define VECT_RTC_OVF    10
+#define VECT_RTC_COMP   11
+#define VECT_NVM_EE     32
+#define VECT_NVM_SPM    33
+
+/* Event system sources (EVSYS.CHnMUX). */
+#define EVSRC_RTC_OVF   0x08
+#define EVSRC_RTC_CMP   0x09
+#define EVSRC_TCC0      0xC0    /* +0 OVF, +1 ERR, +4..7 CCA..CCD; next TC +8 */
+
+#define XMEGA_NUM_TC    8
+#define XMEGA_NUM_DMA   4
+#define XMEGA_NUM_EVCH  8
+
+/* Oscillator frequencies in Hz, 0 for nominal; xosc 0 means no crystal. */
+struct xmega_periph_conf {
+	uint32_t rc2m_hz;
+	uint32_t rc32m_hz;
+	uint32_t rc32k_hz;
+	uint32_t ulp_hz;
+	uint32_t xosc_hz;
+};
+
+struct xmega_periph;
+
+/* Fractional clock: converts CPU cycles into ticks of another clock. */
+struct clk_acc {
+	uint64_t acc;
+};
+
+struct clk_model {
+	struct xmega_periph *x;
+	uint8_t osc[8];
+	uint8_t clk[8];
+	double enabled_at[5];       /* seconds when each oscillator was enabled */
+};
+
+struct rst_model {
+	struct xmega_periph *x;
+	uint8_t ctrl;
+};
+
+struct wdt_model {
+	struct xmega_periph *x;
+	uint8_t ctrl, winctrl;
+	uint32_t count;             /* ULP ticks since the last WDR */
+	struct clk_acc ulp;
+	double sync_until;
+};
+
+struct rtc_model {
+	struct xmega_periph *x;
+	int idx;
+	uint8_t ctrl, intctrl, intflags, temp;
+	uint16_t cnt, per, comp;
+	uint32_t presc;             /* RTC clocks since the last count */
+	struct clk_acc clk;
+	double sync_until;
+};
+
+struct tc_model {
+	struct xmega_periph *x;
+	int idx;
+	uint16_t base;
+	unsigned vect;              /* OVF vector; ERR, CCA.. follow */
+	unsigned nchannels;         /* 4 for type 0, 2 for type 1 */
+	uint8_t evsrc;
+	uint8_t regs[0x40];         /* control registers */
+	uint16_t cnt, per, perbuf, cc[4], ccbuf[4];
+	uint8_t temp;
+	uint32_t presc;
+};
+
+struct evsys_model {
+	struct xmega_periph *x;
+	uint8_t regs[0x20];
+	unsigned depth;             /* nesting of cascaded events */
+};
+
+struct crc_model {
+	struct xmega_periph *x;
+	uint8_t ctrl, status;
+	uint32_t raw;               /* checksum register */
+};
+
+struct nvm_model {
+	struct xmega_periph *x;
+	int idx;
+	uint8_t regs[0x20];
+	uint8_t ee_buf[32];
+	uint32_t ee_loaded;         /* bit per loaded page buffer byte */
+	uint16_t *flash_buf;
+	double busy_until;
+};
+
+struct dma_channel {
+	uint8_t ctrla, ctrlb, addrctrl, trigsrc, repcnt;
+	uint16_t trfcnt, block;     /* block is the programmed TRFCNT */
+	uint32_t src, dest, src0, dest0;
+	int active;                 /* transferring */
+	uint32_t left;              /* bytes left in the current request */
+};
+
+struct dma_model {
+	struct xmega_periph *x;
+	int idx;
+	uint8_t ctrl, temp;
+	struct dma_channel ch[XMEGA_NUM_DMA];
+	uint32_t budget;            /* cycles not yet used for transfers */
+};
+
+struct xmega_periph {
+	struct avr_cpu *cpu;
+	struct xmega_periph_conf conf;
+	struct clk_model clk;
+	struct rst_model rst;
+	struct wdt_model wdt;
+	struct rtc_model rtc;
+	struct tc_model tc[XMEGA_NUM_TC];
+	struct evsys_model evsys;
+	struct crc_model crc;
+	struct nvm_model nvm;
+	struct dma_model dma;
+};
+
+/* Attach all models to cpu. conf may be NULL. Returns 0 or -1. */
+int xmega_periph_attach(struct xmega_periph *x, struct avr_cpu *cpu, const struct xmega_periph_conf *conf);
+void xmega_periph_free(struct xmega_periph *x);
+
+/* Ticks of a clock of hz that elapsed in cycles CPU cycles. */
+static inline uint64_t clk_acc_ticks(struct clk_acc *a, const struct avr_cpu *cpu, uint32_t cycles, uint32_t hz)
+{
+	uint64_t n;
+
+	a->acc += (uint64_t)cycles * hz;
+	n = a->acc / cpu->f_cpu;
+	a->acc %= cpu->f_cpu;
+	return n;
+}
+
+/* Per model attach functions, used by xmega_periph_attach(). */
+int clk_attach(struct xmega_periph *x);
+int rst_attach(struct xmega_periph *x);
+int wdt_attach(struct xmega_periph *x);
+int rtc_attach(struct xmega_periph *x);
+int tc_attach(struct xmega_periph *x);
+int evsys_attach(struct xmega_periph *x);
+int crc_attach(struct xmega_periph *x);
+int nvm_attach(struct xmega_periph *x);
+int dma_attach(struct xmega_periph *x);
+
+/* Frequencies from the clock model, in Hz; 0 if the clock is off. */
+uint32_t clk_ulp_hz(const struct xmega_periph *x);
+uint32_t clk_rtc_hz(const struct xmega_periph *x);
+
+/* Event system: a source fired, and the channels a source is routed to. */
+void evsys_signal(struct xmega_periph *x, uint8_t source);
+
+/* Event on channel ch for the TCs and DMA. */
+void tc_event(struct tc_model *tc, unsigned ch);
+void dma_event(struct dma_model *dma, unsigned ch);
+
+/* CRC module: data from the Flash or a DMA channel, and end of that data. */
+int crc_source_is(const struct crc_model *crc, uint8_t source);
+void crc_feed(struct crc_model *crc, const uint8_t *buf, uint32_t len);
+void crc_complete(struct crc_model *crc);
+
+#define CRC_SOURCE_IO    1
+#define CRC_SOURCE_FLASH 2
+#define CRC_SOURCE_DMAC0 4
+
+#endif
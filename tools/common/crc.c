@@ -0,0 +1,108 @@
+/*
+ * crc.c - slice-by-16 CRC-32 (IEEE 802.3) and CRC-16 (CCITT) engines.
+ */
+
+#include "crc.h"
+
+#define CRC32_REFL_POLY 0xEDB88320UL
+#define CRC16_POLY      0x1021U
+
+static uint32_t crc32_table[16][256];
+static uint16_t crc16_table[16][256];
+
+void crc_init(void)
+{
+	unsigned b, k, i;
+
+	for (b = 0; b < 256; b++) {
+		uint32_t c = b;
+		uint16_t d = (uint16_t)(b << 8);
+
+		for (i = 0; i < 8; i++) {
+			c = (c & 1) ? (c >> 1) ^ CRC32_REFL_POLY : c >> 1;
+			d = (d & 0x8000) ? (uint16_t)((d << 1) ^ CRC16_POLY) : (uint16_t)(d << 1);
+		}
+		crc32_table[0][b] = c;
+		crc16_table[0][b] = d;
+	}
+
+	/* Table k gives the contribution of a byte followed by k zero bytes. */
+	for (k = 1; k < 16; k++) {
+		for (b = 0; b < 256; b++) {
+			uint32_t c = crc32_table[k - 1][b];
+			uint16_t d = crc16_table[k - 1][b];
+
+			crc32_table[k][b] = (c >> 8) ^ crc32_table[0][c & 0xFF];
+			crc16_table[k][b] = (uint16_t)((d << 8) ^ crc16_table[0][d >> 8]);
+		}
+	}
+}
+
+uint32_t crc32_ieee(uint32_t crc, const uint8_t *p, size_t len)
+{
+	crc = ~crc;
+
+	while (len >= 16) {
+		uint32_t w = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+
+		crc = crc32_table[15][w & 0xFF] ^ crc32_table[14][(w >> 8) & 0xFF] ^
+			crc32_table[13][(w >> 16) & 0xFF] ^ crc32_table[12][w >> 24] ^
+			crc32_table[11][p[4]] ^ crc32_table[10][p[5]] ^
+			crc32_table[9][p[6]] ^ crc32_table[8][p[7]] ^
+			crc32_table[7][p[8]] ^ crc32_table[6][p[9]] ^
+			crc32_table[5][p[10]] ^ crc32_table[4][p[11]] ^
+			crc32_table[3][p[12]] ^ crc32_table[2][p[13]] ^
+			crc32_table[1][p[14]] ^ crc32_table[0][p[15]];
+		p += 16;
+		len -= 16;
+	}
+	while (len--)
+		crc = (crc >> 8) ^ crc32_table[0][(crc ^ *p++) & 0xFF];
+
+	return ~crc;
+}
+
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *p, size_t len)
+{
+	while (len >= 16) {
+		crc = crc16_table[15][p[0] ^ (crc >> 8)] ^ crc16_table[14][p[1] ^ (crc & 0xFF)] ^
+			crc16_table[13][p[2]] ^ crc16_table[12][p[3]] ^
+			crc16_table[11][p[4]] ^ crc16_table[10][p[5]] ^
+			crc16_table[9][p[6]] ^ crc16_table[8][p[7]] ^
+			crc16_table[7][p[8]] ^ crc16_table[6][p[9]] ^
+			crc16_table[5][p[10]] ^ crc16_table[4][p[11]] ^
+			crc16_table[3][p[12]] ^ crc16_table[2][p[13]] ^
+			crc16_table[1][p[14]] ^ crc16_table[0][p[15]];
+		p += 16;
+		len -= 16;
+	}
+	while (len--)
+		crc = (uint16_t)((crc << 8) ^ crc16_table[0][(crc >> 8) ^ *p++]);
+
+	return crc;
+}
+
+uint32_t crc32_ieee_bitwise(uint32_t crc, const uint8_t *p, size_t len)
+{
+	unsigned i;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 1) ? (crc >> 1) ^ CRC32_REFL_POLY : crc >> 1;
+	}
+	return ~crc;
+}
+
+uint16_t crc16_ccitt_bitwise(uint16_t crc, const uint8_t *p, size_t len)
+{
+	unsigned i;
+
+	while (len--) {
+		crc ^= (uint16_t)(*p++ << 8);
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ CRC16_POLY) : (uint16_t)(crc << 1);
+	}
+	return crc;
+}
@@ -0,0 +1,32 @@
+/*
+ * crc.h - table-driven CRC engines matching the AVR1610 Class B library.
+ *
+ * CRC-32 is IEEE 802.3 (reflected, initial value and final XOR 0xFFFFFFFF),
+ * as computed by the XMEGA CRC module in 32-bit mode and by
+ * CLASSB_CRC32_*_SW. CRC-16 is CCITT 0x1021, MSB first, initial value 0 and
+ * no final XOR, as computed by the CRC module in 16-bit mode and by
+ * CLASSB_CRC16_*_SW.
+ *
+ * Both engines process 16 bytes per step with slice-by-16 tables.
+ */
+
+#ifndef TOOLS_CRC_H
+#define TOOLS_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Build the tables. Must be called once before any other function. */
+void crc_init(void);
+
+/* Continue a CRC-32: pass 0 to start, the previous result to append. */
+uint32_t crc32_ieee(uint32_t crc, const uint8_t *buf, size_t len);
+
+/* Continue a CRC-16: pass 0 to start, the previous result to append. */
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *buf, size_t len);
+
+/* Bitwise reference implementations, used to check the tables. */
+uint32_t crc32_ieee_bitwise(uint32_t crc, const uint8_t *buf, size_t len);
+uint16_t crc16_ccitt_bitwise(uint16_t crc, const uint8_t *buf, size_t len);
+
+#endif
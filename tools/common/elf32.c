@@ -0,0 +1,236 @@
+/*
+ * elf32.c - minimal reader for AVR ELF32 files produced by avr-gcc.
+ */
+
+#include "elf32.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EM_AVR 83
+#define PT_LOAD 1
+
+static uint16_t rd16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int fail(const struct elf_file *ef, const char *msg)
+{
+	fprintf(stderr, "%s: %s\n", ef->path, msg);
+	return -1;
+}
+
+static const char *strtab_get(const struct elf_file *ef, uint32_t strtab_off, uint32_t strtab_size, uint32_t idx)
+{
+	if (idx >= strtab_size || (size_t)strtab_off + strtab_size > ef->size)
+		return "";
+	/* The string table is NUL terminated, which the header checks below rely on. */
+	return (const char *)ef->data + strtab_off + idx;
+}
+
+int elf_load(const char *path, struct elf_file *ef)
+{
+	FILE *f;
+	long len;
+	uint32_t shoff, shnum, shentsize, shstrndx;
+	unsigned i;
+
+	memset(ef, 0, sizeof(*ef));
+	ef->path = path;
+
+	f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	if (fseek(f, 0, SEEK_END) != 0 || (len = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0) {
+		fclose(f);
+		return fail(ef, "cannot determine file size");
+	}
+	ef->size = (size_t)len;
+	ef->data = malloc(ef->size ? ef->size : 1);
+	if (!ef->data || fread(ef->data, 1, ef->size, f) != ef->size) {
+		fclose(f);
+		elf_free(ef);
+		return fail(ef, "read error");
+	}
+	fclose(f);
+
+	if (ef->size < 52 || memcmp(ef->data, "\177ELF", 4) != 0)
+		return elf_free(ef), fail(ef, "not an ELF file");
+	if (ef->data[4] != 1 || ef->data[5] != 1)
+		return elf_free(ef), fail(ef, "not a 32-bit little-endian ELF file");
+	if (rd16(ef->data + 18) != EM_AVR)
+		return elf_free(ef), fail(ef, "not an AVR ELF file");
+
+	ef->entry = rd32(ef->data + 24);
+	shoff = rd32(ef->data + 32);
+	shentsize = rd16(ef->data + 46);
+	shnum = rd16(ef->data + 48);
+	shstrndx = rd16(ef->data + 50);
+
+	if (shnum == 0 || shentsize < 40 || (uint64_t)shoff + (uint64_t)shnum * shentsize > ef->size
+			|| shstrndx >= shnum)
+		return elf_free(ef), fail(ef, "bad section header table");
+
+	ef->sections = calloc(shnum, sizeof(*ef->sections));
+	if (!ef->sections)
+		return elf_free(ef), fail(ef, "out of memory");
+	ef->nsections = shnum;
+
+	{
+		const uint8_t *sh = ef->data + shoff + shstrndx * shentsize;
+		uint32_t str_off = rd32(sh + 16), str_size = rd32(sh + 20);
+
+		for (i = 0; i < shnum; i++) {
+			const uint8_t *p = ef->data + shoff + i * shentsize;
+			struct elf_section *s = &ef->sections[i];
+
+			s->name = strtab_get(ef, str_off, str_size, rd32(p));
+			s->type = rd32(p + 4);
+			s->flags = rd32(p + 8);
+			s->addr = rd32(p + 12);
+			s->offset = rd32(p + 16);
+			s->size = rd32(p + 20);
+			if (s->type != ELF_SHT_NOBITS && (uint64_t)s->offset + s->size > ef->size)
+				return elf_free(ef), fail(ef, "section outside of file");
+		}
+	}
+
+	/* Symbols from .symtab, with names from its linked string table. */
+	for (i = 0; i < shnum; i++) {
+		const uint8_t *p = ef->data + shoff + i * shentsize;
+		uint32_t link, entsize, n, j;
+		const struct elf_section *strs;
+
+		if (ef->sections[i].type != ELF_SHT_SYMTAB)
+			continue;
+		link = rd32(p + 24);
+		entsize = rd32(p + 36);
+		if (link >= shnum || entsize < 16)
+			return elf_free(ef), fail(ef, "bad symbol table");
+		strs = &ef->sections[link];
+		n = ef->sections[i].size / entsize;
+		ef->symbols = calloc(n ? n : 1, sizeof(*ef->symbols));
+		if (!ef->symbols)
+			return elf_free(ef), fail(ef, "out of memory");
+		for (j = 0; j < n; j++) {
+			const uint8_t *sp = ef->data + ef->sections[i].offset + j * entsize;
+			struct elf_symbol *sym = &ef->symbols[ef->nsymbols];
+
+			sym->name = strtab_get(ef, strs->offset, strs->size, rd32(sp));
+			sym->value = rd32(sp + 4);
+			sym->size = rd32(sp + 8);
+			sym->type = sp[12] & 0x0F;
+			sym->bind = sp[12] >> 4;
+			sym->shndx = rd16(sp + 14);
+			if (sym->name[0])
+				ef->nsymbols++;
+		}
+		break;
+	}
+
+	return 0;
+}
+
+void elf_free(struct elf_file *ef)
+{
+	free(ef->data);
+	free(ef->sections);
+	free(ef->symbols);
+	ef->data = NULL;
+	ef->sections = NULL;
+	ef->symbols = NULL;
+	ef->nsections = ef->nsymbols = 0;
+}
+
+const struct elf_symbol *elf_find_symbol(const struct elf_file *ef, const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < ef->nsymbols; i++)
+		if (strcmp(ef->symbols[i].name, name) == 0)
+			return &ef->symbols[i];
+	return NULL;
+}
+
+const struct elf_section *elf_find_section(const struct elf_file *ef, const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < ef->nsections; i++)
+		if (strcmp(ef->sections[i].name, name) == 0)
+			return &ef->sections[i];
+	return NULL;
+}
+
+uint8_t *elf_vaddr_ptr(const struct elf_file *ef, uint32_t addr, uint32_t len)
+{
+	unsigned i;
+
+	for (i = 0; i < ef->nsections; i++) {
+		const struct elf_section *s = &ef->sections[i];
+
+		if (!(s->flags & ELF_SHF_ALLOC) || s->type == ELF_SHT_NOBITS)
+			continue;
+		if (addr >= s->addr && (uint64_t)addr + len <= (uint64_t)s->addr + s->size)
+			return ef->data + s->offset + (addr - s->addr);
+	}
+	return NULL;
+}
+
+uint32_t elf_load_image(const struct elf_file *ef, uint32_t base, uint8_t *buf, uint32_t bufsize)
+{
+	uint32_t phoff = rd32(ef->data + 28);
+	uint32_t phentsize = rd16(ef->data + 42);
+	uint32_t phnum = rd16(ef->data + 44);
+	uint32_t top = 0;
+	unsigned i;
+
+	if (phentsize < 32 || (uint64_t)phoff + (uint64_t)phnum * phentsize > ef->size)
+		return 0;
+
+	for (i = 0; i < phnum; i++) {
+		const uint8_t *p = ef->data + phoff + i * phentsize;
+		uint32_t offset = rd32(p + 4);
+		uint32_t paddr = rd32(p + 12);
+		uint32_t filesz = rd32(p + 16);
+		uint32_t j;
+
+		if (rd32(p) != PT_LOAD || filesz == 0 || (uint64_t)offset + filesz > ef->size)
+			continue;
+		for (j = 0; j < filesz; j++) {
+			uint32_t a = paddr + j;
+
+			if (a < base || a - base >= bufsize)
+				continue;
+			buf[a - base] = ef->data[offset + j];
+			if (a - base + 1 > top)
+				top = a - base + 1;
+		}
+	}
+	return top;
+}
+
+int elf_save(const struct elf_file *ef, const char *path)
+{
+	FILE *f = fopen(path, "wb");
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	if (fwrite(ef->data, 1, ef->size, f) != ef->size) {
+		fclose(f);
+		fprintf(stderr, "%s: write error\n", path);
+		return -1;
+	}
+	return fclose(f) == 0 ? 0 : -1;
+}
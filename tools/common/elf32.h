@@ -0,0 +1,96 @@
+/*
+ * elf32.h - minimal reader for AVR ELF32 files produced by avr-gcc.
+ *
+ * avr-gcc links every memory into one address space:
+ *   0x000000 - 0x7FFFFF  Flash
+ *   0x800000 - 0x80FFFF  SRAM (data space)
+ *   0x810000 - 0x81FFFF  EEPROM
+ * The helpers below load the whole file into memory, look up symbols and
+ * extract the Flash and EEPROM images from the program headers.
+ */
+
+#ifndef TOOLS_ELF32_H
+#define TOOLS_ELF32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AVR_FLASH_BASE   0x000000UL
+#define AVR_SRAM_BASE    0x800000UL
+#define AVR_EEPROM_BASE  0x810000UL
+#define AVR_EEPROM_END   0x820000UL
+
+/* Section header types and flags used by the tools. */
+#define ELF_SHT_PROGBITS 1
+#define ELF_SHT_SYMTAB   2
+#define ELF_SHT_NOBITS   8
+#define ELF_SHF_ALLOC    0x2
+#define ELF_SHF_EXEC     0x4
+
+/* Symbol types and bindings. */
+#define ELF_STT_NOTYPE   0
+#define ELF_STT_OBJECT   1
+#define ELF_STT_FUNC     2
+#define ELF_STT_SECTION  3
+#define ELF_STT_FILE     4
+#define ELF_STB_LOCAL    0
+#define ELF_STB_GLOBAL   1
+#define ELF_STB_WEAK     2
+
+struct elf_section {
+	const char *name;
+	uint32_t type;
+	uint32_t flags;
+	uint32_t addr;
+	uint32_t offset;
+	uint32_t size;
+};
+
+struct elf_symbol {
+	const char *name;
+	uint32_t value;
+	uint32_t size;
+	uint8_t type;
+	uint8_t bind;
+	uint16_t shndx;
+};
+
+struct elf_file {
+	const char *path;
+	uint8_t *data;
+	size_t size;
+	struct elf_section *sections;
+	unsigned nsections;
+	struct elf_symbol *symbols;
+	unsigned nsymbols;
+	uint32_t entry;
+};
+
+/* Load and index an ELF file. Returns 0 on success, -1 with a message on stderr. */
+int elf_load(const char *path, struct elf_file *ef);
+void elf_free(struct elf_file *ef);
+
+/* Symbol by name, or NULL. */
+const struct elf_symbol *elf_find_symbol(const struct elf_file *ef, const char *name);
+
+/* Section by name, or NULL. */
+const struct elf_section *elf_find_section(const struct elf_file *ef, const char *name);
+
+/*
+ * Pointer into the file contents for a linked (virtual) address range, or
+ * NULL if the range is not entirely inside a section with file contents.
+ */
+uint8_t *elf_vaddr_ptr(const struct elf_file *ef, uint32_t addr, uint32_t len);
+
+/*
+ * Copy the loadable contents of [base, base + bufsize) into buf, which the
+ * caller pre-fills (0xFF for erased Flash/EEPROM). Program headers are used,
+ * so initialised .data is placed at its load address in Flash.
+ * Returns the highest address written + 1 relative to base (0 if none).
+ */
+uint32_t elf_load_image(const struct elf_file *ef, uint32_t base, uint8_t *buf, uint32_t bufsize);
+
+/* Write the modified file contents back to path. */
+int elf_save(const struct elf_file *ef, const char *path);
+
+#endif
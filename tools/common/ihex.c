@@ -0,0 +1,153 @@
+/*
+ * ihex.c - Intel HEX reader and writer.
+ */
+
+#include "ihex.h"
+
+#include <ctype.h>
+#include <string.h>
+
+static int hexval(int c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	c = toupper(c);
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static int hexbyte(const char *s)
+{
+	int h = hexval(s[0]), l = hexval(s[1]);
+
+	return (h < 0 || l < 0) ? -1 : (h << 4) | l;
+}
+
+int ihex_load(const char *path, uint8_t *buf, uint32_t bufsize, uint32_t *top)
+{
+	char line[600];
+	uint32_t upper = 0;
+	unsigned lineno = 0;
+	FILE *f = fopen(path, "r");
+
+	*top = 0;
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		uint8_t rec[256 + 5];
+		size_t len = strcspn(line, "\r\n");
+		unsigned n, i, sum = 0;
+
+		lineno++;
+		if (len == 0)
+			continue;
+		if (line[0] != ':' || len < 11 || (len - 1) % 2 != 0)
+			goto bad;
+		n = (unsigned)(len - 1) / 2;
+		for (i = 0; i < n; i++) {
+			int b = hexbyte(line + 1 + 2 * i);
+
+			if (b < 0)
+				goto bad;
+			rec[i] = (uint8_t)b;
+			sum += (unsigned)b;
+		}
+		if ((sum & 0xFF) != 0 || n != rec[0] + 5u)
+			goto bad;
+
+		switch (rec[3]) {
+		case 0x00: {
+			uint32_t addr = upper + ((uint32_t)rec[1] << 8 | rec[2]);
+
+			for (i = 0; i < rec[0]; i++) {
+				if (addr + i >= bufsize) {
+					fprintf(stderr, "%s:%u: address 0x%06lX outside of memory\n",
+							path, lineno, (unsigned long)(addr + i));
+					fclose(f);
+					return -1;
+				}
+				buf[addr + i] = rec[4 + i];
+			}
+			if (addr + rec[0] > *top)
+				*top = addr + rec[0];
+			break;
+		}
+		case 0x01:
+			fclose(f);
+			return 0;
+		case 0x02:
+			if (rec[0] != 2)
+				goto bad;
+			upper = ((uint32_t)rec[4] << 8 | rec[5]) << 4;
+			break;
+		case 0x04:
+			if (rec[0] != 2)
+				goto bad;
+			upper = ((uint32_t)rec[4] << 8 | rec[5]) << 16;
+			break;
+		case 0x03:
+		case 0x05:
+			/* Start address records carry no data. */
+			break;
+		default:
+			goto bad;
+		}
+	}
+	fclose(f);
+	return 0;
+
+bad:
+	fprintf(stderr, "%s:%u: malformed Intel HEX record\n", path, lineno);
+	fclose(f);
+	return -1;
+}
+
+static int write_record(FILE *f, uint8_t type, uint16_t addr, const uint8_t *data, unsigned len)
+{
+	unsigned sum = len + (addr >> 8) + (addr & 0xFF) + type;
+	unsigned i;
+
+	fprintf(f, ":%02X%04X%02X", len, addr, type);
+	for (i = 0; i < len; i++) {
+		fprintf(f, "%02X", data[i]);
+		sum += data[i];
+	}
+	return fprintf(f, "%02X\n", (unsigned)(-sum) & 0xFF) < 0 ? -1 : 0;
+}
+
+int ihex_write(FILE *f, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+	uint32_t upper = 0xFFFFFFFFUL;
+
+	while (len) {
+		unsigned n = len > 16 ? 16 : (unsigned)len;
+
+		/* Do not let a record cross a 64 KB boundary. */
+		if ((addr & 0xFFFF) + n > 0x10000)
+			n = 0x10000 - (addr & 0xFFFF);
+		if ((addr >> 16) != upper) {
+			uint8_t ext[2];
+
+			upper = addr >> 16;
+			ext[0] = (uint8_t)(upper >> 8);
+			ext[1] = (uint8_t)upper;
+			if (write_record(f, 0x04, 0, ext, 2))
+				return -1;
+		}
+		if (write_record(f, 0x00, (uint16_t)addr, buf, n))
+			return -1;
+		addr += n;
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+int ihex_write_end(FILE *f)
+{
+	return write_record(f, 0x01, 0, NULL, 0);
+}
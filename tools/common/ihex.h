@@ -0,0 +1,24 @@
+/*
+ * ihex.h - Intel HEX reader and writer.
+ */
+
+#ifndef TOOLS_IHEX_H
+#define TOOLS_IHEX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Read an Intel HEX file into buf, which the caller pre-fills (0xFF for
+ * erased memory). Data outside [0, bufsize) is an error.
+ * On success returns 0 and sets *top to the highest address written + 1.
+ */
+int ihex_load(const char *path, uint8_t *buf, uint32_t bufsize, uint32_t *top);
+
+/* Write len bytes from buf as Intel HEX records starting at addr. */
+int ihex_write(FILE *f, uint32_t addr, const uint8_t *buf, uint32_t len);
+
+/* Write the end-of-file record. */
+int ihex_write_end(FILE *f);
+
+#endif
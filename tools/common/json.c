@@ -0,0 +1,308 @@
+/*
+ * json.c - JSON reader for the result files of the tools.
+ */
+
+#include "json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_MAX_DEPTH 64
+
+struct parser {
+	const char *s;
+	const char *start;
+	const char *name;
+	int failed;
+};
+
+static void error(struct parser *p, const char *msg)
+{
+	const char *c;
+	unsigned line = 1;
+
+	if (p->failed)
+		return;
+	for (c = p->start; c < p->s; c++)
+		if (*c == '\n')
+			line++;
+	fprintf(stderr, "%s:%u: %s\n", p->name, line, msg);
+	p->failed = 1;
+}
+
+static void skip_space(struct parser *p)
+{
+	while (*p->s == ' ' || *p->s == '\t' || *p->s == '\n' || *p->s == '\r')
+		p->s++;
+}
+
+static int hexval(int c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* A string at p->s, which is the opening quote; \u escapes become UTF-8. */
+static char *parse_string(struct parser *p)
+{
+	const char *s = ++p->s;
+	char *out, *o;
+
+	/* The result is never longer than the source. */
+	while (*s && *s != '"') {
+		if (*s == '\\' && s[1])
+			s++;
+		s++;
+	}
+	if (!*s) {
+		error(p, "unterminated string");
+		return NULL;
+	}
+	out = o = malloc((size_t)(s - p->s) + 1);
+	if (!out) {
+		error(p, "out of memory");
+		return NULL;
+	}
+	while (*p->s != '"') {
+		char c = *p->s++;
+		unsigned u = 0;
+		int i, h;
+
+		if ((unsigned char)c < 0x20) {
+			error(p, "control character in string");
+			return free(out), NULL;
+		}
+		if (c != '\\') {
+			*o++ = c;
+			continue;
+		}
+		switch (c = *p->s++) {
+		case '"': case '\\': case '/':
+			*o++ = c;
+			break;
+		case 'b': *o++ = '\b'; break;
+		case 'f': *o++ = '\f'; break;
+		case 'n': *o++ = '\n'; break;
+		case 'r': *o++ = '\r'; break;
+		case 't': *o++ = '\t'; break;
+		case 'u':
+			for (i = 0; i < 4; i++) {
+				if ((h = hexval(p->s[i])) < 0) {
+					error(p, "bad \\u escape");
+					return free(out), NULL;
+				}
+				u = u << 4 | (unsigned)h;
+			}
+			p->s += 4;
+			if (u < 0x80) {
+				*o++ = (char)u;
+			} else if (u < 0x800) {
+				*o++ = (char)(0xC0 | u >> 6);
+				*o++ = (char)(0x80 | (u & 0x3F));
+			} else {
+				*o++ = (char)(0xE0 | u >> 12);
+				*o++ = (char)(0x80 | (u >> 6 & 0x3F));
+				*o++ = (char)(0x80 | (u & 0x3F));
+			}
+			break;
+		default:
+			error(p, "bad escape in string");
+			return free(out), NULL;
+		}
+	}
+	p->s++;
+	*o = '\0';
+	return out;
+}
+
+static struct json *parse_value(struct parser *p, unsigned depth);
+
+/* The elements of an array or the members of an object, up to close. */
+static int parse_children(struct parser *p, struct json *j, char close, unsigned depth)
+{
+	struct json **tail = &j->child;
+
+	p->s++;
+	skip_space(p);
+	if (*p->s == close) {
+		p->s++;
+		return 0;
+	}
+	for (;;) {
+		char *key = NULL;
+		struct json *c;
+
+		if (j->type == JSON_OBJECT) {
+			if (*p->s != '"') {
+				error(p, "expected a member name");
+				return -1;
+			}
+			if (!(key = parse_string(p)))
+				return -1;
+			skip_space(p);
+			if (*p->s != ':') {
+				error(p, "expected ':'");
+				return free(key), -1;
+			}
+			p->s++;
+		}
+		if (!(c = parse_value(p, depth + 1)))
+			return free(key), -1;
+		c->key = key;
+		*tail = c;
+		tail = &c->next;
+		skip_space(p);
+		if (*p->s == close) {
+			p->s++;
+			return 0;
+		}
+		if (*p->s != ',') {
+			error(p, close == ']' ? "expected ',' or ']'" : "expected ',' or '}'");
+			return -1;
+		}
+		p->s++;
+		skip_space(p);
+	}
+}
+
+static struct json *parse_value(struct parser *p, unsigned depth)
+{
+	static const struct {
+		const char *word;
+		enum json_type type;
+	} words[] = {
+		{ "null", JSON_NULL }, { "false", JSON_FALSE }, { "true", JSON_TRUE },
+	};
+	struct json *j;
+	unsigned i;
+
+	if (depth > JSON_MAX_DEPTH) {
+		error(p, "nested too deeply");
+		return NULL;
+	}
+	skip_space(p);
+	j = calloc(1, sizeof(*j));
+	if (!j) {
+		error(p, "out of memory");
+		return NULL;
+	}
+	switch (*p->s) {
+	case '{':
+	case '[':
+		j->type = *p->s == '{' ? JSON_OBJECT : JSON_ARRAY;
+		if (parse_children(p, j, *p->s == '{' ? '}' : ']', depth))
+			return json_free(j), NULL;
+		return j;
+	case '"':
+		j->type = JSON_STRING;
+		if (!(j->string = parse_string(p)))
+			return json_free(j), NULL;
+		return j;
+	}
+	for (i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+		size_t n = strlen(words[i].word);
+
+		if (!strncmp(p->s, words[i].word, n)) {
+			j->type = words[i].type;
+			p->s += n;
+			return j;
+		}
+	}
+	if (*p->s == '-' || (*p->s >= '0' && *p->s <= '9')) {
+		char *end;
+
+		j->type = JSON_NUMBER;
+		j->number = strtod(p->s, &end);
+		p->s = end;
+		return j;
+	}
+	error(p, *p->s ? "unexpected character" : "unexpected end of input");
+	free(j);
+	return NULL;
+}
+
+struct json *json_parse(const char *text, const char *name)
+{
+	struct parser p = { text, text, name, 0 };
+	struct json *j = parse_value(&p, 0);
+
+	if (!j)
+		return NULL;
+	skip_space(&p);
+	if (*p.s) {
+		error(&p, "trailing characters");
+		json_free(j);
+		return NULL;
+	}
+	return j;
+}
+
+struct json *json_load(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	struct json *j = NULL;
+	char *text = NULL;
+	size_t len = 0, cap = 0, n;
+
+	if (!f) {
+		perror(path);
+		return NULL;
+	}
+	do {
+		if (len + 4096 + 1 > cap) {
+			char *t = realloc(text, cap = 2 * cap + 4096 + 1);
+
+			if (!t) {
+				fprintf(stderr, "%s: out of memory\n", path);
+				goto out;
+			}
+			text = t;
+		}
+		n = fread(text + len, 1, cap - len - 1, f);
+		len += n;
+	} while (n);
+	if (ferror(f)) {
+		perror(path);
+		goto out;
+	}
+	text[len] = '\0';
+	if (strlen(text) != len)
+		fprintf(stderr, "%s: NUL character in the file\n", path);
+	else
+		j = json_parse(text, path);
+out:
+	free(text);
+	fclose(f);
+	return j;
+}
+
+void json_free(struct json *j)
+{
+	while (j) {
+		struct json *next = j->next;
+
+		json_free(j->child);
+		free(j->string);
+		free(j->key);
+		free(j);
+		j = next;
+	}
+}
+
+const struct json *json_get(const struct json *j, const char *key)
+{
+	const struct json *c;
+
+	if (!j || j->type != JSON_OBJECT)
+		return NULL;
+	for (c = j->child; c; c = c->next)
+		if (!strcmp(c->key, key))
+			return c;
+	return NULL;
+}
@@ -0,0 +1,41 @@
+/*
+ * json.h - JSON reader for the result files of the tools.
+ */
+
+#ifndef TOOLS_JSON_H
+#define TOOLS_JSON_H
+
+enum json_type {
+	JSON_NULL,
+	JSON_FALSE,
+	JSON_TRUE,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT,
+};
+
+/* A value. The elements of an array and the members of an object are a
+ * list of children; a member has its name in key. */
+struct json {
+	enum json_type type;
+	double number;
+	char *string;
+	char *key;
+	struct json *child;
+	struct json *next;
+};
+
+/* Parse a whole file. Errors are reported on stderr with the line number;
+ * returns NULL on errors. */
+struct json *json_load(const char *path);
+
+/* Parse text; name is used in error messages. */
+struct json *json_parse(const char *text, const char *name);
+
+void json_free(struct json *j);
+
+/* Member of an object, or NULL if j is not an object or has no such member. */
+const struct json *json_get(const struct json *j, const char *key);
+
+#endif
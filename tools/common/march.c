@@ -0,0 +1,231 @@
+/*
+ * march.c - March test notation.
+ */
+
+#include "march.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const struct march_builtin march_builtins[] = {
+	{ "mats+", "{any(w0); up(r0,w1); down(r1,w0)}", "5n" },
+	{ "march-x", "{any(w0); up(r0,w1); down(r1,w0); any(r0)}",
+		"classb_marchX()" },
+	{ "march-x-iw", "{any(w0); up(r0,w1); down(r1,w0); any(r0); "
+		"up(w0x55,r0x55,w0xAA,r0xAA,w0x33,r0x33,w0xCC,r0xCC,w0xF0,r0xF0,w0x0F,r0x0F)}",
+		"classb_marchX() with CLASSB_SRAM_INTRAWORD_TEST" },
+	{ "march-c-", "{any(w0); up(r0,w1); up(r1,w0); down(r0,w1); down(r1,w0); any(r0)}",
+		"ramtest.S, with the backgrounds 'bits'" },
+	{ "march-b", "{any(w0); up(r0,w1,r1,w0,r0,w1); up(r1,w0,w1); down(r1,w0,w1,w0); down(r0,w1,w0)}",
+		"ramtest_march_b" },
+	{ "march-lr", "{any(w0); down(r0,w1); up(r1,w0,r0,w1); up(r1,w0); up(r0,w1,r1,w0); up(r0)}", "14n" },
+	{ "march-sr", "{down(w0); up(r0,w1,r1,w0); up(r0,r0); up(w1); down(r1,w0,r0,w1); down(r1,r1)}", "14n" },
+	{ "march-ss", "{any(w0); up(r0,r0,w0,r0,w1); up(r1,r1,w1,r1,w0); down(r0,r0,w0,r0,w1); "
+		"down(r1,r1,w1,r1,w0); any(r0)}", "22n" },
+};
+
+const unsigned march_nbuiltins = sizeof(march_builtins) / sizeof(march_builtins[0]);
+
+static const struct {
+	const char *text;
+	enum march_order order;
+} order_names[] = {
+	{ "\xE2\x87\x91", MARCH_UP },       /* U+21D1 */
+	{ "\xE2\x87\x93", MARCH_DOWN },     /* U+21D3 */
+	{ "\xE2\x87\x95", MARCH_ANY },      /* U+21D5 */
+	{ "\xE2\x86\x91", MARCH_UP },       /* U+2191 */
+	{ "\xE2\x86\x93", MARCH_DOWN },     /* U+2193 */
+	{ "\xE2\x86\x95", MARCH_ANY },      /* U+2195 */
+	{ "up", MARCH_UP },
+	{ "down", MARCH_DOWN },
+	{ "any", MARCH_ANY },
+};
+
+static const char *skip_space(const char *s)
+{
+	while (isspace((unsigned char)*s))
+		s++;
+	return s;
+}
+
+static int parse_op(const char **ps, struct march_op *op)
+{
+	const char *s = *ps;
+	char *end;
+	unsigned long v;
+
+	memset(op, 0, sizeof(*op));
+	if (!strncmp(s, "del", 3)) {
+		op->kind = MARCH_DELAY;
+		*ps = s + 3;
+		return 0;
+	}
+	if (*s != 'r' && *s != 'w')
+		return -1;
+	op->kind = *s == 'r' ? MARCH_READ : MARCH_WRITE;
+	s++;
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+		v = strtoul(s, &end, 16);
+		if (end == s + 2 || v > 0xFF)
+			return -1;
+		op->literal = 1;
+		op->data = (uint8_t)v;
+		*ps = end;
+		return 0;
+	}
+	if (*s != '0' && *s != '1')
+		return -1;
+	op->data = (uint8_t)(*s - '0');
+	*ps = s + 1;
+	return 0;
+}
+
+int march_parse(const char *text, struct march_test *t)
+{
+	const char *s;
+	unsigned i;
+
+	for (i = 0; i < march_nbuiltins; i++)
+		if (!strcmp(text, march_builtins[i].name))
+			return march_parse(march_builtins[i].notation, t);
+
+	memset(t, 0, sizeof(*t));
+	s = skip_space(text);
+	if (*s == '{')
+		s = skip_space(s + 1);
+	while (*s && *s != '}') {
+		struct march_element *e;
+
+		if (t->nelements == MARCH_MAX_ELEMENTS)
+			goto bad;
+		e = &t->el[t->nelements++];
+		if (!strncmp(s, "del", 3)) {
+			/* A pause between elements. */
+			e->nops = 1;
+			e->ops[0].kind = MARCH_DELAY;
+			s = skip_space(s + 3);
+			if (*s == ';')
+				s = skip_space(s + 1);
+			continue;
+		}
+		for (i = 0; i < sizeof(order_names) / sizeof(order_names[0]); i++)
+			if (!strncmp(s, order_names[i].text, strlen(order_names[i].text)))
+				break;
+		if (i == sizeof(order_names) / sizeof(order_names[0]))
+			goto bad;
+		e->order = (uint8_t)order_names[i].order;
+		s = skip_space(s + strlen(order_names[i].text));
+		if (*s++ != '(')
+			goto bad;
+		for (;;) {
+			s = skip_space(s);
+			if (e->nops == MARCH_MAX_OPS || parse_op(&s, &e->ops[e->nops++]))
+				goto bad;
+			s = skip_space(s);
+			if (*s == ')')
+				break;
+			if (*s++ != ',')
+				goto bad;
+		}
+		s = skip_space(s + 1);
+		if (*s == ';')
+			s = skip_space(s + 1);
+	}
+	if (*s == '}')
+		s = skip_space(s + 1);
+	if (*s || !t->nelements)
+		goto bad;
+	return 0;
+bad:
+	fprintf(stderr, "bad March test '%s'\n", text);
+	return -1;
+}
+
+void march_format(const struct march_test *t, int ascii, char *buf, size_t size)
+{
+	static const char *const utf8[] = { "\xE2\x87\x95", "\xE2\x87\x91", "\xE2\x87\x93" };
+	static const char *const text[] = { "any", "up", "down" };
+	size_t n = 0;
+	unsigned i, j;
+
+#define PUT(...) do { \
+		if (n < size) \
+			n += (size_t)snprintf(buf + n, size - n, __VA_ARGS__); \
+	} while (0)
+
+	if (size)
+		buf[0] = '\0';
+	PUT("{");
+	for (i = 0; i < t->nelements; i++) {
+		const struct march_element *e = &t->el[i];
+
+		if (march_is_pause(e)) {
+			PUT("%sdel", i ? "; " : "");
+			continue;
+		}
+		PUT("%s%s(", i ? "; " : "", ascii ? text[e->order] : utf8[e->order]);
+		for (j = 0; j < e->nops; j++) {
+			const struct march_op *op = &e->ops[j];
+
+			if (op->kind == MARCH_DELAY)
+				PUT("%sdel", j ? "," : "");
+			else if (op->literal)
+				PUT("%s%c0x%02X", j ? "," : "", op->kind == MARCH_READ ? 'r' : 'w', op->data);
+			else
+				PUT("%s%c%u", j ? "," : "", op->kind == MARCH_READ ? 'r' : 'w', op->data);
+		}
+		PUT(")");
+	}
+	PUT("}");
+#undef PUT
+}
+
+int march_backgrounds(const char *text, struct march_background *bg, unsigned max)
+{
+	const char *s = text;
+	unsigned n = 0, b;
+
+	while (*s) {
+		char *end;
+		unsigned long v;
+
+		if (!strncmp(s, "bits", 4) && (s[4] == ',' || !s[4])) {
+			for (b = 0; b < 8; b++) {
+				if (n == max)
+					goto bad;
+				bg[n].zero = 0;
+				bg[n++].one = (uint8_t)(1u << b);
+			}
+			end = (char *)s + 4;
+		} else {
+			v = strtoul(s, &end, 0);
+			if (end == s || v > 0xFF || n == max)
+				goto bad;
+			bg[n].zero = (uint8_t)v;
+			bg[n++].one = (uint8_t)~v;
+		}
+		if (*end == ',')
+			end++;
+		else if (*end)
+			goto bad;
+		s = end;
+	}
+	if (n)
+		return (int)n;
+bad:
+	fprintf(stderr, "bad background list '%s'\n", text);
+	return -1;
+}
+
+unsigned march_ops_per_cell(const struct march_test *t)
+{
+	unsigned i, j, n = 0;
+
+	for (i = 0; i < t->nelements; i++)
+		for (j = 0; j < t->el[i].nops; j++)
+			if (t->el[i].ops[j].kind != MARCH_DELAY)
+				n++;
+	return n;
+}
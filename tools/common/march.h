@@ -0,0 +1,91 @@
+/*
+ * march.h - March test notation.
+ *
+ * A March test is a sequence of elements, each an address order and the
+ * operations applied to every cell in that order:
+ *
+ *   {⇕(w0); ⇑(r0,w1); ⇑(r1,w0); ⇓(r0,w1); ⇓(r1,w0); ⇕(r0)}
+ *
+ * The orders are ⇑ (up), ⇓ (down) and ⇕ (either), also written ↑ ↓ ↕ or
+ * up, down and any. The operations are r0, r1, w0 and w1 for the data
+ * background D and its complement, rBYTE and wBYTE for a literal byte
+ * (r0x55, w0xAA), and del for a delay. An element of its own, del is one
+ * pause between two elements rather than one per cell. The braces and the
+ * spaces are optional. The tests are byte oriented: "0" is the byte D and "1" the
+ * byte given as the complement of D, so testing bit by bit, as ramtest.S
+ * does, is a list of backgrounds (see march_backgrounds()).
+ */
+
+#ifndef TOOLS_MARCH_H
+#define TOOLS_MARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MARCH_MAX_ELEMENTS    32
+#define MARCH_MAX_OPS         24
+#define MARCH_MAX_BACKGROUNDS 16
+
+enum march_order { MARCH_ANY, MARCH_UP, MARCH_DOWN };
+
+enum march_kind { MARCH_READ, MARCH_WRITE, MARCH_DELAY };
+
+struct march_op {
+	uint8_t kind;               /* enum march_kind */
+	uint8_t literal;            /* data is a byte, not a background index */
+	uint8_t data;               /* 0 for D, 1 for its complement, or the byte */
+};
+
+struct march_element {
+	uint8_t order;              /* enum march_order */
+	unsigned nops;
+	struct march_op ops[MARCH_MAX_OPS];
+};
+
+/* A data background: the bytes that stand for 0 and 1. */
+struct march_background {
+	uint8_t zero, one;
+};
+
+struct march_test {
+	unsigned nelements;
+	struct march_element el[MARCH_MAX_ELEMENTS];
+};
+
+struct march_builtin {
+	const char *name;
+	const char *notation;
+	const char *note;
+};
+
+extern const struct march_builtin march_builtins[];
+extern const unsigned march_nbuiltins;
+
+/* Parse a notation, or the name of a built-in test. Returns 0, or -1 with a
+ * message on stderr. */
+int march_parse(const char *text, struct march_test *t);
+
+/* The notation of a test, with ASCII orders if ascii is set. */
+void march_format(const struct march_test *t, int ascii, char *buf, size_t size);
+
+/* Parse a background list: "D" for the pair (D, ~D), "bits" for the
+ * pairs (0, 1 << b) of ramtest.S, separated by commas. Returns the number
+ * of backgrounds or -1. */
+int march_backgrounds(const char *text, struct march_background *bg, unsigned max);
+
+/* Operations per cell (the n in 10n), delays not counted. */
+unsigned march_ops_per_cell(const struct march_test *t);
+
+/* The element is a single pause, not a pass over the cells. */
+static inline int march_is_pause(const struct march_element *e)
+{
+	return e->nops == 1 && e->ops[0].kind == MARCH_DELAY;
+}
+
+/* Byte of an operation under a background. */
+static inline uint8_t march_data(const struct march_op *op, const struct march_background *bg)
+{
+	return op->literal ? op->data : (op->data ? bg->one : bg->zero);
+}
+
+#endif
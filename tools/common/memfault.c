@@ -0,0 +1,435 @@
+/*
+ * memfault.c - functional fault models of a byte-wide SRAM.
+ */
+
+#include "memfault.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MF_MAX_FIELDS 6
+
+static const char *const type_names[MF_NTYPES] = {
+	[MF_SAF] = "saf",
+	[MF_TF] = "tf",
+	[MF_CFST] = "cfst",
+	[MF_CFID] = "cfid",
+	[MF_CFIN] = "cfin",
+	[MF_RDF] = "rdf",
+	[MF_DRDF] = "drdf",
+	[MF_DRF] = "drf",
+	[MF_AF_NONE] = "af-none",
+	[MF_AF_ALIAS] = "af-alias",
+	[MF_AF_MULTI] = "af-multi",
+};
+
+/* Number of fields after the type: minimum and maximum. */
+static const uint8_t type_fields[MF_NTYPES][2] = {
+	[MF_SAF] = { 2, 2 },
+	[MF_TF] = { 2, 2 },
+	[MF_CFST] = { 4, 4 },
+	[MF_CFID] = { 4, 4 },
+	[MF_CFIN] = { 3, 3 },
+	[MF_RDF] = { 2, 2 },
+	[MF_DRDF] = { 2, 2 },
+	[MF_DRF] = { 3, 3 },
+	[MF_AF_NONE] = { 1, 2 },
+	[MF_AF_ALIAS] = { 2, 2 },
+	[MF_AF_MULTI] = { 2, 2 },
+};
+
+const char *mf_type_name(enum mf_type type)
+{
+	return type < MF_NTYPES ? type_names[type] : "?";
+}
+
+static int parse_num(const char *s, uint64_t max, uint64_t *v)
+{
+	char *end;
+
+	if (!*s)
+		return -1;
+	*v = strtoull(s, &end, 0);
+	return (*end || *v > max) ? -1 : 0;
+}
+
+static int parse_cell(const char *s, struct mf_cell *c)
+{
+	const char *dot = strrchr(s, '.');
+	char addr[32];
+	uint64_t a, b;
+
+	if (!dot || (size_t)(dot - s) >= sizeof(addr))
+		return -1;
+	memcpy(addr, s, (size_t)(dot - s));
+	addr[dot - s] = '\0';
+	if (parse_num(addr, 0xFFFFFF, &a) || parse_num(dot + 1, 7, &b))
+		return -1;
+	c->addr = (uint32_t)a;
+	c->bit = (uint8_t)b;
+	return 0;
+}
+
+static int parse_addr(const char *s, struct mf_cell *c)
+{
+	uint64_t a;
+
+	if (parse_num(s, 0xFFFFFF, &a))
+		return -1;
+	c->addr = (uint32_t)a;
+	c->bit = 0;
+	return 0;
+}
+
+static int parse_bit(const char *s, uint8_t *v)
+{
+	uint64_t b;
+
+	if (parse_num(s, 1, &b))
+		return -1;
+	*v = (uint8_t)b;
+	return 0;
+}
+
+static int parse_dir(const char *s, uint8_t *up)
+{
+	if (!strcmp(s, "up"))
+		*up = 1;
+	else if (!strcmp(s, "down"))
+		*up = 0;
+	else
+		return -1;
+	return 0;
+}
+
+int mf_parse(const char *spec, struct mf_fault *f)
+{
+	char buf[128], *field[MF_MAX_FIELDS + 1], *p;
+	unsigned n = 0, t;
+	uint64_t v = 0;
+	int err = 0;
+
+	if (strlen(spec) >= sizeof(buf))
+		goto bad;
+	strcpy(buf, spec);
+	memset(f, 0, sizeof(*f));
+	for (p = buf; n <= MF_MAX_FIELDS; n++) {
+		field[n] = p;
+		p = strchr(p, ':');
+		if (!p) {
+			n++;
+			break;
+		}
+		*p++ = '\0';
+	}
+	if (p)
+		goto bad;
+	for (t = 0; t < MF_NTYPES; t++)
+		if (!strcmp(field[0], type_names[t]))
+			break;
+	if (t == MF_NTYPES || n - 1 < type_fields[t][0] || n - 1 > type_fields[t][1])
+		goto bad;
+	f->type = (enum mf_type)t;
+
+	switch (f->type) {
+	case MF_SAF:
+		err = parse_cell(field[1], &f->victim) || parse_bit(field[2], &f->value);
+		break;
+	case MF_TF:
+		err = parse_cell(field[1], &f->victim) || parse_dir(field[2], &f->up);
+		break;
+	case MF_CFST:
+		err = parse_cell(field[1], &f->aggressor) || parse_bit(field[2], &f->state)
+				|| parse_cell(field[3], &f->victim) || parse_bit(field[4], &f->value);
+		break;
+	case MF_CFID:
+		err = parse_cell(field[1], &f->aggressor) || parse_dir(field[2], &f->up)
+				|| parse_cell(field[3], &f->victim) || parse_bit(field[4], &f->value);
+		break;
+	case MF_CFIN:
+		err = parse_cell(field[1], &f->aggressor) || parse_dir(field[2], &f->up)
+				|| parse_cell(field[3], &f->victim);
+		break;
+	case MF_RDF:
+	case MF_DRDF:
+		err = parse_cell(field[1], &f->victim) || parse_bit(field[2], &f->state);
+		break;
+	case MF_DRF:
+		err = parse_cell(field[1], &f->victim) || parse_bit(field[2], &f->state)
+				|| parse_num(field[3], UINT64_MAX, &f->retention) || !f->retention;
+		break;
+	case MF_AF_NONE:
+		err = parse_addr(field[1], &f->victim);
+		if (!err && n == 3) {
+			err = parse_num(field[2], 0xFF, &v);
+			f->value = (uint8_t)v;
+		}
+		break;
+	case MF_AF_ALIAS:
+	case MF_AF_MULTI:
+		err = parse_addr(field[1], &f->victim) || parse_addr(field[2], &f->aggressor)
+				|| f->victim.addr == f->aggressor.addr;
+		break;
+	default:
+		err = 1;
+		break;
+	}
+	if (!err && (f->type == MF_CFST || f->type == MF_CFID || f->type == MF_CFIN)
+			&& f->victim.addr == f->aggressor.addr && f->victim.bit == f->aggressor.bit)
+		err = 1;
+	if (!err)
+		return 0;
+bad:
+	fprintf(stderr, "bad fault '%s'\n", spec);
+	return -1;
+}
+
+void mf_format(const struct mf_fault *f, char *buf, size_t size)
+{
+	const char *name = mf_type_name(f->type), *dir = f->up ? "up" : "down";
+	unsigned va = (unsigned)f->victim.addr, vb = f->victim.bit;
+	unsigned aa = (unsigned)f->aggressor.addr, ab = f->aggressor.bit;
+
+	switch (f->type) {
+	case MF_SAF:
+		snprintf(buf, size, "%s:0x%04X.%u:%u", name, va, vb, f->value);
+		break;
+	case MF_TF:
+		snprintf(buf, size, "%s:0x%04X.%u:%s", name, va, vb, dir);
+		break;
+	case MF_CFST:
+		snprintf(buf, size, "%s:0x%04X.%u:%u:0x%04X.%u:%u", name, aa, ab, f->state, va, vb, f->value);
+		break;
+	case MF_CFID:
+		snprintf(buf, size, "%s:0x%04X.%u:%s:0x%04X.%u:%u", name, aa, ab, dir, va, vb, f->value);
+		break;
+	case MF_CFIN:
+		snprintf(buf, size, "%s:0x%04X.%u:%s:0x%04X.%u", name, aa, ab, dir, va, vb);
+		break;
+	case MF_RDF:
+	case MF_DRDF:
+		snprintf(buf, size, "%s:0x%04X.%u:%u", name, va, vb, f->state);
+		break;
+	case MF_DRF:
+		snprintf(buf, size, "%s:0x%04X.%u:%u:%llu", name, va, vb, f->state,
+				(unsigned long long)f->retention);
+		break;
+	case MF_AF_NONE:
+		snprintf(buf, size, "%s:0x%04X:0x%02X", name, va, f->value);
+		break;
+	default:
+		snprintf(buf, size, "%s:0x%04X:0x%04X", name, va, aa);
+		break;
+	}
+}
+
+int mf_init(struct mf_memory *m, uint8_t *cells, uint32_t base, uint32_t size)
+{
+	memset(m, 0, sizeof(*m));
+	m->cells = cells;
+	m->base = base;
+	m->size = size;
+	m->involved = calloc(size ? size : 1, 1);
+	return m->involved ? 0 : -1;
+}
+
+void mf_free(struct mf_memory *m)
+{
+	free(m->faults);
+	free(m->involved);
+	m->faults = NULL;
+	m->involved = NULL;
+	m->nfaults = 0;
+}
+
+static int in_memory(const struct mf_memory *m, uint32_t addr)
+{
+	return addr >= m->base && addr - m->base < m->size;
+}
+
+static int has_aggressor(enum mf_type t)
+{
+	return t == MF_CFST || t == MF_CFID || t == MF_CFIN || t == MF_AF_ALIAS || t == MF_AF_MULTI;
+}
+
+static inline int get_bit(const struct mf_memory *m, const struct mf_cell *c)
+{
+	return (m->cells[c->addr - m->base] >> c->bit) & 1;
+}
+
+static inline void set_bit(struct mf_memory *m, const struct mf_cell *c, int v)
+{
+	uint8_t *p = &m->cells[c->addr - m->base];
+
+	*p = (uint8_t)(v ? (*p | (1u << c->bit)) : (*p & ~(1u << c->bit)));
+}
+
+/* Apply the faults that hold a cell in a state: stuck-at and state coupling. */
+static void settle(struct mf_memory *m)
+{
+	unsigned i;
+
+	for (i = 0; i < m->nfaults; i++) {
+		const struct mf_fault *f = &m->faults[i];
+
+		if (f->type == MF_CFST && get_bit(m, &f->aggressor) == f->state)
+			set_bit(m, &f->victim, f->value);
+	}
+	for (i = 0; i < m->nfaults; i++) {
+		const struct mf_fault *f = &m->faults[i];
+
+		if (f->type == MF_SAF)
+			set_bit(m, &f->victim, f->value);
+	}
+}
+
+int mf_add(struct mf_memory *m, const struct mf_fault *f)
+{
+	struct mf_fault *n;
+
+	if (!in_memory(m, f->victim.addr) || (has_aggressor(f->type) && !in_memory(m, f->aggressor.addr)))
+		return -1;
+	n = realloc(m->faults, (m->nfaults + 1) * sizeof(*n));
+	if (!n)
+		return -1;
+	m->faults = n;
+	n[m->nfaults] = *f;
+	n[m->nfaults].written = m->now;
+	m->nfaults++;
+	m->involved[f->victim.addr - m->base] = 1;
+	if (has_aggressor(f->type))
+		m->involved[f->aggressor.addr - m->base] = 1;
+	settle(m);
+	return 0;
+}
+
+/* Address decoder: the byte addresses an access selects; returns their number. */
+static unsigned decode(const struct mf_memory *m, uint32_t addr, uint32_t sel[2], uint8_t *none_value)
+{
+	unsigned i;
+
+	sel[0] = addr;
+	if (!m->involved[addr - m->base])
+		return 1;
+	for (i = 0; i < m->nfaults; i++) {
+		const struct mf_fault *f = &m->faults[i];
+
+		if (f->victim.addr != addr)
+			continue;
+		switch (f->type) {
+		case MF_AF_NONE:
+			*none_value = f->value;
+			return 0;
+		case MF_AF_ALIAS:
+			sel[0] = f->aggressor.addr;
+			return 1;
+		case MF_AF_MULTI:
+			sel[1] = f->aggressor.addr;
+			return 2;
+		default:
+			break;
+		}
+	}
+	return 1;
+}
+
+static void write_byte(struct mf_memory *m, uint32_t addr, uint8_t v)
+{
+	uint8_t old = m->cells[addr - m->base];
+	unsigned i;
+
+	if (!m->involved[addr - m->base]) {
+		m->cells[addr - m->base] = v;
+		return;
+	}
+	for (i = 0; i < m->nfaults; i++) {
+		struct mf_fault *f = &m->faults[i];
+		uint8_t bm = (uint8_t)(1u << f->victim.bit);
+
+		if (f->victim.addr != addr)
+			continue;
+		if (f->type == MF_TF) {
+			/* The cell keeps its value instead of making the transition. */
+			if (f->up && !(old & bm) && (v & bm))
+				v &= (uint8_t)~bm;
+			else if (!f->up && (old & bm) && !(v & bm))
+				v |= bm;
+		} else if (f->type == MF_DRF) {
+			f->written = m->now;
+		}
+	}
+	m->cells[addr - m->base] = v;
+
+	for (i = 0; i < m->nfaults; i++) {
+		const struct mf_fault *f = &m->faults[i];
+		uint8_t bm = (uint8_t)(1u << f->aggressor.bit);
+		int rose, fell;
+
+		if ((f->type != MF_CFID && f->type != MF_CFIN) || f->aggressor.addr != addr)
+			continue;
+		rose = !(old & bm) && (v & bm);
+		fell = (old & bm) && !(v & bm);
+		if (f->up ? !rose : !fell)
+			continue;
+		if (f->type == MF_CFID)
+			set_bit(m, &f->victim, f->value);
+		else
+			set_bit(m, &f->victim, !get_bit(m, &f->victim));
+	}
+	settle(m);
+}
+
+static uint8_t read_byte(struct mf_memory *m, uint32_t addr)
+{
+	uint8_t v;
+	unsigned i;
+
+	if (!m->involved[addr - m->base])
+		return m->cells[addr - m->base];
+	for (i = 0; i < m->nfaults; i++) {
+		const struct mf_fault *f = &m->faults[i];
+
+		/* The cell decays when it is next looked at. */
+		if (f->type == MF_DRF && f->victim.addr == addr && get_bit(m, &f->victim) == f->state
+				&& m->now - f->written >= f->retention)
+			set_bit(m, &f->victim, !f->state);
+	}
+	v = m->cells[addr - m->base];
+	for (i = 0; i < m->nfaults; i++) {
+		const struct mf_fault *f = &m->faults[i];
+		uint8_t bm = (uint8_t)(1u << f->victim.bit);
+
+		if ((f->type != MF_RDF && f->type != MF_DRDF) || f->victim.addr != addr
+				|| get_bit(m, &f->victim) != f->state)
+			continue;
+		set_bit(m, &f->victim, !f->state);
+		if (f->type == MF_RDF)
+			v ^= bm;
+	}
+	settle(m);
+	return v;
+}
+
+uint8_t mf_read(struct mf_memory *m, uint32_t addr)
+{
+	uint32_t sel[2];
+	uint8_t none = 0;
+	unsigned n = decode(m, addr, sel, &none);
+
+	if (n == 0)
+		return none;
+	if (n == 2)
+		return read_byte(m, sel[0]) & read_byte(m, sel[1]);
+	return read_byte(m, sel[0]);
+}
+
+void mf_write(struct mf_memory *m, uint32_t addr, uint8_t value)
+{
+	uint32_t sel[2];
+	uint8_t none;
+	unsigned i, n = decode(m, addr, sel, &none);
+
+	for (i = 0; i < n; i++)
+		write_byte(m, sel[i], value);
+}
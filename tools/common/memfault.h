@@ -0,0 +1,104 @@
+/*
+ * memfault.h - functional fault models of a byte-wide SRAM.
+ *
+ * A fault memory wraps the cells of a simulated SRAM and applies the
+ * classical functional fault models to every access:
+ *
+ *   saf:CELL:V             stuck-at: the cell always holds V
+ *   tf:CELL:up|down        transition: the cell cannot make the up (0 to 1)
+ *                          or down (1 to 0) transition
+ *   cfst:AGG:S:VIC:V       state coupling: the victim is forced to V while
+ *                          the aggressor holds S
+ *   cfid:AGG:up|down:VIC:V idempotent coupling: an up or down transition of
+ *                          the aggressor writes V into the victim
+ *   cfin:AGG:up|down:VIC   inversion coupling: the transition inverts the
+ *                          victim
+ *   rdf:CELL:S             read disturb: reading S flips the cell and
+ *                          returns the flipped value
+ *   drdf:CELL:S            deceptive read disturb: flips the cell, but the
+ *                          read returns S
+ *   drf:CELL:S:TIME        data retention: the cell loses S when it has not
+ *                          been written for TIME
+ *   af-none:ADDR[:V]       address decoder: ADDR selects no cell; writes are
+ *                          lost and reads return V (default 0)
+ *   af-alias:ADDR:OTHER    ADDR selects the cells of OTHER instead of its own
+ *   af-multi:ADDR:OTHER    ADDR selects its own cells and those of OTHER;
+ *                          reads return both ANDed (wired-AND bit lines)
+ *
+ * A cell is ADDR.BIT, with the byte address in the data space (0x2000 is
+ * the first SRAM byte on XMEGA) and the bit 0..7. Numbers are C style, so
+ * addresses are usually given in hex. TIME is in the caller's units, CPU
+ * cycles in the simulator.
+ *
+ * The address decoder faults cover the four classical cases: an address
+ * without a cell (af-none), a cell without an address and a cell with two
+ * addresses (af-alias), an address with two cells (af-multi).
+ */
+
+#ifndef TOOLS_MEMFAULT_H
+#define TOOLS_MEMFAULT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum mf_type {
+	MF_SAF,
+	MF_TF,
+	MF_CFST,
+	MF_CFID,
+	MF_CFIN,
+	MF_RDF,
+	MF_DRDF,
+	MF_DRF,
+	MF_AF_NONE,
+	MF_AF_ALIAS,
+	MF_AF_MULTI,
+	MF_NTYPES
+};
+
+struct mf_cell {
+	uint32_t addr;              /* byte address */
+	uint8_t bit;
+};
+
+struct mf_fault {
+	enum mf_type type;
+	struct mf_cell victim;      /* the faulty cell, or the faulty address */
+	struct mf_cell aggressor;   /* coupling faults; the other address of af-alias/af-multi */
+	uint8_t state;              /* S: aggressor state (cfst), sensitive victim state (rdf, drf) */
+	uint8_t value;              /* V: forced value, a byte for af-none */
+	uint8_t up;                 /* sensitising transition: 1 up, 0 down */
+	uint64_t retention;         /* drf */
+	uint64_t written;           /* drf: time of the last write of the victim */
+};
+
+struct mf_memory {
+	uint8_t *cells;             /* size bytes, for addresses base.. */
+	uint32_t base, size;
+	struct mf_fault *faults;
+	unsigned nfaults;
+	uint8_t *involved;          /* per byte: a fault cell or address lies in it */
+	uint64_t now;               /* current time, set by the caller */
+};
+
+/* Name of a fault type, as in the specifications. */
+const char *mf_type_name(enum mf_type type);
+
+/* Parse a fault specification; returns 0, or -1 with a message on stderr. */
+int mf_parse(const char *spec, struct mf_fault *f);
+
+/* Specification of a fault, as accepted by mf_parse(). */
+void mf_format(const struct mf_fault *f, char *buf, size_t size);
+
+/* Wrap the cells of [base, base + size). The cells keep their contents. */
+int mf_init(struct mf_memory *m, uint8_t *cells, uint32_t base, uint32_t size);
+void mf_free(struct mf_memory *m);
+
+/* Add a fault; returns -1 if a cell or address is outside the memory. */
+int mf_add(struct mf_memory *m, const struct mf_fault *f);
+
+/* Accesses through the faults; addr must lie in the memory. */
+uint8_t mf_read(struct mf_memory *m, uint32_t addr);
+void mf_write(struct mf_memory *m, uint32_t addr, uint8_t value);
+
+#endif
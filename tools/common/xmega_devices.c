@@ -0,0 +1,65 @@
+/*
+ * xmega_devices.c - memory layout of the supported XMEGA devices.
+ */
+
+#include "xmega_devices.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "elf32.h"
+
+const struct xmega_device xmega_devices[] = {
+	/* name              app      boot    page  sram    eeprom */
+	{ "atxmega16a4u",   0x04000, 0x1000, 256, 0x0800, 0x0400 },
+	{ "atxmega32a4u",   0x08000, 0x1000, 256, 0x1000, 0x0400 },
+	{ "atxmega64a1u",   0x10000, 0x1000, 256, 0x1000, 0x0800 },
+	{ "atxmega64a3u",   0x10000, 0x1000, 256, 0x1000, 0x0800 },
+	{ "atxmega128a1",   0x20000, 0x2000, 512, 0x2000, 0x0800 },
+	{ "atxmega128a1u",  0x20000, 0x2000, 512, 0x2000, 0x0800 },
+	{ "atxmega128a3u",  0x20000, 0x2000, 512, 0x2000, 0x0800 },
+	{ "atxmega192a3u",  0x30000, 0x2000, 512, 0x4000, 0x0800 },
+	{ "atxmega256a3u",  0x40000, 0x2000, 512, 0x4000, 0x1000 },
+	{ "atxmega256a3bu", 0x40000, 0x2000, 512, 0x4000, 0x1000 },
+};
+
+const unsigned xmega_ndevices = sizeof(xmega_devices) / sizeof(xmega_devices[0]);
+
+static int name_eq(const char *a, const char *b)
+{
+	while (*a && *b && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+		a++;
+		b++;
+	}
+	return *a == '\0' && *b == '\0';
+}
+
+const struct xmega_device *xmega_find_device(const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < xmega_ndevices; i++)
+		if (name_eq(xmega_devices[i].name, name) || name_eq(xmega_devices[i].name + 2, name))
+			return &xmega_devices[i];
+	return NULL;
+}
+
+const struct xmega_device *xmega_detect_device(const struct elf_file *ef)
+{
+	const struct elf_section *s = elf_find_section(ef, ".note.gnu.avr.deviceinfo");
+	unsigned i;
+
+	if (!s || s->type == ELF_SHT_NOBITS)
+		return NULL;
+	for (i = 0; i < xmega_ndevices; i++) {
+		const char *name = xmega_devices[i].name;
+		size_t len = strlen(name) + 1;
+		uint32_t j;
+
+		for (j = 0; j + len <= s->size; j++)
+			if (memcmp(ef->data + s->offset + j, name, len) == 0)
+				return &xmega_devices[i];
+	}
+	return NULL;
+}
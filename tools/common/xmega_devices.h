@@ -0,0 +1,42 @@
+/*
+ * xmega_devices.h - memory layout of the supported XMEGA devices.
+ */
+
+#ifndef TOOLS_XMEGA_DEVICES_H
+#define TOOLS_XMEGA_DEVICES_H
+
+#include <stdint.h>
+
+/* Data memory map common to the XMEGA A family. */
+#define XMEGA_IO_SIZE             0x1000U
+#define XMEGA_MAPPED_EEPROM_START 0x1000U
+#define XMEGA_INTERNAL_SRAM_START 0x2000U
+
+struct xmega_device {
+	const char *name;
+	uint32_t app_size;      /* application section, including the application table */
+	uint32_t boot_size;     /* boot section */
+	uint32_t page_size;     /* Flash page */
+	uint32_t sram_size;     /* internal SRAM */
+	uint32_t eeprom_size;
+};
+
+extern const struct xmega_device xmega_devices[];
+extern const unsigned xmega_ndevices;
+
+/* Device by name (case insensitive, with or without the "at" prefix), or NULL. */
+const struct xmega_device *xmega_find_device(const char *name);
+
+struct elf_file;
+
+/* Device from the .note.gnu.avr.deviceinfo section that avr-gcc links into
+ * the ELF file, or NULL. */
+const struct xmega_device *xmega_detect_device(const struct elf_file *ef);
+
+/* Number of bytes pushed for a return address: 3 if the Flash exceeds 128 KB. */
+static inline unsigned xmega_pc_bytes(const struct xmega_device *d)
+{
+	return (d->app_size + d->boot_size) > 0x20000UL ? 3 : 2;
+}
+
+#endif
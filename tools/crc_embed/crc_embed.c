@@ -0,0 +1,693 @@
+/*
+ * crc_embed - compute the Class B reference checksums of a linked image
+ * and write them into the image.
+ *
+ * The Flash checksum is computed the way CLASSB_CRC32_Flash_HW/SW and
+ * CLASSB_CRC16_Flash_HW/SW compute it at run time: the whole range is read,
+ * including erased (0xFF) bytes that the image does not cover. The result
+ * is stored little-endian in an EEPROM variable, by default
+ * classb_precalculated_flash_crc. The checksum of an EEPROM data range can
+ * be stored in the same way, and a per-page map for CLASSB_CRC32_Flash_Pages
+ * can be generated.
+ *
+ * ELF files are patched in place (or written to -o). For Intel HEX Flash
+ * images the reference address has to be given with --symbol-addr and an
+ * EEPROM patch file <image>.crc.eep is written.
+ *
+ * Several images are processed in parallel.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "crc.h"
+#include "elf32.h"
+#include "ihex.h"
+#include "xmega_devices.h"
+
+#define EEPROM_MAX_SIZE 0x10000UL
+#define FLASH_MAX_SIZE  0x800000UL
+
+enum range_kind { RANGE_APP, RANGE_BOOT, RANGE_ADDR, RANGE_SYMBOL };
+
+struct range {
+	enum range_kind kind;
+	uint32_t start;
+	uint32_t len;
+	const char *symbol;
+};
+
+static struct {
+	uint32_t app_size;
+	uint32_t boot_size;
+	uint32_t page_size;
+	struct range flash;
+	int width;
+	int hw_range;
+	const char *symbol;
+	long symbol_addr;
+	int have_eeprom;
+	struct range eeprom;
+	int eeprom_width;
+	const char *eeprom_symbol;
+	const char *pagemap;
+	const char *output;
+	int dry_run;
+	int check;
+	int quiet;
+} opt = {
+	.flash = { RANGE_APP, 0, 0, NULL },
+	.width = 32,
+	.symbol = "classb_precalculated_flash_crc",
+	.symbol_addr = -1,
+	.eeprom_width = 16,
+	.eeprom_symbol = "classb_precalculated_eeprom_crc",
+};
+
+struct job {
+	const char *path;
+	int status;
+	char *log;
+	size_t loglen;
+};
+
+static struct job *jobs;
+static unsigned njobs;
+static unsigned next_job;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void jlog(struct job *j, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+	char *p;
+
+	va_start(ap, fmt);
+	n = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return;
+	p = realloc(j->log, j->loglen + (size_t)n + 1);
+	if (!p)
+		return;
+	j->log = p;
+	va_start(ap, fmt);
+	vsnprintf(j->log + j->loglen, (size_t)n + 1, fmt, ap);
+	va_end(ap);
+	j->loglen += (size_t)n;
+}
+
+static int jerr(struct job *j, const char *fmt, ...)
+{
+	va_list ap;
+	char buf[512];
+
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	jlog(j, "%s: error: %s\n", j->path, buf);
+	j->status = 1;
+	return -1;
+}
+
+static int has_suffix(const char *s, const char *suffix)
+{
+	size_t n = strlen(s), m = strlen(suffix);
+
+	return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static void put_le(uint8_t *p, uint32_t v, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t checksum(int width, const uint8_t *buf, uint32_t len)
+{
+	return width == 32 ? crc32_ieee(0, buf, len) : crc16_ccitt(0, buf, len);
+}
+
+/* Resolve a range to [start, start + len) relative to the memory base. */
+static int resolve_range(struct job *j, const struct elf_file *ef, const struct range *r,
+		uint32_t base, uint32_t *start, uint32_t *len)
+{
+	switch (r->kind) {
+	case RANGE_APP:
+		if (!opt.app_size)
+			return jerr(j, "the application section size is unknown, use --device or --app-size");
+		*start = 0;
+		*len = opt.app_size;
+		return 0;
+	case RANGE_BOOT:
+		if (!opt.app_size || !opt.boot_size)
+			return jerr(j, "the boot section is unknown, use --device or --app-size and --boot-size");
+		*start = opt.app_size;
+		*len = opt.boot_size;
+		return 0;
+	case RANGE_ADDR:
+		*start = r->start;
+		*len = r->len;
+		return 0;
+	case RANGE_SYMBOL: {
+		const struct elf_symbol *s;
+
+		if (!ef)
+			return jerr(j, "symbol ranges need an ELF file");
+		s = elf_find_symbol(ef, r->symbol);
+		if (!s)
+			return jerr(j, "symbol '%s' not found", r->symbol);
+		if (s->value < base || s->value - base >= (base == AVR_FLASH_BASE ? FLASH_MAX_SIZE : EEPROM_MAX_SIZE))
+			return jerr(j, "symbol '%s' is not in the expected memory", r->symbol);
+		*start = s->value - base;
+		*len = s->size;
+		return 0;
+	}
+	}
+	return -1;
+}
+
+/* A reference variable that receives a checksum. */
+struct target {
+	const char *name;
+	uint32_t addr;      /* linked address */
+	uint32_t size;
+	uint8_t *ptr;       /* contents in the ELF file, NULL for HEX images */
+};
+
+static int find_target(struct job *j, const struct elf_file *ef, const char *name, uint32_t need, struct target *t)
+{
+	const struct elf_symbol *s = elf_find_symbol(ef, name);
+
+	if (!s)
+		return jerr(j, "symbol '%s' not found", name);
+	if (s->size && s->size < need)
+		return jerr(j, "symbol '%s' has %lu bytes, %lu needed", name,
+				(unsigned long)s->size, (unsigned long)need);
+	t->name = name;
+	t->addr = s->value;
+	t->size = need;
+	t->ptr = elf_vaddr_ptr(ef, s->value, need);
+	if (!t->ptr)
+		return jerr(j, "symbol '%s' has no contents in the file", name);
+	if (!(t->addr < FLASH_MAX_SIZE || (t->addr >= AVR_EEPROM_BASE && t->addr < AVR_EEPROM_END)))
+		return jerr(j, "symbol '%s' is neither in Flash nor in EEPROM", name);
+	return 0;
+}
+
+static int overlaps(uint32_t a, uint32_t alen, uint32_t b, uint32_t blen)
+{
+	return a < b + blen && b < a + alen;
+}
+
+/*
+ * Store a value in a target. Returns 1 if the file changed, 0 if it already
+ * held the value. In check mode a difference is an error.
+ */
+static int store(struct job *j, const struct target *t, const uint8_t *val, const char *what)
+{
+	if (memcmp(t->ptr, val, t->size) == 0)
+		return 0;
+	if (opt.check)
+		return jerr(j, "%s in '%s' is out of date", what, t->name);
+	/* Also in a dry run: later checksums may cover this value. */
+	memcpy(t->ptr, val, t->size);
+	return 1;
+}
+
+static void process_elf(struct job *j)
+{
+	struct elf_file ef;
+	uint8_t *flash = NULL, *eeprom = NULL;
+	uint32_t fstart, flen, crc;
+	struct target ref, map, eref;
+	uint8_t val[4];
+	int changed = 0, r;
+	int width_bytes = opt.width / 8;
+
+	if (elf_load(j->path, &ef)) {
+		j->status = 1;
+		jlog(j, "%s: error: cannot load ELF file\n", j->path);
+		return;
+	}
+
+	if (resolve_range(j, &ef, &opt.flash, AVR_FLASH_BASE, &fstart, &flen))
+		goto out;
+	if (opt.hw_range && opt.width == 32 && opt.flash.kind != RANGE_APP && opt.flash.kind != RANGE_BOOT)
+		flen = (flen + 1) & ~1UL; /* the NVM range command reads whole words */
+	if (flen == 0 || (uint64_t)fstart + flen > FLASH_MAX_SIZE) {
+		jerr(j, "invalid Flash range");
+		goto out;
+	}
+
+	flash = malloc(fstart + flen);
+	if (!flash) {
+		jerr(j, "out of memory");
+		goto out;
+	}
+	memset(flash, 0xFF, fstart + flen);
+	elf_load_image(&ef, AVR_FLASH_BASE, flash, fstart + flen);
+
+	if (find_target(j, &ef, opt.symbol, (uint32_t)width_bytes, &ref))
+		goto out;
+	if (ref.addr < FLASH_MAX_SIZE && overlaps(ref.addr, ref.size, fstart, flen)) {
+		jerr(j, "'%s' is inside the checked Flash range", ref.name);
+		goto out;
+	}
+
+	/* Page map, if requested. */
+	if (opt.pagemap) {
+		uint32_t npages, p;
+		uint8_t *mapval;
+
+		if (!opt.page_size || flen % opt.page_size) {
+			jerr(j, "the Flash range is not a whole number of %lu-byte pages",
+					(unsigned long)opt.page_size);
+			goto out;
+		}
+		if (opt.width != 32) {
+			jerr(j, "the page map holds 32-bit checksums");
+			goto out;
+		}
+		npages = flen / opt.page_size;
+		if (find_target(j, &ef, opt.pagemap, npages * 4, &map))
+			goto out;
+		if (map.addr < FLASH_MAX_SIZE && overlaps(map.addr, map.size, fstart, flen)) {
+			jerr(j, "'%s' is inside the checked Flash range", map.name);
+			goto out;
+		}
+		mapval = malloc(npages * 4);
+		if (!mapval) {
+			jerr(j, "out of memory");
+			goto out;
+		}
+		for (p = 0; p < npages; p++)
+			put_le(mapval + 4 * p, crc32_ieee(0, flash + fstart + p * opt.page_size, opt.page_size), 4);
+		r = store(j, &map, mapval, "page map");
+		free(mapval);
+		if (r < 0)
+			goto out;
+		changed |= r;
+		jlog(j, "%s: page map %lu x %lu bytes -> %s%s\n", j->path, (unsigned long)npages,
+				(unsigned long)opt.page_size, map.name, r ? "" : " (unchanged)");
+	}
+
+	crc = checksum(opt.width, flash + fstart, flen);
+	put_le(val, crc, width_bytes);
+	r = store(j, &ref, val, "Flash checksum");
+	if (r < 0)
+		goto out;
+	changed |= r;
+	jlog(j, "%s: flash 0x%06lX+0x%06lX crc%d 0x%0*lX -> %s%s\n", j->path,
+			(unsigned long)fstart, (unsigned long)flen, opt.width, width_bytes * 2,
+			(unsigned long)crc, ref.name, r ? "" : " (unchanged)");
+
+	if (opt.have_eeprom) {
+		uint32_t estart, elen;
+		int ebytes = opt.eeprom_width / 8;
+
+		if (resolve_range(j, &ef, &opt.eeprom, AVR_EEPROM_BASE, &estart, &elen))
+			goto out;
+		if (elen == 0 || (uint64_t)estart + elen > EEPROM_MAX_SIZE) {
+			jerr(j, "invalid EEPROM range");
+			goto out;
+		}
+		if (find_target(j, &ef, opt.eeprom_symbol, (uint32_t)ebytes, &eref))
+			goto out;
+		if (eref.addr >= AVR_EEPROM_BASE && overlaps(eref.addr - AVR_EEPROM_BASE, eref.size, estart, elen)) {
+			jerr(j, "'%s' is inside the checked EEPROM range", eref.name);
+			goto out;
+		}
+		/* Taken after the Flash references were stored, which may be in this range. */
+		eeprom = malloc(estart + elen);
+		if (!eeprom) {
+			jerr(j, "out of memory");
+			goto out;
+		}
+		memset(eeprom, 0xFF, estart + elen);
+		elf_load_image(&ef, AVR_EEPROM_BASE, eeprom, estart + elen);
+
+		crc = checksum(opt.eeprom_width, eeprom + estart, elen);
+		put_le(val, crc, ebytes);
+		r = store(j, &eref, val, "EEPROM checksum");
+		if (r < 0)
+			goto out;
+		changed |= r;
+		jlog(j, "%s: eeprom 0x%04lX+0x%04lX crc%d 0x%0*lX -> %s%s\n", j->path,
+				(unsigned long)estart, (unsigned long)elen, opt.eeprom_width, ebytes * 2,
+				(unsigned long)crc, eref.name, r ? "" : " (unchanged)");
+	}
+
+	if (!opt.dry_run && !opt.check && (changed || opt.output)) {
+		if (elf_save(&ef, opt.output ? opt.output : j->path)) {
+			jerr(j, "cannot write the image");
+			goto out;
+		}
+	}
+
+out:
+	free(flash);
+	free(eeprom);
+	elf_free(&ef);
+}
+
+static void process_hex(struct job *j)
+{
+	uint8_t *flash = NULL;
+	uint32_t fstart, flen, top, crc;
+	uint8_t val[4];
+	int width_bytes = opt.width / 8;
+	char *out = NULL;
+	FILE *f;
+
+	if (opt.flash.kind == RANGE_SYMBOL || opt.pagemap || opt.have_eeprom) {
+		jerr(j, "symbol ranges, page maps and EEPROM ranges need an ELF file");
+		return;
+	}
+	if (resolve_range(j, NULL, &opt.flash, AVR_FLASH_BASE, &fstart, &flen))
+		return;
+	if (opt.hw_range && opt.width == 32 && opt.flash.kind == RANGE_ADDR)
+		flen = (flen + 1) & ~1UL;
+	if (flen == 0 || (uint64_t)fstart + flen > FLASH_MAX_SIZE) {
+		jerr(j, "invalid Flash range");
+		return;
+	}
+
+	flash = malloc(fstart + flen);
+	if (!flash) {
+		jerr(j, "out of memory");
+		return;
+	}
+	memset(flash, 0xFF, fstart + flen);
+	if (ihex_load(j->path, flash, fstart + flen, &top)) {
+		jerr(j, "cannot load Intel HEX file (data outside of the Flash range?)");
+		goto out;
+	}
+
+	crc = checksum(opt.width, flash + fstart, flen);
+	jlog(j, "%s: flash 0x%06lX+0x%06lX crc%d 0x%0*lX\n", j->path, (unsigned long)fstart,
+			(unsigned long)flen, opt.width, width_bytes * 2, (unsigned long)crc);
+
+	if (opt.symbol_addr < 0 || opt.dry_run || opt.check)
+		goto out;
+
+	/* <image>.crc.eep with the checksum at the EEPROM address of the reference. */
+	out = malloc(strlen(j->path) + 9);
+	if (!out) {
+		jerr(j, "out of memory");
+		goto out;
+	}
+	strcpy(out, j->path);
+	if (has_suffix(out, ".hex"))
+		out[strlen(out) - 4] = '\0';
+	strcat(out, ".crc.eep");
+
+	put_le(val, crc, width_bytes);
+	f = fopen(out, "w");
+	if (!f || ihex_write(f, (uint32_t)opt.symbol_addr, val, (uint32_t)width_bytes) || ihex_write_end(f)) {
+		jerr(j, "cannot write %s: %s", out, strerror(errno));
+		if (f)
+			fclose(f);
+		goto out;
+	}
+	fclose(f);
+	jlog(j, "%s: wrote %s\n", j->path, out);
+
+out:
+	free(out);
+	free(flash);
+}
+
+static void *worker(void *arg)
+{
+	(void)arg;
+
+	for (;;) {
+		struct job *j;
+
+		pthread_mutex_lock(&job_lock);
+		j = next_job < njobs ? &jobs[next_job++] : NULL;
+		pthread_mutex_unlock(&job_lock);
+		if (!j)
+			return NULL;
+
+		if (has_suffix(j->path, ".hex") || has_suffix(j->path, ".ihex"))
+			process_hex(j);
+		else
+			process_elf(j);
+	}
+}
+
+static int parse_num(const char *s, uint32_t *v)
+{
+	char *end;
+	unsigned long n;
+
+	errno = 0;
+	n = strtoul(s, &end, 0);
+	if (errno || end == s)
+		return -1;
+	if (*end == 'k' || *end == 'K') {
+		n *= 1024;
+		end++;
+	}
+	if (*end)
+		return -1;
+	*v = (uint32_t)n;
+	return 0;
+}
+
+/* app, boot, START:LEN or a symbol name. */
+static int parse_range(const char *s, struct range *r, int allow_sections)
+{
+	const char *colon = strchr(s, ':');
+
+	if (allow_sections && strcmp(s, "app") == 0) {
+		r->kind = RANGE_APP;
+	} else if (allow_sections && strcmp(s, "boot") == 0) {
+		r->kind = RANGE_BOOT;
+	} else if (colon) {
+		char start[32];
+
+		if ((size_t)(colon - s) >= sizeof(start))
+			return -1;
+		memcpy(start, s, (size_t)(colon - s));
+		start[colon - s] = '\0';
+		if (parse_num(start, &r->start) || parse_num(colon + 1, &r->len))
+			return -1;
+		r->kind = RANGE_ADDR;
+	} else {
+		r->kind = RANGE_SYMBOL;
+		r->symbol = s;
+	}
+	return 0;
+}
+
+static void usage(FILE *f)
+{
+	unsigned i;
+
+	fprintf(f,
+		"Usage: crc_embed [options] IMAGE...\n"
+		"\n"
+		"Compute the Class B reference checksums of linked images (ELF or Intel HEX)\n"
+		"and store them in the images.\n"
+		"\n"
+		"  -d, --device NAME        device with known section and page sizes\n"
+		"      --app-size N         application section size in bytes\n"
+		"      --boot-size N        boot section size in bytes\n"
+		"      --page-size N        Flash page size in bytes\n"
+		"  -r, --range R            Flash range: app (default), boot, START:LEN or a symbol\n"
+		"  -w, --width 16|32        Flash checksum width (default 32)\n"
+		"      --hw-range           round START:LEN ranges up to whole words, like the\n"
+		"                           NVM range CRC command used by CLASSB_CRC32_Flash_HW\n"
+		"  -s, --symbol NAME        reference variable (default classb_precalculated_flash_crc)\n"
+		"      --symbol-addr ADDR   EEPROM address of the reference, for Intel HEX images\n"
+		"  -p, --pagemap NAME       also fill the page map NAME for CLASSB_CRC32_Flash_Pages\n"
+		"  -e, --eeprom-range R     also check EEPROM data: START:LEN or a symbol\n"
+		"      --eeprom-width 16|32 EEPROM checksum width (default 16)\n"
+		"      --eeprom-symbol NAME EEPROM reference (default classb_precalculated_eeprom_crc)\n"
+		"  -o, --output FILE        write the patched ELF to FILE (one image only)\n"
+		"  -n, --dry-run            compute and report, do not write anything\n"
+		"  -c, --check              fail if a stored reference is out of date\n"
+		"  -j, --jobs N             number of worker threads (default: all CPUs)\n"
+		"  -q, --quiet              only report errors\n"
+		"  -h, --help               show this help\n"
+		"\n"
+		"Devices:");
+	for (i = 0; i < xmega_ndevices; i++)
+		fprintf(f, " %s", xmega_devices[i].name);
+	fprintf(f, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "device", required_argument, NULL, 'd' },
+		{ "app-size", required_argument, NULL, 'A' },
+		{ "boot-size", required_argument, NULL, 'B' },
+		{ "page-size", required_argument, NULL, 'P' },
+		{ "range", required_argument, NULL, 'r' },
+		{ "width", required_argument, NULL, 'w' },
+		{ "hw-range", no_argument, NULL, 'H' },
+		{ "symbol", required_argument, NULL, 's' },
+		{ "symbol-addr", required_argument, NULL, 'S' },
+		{ "pagemap", required_argument, NULL, 'p' },
+		{ "eeprom-range", required_argument, NULL, 'e' },
+		{ "eeprom-width", required_argument, NULL, 'W' },
+		{ "eeprom-symbol", required_argument, NULL, 'E' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "dry-run", no_argument, NULL, 'n' },
+		{ "check", no_argument, NULL, 'c' },
+		{ "jobs", required_argument, NULL, 'j' },
+		{ "quiet", no_argument, NULL, 'q' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	const struct xmega_device *dev;
+	pthread_t *threads;
+	uint32_t v;
+	unsigned i;
+	int c, status = 0;
+
+	while ((c = getopt_long(argc, argv, "d:r:w:s:p:e:o:ncj:qh", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'd':
+			dev = xmega_find_device(optarg);
+			if (!dev) {
+				fprintf(stderr, "crc_embed: unknown device '%s'\n", optarg);
+				return 2;
+			}
+			opt.app_size = dev->app_size;
+			opt.boot_size = dev->boot_size;
+			opt.page_size = dev->page_size;
+			break;
+		case 'A':
+		case 'B':
+		case 'P':
+			if (parse_num(optarg, &v)) {
+				fprintf(stderr, "crc_embed: bad size '%s'\n", optarg);
+				return 2;
+			}
+			*(c == 'A' ? &opt.app_size : c == 'B' ? &opt.boot_size : &opt.page_size) = v;
+			break;
+		case 'r':
+			if (parse_range(optarg, &opt.flash, 1)) {
+				fprintf(stderr, "crc_embed: bad range '%s'\n", optarg);
+				return 2;
+			}
+			break;
+		case 'e':
+			if (parse_range(optarg, &opt.eeprom, 0)) {
+				fprintf(stderr, "crc_embed: bad range '%s'\n", optarg);
+				return 2;
+			}
+			opt.have_eeprom = 1;
+			break;
+		case 'w':
+		case 'W':
+			if (strcmp(optarg, "16") && strcmp(optarg, "32")) {
+				fprintf(stderr, "crc_embed: width must be 16 or 32\n");
+				return 2;
+			}
+			*(c == 'w' ? &opt.width : &opt.eeprom_width) = atoi(optarg);
+			break;
+		case 'H':
+			opt.hw_range = 1;
+			break;
+		case 's':
+			opt.symbol = optarg;
+			break;
+		case 'S':
+			if (parse_num(optarg, &v) || v >= EEPROM_MAX_SIZE) {
+				fprintf(stderr, "crc_embed: bad EEPROM address '%s'\n", optarg);
+				return 2;
+			}
+			opt.symbol_addr = (long)v;
+			break;
+		case 'p':
+			opt.pagemap = optarg;
+			break;
+		case 'E':
+			opt.eeprom_symbol = optarg;
+			break;
+		case 'o':
+			opt.output = optarg;
+			break;
+		case 'n':
+			opt.dry_run = 1;
+			break;
+		case 'c':
+			opt.check = 1;
+			break;
+		case 'j':
+			nthreads = atol(optarg);
+			break;
+		case 'q':
+			opt.quiet = 1;
+			break;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+
+	njobs = (unsigned)(argc - optind);
+	if (njobs == 0) {
+		usage(stderr);
+		return 2;
+	}
+	if (opt.output && njobs != 1) {
+		fprintf(stderr, "crc_embed: --output needs exactly one image\n");
+		return 2;
+	}
+	if (nthreads < 1)
+		nthreads = 1;
+	if ((unsigned long)nthreads > njobs)
+		nthreads = (long)njobs;
+
+	crc_init();
+
+	jobs = calloc(njobs, sizeof(*jobs));
+	threads = calloc((size_t)nthreads, sizeof(*threads));
+	if (!jobs || !threads) {
+		fprintf(stderr, "crc_embed: out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < njobs; i++)
+		jobs[i].path = argv[optind + (int)i];
+
+	for (i = 0; i < (unsigned)nthreads; i++)
+		if (pthread_create(&threads[i], NULL, worker, NULL)) {
+			fprintf(stderr, "crc_embed: cannot create thread\n");
+			return 1;
+		}
+	for (i = 0; i < (unsigned)nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	/* Report in command-line order. */
+	for (i = 0; i < njobs; i++) {
+		if (jobs[i].log && (jobs[i].status || !opt.quiet))
+			fputs(jobs[i].log, jobs[i].status ? stderr : stdout);
+		status |= jobs[i].status;
+		free(jobs[i].log);
+	}
+	free(jobs);
+	free(threads);
+
+	return status;
+}
@@ -0,0 +1,377 @@
+/*
+ * cyclebudget - compare the cycle counts and stack usage measured by avrsim
+ * with a stored baseline.
+ *
+ * The measurements are taken from the JSON results of avrsim (-j):
+ *
+ *   mark NAME     cycles when the mark was first reached, e.g. the boot
+ *                 time with -m main
+ *   range NAME    cycles spent in a range
+ *   FUNC          the longest call of a function whose name starts with
+ *                 one of the --func prefixes, and its stack usage
+ *   FUNC#N        call N of a function recorded with avrsim --calls
+ *   program       the stack depth reached by the whole run
+ *
+ * --update writes them as the baseline. Otherwise every measurement of the
+ * baseline must be present and may exceed its baseline by at most
+ * --threshold percent of cycles and --stack-slack bytes of stack; the
+ * exit status is 1 if any does not.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+#define MAX_PREFIXES 16
+
+struct measurement {
+	char *name;
+	double cycles;              /* -1 if not measured */
+	double stack;               /* -1 if not measured */
+};
+
+struct mlist {
+	struct measurement *m;
+	unsigned n, cap;
+};
+
+static int add(struct mlist *l, const char *name, double cycles, double stack)
+{
+	unsigned i;
+
+	for (i = 0; i < l->n; i++)
+		if (!strcmp(l->m[i].name, name)) {
+			fprintf(stderr, "cyclebudget: '%s' is measured twice\n", name);
+			return -1;
+		}
+	if (l->n == l->cap) {
+		struct measurement *m = realloc(l->m, (l->cap = 2 * l->cap + 16) * sizeof(*m));
+
+		if (!m) {
+			fprintf(stderr, "cyclebudget: out of memory\n");
+			return -1;
+		}
+		l->m = m;
+	}
+	l->m[l->n].name = strdup(name);
+	if (!l->m[l->n].name) {
+		fprintf(stderr, "cyclebudget: out of memory\n");
+		return -1;
+	}
+	l->m[l->n].cycles = cycles;
+	l->m[l->n].stack = stack;
+	l->n++;
+	return 0;
+}
+
+static void mlist_free(struct mlist *l)
+{
+	unsigned i;
+
+	for (i = 0; i < l->n; i++)
+		free(l->m[i].name);
+	free(l->m);
+}
+
+static const struct measurement *find(const struct mlist *l, const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < l->n; i++)
+		if (!strcmp(l->m[i].name, name))
+			return &l->m[i];
+	return NULL;
+}
+
+static double number(const struct json *j, const char *key)
+{
+	const struct json *v = json_get(j, key);
+
+	return v && v->type == JSON_NUMBER ? v->number : -1;
+}
+
+static const char *string(const struct json *j, const char *key)
+{
+	const struct json *v = json_get(j, key);
+
+	return v && v->type == JSON_STRING ? v->string : NULL;
+}
+
+/* The measurements of an avrsim result file. */
+static int from_results(const struct json *r, const char *path, const char *const *prefixes,
+		unsigned nprefixes, struct mlist *l)
+{
+	const struct json *a, *e;
+	char name[256];
+	unsigned i;
+
+	if (!json_get(r, "functions") || !string(r, "image")) {
+		fprintf(stderr, "%s: not an avrsim result file\n", path);
+		return -1;
+	}
+	if ((a = json_get(r, "marks")))
+		for (e = a->child; e; e = e->next) {
+			snprintf(name, sizeof(name), "mark %s", string(e, "name") ? string(e, "name") : "?");
+			if (add(l, name, number(e, "cycles"), -1))
+				return -1;
+		}
+	if ((a = json_get(r, "ranges")))
+		for (e = a->child; e; e = e->next) {
+			snprintf(name, sizeof(name), "range %s", string(e, "name") ? string(e, "name") : "?");
+			if (add(l, name, number(e, "cycles"), -1))
+				return -1;
+		}
+	for (e = json_get(r, "functions")->child; e; e = e->next) {
+		const char *fn = string(e, "name");
+		const struct json *each = json_get(e, "each"), *c;
+
+		if (!fn || number(e, "calls") <= 0)
+			continue;
+		for (i = 0; i < nprefixes; i++)
+			if (!strncmp(fn, prefixes[i], strlen(prefixes[i])))
+				break;
+		if (i < nprefixes && add(l, fn, number(e, "max"), number(e, "stack")))
+			return -1;
+		if (each)
+			for (c = each->child, i = 0; c; c = c->next, i++) {
+				snprintf(name, sizeof(name), "%s#%u", fn, i);
+				if (add(l, name, number(c, "cycles"), number(c, "stack")))
+					return -1;
+			}
+	}
+	return add(l, "program", -1, number(r, "max_stack"));
+}
+
+static int from_baseline(const struct json *b, const char *path, struct mlist *l)
+{
+	const struct json *a = json_get(b, "measurements"), *e;
+
+	if (!a || a->type != JSON_ARRAY) {
+		fprintf(stderr, "%s: no measurements in the baseline\n", path);
+		return -1;
+	}
+	for (e = a->child; e; e = e->next) {
+		if (!string(e, "name")) {
+			fprintf(stderr, "%s: measurement without a name\n", path);
+			return -1;
+		}
+		if (add(l, string(e, "name"), number(e, "cycles"), number(e, "stack")))
+			return -1;
+	}
+	return 0;
+}
+
+static void json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fputc('\\', f);
+		fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static int write_baseline(const char *path, const struct json *r, const struct mlist *l)
+{
+	FILE *f = fopen(path, "w");
+	unsigned i;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "{\n  \"image\": ");
+	json_string(f, string(r, "image"));
+	if (string(r, "device")) {
+		fprintf(f, ",\n  \"device\": ");
+		json_string(f, string(r, "device"));
+	}
+	fprintf(f, ",\n  \"measurements\": [");
+	for (i = 0; i < l->n; i++) {
+		const struct measurement *m = &l->m[i];
+
+		fprintf(f, "%s\n    { \"name\": ", i ? "," : "");
+		json_string(f, m->name);
+		if (m->cycles >= 0)
+			fprintf(f, ", \"cycles\": %.0f", m->cycles);
+		if (m->stack >= 0)
+			fprintf(f, ", \"stack\": %.0f", m->stack);
+		fprintf(f, " }");
+	}
+	fprintf(f, "%s]\n}\n", l->n ? "\n  " : "");
+	return fclose(f) == 0 ? 0 : -1;
+}
+
+static void print_value(double v)
+{
+	if (v >= 0)
+		printf(" %12.0f", v);
+	else
+		printf(" %12s", "-");
+}
+
+static void usage(FILE *f)
+{
+	fprintf(f,
+		"Usage: cyclebudget [options] -b BASELINE.json RESULTS.json\n"
+		"\n"
+		"Compare the cycles and stack usage in avrsim results with a baseline.\n"
+		"\n"
+		"  -b, --baseline FILE      the baseline (required)\n"
+		"  -u, --update             write the results as the new baseline\n"
+		"  -t, --threshold PCT      cycles allowed above the baseline, in percent\n"
+		"                           (default 0)\n"
+		"  -s, --stack-slack N      stack bytes allowed above the baseline (default 0)\n"
+		"  -f, --func PREFIX        measure the functions whose names start with PREFIX\n"
+		"                           (repeatable, default bench_ and __vector_)\n"
+		"  -q, --quiet              only print the measurements that are not ok\n"
+		"  -h, --help               show this help\n"
+		"\n"
+		"Exit status: 0 if no measurement regressed, 1 if any regressed or is\n"
+		"missing, 2 for usage errors.\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "baseline", required_argument, NULL, 'b' },
+		{ "update", no_argument, NULL, 'u' },
+		{ "threshold", required_argument, NULL, 't' },
+		{ "stack-slack", required_argument, NULL, 's' },
+		{ "func", required_argument, NULL, 'f' },
+		{ "quiet", no_argument, NULL, 'q' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	const char *prefixes[MAX_PREFIXES] = { "bench_", "__vector_" };
+	const char *baseline = NULL;
+	unsigned nprefixes = 0, i, regressed = 0, improved = 0, missing = 0, added = 0;
+	double threshold = 0, slack = 0;
+	int update = 0, quiet = 0, c, status = 0;
+	struct mlist now = { 0 }, base = { 0 };
+	struct json *r, *b;
+	char *end;
+
+	while ((c = getopt_long(argc, argv, "b:ut:s:f:qh", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'b':
+			baseline = optarg;
+			break;
+		case 'u':
+			update = 1;
+			break;
+		case 't':
+		case 's':
+			if (c == 't')
+				threshold = strtod(optarg, &end);
+			else
+				slack = strtod(optarg, &end);
+			if (*end || end == optarg || (c == 't' ? threshold : slack) < 0) {
+				fprintf(stderr, "cyclebudget: bad number '%s'\n", optarg);
+				return 2;
+			}
+			break;
+		case 'f':
+			if (nprefixes == MAX_PREFIXES) {
+				fprintf(stderr, "cyclebudget: too many prefixes\n");
+				return 2;
+			}
+			prefixes[nprefixes++] = optarg;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+	if (optind + 1 != argc || !baseline) {
+		usage(stderr);
+		return 2;
+	}
+	if (!nprefixes)
+		nprefixes = 2;
+
+	if (!(r = json_load(argv[optind])))
+		return 2;
+	if (from_results(r, argv[optind], prefixes, nprefixes, &now)) {
+		json_free(r);
+		return 2;
+	}
+	if (update) {
+		status = write_baseline(baseline, r, &now) ? 2 : 0;
+		if (!status)
+			printf("%s: %u measurements\n", baseline, now.n);
+		json_free(r);
+		mlist_free(&now);
+		return status;
+	}
+	json_free(r);
+
+	if (!(b = json_load(baseline)) || from_baseline(b, baseline, &base)) {
+		json_free(b);
+		mlist_free(&now);
+		return 2;
+	}
+	json_free(b);
+
+	printf("%-32s %12s %12s %8s %12s %12s  %s\n", "measurement", "baseline", "cycles", "change",
+			"base stack", "stack", "status");
+	for (i = 0; i < base.n; i++) {
+		const struct measurement *m = &base.m[i], *n = find(&now, m->name);
+		const char *what = "ok";
+
+		if (!n || (m->cycles >= 0 && n->cycles < 0) || (m->stack >= 0 && n->stack < 0)) {
+			what = "MISSING";
+			missing++;
+		} else if ((m->cycles >= 0 && n->cycles > m->cycles * (1 + threshold / 100))
+				|| (m->stack >= 0 && n->stack > m->stack + slack)) {
+			what = "REGRESSED";
+			regressed++;
+		} else if ((m->cycles >= 0 && n->cycles < m->cycles) || (m->stack >= 0 && n->stack < m->stack)) {
+			what = "improved";
+			improved++;
+		}
+		if (quiet && !strcmp(what, "ok"))
+			continue;
+		printf("%-32s", m->name);
+		print_value(m->cycles);
+		print_value(n ? n->cycles : -1);
+		if (n && m->cycles > 0 && n->cycles >= 0)
+			printf(" %+7.2f%%", 100 * (n->cycles - m->cycles) / m->cycles);
+		else
+			printf(" %8s", "-");
+		print_value(m->stack);
+		print_value(n ? n->stack : -1);
+		printf("  %s\n", what);
+	}
+	for (i = 0; i < now.n; i++)
+		if (!find(&base, now.m[i].name)) {
+			added++;
+			if (quiet)
+				continue;
+			printf("%-32s %12s", now.m[i].name, "-");
+			print_value(now.m[i].cycles);
+			printf(" %8s %12s", "-", "-");
+			print_value(now.m[i].stack);
+			printf("  new\n");
+		}
+	printf("%u measurements: %u regressed, %u missing, %u improved, %u not in the baseline\n",
+			base.n, regressed, missing, improved, added);
+	if (improved && !regressed && !missing)
+		printf("run with --update to lower the baseline\n");
+
+	mlist_free(&now);
+	mlist_free(&base);
+	return regressed || missing ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * hal.c - model of the XMEGA behind the host build of the Class B library.
+ */
+
+#include "hal.h"
+
+#include <string.h>
+
+#include "crc.h"
+
+/* Register values that the library cannot write: the 16-bit CRC registers
+ * hold one of these until the next write, so that every write is seen,
+ * even of the value last read. */
+#define NOT_WRITTEN 0x100
+
+uint8_t hostbench_sram[INTERNAL_SRAM_SIZE];
+uint8_t hostbench_eeprom[EEPROM_SIZE];
+uint8_t hostbench_flash[PROGMEM_SIZE];
+
+volatile uint8_t hostbench_sreg, hostbench_ccp;
+OSC_t hostbench_osc;
+CLK_t hostbench_clk;
+SLEEP_t hostbench_sleep;
+RTC_t hostbench_rtc;
+TC0_t hostbench_tcc0, hostbench_tcf0;
+TC1_t hostbench_tcc1;
+EVSYS_t hostbench_evsys;
+
+static CRC_t crc_regs;
+static NVM_t nvm_regs;
+
+static struct {
+	uint8_t ctrl, status;
+	uint32_t raw;
+} crc;
+
+static int crc32_mode(void)
+{
+	return (crc.ctrl & CRC_CRC32_bm) != 0;
+}
+
+/* Checksum as read by the CPU: the final IEEE 802.3 checksum once a
+ * CRC-32 calculation has completed, the remainder otherwise. */
+static uint32_t crc_checksum(void)
+{
+	if (crc32_mode() && !(crc.status & CRC_BUSY_bm))
+		return ~crc.raw;
+	return crc32_mode() ? crc.raw : (crc.raw & 0xFFFF);
+}
+
+static int crc_source_is(uint8_t source)
+{
+	return (crc.status & CRC_BUSY_bm) && (crc.ctrl & CRC_SOURCE_gm) == source;
+}
+
+static void crc_feed(const uint8_t *buf, uint32_t len)
+{
+	if (crc32_mode())
+		crc.raw = ~crc32_ieee(~crc.raw, buf, len);
+	else
+		crc.raw = crc16_ccitt((uint16_t)crc.raw, buf, len);
+}
+
+static void crc_complete(void)
+{
+	crc.status &= (uint8_t)~CRC_BUSY_bm;
+	if (crc_checksum() == 0)
+		crc.status |= CRC_ZERO_bm;
+	else
+		crc.status &= (uint8_t)~CRC_ZERO_bm;
+}
+
+static void crc_write_ctrl(uint8_t v)
+{
+	/* RESET0 clears the checksum, RESET1 sets all bits; both restart the calculation. */
+	if (v & CRC_RESET_gm) {
+		crc.raw = (v & CRC_RESET_gm) == CRC_RESET_RESET1_gc ? 0xFFFFFFFF : 0;
+		crc.status = 0;
+	}
+	/* The polynomial cannot be changed while busy. */
+	if (crc.status & CRC_BUSY_bm)
+		v = (uint8_t)((v & ~CRC_CRC32_bm) | (crc.ctrl & CRC_CRC32_bm));
+	if ((v & CRC_SOURCE_gm) && ((v & CRC_RESET_gm) || (v & CRC_SOURCE_gm) != (crc.ctrl & CRC_SOURCE_gm)))
+		crc.status |= CRC_BUSY_bm;
+	crc.ctrl = v & (CRC_CRC32_bm | CRC_SOURCE_gm);
+}
+
+static void crc_publish(void)
+{
+	uint32_t sum = crc_checksum();
+
+	crc_regs.CTRL = crc.ctrl;
+	crc_regs.STATUS = crc.status & (uint8_t)~CRC_BUSY_bm;
+	crc_regs.DATAIN = NOT_WRITTEN;
+	crc_regs.CHECKSUM0 = NOT_WRITTEN | (uint8_t)sum;
+	crc_regs.CHECKSUM1 = NOT_WRITTEN | (uint8_t)(sum >> 8);
+	crc_regs.CHECKSUM2 = NOT_WRITTEN | (uint8_t)(sum >> 16);
+	crc_regs.CHECKSUM3 = NOT_WRITTEN | (uint8_t)(sum >> 24);
+}
+
+/* Apply the access made since the last call, which wrote one register at most. */
+static void crc_sync(void)
+{
+	register16_t *sum[4] = {
+		&crc_regs.CHECKSUM0, &crc_regs.CHECKSUM1, &crc_regs.CHECKSUM2, &crc_regs.CHECKSUM3,
+	};
+	unsigned i;
+
+	if (crc_regs.CTRL != crc.ctrl)
+		crc_write_ctrl(crc_regs.CTRL);
+	/* Writing one to BUSY ends an I/O calculation; it reads zero. */
+	if ((crc_regs.STATUS & CRC_BUSY_bm) && crc_source_is(CRC_SOURCE_IO_gc))
+		crc_complete();
+	if (!(crc_regs.DATAIN & NOT_WRITTEN) && crc_source_is(CRC_SOURCE_IO_gc)) {
+		uint8_t v = (uint8_t)crc_regs.DATAIN;
+
+		crc_feed(&v, 1);
+	}
+	for (i = 0; i < 4; i++)
+		if (!(*sum[i] & NOT_WRITTEN))
+			crc.raw = (crc.raw & ~(0xFFu << 8 * i)) | (uint32_t)(uint8_t)*sum[i] << 8 * i;
+	crc_publish();
+}
+
+CRC_t *hostbench_crc(void)
+{
+	crc_sync();
+	return &crc_regs;
+}
+
+static uint32_t nvm_reg24(register8_t *r)
+{
+	return r[0] | (uint32_t)r[1] << 8 | (uint32_t)r[2] << 16;
+}
+
+static void nvm_flash_crc(uint8_t cmd)
+{
+	uint32_t start, end;
+
+	switch (cmd) {
+	case NVM_CMD_APP_CRC_gc:
+		start = 0;
+		end = APP_SECTION_SIZE - 1;
+		break;
+	case NVM_CMD_BOOT_CRC_gc:
+		start = BOOT_SECTION_START;
+		end = BOOT_SECTION_START + BOOT_SECTION_SIZE - 1;
+		break;
+	default:
+		start = nvm_reg24(&nvm_regs.ADDR0) & ~1u;
+		end = nvm_reg24(&nvm_regs.DATA0) | 1u;
+		break;
+	}
+	if (end >= PROGMEM_SIZE || start > end)
+		return;
+	crc_sync();
+	if (crc_source_is(CRC_SOURCE_FLASH_gc)) {
+		crc_feed(hostbench_flash + start, end - start + 1);
+		crc_complete();
+		crc_publish();
+	}
+}
+
+/* Run the command of a CMDEX write made since the last call. */
+static void nvm_sync(void)
+{
+	if (nvm_regs.CTRLA & NVM_CMDEX_bm) {
+		nvm_regs.CTRLA = 0;
+		if (hostbench_ccp == CCP_IOREG_gc) {
+			switch (nvm_regs.CMD) {
+			case NVM_CMD_APP_CRC_gc:
+			case NVM_CMD_BOOT_CRC_gc:
+			case NVM_CMD_FLASH_RANGE_CRC_gc:
+				nvm_flash_crc(nvm_regs.CMD);
+				break;
+			}
+		}
+		hostbench_ccp = 0;
+	}
+	nvm_regs.STATUS = 0;
+}
+
+NVM_t *hostbench_nvm(void)
+{
+	nvm_sync();
+	return &nvm_regs;
+}
+
+void hal_reset(void)
+{
+	static int initialized;
+
+	if (!initialized) {
+		crc_init();
+		initialized = 1;
+	}
+	hostbench_sreg = hostbench_ccp = 0;
+	memset(&hostbench_osc, 0, sizeof(hostbench_osc));
+	memset(&hostbench_clk, 0, sizeof(hostbench_clk));
+	memset(&hostbench_sleep, 0, sizeof(hostbench_sleep));
+	memset(&hostbench_rtc, 0, sizeof(hostbench_rtc));
+	memset(&hostbench_tcc0, 0, sizeof(hostbench_tcc0));
+	memset(&hostbench_tcc1, 0, sizeof(hostbench_tcc1));
+	memset(&hostbench_tcf0, 0, sizeof(hostbench_tcf0));
+	memset(&hostbench_evsys, 0, sizeof(hostbench_evsys));
+	memset(&nvm_regs, 0, sizeof(nvm_regs));
+	memset(&crc, 0, sizeof(crc));
+	hostbench_osc.STATUS = OSC_RC2MRDY_bm | OSC_RC32MRDY_bm | OSC_RC32KRDY_bm;
+	crc_publish();
+}
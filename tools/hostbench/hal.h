@@ -0,0 +1,22 @@
+/*
+ * hal.h - model of the XMEGA behind the host build of the Class B library.
+ *
+ * The memories and registers that include/avr/io.h declares live here.
+ * The CRC module follows the avrsim model: I/O and Flash sources, CRC-16
+ * and CRC-32, reset to zero or all ones. A calculation completes as soon
+ * as its data has been fed, so STATUS never reads busy. The NVM controller
+ * runs the Flash CRC commands (application, boot, range) when CTRLA.CMDEX
+ * is written after the CCP I/O key; other commands are ignored and the
+ * controller is never busy.
+ */
+
+#ifndef HOSTBENCH_HAL_H
+#define HOSTBENCH_HAL_H
+
+#include <avr/io.h>
+
+/* Clear the registers and the models, and mark the oscillators ready. The
+ * memories keep their contents. */
+void hal_reset(void);
+
+#endif
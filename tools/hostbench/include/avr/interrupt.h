@@ -0,0 +1,20 @@
+/*
+ * avr/interrupt.h - interrupt control for building the Class B library on
+ * the host.
+ *
+ * cli() and sei() change the I bit of the modelled SREG. An interrupt
+ * handler is an ordinary function named after its vector, see avr/io.h,
+ * which the benchmarks call directly.
+ */
+
+#ifndef HOSTBENCH_AVR_INTERRUPT_H
+#define HOSTBENCH_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define cli() ((void)(SREG &= (uint8_t)~CPU_I_bm))
+#define sei() ((void)(SREG |= CPU_I_bm))
+
+#define ISR(vector, ...) void vector(void); void vector(void)
+
+#endif
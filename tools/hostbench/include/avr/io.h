@@ -0,0 +1,258 @@
+/*
+ * avr/io.h - XMEGA registers for building the Class B library on the host.
+ *
+ * The device is an ATxmega128A1: 8 KB of SRAM, 2 KB of EEPROM and 128 KB
+ * of application Flash plus an 8 KB boot section. The memories are arrays
+ * of the model in hal.c: the SRAM and the mapped EEPROM are addressed
+ * through their host addresses, the Flash through the byte addresses that
+ * the library passes to pgm_read_byte_far().
+ *
+ * Only the registers of the modules built on the host are declared. Most
+ * are plain variables. The CRC module and the NVM controller act on
+ * writes, so their register blocks are reached through a function that
+ * first brings the model up to date with the previous access: every
+ * access to them calls it once, before the access itself. Bit masks and
+ * group configurations have the values of the device header.
+ */
+
+#ifndef HOSTBENCH_AVR_IO_H
+#define HOSTBENCH_AVR_IO_H
+
+#include <stdint.h>
+
+typedef volatile uint8_t register8_t;
+typedef volatile uint16_t register16_t;
+
+/* Memories. */
+#define INTERNAL_SRAM_SIZE   8192
+#define INTERNAL_SRAM_START  ((uintptr_t)hostbench_sram)
+#define INTERNAL_SRAM_END    (INTERNAL_SRAM_START + INTERNAL_SRAM_SIZE - 1)
+#define EEPROM_SIZE          2048
+#define MAPPED_EEPROM_START  ((uintptr_t)hostbench_eeprom)
+#define PROGMEM_SIZE         0x22000UL
+#define PROGMEM_PAGE_SIZE    512U
+#define APP_SECTION_SIZE     0x20000UL
+#define BOOT_SECTION_START   0x20000UL
+#define BOOT_SECTION_SIZE    0x2000UL
+
+extern uint8_t hostbench_sram[INTERNAL_SRAM_SIZE];
+extern uint8_t hostbench_eeprom[EEPROM_SIZE];
+extern uint8_t hostbench_flash[PROGMEM_SIZE];
+
+/* CPU. */
+extern volatile uint8_t hostbench_sreg, hostbench_ccp;
+#define SREG hostbench_sreg
+#define CCP  hostbench_ccp
+
+#define CPU_I_bm        0x80
+#define CCP_SPM_gc      0x9D
+#define CCP_IOREG_gc    0xD8
+
+/* Oscillators and clock system. */
+typedef struct OSC_struct {
+	register8_t CTRL;
+	register8_t STATUS;
+} OSC_t;
+
+typedef struct CLK_struct {
+	register8_t CTRL;
+	register8_t PSCTRL;
+	register8_t LOCK;
+	register8_t RTCCTRL;
+} CLK_t;
+
+extern OSC_t hostbench_osc;
+extern CLK_t hostbench_clk;
+#define OSC hostbench_osc
+#define CLK hostbench_clk
+
+#define OSC_RC2MEN_bm       0x01
+#define OSC_RC32MEN_bm      0x02
+#define OSC_RC32KEN_bm      0x04
+#define OSC_RC2MRDY_bm      0x01
+#define OSC_RC32MRDY_bm     0x02
+#define OSC_RC32KRDY_bm     0x04
+#define CLK_RTCEN_bm        0x01
+#define CLK_RTCSRC_ULP_gc   (0x00 << 1)
+#define CLK_RTCSRC_TOSC_gc  (0x01 << 1)
+#define CLK_RTCSRC_RCOSC_gc (0x02 << 1)
+
+/* Sleep controller. */
+typedef struct SLEEP_struct {
+	register8_t CTRL;
+} SLEEP_t;
+
+extern SLEEP_t hostbench_sleep;
+#define SLEEP hostbench_sleep
+
+#define SLEEP_SMODE_IDLE_gc  (0x00 << 1)
+#define SLEEP_SEN_bm         0x01
+
+/* RTC. */
+typedef struct RTC_struct {
+	register8_t CTRL;
+	register8_t STATUS;
+	register8_t INTCTRL;
+	register8_t INTFLAGS;
+	register8_t TEMP;
+	register16_t CNT;
+	register16_t PER;
+	register16_t COMP;
+} RTC_t;
+
+extern RTC_t hostbench_rtc;
+#define RTC hostbench_rtc
+
+#define RTC_PRESCALER_DIV1_gc   0x01
+#define RTC_SYNCBUSY_bm         0x01
+#define RTC_COMPINTLVL_OFF_gc   (0x00 << 2)
+#define RTC_COMPINTLVL_LO_gc    (0x01 << 2)
+#define RTC_OVFIF_bm            0x01
+#define RTC_COMPIF_bm           0x02
+
+/* Timer/counter 0. */
+typedef struct TC0_struct {
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t INTCTRLA;
+	register8_t INTFLAGS;
+	register8_t CTRLD;
+	register8_t INTCTRLB;
+	register16_t CNT;
+	register16_t PER;
+	register16_t CCA;
+	register16_t CCB;
+} TC0_t;
+
+extern TC0_t hostbench_tcc0, hostbench_tcf0;
+#define TCC0 hostbench_tcc0
+#define TCF0 hostbench_tcf0
+
+#define TC0_CCAEN_bm         0x10
+#define TC0_CCAIF_bm         0x10
+#define TC0_EVDLY_bm         0x10
+#define TC_EVACT_CAPT_gc     0x20
+#define TC_EVSEL_CH6_gc      0x0E
+#define TC_CLKSEL_EVCH5_gc   0x0D
+#define TC_CCBINTLVL_LO_gc   0x04
+
+/* Timer/counter 1, with the registers the library uses. */
+typedef struct TC1_struct {
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t INTCTRLA;
+	register8_t INTCTRLB;
+	register8_t INTFLAGS;
+	register16_t CNT;
+	register16_t PER;
+	register16_t CCA;
+} TC1_t;
+
+extern TC1_t hostbench_tcc1;
+#define TCC1 hostbench_tcc1
+
+#define TC1_CCAIF_bm         0x10
+#define TC_CCAINTLVL_OFF_gc  0x00
+#define TC_CCAINTLVL_LO_gc   0x01
+
+#define TC_CLKSEL_OFF_gc     0x00
+#define TC_CLKSEL_DIV1_gc    0x01
+#define TC_CLKSEL_DIV2_gc    0x02
+#define TC_CLKSEL_DIV4_gc    0x03
+#define TC_CLKSEL_DIV8_gc    0x04
+#define TC_CLKSEL_DIV64_gc   0x05
+#define TC_CLKSEL_DIV256_gc  0x06
+#define TC_CLKSEL_DIV1024_gc 0x07
+#define TC_OVFINTLVL_OFF_gc  0x00
+#define TC_OVFINTLVL_LO_gc   0x01
+
+/* Event system, with the channels the library uses. */
+typedef struct EVSYS_struct {
+	register8_t CH5MUX;
+	register8_t CH6MUX;
+} EVSYS_t;
+
+extern EVSYS_t hostbench_evsys;
+#define EVSYS hostbench_evsys
+
+#define EVSYS_CHMUX_RTC_CMP_gc  0x09
+#define EVSYS_CHMUX_TCC0_OVF_gc 0xC0
+
+/* CRC module. CHECKSUM0..3 and DATAIN are wider than on the device, so
+ * that the model sees every write to them; the library masks the reads. */
+typedef struct CRC_struct {
+	register8_t CTRL;
+	register8_t STATUS;
+	register16_t DATAIN;
+	register16_t CHECKSUM0;
+	register16_t CHECKSUM1;
+	register16_t CHECKSUM2;
+	register16_t CHECKSUM3;
+} CRC_t;
+
+CRC_t *hostbench_crc(void);
+#define CRC (*hostbench_crc())
+
+#define CRC_CTRL      CRC.CTRL
+#define CRC_STATUS    CRC.STATUS
+#define CRC_DATAIN    CRC.DATAIN
+#define CRC_CHECKSUM0 CRC.CHECKSUM0
+#define CRC_CHECKSUM1 CRC.CHECKSUM1
+#define CRC_CHECKSUM2 CRC.CHECKSUM2
+#define CRC_CHECKSUM3 CRC.CHECKSUM3
+
+#define CRC_RESET_gm        0xC0
+#define CRC_RESET_NO_gc     (0x00 << 6)
+#define CRC_RESET_RESET0_gc (0x02 << 6)
+#define CRC_RESET_RESET1_gc (0x03 << 6)
+#define CRC_CRC32_bm        0x20
+#define CRC_SOURCE_gm       0x0F
+#define CRC_BUSY_bm         0x01
+#define CRC_ZERO_bm         0x02
+
+typedef enum CRC_SOURCE_enum {
+	CRC_SOURCE_DISABLE_gc = 0x00,
+	CRC_SOURCE_IO_gc = 0x01,
+	CRC_SOURCE_FLASH_gc = 0x02,
+	CRC_SOURCE_DMAC0_gc = 0x04,
+	CRC_SOURCE_DMAC1_gc = 0x05,
+	CRC_SOURCE_DMAC2_gc = 0x06,
+	CRC_SOURCE_DMAC3_gc = 0x07,
+} CRC_SOURCE_t;
+
+/* NVM controller. */
+typedef struct NVM_struct {
+	register8_t ADDR0;
+	register8_t ADDR1;
+	register8_t ADDR2;
+	register8_t DATA0;
+	register8_t DATA1;
+	register8_t DATA2;
+	register8_t CMD;
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t INTCTRL;
+	register8_t STATUS;
+	register8_t LOCKBITS;
+} NVM_t;
+
+NVM_t *hostbench_nvm(void);
+#define NVM (*hostbench_nvm())
+
+#define NVM_CMDEX_bm    0x01
+#define NVM_EEMAPEN_bm  0x08
+#define NVM_NVMBUSY_bm  0x80
+
+typedef enum NVM_CMD_enum {
+	NVM_CMD_NO_OPERATION_gc = 0x00,
+	NVM_CMD_APP_CRC_gc = 0x38,
+	NVM_CMD_BOOT_CRC_gc = 0x39,
+	NVM_CMD_FLASH_RANGE_CRC_gc = 0x3A,
+} NVM_CMD_t;
+
+/* Interrupt vectors: the handlers are functions of these names. */
+#define TCC0_OVF_vect hostbench_tcc0_ovf_vect
+#define TCF0_CCB_vect hostbench_tcf0_ccb_vect
+#define RTC_COMP_vect hostbench_rtc_comp_vect
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * avr/pgmspace.h - program memory access for building the Class B library
+ * on the host.
+ *
+ * Tables declared PROGMEM are ordinary constants, so the near reads
+ * dereference their argument. The far reads take a Flash byte address and
+ * read the modelled Flash, see avr/io.h.
+ */
+
+#ifndef HOSTBENCH_AVR_PGMSPACE_H
+#define HOSTBENCH_AVR_PGMSPACE_H
+
+#include <stdint.h>
+
+#include <avr/io.h>
+
+/* __progmem__ becomes an attribute that changes nothing. */
+#define PROGMEM
+#define __progmem__ __unused__
+
+typedef const char *PGM_P;
+#define PSTR(s) (s)
+
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+
+static inline uint16_t hostbench_flash_word(uint32_t addr)
+{
+	return (uint16_t)(hostbench_flash[addr] | hostbench_flash[addr + 1] << 8);
+}
+
+static inline uint32_t hostbench_flash_dword(uint32_t addr)
+{
+	return hostbench_flash_word(addr) | (uint32_t)hostbench_flash_word(addr + 2) << 16;
+}
+
+#define pgm_read_byte_far(a)  (hostbench_flash[(uint32_t)(a)])
+#define pgm_read_word_far(a)  (hostbench_flash_word((uint32_t)(a)))
+#define pgm_read_dword_far(a) (hostbench_flash_dword((uint32_t)(a)))
+
+#endif
@@ -0,0 +1,11 @@
+/*
+ * avr/sleep.h - sleep instruction for building the Class B library on the
+ * host, where it returns at once.
+ */
+
+#ifndef HOSTBENCH_AVR_SLEEP_H
+#define HOSTBENCH_AVR_SLEEP_H
+
+#define sleep_cpu() ((void)0)
+
+#endif
@@ -0,0 +1,11 @@
+/*
+ * avr/wdt.h - watchdog reset for building the Class B library on the host,
+ * where there is no watchdog to reset.
+ */
+
+#ifndef HOSTBENCH_AVR_WDT_H
+#define HOSTBENCH_AVR_WDT_H
+
+#define wdt_reset() ((void)0)
+
+#endif
@@ -0,0 +1,445 @@
+/*
+ * hostbench - microbenchmarks of the Class B library built for the host.
+ *
+ * The library sources are compiled unchanged against the register model
+ * of hal.c and timed call by call. Every benchmark also checks what it
+ * ran: the checksums against common/crc.c, the SRAM contents across the
+ * SRAM test, and classb_error, so a change that breaks a test is reported
+ * along with its timing.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hal.h"
+#include "crc.h"
+
+#include "avr_compiler.h"
+#include "classb_crc.h"
+#include "classb_freq.h"
+#include "classb_interrupt_monitor.h"
+#include "classb_rtc_common.h"
+#include "classb_scheduler.h"
+#include "classb_sram.h"
+
+/* EEPROM layout: data, reference checksums, Flash page map. */
+#define EE_DATA     0
+#define EE_BYTES    1024
+#define EE_CRC16    1024
+#define EE_CRC32    1028
+#define EE_FCRC16   1032
+#define EE_FCRC32   1036
+#define EE_PCRC32   1040
+#define EE_PAGEMAP  1044
+#define MAX_PAGES   ((EEPROM_SIZE - EE_PAGEMAP) / 4)
+
+#define RAM_REGION  1024
+
+NO_INIT volatile uint8_t classb_error;
+
+void RTC_COMP_vect(void);
+
+struct bench {
+	const char *name;
+	void (*prepare)(void);
+	uint32_t (*run)(void);      /* one operation, returns its result */
+	unsigned calls;             /* library calls per operation */
+	uint32_t bytes;             /* bytes per operation, 0 if not per byte */
+	uint32_t want;              /* expected result */
+	int check;                  /* compare the result with want */
+};
+
+static uint32_t flash_bytes = 65536;
+static uint16_t pages;
+static uint8_t sram_copy[INTERNAL_SRAM_SIZE];
+
+static void put32(uint16_t addr, uint32_t v)
+{
+	memcpy(&hostbench_eeprom[addr], &v, 4);
+}
+
+static void prepare_sram(void)
+{
+	memcpy(sram_copy, hostbench_sram, sizeof(sram_copy));
+}
+
+static uint32_t run_sram_test(void)
+{
+	unsigned i;
+
+	for (i = 0; i < CLASSB_NSEC_TOTAL; i++)
+		classb_sram_test();
+	return 0;
+}
+
+static uint32_t run_marchx(void)
+{
+	volatile uint8_t *p = (volatile uint8_t *)INTERNAL_SRAM_START + INTERNAL_SRAM_SIZE / 2;
+
+	classb_marchX(p, p, 1024);
+	return 0;
+}
+
+static uint32_t run_crc16_flash_sw(void)
+{
+	return CLASSB_CRC16_Flash_SW(0, flash_bytes, (eeprom_uint16ptr_t)EE_FCRC16);
+}
+
+static uint32_t run_crc32_flash_sw(void)
+{
+	return CLASSB_CRC32_Flash_SW(0, flash_bytes, (eeprom_uint32ptr_t)EE_FCRC32);
+}
+
+static uint32_t run_crc16_eeprom_sw(void)
+{
+	return CLASSB_CRC16_EEPROM_SW((eepromptr_t)EE_DATA, EE_BYTES, (eeprom_uint16ptr_t)EE_CRC16);
+}
+
+static uint32_t run_crc32_eeprom_sw(void)
+{
+	return CLASSB_CRC32_EEPROM_SW((eepromptr_t)EE_DATA, EE_BYTES, (eeprom_uint32ptr_t)EE_CRC32);
+}
+
+static uint32_t run_crc16_flash_hw(void)
+{
+	return CLASSB_CRC16_Flash_HW(0, flash_bytes, (eeprom_uint16ptr_t)EE_FCRC16);
+}
+
+static uint32_t run_crc32_flash_hw(void)
+{
+	return CLASSB_CRC32_Flash_HW(CRC_FLASH_RANGE, 0, flash_bytes, (eeprom_uint32ptr_t)EE_FCRC32);
+}
+
+static uint32_t run_crc16_eeprom_hw(void)
+{
+	return CLASSB_CRC16_EEPROM_HW((eepromptr_t)EE_DATA, EE_BYTES, (eeprom_uint16ptr_t)EE_CRC16);
+}
+
+static uint32_t run_crc32_eeprom_hw(void)
+{
+	return CLASSB_CRC32_EEPROM_HW((eepromptr_t)EE_DATA, EE_BYTES, (eeprom_uint32ptr_t)EE_CRC32);
+}
+
+static uint32_t run_crc32_flash_pages(void)
+{
+	return CLASSB_CRC32_Flash_Pages(0, pages, (eeprom_uint32ptr_t)EE_PAGEMAP, (eeprom_uint32ptr_t)EE_PCRC32);
+}
+
+static void prepare_crc_ram(void)
+{
+	classb_crc_ram_reg_region(MY_RAM_REGION, hostbench_sram, RAM_REGION);
+}
+
+static uint32_t run_crc_ram(void)
+{
+	unsigned i;
+
+	for (i = 0; i < RAM_REGION / CLASSB_CRC_RAM_SLICE; i++)
+		classb_crc_ram_test();
+	return 0;
+}
+
+/* The monitored interrupt is turned off and on again, so that it starts
+ * from a zero counter. */
+static void prepare_intmon(void)
+{
+	if (classb_intmon_s[MY_INTERRUPT] == ON) {
+		classb_intmon_set_state(MY_INTERRUPT, DISABLE);
+		classb_intmon_callback();
+	}
+	classb_intmon_set_state(MY_INTERRUPT, ENABLE);
+	classb_intmon_callback();
+}
+
+/* The interrupt ran exactly as often as expected, so that every period
+ * passes the check. */
+static void intmon_expected(void)
+{
+	classb_intmon_c[MY_INTERRUPT] = PROGMEM_READ_WORD(&classb_intmon_n[MY_INTERRUPT]);
+}
+
+static uint32_t run_intmon_callback(void)
+{
+	intmon_expected();
+	classb_intmon_callback();
+	return 0;
+}
+
+static uint32_t run_intmon_increase(void)
+{
+	classb_intmon_increase(MY_INTERRUPT);
+	return 0;
+}
+
+/* The TCs captured the expected count since the last capture, as if the
+ * RTC period had just elapsed. The first capture is not checked. */
+static void tc_expected(void)
+{
+	static uint32_t capture;
+
+	capture += CLASSB_TC_COUNT_REF;
+	TCC0.CCA = (uint16_t)capture;
+	TCF0.CCA = (uint16_t)(capture >> 16);
+	TCC0.INTFLAGS = TC0_CCAIF_bm;
+}
+
+static uint32_t run_freq_callback(void)
+{
+	tc_expected();
+	classb_freq_callback();
+	return 0;
+}
+
+static bool sched_step(void)
+{
+	return true;
+}
+
+static void prepare_sched(void)
+{
+	classb_sched_setup();
+	classb_sched_reg_task(SCHED_REGISTERS, sched_step, 1, 0);
+}
+
+/* The time does not advance on the host, so the pass is started again by hand. */
+static uint32_t run_sched_run(void)
+{
+	classb_sched_tasks[SCHED_REGISTERS].release = classb_sched_time();
+	classb_sched_run(0xFFFF);
+	return 0;
+}
+
+/* Nothing is due, so the idle hook goes as far as the sleep instruction. */
+static uint32_t run_sched_idle(void)
+{
+	classb_sched_tasks[SCHED_REGISTERS].release = classb_sched_time() + 1;
+	classb_sched_idle(0);
+	return 0;
+}
+
+static uint32_t run_rtc_isr(void)
+{
+	tc_expected();
+	intmon_expected();
+	RTC_COMP_vect();
+	return 0;
+}
+
+static struct bench benches[] = {
+	{ "sram_test", prepare_sram, run_sram_test, CLASSB_NSEC_TOTAL, 0, 0, 0 },
+	{ "marchx_1k", NULL, run_marchx, 1, 1024, 0, 0 },
+	{ "crc16_flash_sw", NULL, run_crc16_flash_sw, 1, 0, 0, 1 },
+	{ "crc32_flash_sw", NULL, run_crc32_flash_sw, 1, 0, 0, 1 },
+	{ "crc16_eeprom_sw", NULL, run_crc16_eeprom_sw, 1, EE_BYTES, 0, 1 },
+	{ "crc32_eeprom_sw", NULL, run_crc32_eeprom_sw, 1, EE_BYTES, 0, 1 },
+	{ "crc16_flash_hw", NULL, run_crc16_flash_hw, 1, 0, 0, 1 },
+	{ "crc32_flash_hw", NULL, run_crc32_flash_hw, 1, 0, 0, 1 },
+	{ "crc16_eeprom_hw", NULL, run_crc16_eeprom_hw, 1, EE_BYTES, 0, 1 },
+	{ "crc32_eeprom_hw", NULL, run_crc32_eeprom_hw, 1, EE_BYTES, 0, 1 },
+	{ "crc32_flash_pages", NULL, run_crc32_flash_pages, 1, 0, 0, 1 },
+	{ "crc_ram_test", prepare_crc_ram, run_crc_ram, RAM_REGION / CLASSB_CRC_RAM_SLICE, RAM_REGION, 0, 0 },
+	{ "intmon_callback", prepare_intmon, run_intmon_callback, 1, 0, 0, 0 },
+	{ "intmon_increase", prepare_intmon, run_intmon_increase, 1, 0, 0, 0 },
+	{ "sched_run", prepare_sched, run_sched_run, 1, 0, 0, 0 },
+	{ "sched_idle", prepare_sched, run_sched_idle, 1, 0, 0, 0 },
+	{ "freq_callback", NULL, run_freq_callback, 1, 0, 0, 0 },
+	{ "rtc_isr", prepare_intmon, run_rtc_isr, 1, 0, 0, 0 },
+};
+
+#define NBENCHES (sizeof(benches) / sizeof(benches[0]))
+
+/* Memory contents and the reference results of the checksum benchmarks. */
+static void setup(void)
+{
+	uint32_t x = 1, i, crc16, crc32;
+
+	for (i = 0; i < PROGMEM_SIZE; i++) {
+		x = x * 1103515245 + 12345;
+		hostbench_flash[i] = (uint8_t)(x >> 16);
+	}
+	memcpy(hostbench_sram, hostbench_flash + APP_SECTION_SIZE, INTERNAL_SRAM_SIZE);
+	memcpy(hostbench_eeprom, hostbench_flash + APP_SECTION_SIZE / 2, EEPROM_SIZE);
+	hal_reset();
+
+	crc16 = crc16_ccitt(0, hostbench_eeprom + EE_DATA, EE_BYTES);
+	crc32 = crc32_ieee(0, hostbench_eeprom + EE_DATA, EE_BYTES);
+	hostbench_eeprom[EE_CRC16] = (uint8_t)crc16;
+	hostbench_eeprom[EE_CRC16 + 1] = (uint8_t)(crc16 >> 8);
+	put32(EE_CRC32, crc32);
+	for (i = 0; i < NBENCHES; i++)
+		if (strstr(benches[i].name, "eeprom"))
+			benches[i].want = strstr(benches[i].name, "crc16") ? crc16 : crc32;
+
+	crc16 = crc16_ccitt(0, hostbench_flash, flash_bytes);
+	crc32 = crc32_ieee(0, hostbench_flash, flash_bytes);
+	hostbench_eeprom[EE_FCRC16] = (uint8_t)crc16;
+	hostbench_eeprom[EE_FCRC16 + 1] = (uint8_t)(crc16 >> 8);
+	put32(EE_FCRC32, crc32);
+	for (i = 0; i < NBENCHES; i++)
+		if (strstr(benches[i].name, "flash")) {
+			benches[i].want = strstr(benches[i].name, "crc16") ? crc16 : crc32;
+			benches[i].bytes = flash_bytes;
+		}
+
+	for (i = 0; i < NBENCHES; i++)
+		if (benches[i].run == run_sram_test)
+			benches[i].bytes = CLASSB_NSECS * CLASSB_SEC_SIZE + (CLASSB_NSECS - 1) * CLASSB_OVERLAP_SIZE
+					+ (CLASSB_SEC_REM ? CLASSB_SEC_REM + CLASSB_OVERLAP_SIZE : 0);
+
+	pages = (uint16_t)(flash_bytes / CLASSB_CRC_PAGE_SIZE);
+	if (pages > MAX_PAGES)
+		pages = MAX_PAGES;
+	for (i = 0; i < pages; i++)
+		put32(EE_PAGEMAP + 4 * i, crc32_ieee(0, hostbench_flash + i * CLASSB_CRC_PAGE_SIZE,
+				CLASSB_CRC_PAGE_SIZE));
+	crc32 = crc32_ieee(0, hostbench_flash, pages * CLASSB_CRC_PAGE_SIZE);
+	put32(EE_PCRC32, crc32);
+	for (i = 0; i < NBENCHES; i++)
+		if (!strcmp(benches[i].name, "crc32_flash_pages")) {
+			benches[i].want = crc32;
+			benches[i].bytes = pages * CLASSB_CRC_PAGE_SIZE;
+		}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Seconds per operation: the best of batches of at least 10 ms each, run
+ * for about the given time in total. */
+static double measure(const struct bench *b, double time, uint32_t *result)
+{
+	double t0, t, best = 0, start = now();
+	unsigned long n = 1, i;
+
+	do {
+		t0 = now();
+		for (i = 0; i < n; i++)
+			*result = b->run();
+		t = now() - t0;
+		if (t < 0.01) {
+			n *= 2;
+			continue;
+		}
+		if (!best || t / n < best)
+			best = t / n;
+	} while (!best || now() - start < time);
+	return best;
+}
+
+static void usage(FILE *f)
+{
+	unsigned i;
+
+	fprintf(f,
+		"Usage: hostbench [options] [BENCHMARK...]\n"
+		"\n"
+		"Time the Class B library built for the host against its register model.\n"
+		"\n"
+		"  -t, --time SECONDS       time per benchmark (default 0.2)\n"
+		"  -n, --bytes N            bytes of Flash for the Flash CRCs (default 65536)\n"
+		"  -l, --list               list the benchmarks\n"
+		"  -h, --help               show this help\n"
+		"\n"
+		"Benchmarks:");
+	for (i = 0; i < NBENCHES; i++)
+		fprintf(f, " %s", benches[i].name);
+	fprintf(f, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "time", required_argument, NULL, 't' },
+		{ "bytes", required_argument, NULL, 'n' },
+		{ "list", no_argument, NULL, 'l' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	double time = 0.2;
+	unsigned long v;
+	unsigned i;
+	char *end;
+	int c, j, status = 0;
+
+	while ((c = getopt_long(argc, argv, "t:n:lh", longopts, NULL)) != -1) {
+		switch (c) {
+		case 't':
+			time = strtod(optarg, &end);
+			if (*end || !(time > 0)) {
+				fprintf(stderr, "hostbench: bad time '%s'\n", optarg);
+				return 2;
+			}
+			break;
+		case 'n':
+			v = strtoul(optarg, &end, 0);
+			if (*end || !v || v > APP_SECTION_SIZE || v % 2) {
+				fprintf(stderr, "hostbench: bad byte count '%s'\n", optarg);
+				return 2;
+			}
+			flash_bytes = (uint32_t)v;
+			break;
+		case 'l':
+			for (i = 0; i < NBENCHES; i++)
+				printf("%s\n", benches[i].name);
+			return 0;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+	for (j = optind; j < argc; j++) {
+		for (i = 0; i < NBENCHES; i++)
+			if (!strcmp(argv[j], benches[i].name))
+				break;
+		if (i == NBENCHES) {
+			fprintf(stderr, "hostbench: unknown benchmark '%s'\n", argv[j]);
+			return 2;
+		}
+	}
+
+	setup();
+	printf("%-20s %8s %12s %10s  %s\n", "benchmark", "bytes", "ns/call", "ns/byte", "check");
+	for (i = 0; i < NBENCHES; i++) {
+		const struct bench *b = &benches[i];
+		uint32_t result = 0;
+		double t;
+		int ok;
+
+		if (optind < argc) {
+			for (j = optind; j < argc; j++)
+				if (!strcmp(argv[j], b->name))
+					break;
+			if (j == argc)
+				continue;
+		}
+		classb_error = 0;
+		if (b->prepare)
+			b->prepare();
+		t = measure(b, time, &result);
+		ok = !classb_error && (!b->check || result == b->want);
+		if (b->prepare == prepare_sram)
+			ok = ok && !memcmp(sram_copy, hostbench_sram, sizeof(sram_copy));
+		printf("%-20s %8lu %12.1f", b->name, (unsigned long)b->bytes, t * 1e9 / b->calls);
+		if (b->bytes)
+			printf(" %10.3f", t * 1e9 / b->bytes);
+		else
+			printf(" %10s", "-");
+		printf("  %s\n", ok ? "ok" : "FAILED");
+		if (!ok)
+			status = 1;
+	}
+	return status;
+}
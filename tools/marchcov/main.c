@@ -0,0 +1,568 @@
+/*
+ * marchcov - fault coverage campaigns for the SRAM tests.
+ *
+ * Simulates a set of test configurations, each a March test with its data
+ * backgrounds and a section schedule as classb_sram_test() runs it
+ * (CLASSB_NSECS sections, CLASSB_OVERLAP percent overlap), against every
+ * fault of the chosen classes, and reports per configuration and class the
+ * fault coverage as a function of the time spent testing. The work is
+ * spread over all cores by a work-stealing pool.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bitsim.h"
+#include "faultset.h"
+#include "march.h"
+#include "memfault.h"
+#include "pool.h"
+
+#define MAX_CONFIGS  64
+#define MAX_TESTS    16
+#define MAX_SCHEDULES 16
+#define MAX_SECTIONS 256            /* current_section is a uint8_t */
+#define NBINS        65             /* detection times by bit length */
+#define CHUNK        (64 * BITSIM_LANES)
+
+/* One call of classb_marchX(): bytes first..first+count-1 of the SRAM. */
+struct section {
+	uint32_t first, count;
+	uint64_t save;              /* operations before the test: saving to the buffer */
+	uint64_t start;             /* cycles from the start of the round */
+};
+
+struct config {
+	const char *test_arg, *bg_arg;
+	struct march_test test;
+	struct march_background bg[MARCH_MAX_BACKGROUNDS];
+	unsigned nbg;
+	unsigned nsecs, overlap;
+	struct section sec[MAX_SECTIONS];
+	unsigned nsec;
+	uint64_t round;             /* cycles of all sections, periods included */
+};
+
+struct result {
+	uint64_t faults, detected;
+	uint64_t hist[NBINS];       /* detected faults by bit length of the time */
+};
+
+struct campaign {
+	struct config *cfg;
+	unsigned ncfg;
+	struct faultset fs;
+	uint64_t chunks;            /* tasks per configuration */
+	uint64_t op_cycles;
+	struct bitsim *sim;         /* per worker */
+	struct result *res;         /* per worker, configuration and class */
+};
+
+static int parse_u64(const char *s, uint64_t *v)
+{
+	char *end;
+
+	if (!*s)
+		return -1;
+	*v = strtoull(s, &end, 0);
+	/* Allow 1e6 style numbers. */
+	if (*end == 'e' || *end == 'E') {
+		long e = strtol(end + 1, &end, 10);
+
+		while (e-- > 0)
+			*v *= 10;
+	}
+	return *end ? -1 : 0;
+}
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned bit_length(uint64_t v)
+{
+	unsigned n = 0;
+
+	while (v) {
+		n++;
+		v >>= 1;
+	}
+	return n;
+}
+
+/* Operations of a test over count bytes. */
+static uint64_t test_ops(const struct config *c, uint32_t count, uint64_t delay)
+{
+	struct bitsim s;
+
+	memset(&s, 0, sizeof(s));
+	s.test = &c->test;
+	s.nbg = c->nbg;
+	s.count = count;
+	s.delay = delay;
+	return bitsim_total_ops(&s);
+}
+
+static void add_section(struct config *c, uint32_t first, uint32_t count, uint32_t size)
+{
+	struct section *sec = &c->sec[c->nsec++];
+
+	if (count > size - first)
+		count = size - first;
+	sec->first = first;
+	sec->count = count;
+}
+
+/* The sections of classb_sram_test(): the buffer at the start of the SRAM
+ * first, then each section from CLASSB_OVERLAP_SIZE bytes before its start,
+ * and the remainder. Every section but the buffer is saved to the buffer
+ * before the test and restored after it. */
+static void schedule(struct config *c, uint32_t size, uint64_t op_cycles, uint64_t period, uint64_t delay)
+{
+	uint32_t sec = size / c->nsecs, rem = size % c->nsecs;
+	uint32_t ovl = (uint32_t)((uint64_t)sec * c->overlap / 100);
+	uint64_t t = 0;
+	unsigned k;
+
+	c->nsec = 0;
+	add_section(c, 0, sec + ovl, size);
+	for (k = 1; k < c->nsecs; k++)
+		add_section(c, k == 1 ? sec : k * sec - ovl, k == 1 ? sec : sec + ovl, size);
+	if (rem)
+		add_section(c, c->nsecs * sec - ovl, rem + ovl, size);
+	for (k = 0; k < c->nsec; k++) {
+		struct section *s = &c->sec[k];
+		uint64_t copy = k ? 2 * (uint64_t)s->count : 0;
+
+		s->save = copy;
+		s->start = t;
+		t += (2 * copy + test_ops(c, s->count, delay)) * op_cycles + period;
+	}
+	c->round = t - period;
+}
+
+static void run_task(void *arg, unsigned worker, unsigned task)
+{
+	struct campaign *cp = arg;
+	const struct config *c = &cp->cfg[task / cp->chunks];
+	struct result *res = &cp->res[((size_t)worker * cp->ncfg + task / cp->chunks) * MF_NTYPES];
+	struct bitsim *s = &cp->sim[worker];
+	uint64_t index = task % cp->chunks * CHUNK, end = index + CHUNK;
+	struct mf_fault faults[BITSIM_LANES];
+	uint64_t time[BITSIM_LANES], found[BITSIM_LANES], t;
+	uint8_t detected[BITSIM_LANES], done[BITSIM_LANES];
+	unsigned n, i, k, left;
+
+	if (end > faultset_size(&cp->fs))
+		end = faultset_size(&cp->fs);
+	s->test = &c->test;
+	s->bg = c->bg;
+	s->nbg = c->nbg;
+	while (index < end) {
+		for (n = 0; n < BITSIM_LANES && index < end; index++)
+			if (faultset_get(&cp->fs, index, &faults[n]))
+				n++;
+		memset(done, 0, sizeof(done));
+		left = n;
+		for (k = 0; k < c->nsec && left; k++) {
+			s->first = c->sec[k].first;
+			s->count = c->sec[k].count;
+			bitsim_run(s, faults, n, detected, time);
+			for (i = 0; i < n; i++) {
+				if (done[i] || !detected[i])
+					continue;
+				done[i] = 1;
+				found[i] = c->sec[k].start + (c->sec[k].save + time[i]) * cp->op_cycles;
+				left--;
+			}
+		}
+		for (i = 0; i < n; i++) {
+			struct result *r = &res[faults[i].type];
+
+			r->faults++;
+			if (!done[i])
+				continue;
+			r->detected++;
+			t = found[i];
+			r->hist[bit_length(t)]++;
+		}
+	}
+}
+
+/* Coverage after a budget of 1 << b cycles. */
+static double coverage(const struct result *r, unsigned b)
+{
+	uint64_t n = 0;
+	unsigned i;
+
+	for (i = 0; i <= b && i < NBINS; i++)
+		n += r->hist[i];
+	return r->faults ? (double)n / r->faults : 0.0;
+}
+
+static int write_csv(const char *path, const struct campaign *cp, const struct result *res, unsigned b0, unsigned b1)
+{
+	FILE *f = fopen(path, "w");
+	unsigned i, t, b;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "test,backgrounds,nsecs,overlap,class,faults,detected,round_cycles");
+	for (b = b0; b <= b1; b++)
+		fprintf(f, ",%llu", 1ULL << b);
+	fprintf(f, "\n");
+	for (i = 0; i < cp->ncfg; i++) {
+		for (t = 0; t < MF_NTYPES; t++) {
+			const struct result *r = &res[i * MF_NTYPES + t];
+
+			if (!r->faults)
+				continue;
+			fprintf(f, "\"%s\",\"%s\",%u,%u,", cp->cfg[i].test_arg, cp->cfg[i].bg_arg, cp->cfg[i].nsecs,
+					cp->cfg[i].overlap);
+			fprintf(f, "%s,%llu,%llu,%llu", mf_type_name(t), (unsigned long long)r->faults,
+					(unsigned long long)r->detected, (unsigned long long)cp->cfg[i].round);
+			for (b = b0; b <= b1; b++)
+				fprintf(f, ",%.6f", coverage(r, b));
+			fprintf(f, "\n");
+		}
+	}
+	return fclose(f) ? -1 : 0;
+}
+
+static int write_json(const char *path, const struct campaign *cp, const struct result *res, unsigned b0, unsigned b1,
+		uint64_t period, double seconds)
+{
+	FILE *f = fopen(path, "w");
+	unsigned i, t, b, first;
+	char buf[512];
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "{\n  \"base\": %lu,\n  \"size\": %lu,\n  \"distance\": %u,\n",
+			(unsigned long)cp->fs.base, (unsigned long)cp->fs.size, cp->fs.distance);
+	fprintf(f, "  \"op_cycles\": %llu,\n  \"period\": %llu,\n  \"seconds\": %.3f,\n  \"budgets\": [",
+			(unsigned long long)cp->op_cycles, (unsigned long long)period, seconds);
+	for (b = b0; b <= b1; b++)
+		fprintf(f, "%s%llu", b > b0 ? ", " : "", 1ULL << b);
+	fprintf(f, "],\n  \"configs\": [");
+	for (i = 0; i < cp->ncfg; i++) {
+		const struct config *c = &cp->cfg[i];
+
+		march_format(&c->test, 1, buf, sizeof(buf));
+		fprintf(f, "%s\n    {\n      \"test\": \"%s\",\n      \"notation\": \"%s\",\n", i ? "," : "",
+				c->test_arg, buf);
+		fprintf(f, "      \"backgrounds\": \"%s\",\n      \"nsecs\": %u,\n      \"overlap\": %u,\n",
+				c->bg_arg, c->nsecs, c->overlap);
+		fprintf(f, "      \"round_cycles\": %llu,\n      \"classes\": {", (unsigned long long)c->round);
+		first = 1;
+		for (t = 0; t < MF_NTYPES; t++) {
+			const struct result *r = &res[i * MF_NTYPES + t];
+
+			if (!r->faults)
+				continue;
+			fprintf(f, "%s\n        \"%s\": { \"faults\": %llu, \"detected\": %llu, \"coverage\": [",
+					first ? "" : ",", mf_type_name(t), (unsigned long long)r->faults,
+					(unsigned long long)r->detected);
+			for (b = b0; b <= b1; b++)
+				fprintf(f, "%s%.6f", b > b0 ? ", " : "", coverage(r, b));
+			fprintf(f, "] }");
+			first = 0;
+		}
+		fprintf(f, "\n      }\n    }");
+	}
+	fprintf(f, "\n  ]\n}\n");
+	return fclose(f) ? -1 : 0;
+}
+
+static void usage(FILE *f)
+{
+	fprintf(f,
+		"Usage: marchcov [options]\n"
+		"\n"
+		"Fault coverage of SRAM test configurations against the time spent testing.\n"
+		"\n"
+		"  -a, --algorithm TEST[/BG] built-in test or March notation, with its data\n"
+		"                           backgrounds as in marchsim (default 0; repeatable,\n"
+		"                           default march-c-/bits, march-b, march-x, march-x-iw)\n"
+		"  -S, --sections N:OVERLAP CLASSB_NSECS and CLASSB_OVERLAP of the section\n"
+		"                           schedule (repeatable, default 1:0 and 8:25)\n"
+		"  -B, --base ADDR          first byte of the SRAM (default 0x2000)\n"
+		"  -s, --size N             bytes of the SRAM (default 8192)\n"
+		"  -c, --classes LIST       fault classes of memfault.h, or all (default all)\n"
+		"  -n, --distance N         coupling faults: aggressors within N bytes of the\n"
+		"                           victim (default 1)\n"
+		"  -r, --retention N        drf: retention time in operations (default 1e6)\n"
+		"  -y, --delay N            operations a del stands for (default 1e7)\n"
+		"  -i, --init BYTE          SRAM contents outside the test (default 0)\n"
+		"  -C, --op-cycles N        CPU cycles per test operation (default 1, so the\n"
+		"                           times are in operations)\n"
+		"  -p, --period N           cycles between two sections (default 0)\n"
+		"  -j, --jobs N             worker threads (default: one per core)\n"
+		"  -o, --csv FILE           write the coverage matrix as CSV\n"
+		"  -J, --json FILE          write the coverage matrix as JSON\n"
+		"  -h, --help               show this help\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "algorithm", required_argument, NULL, 'a' },
+		{ "sections", required_argument, NULL, 'S' },
+		{ "base", required_argument, NULL, 'B' },
+		{ "size", required_argument, NULL, 's' },
+		{ "classes", required_argument, NULL, 'c' },
+		{ "distance", required_argument, NULL, 'n' },
+		{ "retention", required_argument, NULL, 'r' },
+		{ "delay", required_argument, NULL, 'y' },
+		{ "init", required_argument, NULL, 'i' },
+		{ "op-cycles", required_argument, NULL, 'C' },
+		{ "period", required_argument, NULL, 'p' },
+		{ "jobs", required_argument, NULL, 'j' },
+		{ "csv", required_argument, NULL, 'o' },
+		{ "json", required_argument, NULL, 'J' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	static const char *const default_tests[] = { "march-c-/bits", "march-b", "march-x", "march-x-iw" };
+	static const char *const default_schedules[] = { "1:0", "8:25" };
+	const char *test_args[MAX_TESTS], *sched_args[MAX_SCHEDULES];
+	const char *classes_arg = "all", *csv = NULL, *json = NULL;
+	uint64_t base = 0x2000, size = 8192, distance = 1, retention = 1000000, delay = 10000000;
+	uint64_t init = 0, op_cycles = 1, period = 0, jobs = 0, v, max_round = 0;
+	unsigned ntests = 0, nscheds = 0, classes, i, j, t, w, b, b0, b1;
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	static struct config cfg[MAX_CONFIGS];
+	struct campaign cp;
+	struct result *res;
+	struct pool pool;
+	double t0, seconds;
+	int c, status = 0;
+
+	while ((c = getopt_long(argc, argv, "a:S:B:s:c:n:r:y:i:C:p:j:o:J:h", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'a':
+			if (ntests == MAX_TESTS) {
+				fprintf(stderr, "marchcov: too many tests\n");
+				return 2;
+			}
+			test_args[ntests++] = optarg;
+			break;
+		case 'S':
+			if (nscheds == MAX_SCHEDULES) {
+				fprintf(stderr, "marchcov: too many section schedules\n");
+				return 2;
+			}
+			sched_args[nscheds++] = optarg;
+			break;
+		case 'c':
+			classes_arg = optarg;
+			break;
+		case 'B':
+		case 's':
+		case 'n':
+		case 'r':
+		case 'y':
+		case 'i':
+		case 'C':
+		case 'p':
+		case 'j':
+			if (parse_u64(optarg, &v)) {
+				fprintf(stderr, "marchcov: bad number '%s'\n", optarg);
+				return 2;
+			}
+			if (c == 'B')
+				base = v;
+			else if (c == 's')
+				size = v;
+			else if (c == 'n')
+				distance = v;
+			else if (c == 'r')
+				retention = v;
+			else if (c == 'y')
+				delay = v;
+			else if (c == 'i')
+				init = v;
+			else if (c == 'C')
+				op_cycles = v;
+			else if (c == 'p')
+				period = v;
+			else
+				jobs = v;
+			break;
+		case 'o':
+			csv = optarg;
+			break;
+		case 'J':
+			json = optarg;
+			break;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+	if (optind != argc) {
+		usage(stderr);
+		return 2;
+	}
+	if (!size || size > 0x10000 || base + size > 0x1000000 || distance > 64 || init > 0xFF || !retention
+			|| !op_cycles) {
+		fprintf(stderr, "marchcov: bad memory or fault parameters\n");
+		return 2;
+	}
+	if (faultset_classes(classes_arg, &classes))
+		return 2;
+	if (!ntests)
+		for (ntests = 0; ntests < sizeof(default_tests) / sizeof(default_tests[0]); ntests++)
+			test_args[ntests] = default_tests[ntests];
+	if (!nscheds)
+		for (nscheds = 0; nscheds < sizeof(default_schedules) / sizeof(default_schedules[0]); nscheds++)
+			sched_args[nscheds] = default_schedules[nscheds];
+	if (ntests * nscheds > MAX_CONFIGS) {
+		fprintf(stderr, "marchcov: too many configurations\n");
+		return 2;
+	}
+
+	memset(&cp, 0, sizeof(cp));
+	cp.cfg = cfg;
+	cp.op_cycles = op_cycles;
+	for (i = 0; i < ntests; i++) {
+		static char text[MAX_TESTS][512];
+		char *slash;
+		struct config *c0 = &cfg[cp.ncfg];
+		int nbg;
+
+		snprintf(text[i], sizeof(text[i]), "%s", test_args[i]);
+		slash = strrchr(text[i], '/');
+		c0->bg_arg = "0";
+		if (slash) {
+			*slash = '\0';
+			c0->bg_arg = slash + 1;
+		}
+		c0->test_arg = text[i];
+		if (march_parse(c0->test_arg, &c0->test))
+			return 2;
+		nbg = march_backgrounds(c0->bg_arg, c0->bg, MARCH_MAX_BACKGROUNDS);
+		if (nbg < 0)
+			return 2;
+		c0->nbg = (unsigned)nbg;
+		for (j = 0; j < nscheds; j++) {
+			struct config *c1 = &cfg[cp.ncfg++];
+			unsigned long nsecs, overlap;
+			char *end;
+
+			if (c1 != c0)
+				*c1 = *c0;
+			nsecs = strtoul(sched_args[j], &end, 10);
+			overlap = *end == ':' ? strtoul(end + 1, &end, 10) : 0;
+			if (*end || !nsecs || nsecs >= MAX_SECTIONS || nsecs > size || overlap > 100) {
+				fprintf(stderr, "marchcov: bad section schedule '%s'\n", sched_args[j]);
+				return 2;
+			}
+			c1->nsecs = (unsigned)nsecs;
+			c1->overlap = (unsigned)overlap;
+			schedule(c1, (uint32_t)size, op_cycles, period, delay);
+			if (c1->round > max_round)
+				max_round = c1->round;
+		}
+	}
+
+	faultset_init(&cp.fs, classes, (uint32_t)base, (uint32_t)size, (unsigned)distance, retention);
+	cp.chunks = (faultset_size(&cp.fs) + CHUNK - 1) / CHUNK;
+	if (jobs)
+		nthreads = (long)jobs;
+	if (nthreads < 1)
+		nthreads = 1;
+	if ((uint64_t)cp.ncfg * cp.chunks > 0xFFFFFFFFu) {
+		fprintf(stderr, "marchcov: too many faults\n");
+		return 2;
+	}
+	cp.sim = calloc((size_t)nthreads, sizeof(*cp.sim));
+	cp.res = calloc((size_t)nthreads * cp.ncfg * MF_NTYPES, sizeof(*cp.res));
+	if (!cp.sim || !cp.res) {
+		fprintf(stderr, "marchcov: out of memory\n");
+		return 1;
+	}
+	for (w = 0; w < (unsigned)nthreads; w++) {
+		if (bitsim_init(&cp.sim[w], &cfg[0].test, cfg[0].bg, cfg[0].nbg, (uint32_t)base, (uint32_t)size)) {
+			fprintf(stderr, "marchcov: out of memory\n");
+			return 1;
+		}
+		cp.sim[w].init = (uint8_t)init;
+		cp.sim[w].delay = delay;
+	}
+
+	t0 = now_seconds();
+	if (pool_run(&pool, (unsigned)nthreads, (unsigned)(cp.ncfg * cp.chunks), run_task, &cp)) {
+		fprintf(stderr, "marchcov: out of memory\n");
+		return 1;
+	}
+	seconds = now_seconds() - t0;
+
+	/* Merge the workers' results into those of worker 0. */
+	res = cp.res;
+	for (w = 1; w < (unsigned)nthreads; w++)
+		for (i = 0; i < cp.ncfg * MF_NTYPES; i++) {
+			const struct result *r = &cp.res[(size_t)w * cp.ncfg * MF_NTYPES + i];
+
+			res[i].faults += r->faults;
+			res[i].detected += r->detected;
+			for (b = 0; b < NBINS; b++)
+				res[i].hist[b] += r->hist[b];
+		}
+	b1 = bit_length(max_round);
+	b0 = b1 > 16 ? b1 - 16 : 0;
+
+	printf("%-24s %4s %3s %12s", "test/backgrounds", "secs", "ovl", "round");
+	for (t = 0; t < MF_NTYPES; t++)
+		if ((classes >> t) & 1)
+			printf(" %8s", mf_type_name(t));
+	printf(" %8s\n", "total");
+	for (i = 0; i < cp.ncfg; i++) {
+		const struct config *c = &cfg[i];
+		uint64_t faults = 0, detected = 0;
+		char label[600];
+
+		snprintf(label, sizeof(label), "%s/%s", c->test_arg, c->bg_arg);
+		printf("%-24s %4u %3u %12llu", label, c->nsecs, c->overlap, (unsigned long long)c->round);
+		for (t = 0; t < MF_NTYPES; t++) {
+			const struct result *r = &res[i * MF_NTYPES + t];
+
+			if (!((classes >> t) & 1))
+				continue;
+			printf(" %7.2f%%", r->faults ? 100.0 * r->detected / r->faults : 0.0);
+			faults += r->faults;
+			detected += r->detected;
+		}
+		printf(" %7.2f%%\n", faults ? 100.0 * detected / faults : 0.0);
+	}
+	printf("\n%u configurations, %llu fault indices each, %.2f s on %ld threads (%s), %lu steals\n",
+			cp.ncfg, (unsigned long long)faultset_size(&cp.fs), seconds, nthreads, bitsim_engine(),
+			pool.steals);
+
+	if (csv && write_csv(csv, &cp, res, b0, b1))
+		status = 1;
+	if (json && write_json(json, &cp, res, b0, b1, period, seconds))
+		status = 1;
+	for (w = 0; w < (unsigned)nthreads; w++)
+		bitsim_free(&cp.sim[w]);
+	free(cp.sim);
+	free(cp.res);
+	return status;
+}
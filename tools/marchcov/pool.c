@@ -0,0 +1,110 @@
+/*
+ * pool.c - work-stealing thread pool.
+ */
+
+#include "pool.h"
+
+#include <stdlib.h>
+
+struct worker {
+	struct pool *pool;
+	unsigned id;
+	unsigned long steals;
+};
+
+static int take_own(struct pool_queue *q, unsigned *task)
+{
+	int ok = 0;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head < q->tail) {
+		*task = --q->tail;
+		ok = 1;
+	}
+	pthread_mutex_unlock(&q->lock);
+	return ok;
+}
+
+static int steal(struct pool_queue *q, unsigned *task)
+{
+	int ok = 0;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head < q->tail) {
+		*task = q->head++;
+		ok = 1;
+	}
+	pthread_mutex_unlock(&q->lock);
+	return ok;
+}
+
+static void *worker(void *arg)
+{
+	struct worker *w = arg;
+	struct pool *p = w->pool;
+	unsigned task = 0, i;
+
+	for (;;) {
+		if (take_own(&p->queue[w->id], &task)) {
+			p->run(p->arg, w->id, task);
+			continue;
+		}
+		/* No task is ever added, so when every queue is empty we are done. */
+		for (i = 1; i < p->nworkers; i++)
+			if (steal(&p->queue[(w->id + i) % p->nworkers], &task))
+				break;
+		if (i == p->nworkers)
+			return NULL;
+		w->steals++;
+		p->run(p->arg, w->id, task);
+	}
+}
+
+int pool_run(struct pool *p, unsigned nworkers, unsigned ntasks,
+		void (*run)(void *arg, unsigned worker, unsigned task), void *arg)
+{
+	struct worker *w;
+	pthread_t *threads;
+	unsigned i, started;
+
+	if (!nworkers)
+		nworkers = 1;
+	p->nworkers = nworkers;
+	p->ntasks = ntasks;
+	p->run = run;
+	p->arg = arg;
+	p->steals = 0;
+	p->queue = calloc(nworkers, sizeof(*p->queue));
+	w = calloc(nworkers, sizeof(*w));
+	threads = calloc(nworkers, sizeof(*threads));
+	if (!p->queue || !w || !threads) {
+		free(p->queue);
+		free(w);
+		free(threads);
+		return -1;
+	}
+	for (i = 0; i < nworkers; i++) {
+		pthread_mutex_init(&p->queue[i].lock, NULL);
+		p->queue[i].head = (unsigned)((unsigned long long)ntasks * i / nworkers);
+		p->queue[i].tail = (unsigned)((unsigned long long)ntasks * (i + 1) / nworkers);
+		w[i].pool = p;
+		w[i].id = i;
+	}
+	for (started = 0; started < nworkers; started++)
+		if (pthread_create(&threads[started], NULL, worker, &w[started]))
+			break;
+	/* The started workers steal the tasks of the others; without any, the
+	 * calling thread does the work. */
+	if (!started)
+		worker(&w[0]);
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+		p->steals += w[i].steals;
+	}
+	for (i = 0; i < nworkers; i++)
+		pthread_mutex_destroy(&p->queue[i].lock);
+	free(p->queue);
+	free(w);
+	free(threads);
+	return 0;
+}
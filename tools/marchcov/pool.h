@@ -0,0 +1,33 @@
+/*
+ * pool.h - work-stealing thread pool.
+ *
+ * The tasks are dealt out to the workers in contiguous runs. A worker
+ * takes its own tasks from the back of its queue and, when it has run out,
+ * steals from the front of another worker's queue, so the workers stay
+ * busy when tasks take very different times.
+ */
+
+#ifndef MARCHCOV_POOL_H
+#define MARCHCOV_POOL_H
+
+#include <pthread.h>
+
+struct pool_queue {
+	pthread_mutex_t lock;
+	unsigned head, tail;        /* tasks head..tail-1 are left */
+};
+
+struct pool {
+	unsigned nworkers, ntasks;
+	struct pool_queue *queue;
+	void (*run)(void *arg, unsigned worker, unsigned task);
+	void *arg;
+	unsigned long steals;
+};
+
+/* Run tasks 0..ntasks-1 as run(arg, worker, task) on nworkers threads and
+ * wait for them. Returns 0, or -1 if out of memory. */
+int pool_run(struct pool *p, unsigned nworkers, unsigned ntasks,
+		void (*run)(void *arg, unsigned worker, unsigned task), void *arg);
+
+#endif
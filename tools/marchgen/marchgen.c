@@ -0,0 +1,603 @@
+/*
+ * marchgen - generate the .init1 SRAM test of ramtest.S from March notation.
+ *
+ * The test is written in March notation (see march.h), with its data
+ * backgrounds, and the generated assembly runs it over the whole internal
+ * SRAM before the C start-up code, reporting a failure in GPIO0..3 as
+ * ramtest.S does: GPIO0 the stage (the element, from 1), GPIO1 the "1"
+ * pattern of the background, GPIO2/3 the address.
+ *
+ * Each element is one loop. Upward elements use post-increment on the
+ * last access of a cell and downward elements pre-decrement on the first,
+ * so no pointer arithmetic is left in the loop; the loop body is unrolled
+ * as far as BRNE reaches, with an 8-bit counter where the iterations fit.
+ * The cycle count of the generated code is exact for the XMEGA core and
+ * is written into the file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "march.h"
+#include "xmega_devices.h"
+
+#define MAX_LITERALS 14            /* r2..r15 */
+#define BRNE_REACH   63            /* words between the loop label and BRNE */
+#define RJMP_REACH   2047
+
+struct gen {
+	FILE *f;
+	const char *prefix;
+	uint64_t pc;                /* words from the start of the section */
+	uint64_t failure_pc;
+	unsigned labels;
+	int z_known;                /* Z holds z_value */
+	uint32_t z_value;
+	int r26_zero;               /* the loop counter is zero */
+	uint8_t literal[MAX_LITERALS];
+	unsigned nliterals;
+	int error;
+};
+
+struct options {
+	const char *test_arg, *bg_arg, *prefix;
+	uint32_t size;
+	unsigned max_unroll;
+	uint64_t delay;             /* cycles of a del */
+	int clock;
+};
+
+static void ins(struct gen *g, unsigned words, const char *fmt, ...)
+{
+	va_list ap;
+
+	fputc('\t', g->f);
+	va_start(ap, fmt);
+	vfprintf(g->f, fmt, ap);
+	va_end(ap);
+	fputc('\n', g->f);
+	g->pc += words;
+}
+
+static void fail_jump(struct gen *g, const char *target)
+{
+	if (g->pc + 1 - g->failure_pc > RJMP_REACH) {
+		fprintf(stderr, "marchgen: the test is too long for RJMP to reach %s_%s, unroll less (-u)\n",
+				g->prefix, target);
+		g->error = 1;
+	}
+	ins(g, 1, "rjmp\t%s_%s", g->prefix, target);
+}
+
+static const char *data_reg(const struct gen *g, const struct march_op *op)
+{
+	static char name[MAX_LITERALS][4];
+	unsigned i;
+
+	if (!op->literal)
+		return op->data ? "r18" : "r16";
+	for (i = 0; i < g->nliterals; i++)
+		if (g->literal[i] == op->data) {
+			snprintf(name[i], sizeof(name[i]), "r%u", i + 2);
+			return name[i];
+		}
+	return "?";
+}
+
+/* Delay loop of n iterations: 3 + 5 n - 1 cycles, 6 words. */
+static uint64_t emit_delay(struct gen *g, uint32_t n)
+{
+	unsigned l = g->labels++;
+
+	ins(g, 1, "ldi\tr24, lo8(%lu)", (unsigned long)n);
+	ins(g, 1, "ldi\tr25, hi8(%lu)", (unsigned long)n);
+	ins(g, 1, "ldi\tr21, hlo8(%lu)", (unsigned long)n);
+	fprintf(g->f, "%s_delay%u:\n", g->prefix, l);
+	ins(g, 1, "sbiw\tr24, 1");
+	ins(g, 1, "sbci\tr21, 0");
+	ins(g, 1, "brne\t%s_delay%u", g->prefix, l);
+	return 3 + 5 * (uint64_t)n - 1;
+}
+
+static uint32_t delay_iterations(uint64_t cycles)
+{
+	uint64_t n = cycles > 7 ? (cycles - 2 + 2) / 5 : 1;
+
+	return n > 0xFFFFFF ? 0xFFFFFF : (uint32_t)n;
+}
+
+static int pure_delay(const struct march_element *e)
+{
+	unsigned j;
+
+	for (j = 0; j < e->nops; j++)
+		if (e->ops[j].kind != MARCH_DELAY)
+			return 0;
+	return 1;
+}
+
+static unsigned op_words(const struct march_op *op)
+{
+	return op->kind == MARCH_READ ? 3 : op->kind == MARCH_WRITE ? 1 : 6;
+}
+
+/* Cycles of the operations on one cell; first/last get the pointer update. */
+static uint64_t cell_cycles(const struct march_element *e, const struct options *o)
+{
+	uint64_t c = 0;
+	unsigned j;
+
+	for (j = 0; j < e->nops; j++) {
+		const struct march_op *op = &e->ops[j];
+		int predec = e->order == MARCH_DOWN && j == 0;
+
+		if (op->kind == MARCH_READ)
+			c += (predec ? 3 : 2) + 2;      /* LD, CPSE skipping RJMP */
+		else if (op->kind == MARCH_WRITE)
+			c += predec ? 2 : 1;            /* ST */
+		else
+			c += 3 + 5 * (uint64_t)delay_iterations(o->delay) - 1;
+	}
+	return c;
+}
+
+static const char *op_name(const struct march_op *op, char *buf)
+{
+	if (op->literal)
+		sprintf(buf, "%c0x%02X", op->kind == MARCH_READ ? 'r' : 'w', op->data);
+	else
+		sprintf(buf, "%c%u", op->kind == MARCH_READ ? 'r' : 'w', op->data);
+	return buf;
+}
+
+static void emit_cell(struct gen *g, const struct march_element *e, const struct options *o)
+{
+	char text[8];
+	unsigned j;
+
+	for (j = 0; j < e->nops; j++) {
+		const struct march_op *op = &e->ops[j];
+		const char *mode = "Z";
+
+		if (e->order == MARCH_DOWN && j == 0)
+			mode = "-Z";
+		else if (e->order != MARCH_DOWN && j == e->nops - 1)
+			mode = "Z+";
+		if (op->kind == MARCH_READ) {
+			ins(g, 1, "ld\tr19, %s\t// %s", mode, op_name(op, text));
+			ins(g, 1, "cpse\tr19, %s", data_reg(g, op));
+			fail_jump(g, !strcmp(mode, "Z+") ? "failure_inc" : "failure");
+		} else if (op->kind == MARCH_WRITE) {
+			ins(g, 1, "st\t%s, %s\t// %s", mode, data_reg(g, op), op_name(op, text));
+		} else {
+			emit_delay(g, delay_iterations(o->delay));
+		}
+	}
+	/* A delay alone still has to step through the cells. */
+	if (pure_delay(e))
+		ins(g, 1, e->order == MARCH_DOWN ? "sbiw\tr30, 1" : "adiw\tr30, 1");
+}
+
+/* Unroll factor and counter width with the fewest cycles. */
+static unsigned choose_unroll(const struct march_element *e, const struct options *o, int *wide)
+{
+	unsigned words = 0, j, u, best = 1;
+	uint64_t cost, best_cost = UINT64_MAX;
+
+	for (j = 0; j < e->nops; j++)
+		words += op_words(&e->ops[j]);
+	if (pure_delay(e))
+		words++;
+	for (u = 1; u <= o->max_unroll && u <= o->size; u *= 2) {
+		uint32_t iter = o->size / u;
+
+		if (o->size % u || u * words + 1 > BRNE_REACH - 1)
+			break;
+		cost = (uint64_t)iter * (iter <= 256 ? 3 : 4);
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = u;
+		}
+	}
+	*wide = o->size / best > 256;
+	return best;
+}
+
+static uint64_t emit_element(struct gen *g, const struct march_element *e, unsigned stage, const struct options *o)
+{
+	uint32_t start = XMEGA_INTERNAL_SRAM_START, end = start + o->size;
+	uint32_t z = e->order == MARCH_DOWN ? end : start, iter;
+	uint64_t c = 0, cell;
+	unsigned u, i;
+	int wide;
+	char text[512];
+	struct march_test one;
+
+	one.nelements = 1;
+	one.el[0] = *e;
+	march_format(&one, 0, text, sizeof(text));
+	text[strlen(text) - 1] = '\0';
+	fprintf(g->f, "\n\t// %s\n", text + 1);
+
+	if (march_is_pause(e))
+		return emit_delay(g, delay_iterations(o->delay));
+
+	u = choose_unroll(e, o, &wide);
+	iter = o->size / u;
+	ins(g, 1, "ldi\tr20, %u", stage);
+	c += 1;
+	if (!g->z_known || g->z_value != z) {
+		if (e->order == MARCH_DOWN) {
+			ins(g, 1, "ldi\tzl, lo8(INTERNAL_SRAM_END + 1)");
+			ins(g, 1, "ldi\tzh, hi8(INTERNAL_SRAM_END + 1)");
+		} else {
+			ins(g, 1, "ldi\tzl, lo8(INTERNAL_SRAM_START)");
+			ins(g, 1, "ldi\tzh, hi8(INTERNAL_SRAM_START)");
+		}
+		c += 2;
+	}
+	if (!(g->r26_zero && (iter & 0xFF) == 0)) {
+		ins(g, 1, "ldi\tr26, lo8(%lu)", (unsigned long)iter);
+		c += 1;
+	}
+	if (wide) {
+		ins(g, 1, "ldi\tr27, hi8(%lu)", (unsigned long)iter);
+		c += 1;
+	}
+	fprintf(g->f, "%s_stage%u:\n", g->prefix, stage);
+	for (i = 0; i < u; i++)
+		emit_cell(g, e, o);
+	if (wide)
+		ins(g, 1, "sbiw\tr26, 1");
+	else
+		ins(g, 1, "dec\tr26");
+	ins(g, 1, "brne\t%s_stage%u", g->prefix, stage);
+
+	cell = cell_cycles(e, o) + (pure_delay(e) ? 2 : 0);
+	c += (uint64_t)iter * (u * cell + (wide ? 2 : 1) + 2) - 1;
+	g->z_known = 1;
+	g->z_value = e->order == MARCH_DOWN ? start : end;
+	g->r26_zero = 1;
+	return c;
+}
+
+static int is_bits(const struct march_background *bg, unsigned nbg)
+{
+	unsigned b;
+
+	if (nbg != 8)
+		return 0;
+	for (b = 0; b < 8; b++)
+		if (bg[b].zero != 0 || bg[b].one != 1u << b)
+			return 0;
+	return 1;
+}
+
+/* The first element only writes D and the test leaves D in every cell, so
+ * with the same D in every background it runs once, before the loop. */
+static int can_hoist(const struct march_test *t, const struct march_background *bg, unsigned nbg)
+{
+	const struct march_element *e = &t->el[0];
+	const struct march_op *last = NULL;
+	unsigned i, j;
+
+	if (nbg < 2 || march_is_pause(e))
+		return 0;
+	for (j = 0; j < e->nops; j++)
+		if (e->ops[j].kind != MARCH_WRITE || e->ops[j].literal || e->ops[j].data)
+			return 0;
+	for (i = 0; i < nbg; i++)
+		if (bg[i].zero != bg[0].zero)
+			return 0;
+	for (i = 0; i < t->nelements; i++)
+		for (j = 0; j < t->el[i].nops; j++)
+			if (t->el[i].ops[j].kind == MARCH_WRITE)
+				last = &t->el[i].ops[j];
+	return last && !last->literal && !last->data;
+}
+
+static void usage(FILE *f)
+{
+	fprintf(f,
+		"Usage: marchgen [options]\n"
+		"\n"
+		"Generate the .init1 SRAM test of ramtest.S for a March test.\n"
+		"\n"
+		"  -a, --algorithm TEST     built-in test or March notation (default march-c-)\n"
+		"  -b, --backgrounds LIST   data backgrounds as in marchsim (default bits)\n"
+		"  -d, --device NAME        device, for its SRAM size\n"
+		"  -s, --size N             SRAM size (default 8192)\n"
+		"  -u, --unroll N           unroll the loops at most N times (default 256)\n"
+		"  -y, --delay CYCLES       length of a del (required with del)\n"
+		"  -p, --prefix NAME        label prefix (default march)\n"
+		"  -C, --no-clock           run at the reset clock, not at 32 MHz\n"
+		"  -o, --output FILE        output file (default standard output)\n"
+		"  -h, --help               show this help\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "algorithm", required_argument, NULL, 'a' },
+		{ "backgrounds", required_argument, NULL, 'b' },
+		{ "device", required_argument, NULL, 'd' },
+		{ "size", required_argument, NULL, 's' },
+		{ "unroll", required_argument, NULL, 'u' },
+		{ "delay", required_argument, NULL, 'y' },
+		{ "prefix", required_argument, NULL, 'p' },
+		{ "no-clock", no_argument, NULL, 'C' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	struct options o = { "march-c-", "bits", "march", 8192, 256, 0, 1 };
+	const char *output = NULL, *device = NULL;
+	struct march_test t;
+	struct march_background bg[MARCH_MAX_BACKGROUNDS];
+	struct gen g;
+	uint64_t once = 0, per_bg = 0, hoisted = 0, total, loop_pc = 0, v;
+	unsigned i, j, first = 0;
+	int nbg, c, bits, hoist, has_delay = 0;
+	char text[1024], *end, *body = NULL;
+	size_t body_size = 0;
+	FILE *f;
+
+	while ((c = getopt_long(argc, argv, "a:b:d:s:u:y:p:Co:h", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'a':
+			o.test_arg = optarg;
+			break;
+		case 'b':
+			o.bg_arg = optarg;
+			break;
+		case 'd':
+			device = optarg;
+			break;
+		case 's':
+		case 'u':
+		case 'y':
+			v = strtoull(optarg, &end, 0);
+			if (*end || !v) {
+				fprintf(stderr, "marchgen: bad number '%s'\n", optarg);
+				return 2;
+			}
+			if (c == 's')
+				o.size = (uint32_t)v;
+			else if (c == 'u')
+				o.max_unroll = (unsigned)v;
+			else
+				o.delay = v;
+			break;
+		case 'p':
+			o.prefix = optarg;
+			break;
+		case 'C':
+			o.clock = 0;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+	if (optind != argc) {
+		usage(stderr);
+		return 2;
+	}
+	if (device) {
+		const struct xmega_device *d = xmega_find_device(device);
+
+		if (!d) {
+			fprintf(stderr, "marchgen: unknown device '%s'\n", device);
+			return 2;
+		}
+		o.size = d->sram_size;
+	}
+	if (o.size > 0x10000 - XMEGA_INTERNAL_SRAM_START) {
+		fprintf(stderr, "marchgen: bad SRAM size\n");
+		return 2;
+	}
+	if (march_parse(o.test_arg, &t))
+		return 2;
+	nbg = march_backgrounds(o.bg_arg, bg, MARCH_MAX_BACKGROUNDS);
+	if (nbg < 0)
+		return 2;
+
+	memset(&g, 0, sizeof(g));
+	g.prefix = o.prefix;
+	for (i = 0; i < t.nelements; i++)
+		for (j = 0; j < t.el[i].nops; j++) {
+			const struct march_op *op = &t.el[i].ops[j];
+			unsigned k;
+
+			if (op->kind == MARCH_DELAY)
+				has_delay = 1;
+			if (!op->literal)
+				continue;
+			for (k = 0; k < g.nliterals && g.literal[k] != op->data; k++)
+				;
+			if (k == g.nliterals) {
+				if (g.nliterals == MAX_LITERALS) {
+					fprintf(stderr, "marchgen: more than %u different literal bytes\n", MAX_LITERALS);
+					return 2;
+				}
+				g.literal[g.nliterals++] = op->data;
+			}
+		}
+	if (has_delay && !o.delay) {
+		fprintf(stderr, "marchgen: the test has a del, give its length with --delay\n");
+		return 2;
+	}
+	bits = is_bits(bg, (unsigned)nbg);
+	hoist = can_hoist(&t, bg, (unsigned)nbg);
+
+	g.f = open_memstream(&body, &body_size);
+	if (!g.f) {
+		perror("marchgen");
+		return 1;
+	}
+	fprintf(g.f, ".section .init1,\"ax\",@progbits\n");
+
+	if (o.clock) {
+		fprintf(g.f, "\t// increase clock speed to accelerate memory test\n");
+		ins(&g, 1, "ldi\tzl, lo8(OSC_CTRL)");
+		ins(&g, 1, "ldi\tzh, hi8(OSC_CTRL)");
+		ins(&g, 1, "ld\tr18, Z");
+		ins(&g, 1, "ori\tr18, OSC_RC32MEN_bm");
+		ins(&g, 1, "st\tZ, r18");
+		ins(&g, 1, "ldi\tzl, lo8(OSC_STATUS)");
+		ins(&g, 1, "ldi\tzh, hi8(OSC_STATUS)");
+		fprintf(g.f, "%s_wait_for_rc32m:\n", g.prefix);
+		ins(&g, 1, "ld\tr18, Z");
+		ins(&g, 1, "sbrs\tr18, OSC_RC32MRDY_bp");
+		ins(&g, 1, "rjmp\t%s_wait_for_rc32m", g.prefix);
+		ins(&g, 1, "ldi\tzl, lo8(CLK_CTRL)");
+		ins(&g, 1, "ldi\tzh, hi8(CLK_CTRL)");
+		ins(&g, 1, "ldi\tr18, 0x01\t\t// CLK_SCLKSEL_RC32M_gc");
+		ins(&g, 1, "ldi\tr19, 0xD8\t\t// CCP_IOREG_gc");
+		ins(&g, 1, "out\tCCP, r19");
+		ins(&g, 1, "st\tZ, r18");
+		/* I/O loads take one cycle; the oscillator is taken as ready at the
+		 * first poll, each further poll adds five cycles. */
+		once += 7 + 3 + 6;
+	}
+
+	ins(&g, 1, "rjmp\t%s_start", g.prefix);
+	once += 2;
+	g.failure_pc = g.pc;
+	fprintf(g.f, "\n%s_failure_inc:\n", g.prefix);
+	ins(&g, 1, "sbiw\tr30, 1\t\t// the failing read had incremented Z");
+	fprintf(g.f, "%s_failure:\n", g.prefix);
+	ins(&g, 1, "out\tGPIO0, r20\t// stage, 0 == no error");
+	ins(&g, 1, "out\tGPIO1, r18\t// background");
+	ins(&g, 1, "out\tGPIO2, zl\t// address");
+	ins(&g, 1, "out\tGPIO3, zh\t// address");
+	ins(&g, 1, "rjmp\t%s_finished", g.prefix);
+	if (!bits && nbg > 1) {
+		fprintf(g.f, "\n%s_backgrounds:\n", g.prefix);
+		for (i = 0; i < (unsigned)nbg; i++) {
+			fprintf(g.f, "\t.byte\t0x%02X, 0x%02X\n", bg[i].zero, bg[i].one);
+			g.pc++;
+		}
+	}
+
+	fprintf(g.f, "\n%s_start:\n", g.prefix);
+	ins(&g, 1, "ldi\tr20, 0");
+	ins(&g, 1, "out\tGPIO0, r20\t// failure flag");
+	once += 2;
+	for (i = 0; i < g.nliterals; i++) {
+		ins(&g, 1, "ldi\tr19, 0x%02X", g.literal[i]);
+		ins(&g, 1, "mov\tr%u, r19", i + 2);
+		once += 2;
+	}
+	if (bits || nbg == 1) {
+		ins(&g, 1, "ldi\tr16, 0x%02X", bg[0].zero);
+		ins(&g, 1, "ldi\tr18, 0x%02X", bg[0].one);
+		once += 2;
+	} else {
+		ins(&g, 1, "ldi\tr22, lo8(%s_backgrounds)", g.prefix);
+		ins(&g, 1, "ldi\tr23, hi8(%s_backgrounds)", g.prefix);
+		ins(&g, 1, "ldi\tr17, %d", nbg);
+		once += 3;
+		if (hoist) {
+			/* D of the first background for the hoisted element. */
+			ins(&g, 1, "ldi\tr16, 0x%02X", bg[0].zero);
+			once += 1;
+		}
+	}
+
+	if (hoist) {
+		hoisted = emit_element(&g, &t.el[0], 1, &o);
+		first = 1;
+	}
+	if (nbg > 1) {
+		fprintf(g.f, "\n%s_background_loop:\n", g.prefix);
+		loop_pc = g.pc;
+		g.z_known = 0;
+		/* The counter is zero on entry only after the hoisted element. */
+		g.r26_zero = hoist;
+		if (!bits) {
+			ins(&g, 1, "movw\tr30, r22");
+			ins(&g, 1, "lpm\tr16, Z+");
+			ins(&g, 1, "lpm\tr18, Z+");
+			ins(&g, 1, "movw\tr22, r30");
+			per_bg += 8;
+		}
+		ins(&g, 1, "out\tGPIO1, r18\t// indicate the background");
+		per_bg += 1;
+	}
+	for (i = first; i < t.nelements; i++)
+		per_bg += emit_element(&g, &t.el[i], i + 1, &o);
+	total = once + hoisted + nbg * per_bg;
+	if (nbg > 1) {
+		fprintf(g.f, "\n\t// next background\n");
+		ins(&g, 1, bits ? "lsl\tr18" : "dec\tr17");
+		ins(&g, 1, "breq\t%s_finished", g.prefix);
+		if (g.pc + 1 - loop_pc > RJMP_REACH) {
+			fprintf(stderr, "marchgen: the test is too long for RJMP, unroll less (-u)\n");
+			g.error = 1;
+		}
+		ins(&g, 1, "rjmp\t%s_background_loop", g.prefix);
+		/* LSL or DEC, then BREQ and RJMP back, or BREQ taken at the end. */
+		total += (uint64_t)nbg + 3 * (uint64_t)(nbg - 1) + 2;
+	}
+
+	fprintf(g.f, "\n%s_finished:\n", g.prefix);
+	if (o.clock) {
+		fprintf(g.f, "\t// reset clock speed to 2MHz\n");
+		ins(&g, 1, "ldi\tzl, lo8(CLK_CTRL)");
+		ins(&g, 1, "ldi\tzh, hi8(CLK_CTRL)");
+		ins(&g, 1, "ldi\tr18, 0x00\t\t// CLK_SCLKSEL_RC2M_gc");
+		ins(&g, 1, "ldi\tr19, 0xD8\t\t// CCP_IOREG_gc");
+		ins(&g, 1, "out\tCCP, r19");
+		ins(&g, 1, "st\tZ, r18");
+		total += 6;
+	}
+	fclose(g.f);
+	if (g.error) {
+		free(body);
+		return 1;
+	}
+
+	f = output ? fopen(output, "w") : stdout;
+	if (!f) {
+		perror(output);
+		free(body);
+		return 1;
+	}
+	march_format(&t, 0, text, sizeof(text));
+	fprintf(f, "/*\n * %s\n *\n * Generated by marchgen, do not edit:\n *\n", output ? output : "SRAM test");
+	fprintf(f, " *   marchgen -a '%s' -b %s -s %lu", o.test_arg, o.bg_arg, (unsigned long)o.size);
+	if (o.delay)
+		fprintf(f, " -y %lu", (unsigned long)o.delay);
+	fprintf(f, "\n *\n");
+	fprintf(f, " * %s\n *\n", text);
+	fprintf(f, " * Runs in .init1 over the whole internal SRAM. On failure GPIO0 holds the\n"
+			" * stage (the element, from 1), GPIO1 the \"1\" pattern of the background\n"
+			" * and GPIO2/3 the address; GPIO0 is 0 if the test passed.\n *\n");
+	fprintf(f, " * Takes %llu cycles for %lu bytes of SRAM", (unsigned long long)total, (unsigned long)o.size);
+	if (o.clock)
+		fprintf(f, ", plus 5 cycles per\n * further poll while the 32 MHz RC oscillator starts up");
+	fprintf(f, ".\n */\n\n#include <avr/io.h>\n\n");
+	fprintf(f, "#if INTERNAL_SRAM_SIZE != %lu\n#error \"generated for %lu bytes of SRAM\"\n#endif\n\n",
+			(unsigned long)o.size, (unsigned long)o.size);
+	fputs(body, f);
+	free(body);
+	if (output && fclose(f)) {
+		perror(output);
+		return 1;
+	}
+	fprintf(stderr, "marchgen: %llu cycles, %llu words\n", (unsigned long long)total,
+			(unsigned long long)g.pc);
+	return 0;
+}
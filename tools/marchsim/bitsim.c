@@ -0,0 +1,475 @@
+/*
+ * bitsim.c - bit-sliced March test fault simulator.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "bitsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+const char *bitsim_engine(void)
+{
+#ifdef __AVX2__
+	return "avx2";
+#else
+	return "64-bit";
+#endif
+}
+
+/* ---------------------------------------------------------------- lanes */
+
+static inline void lanes_fill(struct bitsim_lanes *d, int bit)
+{
+#ifdef __AVX2__
+	_mm256_store_si256((__m256i *)d->w, bit ? _mm256_set1_epi64x(-1) : _mm256_setzero_si256());
+#else
+	uint64_t x = bit ? ~(uint64_t)0 : 0;
+
+	d->w[0] = d->w[1] = d->w[2] = d->w[3] = x;
+#endif
+}
+
+/* Lanes whose byte differs from e. */
+static inline void lanes_mismatch(const struct bitsim_lanes *cell, uint8_t e, struct bitsim_lanes *out)
+{
+#ifdef __AVX2__
+	__m256i acc = _mm256_setzero_si256(), ones = _mm256_set1_epi64x(-1);
+	unsigned i;
+
+	for (i = 0; i < 8; i++) {
+		__m256i c = _mm256_load_si256((const __m256i *)cell[i].w);
+
+		acc = _mm256_or_si256(acc, (e >> i) & 1 ? _mm256_xor_si256(c, ones) : c);
+	}
+	_mm256_store_si256((__m256i *)out->w, acc);
+#else
+	unsigned i, j;
+
+	for (j = 0; j < 4; j++)
+		out->w[j] = 0;
+	for (i = 0; i < 8; i++) {
+		uint64_t x = (e >> i) & 1 ? ~(uint64_t)0 : 0;
+
+		for (j = 0; j < 4; j++)
+			out->w[j] |= cell[i].w[j] ^ x;
+	}
+#endif
+}
+
+static inline int lane_get(const struct bitsim_lanes *v, unsigned lane)
+{
+	return (int)((v->w[lane >> 6] >> (lane & 63)) & 1);
+}
+
+static inline void lane_put(struct bitsim_lanes *v, unsigned lane, int bit)
+{
+	uint64_t m = (uint64_t)1 << (lane & 63);
+
+	if (bit)
+		v->w[lane >> 6] |= m;
+	else
+		v->w[lane >> 6] &= ~m;
+}
+
+static inline uint8_t lane_byte(const struct bitsim_lanes *cell, unsigned lane)
+{
+	uint8_t v = 0;
+	unsigned i;
+
+	for (i = 0; i < 8; i++)
+		v |= (uint8_t)(lane_get(&cell[i], lane) << i);
+	return v;
+}
+
+static inline void lane_set_byte(struct bitsim_lanes *cell, unsigned lane, uint8_t v)
+{
+	unsigned i;
+
+	for (i = 0; i < 8; i++)
+		lane_put(&cell[i], lane, (v >> i) & 1);
+}
+
+/* ---------------------------------------------------------------- set-up */
+
+int bitsim_init(struct bitsim *s, const struct march_test *t, const struct march_background *bg,
+		unsigned nbg, uint32_t base, uint32_t size)
+{
+	void *p;
+	uint32_t i;
+
+	memset(s, 0, sizeof(*s));
+	s->test = t;
+	s->bg = bg;
+	s->nbg = nbg;
+	s->base = base;
+	s->size = size;
+	s->count = size;
+	s->delay = 10000000;
+	s->slot = malloc(size * sizeof(*s->slot));
+	if (!s->slot || posix_memalign(&p, 32, 2 * BITSIM_LANES * 8 * sizeof(struct bitsim_lanes))) {
+		bitsim_free(s);
+		return -1;
+	}
+	s->cells = p;
+	for (i = 0; i < size; i++)
+		s->slot[i] = -1;
+	return 0;
+}
+
+void bitsim_free(struct bitsim *s)
+{
+	free(s->slot);
+	free(s->cells);
+	s->slot = NULL;
+	s->cells = NULL;
+}
+
+static int has_aggressor(enum mf_type t)
+{
+	return t == MF_CFST || t == MF_CFID || t == MF_CFIN || t == MF_AF_ALIAS || t == MF_AF_MULTI;
+}
+
+/* Per cell duration of an element and the offset of each operation in it. */
+static uint64_t element_timing(const struct bitsim *s, const struct march_element *e, uint64_t *offset)
+{
+	uint64_t d = 0;
+	unsigned j;
+
+	for (j = 0; j < e->nops; j++) {
+		offset[j] = d;
+		d += e->ops[j].kind == MARCH_DELAY ? s->delay : 1;
+	}
+	return d;
+}
+
+/* Operations of a whole element. */
+static uint64_t element_ops(const struct bitsim *s, const struct march_element *e)
+{
+	uint64_t offset[MARCH_MAX_OPS];
+
+	if (march_is_pause(e))
+		return s->delay;
+	return (uint64_t)s->count * element_timing(s, e, offset);
+}
+
+uint64_t bitsim_total_ops(const struct bitsim *s)
+{
+	uint64_t total = 0;
+	unsigned i;
+
+	for (i = 0; i < s->test->nelements; i++)
+		total += element_ops(s, &s->test->el[i]);
+	return total * s->nbg;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Slots of the bytes the faults involve, in address order, and per slot the lanes involved. */
+static void setup_slots(struct bitsim *s, const struct mf_fault *faults, unsigned n)
+{
+	uint16_t count[2 * BITSIM_LANES + 1];
+	unsigned i, k;
+
+	s->nslots = 0;
+	for (i = 0; i < n; i++) {
+		const struct mf_fault *f = &faults[i];
+
+		if (s->slot[f->victim.addr - s->base] < 0) {
+			s->slot[f->victim.addr - s->base] = 0;
+			s->addr[s->nslots++] = f->victim.addr;
+		}
+		if (has_aggressor(f->type) && s->slot[f->aggressor.addr - s->base] < 0) {
+			s->slot[f->aggressor.addr - s->base] = 0;
+			s->addr[s->nslots++] = f->aggressor.addr;
+		}
+	}
+	qsort(s->addr, s->nslots, sizeof(s->addr[0]), cmp_u32);
+	for (k = 0; k < s->nslots; k++)
+		s->slot[s->addr[k] - s->base] = (int32_t)k;
+
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++) {
+		const struct mf_fault *f = &faults[i];
+		int v = s->slot[f->victim.addr - s->base];
+
+		count[v + 1]++;
+		if (has_aggressor(f->type) && f->aggressor.addr != f->victim.addr)
+			count[s->slot[f->aggressor.addr - s->base] + 1]++;
+	}
+	for (k = 0; k < s->nslots; k++)
+		count[k + 1] = (uint16_t)(count[k + 1] + count[k]);
+	memcpy(s->lane_start, count, (s->nslots + 1) * sizeof(count[0]));
+	for (i = 0; i < n; i++) {
+		const struct mf_fault *f = &faults[i];
+		int v = s->slot[f->victim.addr - s->base];
+
+		s->lane_list[count[v]++] = (uint16_t)i;
+		if (has_aggressor(f->type) && f->aggressor.addr != f->victim.addr)
+			s->lane_list[count[s->slot[f->aggressor.addr - s->base]]++] = (uint16_t)i;
+	}
+}
+
+static void clear_slots(struct bitsim *s)
+{
+	unsigned k;
+
+	for (k = 0; k < s->nslots; k++)
+		s->slot[s->addr[k] - s->base] = -1;
+}
+
+/* ---------------------------------------------------------------- faults */
+
+static inline struct bitsim_lanes *slot_cells(const struct bitsim *s, uint32_t addr)
+{
+	return &s->cells[8 * s->slot[addr - s->base]];
+}
+
+static inline int cell_get(const struct bitsim *s, const struct mf_cell *c, unsigned lane)
+{
+	return lane_get(&slot_cells(s, c->addr)[c->bit], lane);
+}
+
+static inline void cell_put(const struct bitsim *s, const struct mf_cell *c, unsigned lane, int bit)
+{
+	lane_put(&slot_cells(s, c->addr)[c->bit], lane, bit);
+}
+
+/* The faults that hold a cell in a state. */
+static void settle(const struct bitsim *s, const struct mf_fault *f, unsigned lane)
+{
+	if (f->type == MF_SAF)
+		cell_put(s, &f->victim, lane, f->value);
+	else if (f->type == MF_CFST && cell_get(s, &f->aggressor, lane) == f->state)
+		cell_put(s, &f->victim, lane, f->value);
+}
+
+/* Lane's part of a write of v to addr, after the fault free write; old is the byte before. */
+static void fix_write(struct bitsim *s, const struct mf_fault *f, unsigned lane, uint32_t addr,
+		uint8_t old, uint8_t v, uint64_t now)
+{
+	struct bitsim_lanes *cell = slot_cells(s, addr);
+
+	if (f->victim.addr == addr) {
+		int ob = (old >> f->victim.bit) & 1, nb = (v >> f->victim.bit) & 1;
+
+		switch (f->type) {
+		case MF_TF:
+			if (ob != nb && nb == f->up)
+				lane_put(&cell[f->victim.bit], lane, ob);
+			break;
+		case MF_DRF:
+			s->written[lane] = now;
+			break;
+		case MF_AF_NONE:
+			lane_set_byte(cell, lane, old);
+			break;
+		case MF_AF_ALIAS:
+			lane_set_byte(cell, lane, old);
+			lane_set_byte(slot_cells(s, f->aggressor.addr), lane, v);
+			break;
+		case MF_AF_MULTI:
+			lane_set_byte(slot_cells(s, f->aggressor.addr), lane, v);
+			break;
+		default:
+			break;
+		}
+	}
+	if ((f->type == MF_CFID || f->type == MF_CFIN) && f->aggressor.addr == addr) {
+		int ob = (old >> f->aggressor.bit) & 1, nb = (v >> f->aggressor.bit) & 1;
+
+		if (ob != nb && nb == f->up) {
+			if (f->type == MF_CFID)
+				cell_put(s, &f->victim, lane, f->value);
+			else
+				cell_put(s, &f->victim, lane, !cell_get(s, &f->victim, lane));
+		}
+	}
+	settle(s, f, lane);
+}
+
+/* Byte that lane's read of addr returns. */
+static uint8_t fix_read(struct bitsim *s, const struct mf_fault *f, unsigned lane, uint32_t addr, uint64_t now)
+{
+	struct bitsim_lanes *cell = slot_cells(s, addr);
+	uint8_t v;
+
+	if (f->victim.addr != addr)
+		return lane_byte(cell, lane);
+	switch (f->type) {
+	case MF_DRF:
+		if (cell_get(s, &f->victim, lane) == f->state && now - s->written[lane] >= f->retention)
+			cell_put(s, &f->victim, lane, !f->state);
+		return lane_byte(cell, lane);
+	case MF_RDF:
+	case MF_DRDF:
+		v = lane_byte(cell, lane);
+		if (cell_get(s, &f->victim, lane) == f->state) {
+			cell_put(s, &f->victim, lane, !f->state);
+			if (f->type == MF_RDF)
+				v ^= (uint8_t)(1u << f->victim.bit);
+		}
+		return v;
+	case MF_AF_NONE:
+		return f->value;
+	case MF_AF_ALIAS:
+		return lane_byte(slot_cells(s, f->aggressor.addr), lane);
+	case MF_AF_MULTI:
+		return lane_byte(cell, lane) & lane_byte(slot_cells(s, f->aggressor.addr), lane);
+	default:
+		return lane_byte(cell, lane);
+	}
+}
+
+/* ---------------------------------------------------------------- passes */
+
+void bitsim_run(struct bitsim *s, const struct mf_fault *faults, unsigned n, uint8_t *detected, uint64_t *time)
+{
+	struct bitsim_lanes found, mis, all;
+	uint64_t offset[MARCH_MAX_OPS], start = 0;
+	uint32_t lo = s->base + s->first, hi = lo + s->count;
+	uint8_t old[2 * BITSIM_LANES];
+	unsigned b, e, i, k, j;
+
+	memset(&found, 0, sizeof(found));
+	memset(&all, 0, sizeof(all));
+	for (i = 0; i < n; i++) {
+		lane_put(&all, i, 1);
+		s->written[i] = 0;
+		detected[i] = 0;
+		time[i] = 0;
+	}
+	setup_slots(s, faults, n);
+	for (k = 0; k < s->nslots; k++)
+		for (i = 0; i < 8; i++)
+			lanes_fill(&s->cells[8 * k + i], (s->init >> i) & 1);
+	for (i = 0; i < n; i++)
+		settle(s, &faults[i], i);
+
+	for (b = 0; b < s->nbg; b++) {
+		for (e = 0; e < s->test->nelements; e++) {
+			const struct march_element *el = &s->test->el[e];
+			uint64_t dur = element_timing(s, el, offset);
+
+			if (march_is_pause(el)) {
+				start += s->delay;
+				continue;
+			}
+			for (k = 0; k < s->nslots; k++) {
+				unsigned slot = el->order == MARCH_DOWN ? s->nslots - 1 - k : k;
+				uint32_t addr = s->addr[slot];
+				uint32_t pos = el->order == MARCH_DOWN ? hi - 1 - addr : addr - lo;
+				struct bitsim_lanes *cell = &s->cells[8 * slot];
+				unsigned l0 = s->lane_start[slot], l1 = s->lane_start[slot + 1];
+
+				if (addr < lo || addr >= hi)
+					continue;
+
+				for (j = 0; j < el->nops; j++) {
+					const struct march_op *op = &el->ops[j];
+					uint8_t v = march_data(op, &s->bg[b]);
+					uint64_t now = start + pos * dur + offset[j];
+
+					if (op->kind == MARCH_WRITE) {
+						for (i = l0; i < l1; i++)
+							old[i - l0] = lane_byte(cell, s->lane_list[i]);
+						for (i = 0; i < 8; i++)
+							lanes_fill(&cell[i], (v >> i) & 1);
+						for (i = l0; i < l1; i++) {
+							unsigned lane = s->lane_list[i];
+
+							fix_write(s, &faults[lane], lane, addr, old[i - l0], v, now);
+						}
+					} else if (op->kind == MARCH_READ) {
+						lanes_mismatch(cell, v, &mis);
+						for (i = l0; i < l1; i++) {
+							unsigned lane = s->lane_list[i];
+
+							lane_put(&mis, lane, fix_read(s, &faults[lane], lane, addr, now) != v);
+						}
+						for (i = 0; i < BITSIM_LANES / 64; i++) {
+							uint64_t fresh = mis.w[i] & all.w[i] & ~found.w[i];
+
+							while (fresh) {
+								unsigned lane = 64 * i + (unsigned)__builtin_ctzll(fresh);
+
+								time[lane] = now;
+								detected[lane] = 1;
+								fresh &= fresh - 1;
+							}
+							found.w[i] |= mis.w[i] & all.w[i];
+						}
+					}
+				}
+			}
+			start += element_ops(s, el);
+			if (!memcmp(&found, &all, sizeof(all)))
+				goto done;
+		}
+	}
+done:
+	clear_slots(s);
+}
+
+int bitsim_reference(const struct bitsim *s, const struct mf_fault *fault, uint8_t *detected, uint64_t *time)
+{
+	struct mf_memory m;
+	uint64_t offset[MARCH_MAX_OPS], start = 0;
+	uint8_t *mem = malloc(s->size);
+	uint32_t lo = s->base + s->first;
+	unsigned b, e, j;
+	uint32_t p;
+
+	*detected = 0;
+	*time = 0;
+	if (!mem)
+		return -1;
+	memset(mem, s->init, s->size);
+	if (mf_init(&m, mem, s->base, s->size) || mf_add(&m, fault)) {
+		mf_free(&m);
+		free(mem);
+		return -1;
+	}
+	for (b = 0; b < s->nbg && !*detected; b++) {
+		for (e = 0; e < s->test->nelements && !*detected; e++) {
+			const struct march_element *el = &s->test->el[e];
+			uint64_t dur = element_timing(s, el, offset);
+
+			if (march_is_pause(el)) {
+				start += s->delay;
+				continue;
+			}
+			for (p = 0; p < s->count && !*detected; p++) {
+				uint32_t addr = el->order == MARCH_DOWN ? lo + s->count - 1 - p : lo + p;
+
+				for (j = 0; j < el->nops; j++) {
+					const struct march_op *op = &el->ops[j];
+					uint8_t v = march_data(op, &s->bg[b]);
+
+					m.now = start + p * dur + offset[j];
+					if (op->kind == MARCH_WRITE) {
+						mf_write(&m, addr, v);
+					} else if (op->kind == MARCH_READ && mf_read(&m, addr) != v) {
+						*detected = 1;
+						*time = m.now;
+						break;
+					}
+				}
+			}
+			start += element_ops(s, el);
+		}
+	}
+	mf_free(&m);
+	free(mem);
+	return 0;
+}
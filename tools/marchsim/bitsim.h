@@ -0,0 +1,77 @@
+/*
+ * bitsim.h - bit-sliced March test fault simulator.
+ *
+ * A pass runs a March test over BITSIM_LANES memories at once, each with
+ * one fault of memfault.h. Every cell holds one bit per memory, so a
+ * fault free access is a handful of 256-bit operations for all memories
+ * together (AVX2 when the compiler targets it, four 64-bit words
+ * otherwise), and only the memories whose fault involves the accessed
+ * byte need scalar fix-ups.
+ *
+ * A fault changes only the cells it involves, and the other cells of its
+ * memory read back what the test wrote, so a pass simulates just the
+ * bytes that the faults of its lanes involve, visited in the order of
+ * each March element. Time, which the retention faults depend on, counts
+ * operations as if the whole memory had been visited: the cell at
+ * position p of an element of k operations is accessed at the element
+ * start + p * k. A delay stands for a configurable number of operations.
+ *
+ * The test may cover part of the memory only, as a section of the Class B
+ * SRAM test does; the bytes outside keep their initial contents.
+ */
+
+#ifndef MARCHSIM_BITSIM_H
+#define MARCHSIM_BITSIM_H
+
+#include <stdint.h>
+
+#include "march.h"
+#include "memfault.h"
+
+#define BITSIM_LANES 256
+
+struct bitsim_lanes {
+	uint64_t w[BITSIM_LANES / 64];
+};
+
+struct bitsim {
+	const struct march_test *test;
+	const struct march_background *bg;
+	unsigned nbg;
+	uint32_t base, size;
+	uint32_t first, count;      /* the bytes tested: count from byte first on */
+	uint8_t init;               /* memory contents before the test */
+	uint64_t delay;             /* operations a delay stands for */
+
+	/* Work areas of a pass. */
+	int32_t *slot;              /* per memory byte: its slot, or -1 */
+	uint32_t addr[2 * BITSIM_LANES];
+	unsigned nslots;
+	struct bitsim_lanes *cells; /* 8 per slot, one per bit */
+	uint16_t lane_start[2 * BITSIM_LANES + 1];
+	uint16_t lane_list[2 * BITSIM_LANES];
+	uint64_t written[BITSIM_LANES];
+};
+
+/* Set up a simulator for a test, its backgrounds and a memory, all of
+ * which is tested. */
+int bitsim_init(struct bitsim *s, const struct march_test *t, const struct march_background *bg,
+		unsigned nbg, uint32_t base, uint32_t size);
+void bitsim_free(struct bitsim *s);
+
+/* Run one pass over n <= BITSIM_LANES faults, which must lie in the memory.
+ * detected[i] is set if the test detects fault i, and time[i] is the
+ * operation of the first failing read. */
+void bitsim_run(struct bitsim *s, const struct mf_fault *faults, unsigned n, uint8_t *detected, uint64_t *time);
+
+/* The same for one fault, with the scalar models of memfault.c on the
+ * whole memory: the reference that bitsim_run() is checked against. */
+int bitsim_reference(const struct bitsim *s, const struct mf_fault *fault, uint8_t *detected, uint64_t *time);
+
+/* Total operations of the test, delays included. */
+uint64_t bitsim_total_ops(const struct bitsim *s);
+
+/* "avx2" or "64-bit", as compiled. */
+const char *bitsim_engine(void);
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * faultset.c - enumeration of the faults of a memory.
+ */
+
+#include "faultset.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int faultset_classes(const char *text, unsigned *classes)
+{
+	const char *s = text;
+	unsigned t;
+
+	*classes = 0;
+	while (*s) {
+		size_t n = strcspn(s, ",");
+
+		if (n == 3 && !strncmp(s, "all", 3)) {
+			*classes |= (1u << MF_NTYPES) - 1;
+		} else {
+			for (t = 0; t < MF_NTYPES; t++)
+				if (strlen(mf_type_name(t)) == n && !strncmp(s, mf_type_name(t), n))
+					break;
+			if (t == MF_NTYPES) {
+				fprintf(stderr, "bad fault class list '%s'\n", text);
+				return -1;
+			}
+			*classes |= 1u << t;
+		}
+		s += n;
+		if (*s == ',')
+			s++;
+	}
+	if (*classes)
+		return 0;
+	fprintf(stderr, "bad fault class list '%s'\n", text);
+	return -1;
+}
+
+/* Aggressor candidates of a victim cell, and parameter sets per aggressor. */
+static uint64_t candidates(const struct faultset *fs)
+{
+	return (2 * (uint64_t)fs->distance + 1) * 8 - 1;
+}
+
+static uint64_t class_size(const struct faultset *fs, enum mf_type t)
+{
+	uint64_t cells = (uint64_t)fs->size * 8;
+
+	switch (t) {
+	case MF_CFST:
+	case MF_CFID:
+		return cells * candidates(fs) * 4;
+	case MF_CFIN:
+		return cells * candidates(fs) * 2;
+	case MF_AF_NONE:
+		return fs->size;
+	case MF_AF_ALIAS:
+	case MF_AF_MULTI:
+		return (uint64_t)fs->size * fs->addr_bits;
+	default:
+		return cells * 2;
+	}
+}
+
+void faultset_init(struct faultset *fs, unsigned classes, uint32_t base, uint32_t size,
+		unsigned distance, uint64_t retention)
+{
+	unsigned t;
+
+	memset(fs, 0, sizeof(*fs));
+	fs->base = base;
+	fs->size = size;
+	fs->classes = classes;
+	fs->distance = distance;
+	fs->retention = retention;
+	while (fs->addr_bits < 32 && ((uint64_t)1 << fs->addr_bits) < size)
+		fs->addr_bits++;
+	for (t = 0; t < MF_NTYPES; t++)
+		fs->start[t + 1] = fs->start[t] + ((classes >> t) & 1 ? class_size(fs, t) : 0);
+}
+
+int faultset_get(const struct faultset *fs, uint64_t index, struct mf_fault *f)
+{
+	uint64_t i, ncand = candidates(fs), pos;
+	unsigned t = 0;
+	uint32_t off;
+
+	while (index >= fs->start[t + 1])
+		t++;
+	i = index - fs->start[t];
+	memset(f, 0, sizeof(*f));
+	f->type = t;
+
+	switch (t) {
+	case MF_CFST:
+	case MF_CFID:
+	case MF_CFIN:
+		if (t == MF_CFIN) {
+			f->up = (uint8_t)(i & 1);
+			i >>= 1;
+		} else {
+			f->value = (uint8_t)(i & 1);
+			if (t == MF_CFST)
+				f->state = (uint8_t)((i >> 1) & 1);
+			else
+				f->up = (uint8_t)((i >> 1) & 1);
+			i >>= 2;
+		}
+		pos = i % ncand;
+		i /= ncand;
+		f->victim.addr = fs->base + (uint32_t)(i / 8);
+		f->victim.bit = (uint8_t)(i % 8);
+		/* Skip the victim's own position among the 2 * distance + 1 bytes. */
+		if (pos >= 8 * (uint64_t)fs->distance + f->victim.bit)
+			pos++;
+		if (i / 8 + pos / 8 < fs->distance || i / 8 + pos / 8 - fs->distance >= fs->size)
+			return 0;
+		f->aggressor.addr = (uint32_t)(f->victim.addr + pos / 8 - fs->distance);
+		f->aggressor.bit = (uint8_t)(pos % 8);
+		return 1;
+	case MF_AF_NONE:
+		f->victim.addr = fs->base + (uint32_t)i;
+		return 1;
+	case MF_AF_ALIAS:
+	case MF_AF_MULTI:
+		off = (uint32_t)(i / fs->addr_bits) ^ (1u << (i % fs->addr_bits));
+		if (off >= fs->size)
+			return 0;
+		f->victim.addr = fs->base + (uint32_t)(i / fs->addr_bits);
+		f->aggressor.addr = fs->base + off;
+		return 1;
+	default:
+		f->victim.addr = fs->base + (uint32_t)(i / 16);
+		f->victim.bit = (uint8_t)(i / 2 % 8);
+		if (t == MF_TF)
+			f->up = (uint8_t)(i & 1);
+		else if (t == MF_SAF)
+			f->value = (uint8_t)(i & 1);
+		else
+			f->state = (uint8_t)(i & 1);
+		if (t == MF_DRF)
+			f->retention = fs->retention;
+		return 1;
+	}
+}
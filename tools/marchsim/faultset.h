@@ -0,0 +1,44 @@
+/*
+ * faultset.h - enumeration of the faults of a memory.
+ *
+ * The faults of the chosen classes are numbered class by class, then by
+ * victim cell, aggressor and parameters, so that any range of indices can
+ * be simulated on its own. Coupling faults take their aggressor within
+ * distance bytes of the victim, in either direction; the address decoder
+ * faults pair an address with the addresses one address bit away. Indices
+ * whose aggressor would lie outside the memory are holes.
+ */
+
+#ifndef MARCHSIM_FAULTSET_H
+#define MARCHSIM_FAULTSET_H
+
+#include <stdint.h>
+
+#include "memfault.h"
+
+struct faultset {
+	uint32_t base, size;
+	unsigned classes;           /* bit per enum mf_type */
+	unsigned distance;          /* coupling: bytes between aggressor and victim */
+	uint64_t retention;         /* drf */
+	unsigned addr_bits;         /* af-alias, af-multi: address bits of the memory */
+	uint64_t start[MF_NTYPES + 1];
+};
+
+/* Parse a class list: type names of memfault.h separated by commas, or
+ * "all". Returns 0, or -1 with a message on stderr. */
+int faultset_classes(const char *text, unsigned *classes);
+
+void faultset_init(struct faultset *fs, unsigned classes, uint32_t base, uint32_t size,
+		unsigned distance, uint64_t retention);
+
+/* Number of indices, holes included. */
+static inline uint64_t faultset_size(const struct faultset *fs)
+{
+	return fs->start[MF_NTYPES];
+}
+
+/* The fault of an index; returns 0 for a hole. */
+int faultset_get(const struct faultset *fs, uint64_t index, struct mf_fault *f);
+
+#endif
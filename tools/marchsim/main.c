@@ -0,0 +1,351 @@
+/*
+ * marchsim - March test fault simulator.
+ *
+ * Runs a March test, as ramtest.S and classb_marchX() implement them,
+ * against every fault of the chosen classes of memfault.h in a memory of
+ * the given size and reports the fault coverage per class. The faults are
+ * simulated BITSIM_LANES at a time by the bit-sliced engine of bitsim.h;
+ * --check compares it against the scalar models of the simulator.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bitsim.h"
+#include "faultset.h"
+#include "march.h"
+#include "memfault.h"
+
+#define MAX_FAULTS 256
+
+struct tally {
+	uint64_t faults, detected, time;    /* time: sum over the detected faults */
+};
+
+static int parse_u64(const char *s, uint64_t *v)
+{
+	char *end;
+
+	if (!*s)
+		return -1;
+	*v = strtoull(s, &end, 0);
+	/* Allow 1e6 style numbers. */
+	if (*end == 'e' || *end == 'E') {
+		long e = strtol(end + 1, &end, 10);
+
+		while (e-- > 0)
+			*v *= 10;
+	}
+	return *end ? -1 : 0;
+}
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void list_tests(void)
+{
+	struct march_test t;
+	char buf[512];
+	unsigned i;
+
+	for (i = 0; i < march_nbuiltins; i++) {
+		if (march_parse(march_builtins[i].notation, &t))
+			continue;
+		march_format(&t, 0, buf, sizeof(buf));
+		printf("%-11s %2un  %s\n            %s\n", march_builtins[i].name, march_ops_per_cell(&t),
+				march_builtins[i].note, buf);
+	}
+}
+
+/* Compare a pass with the reference simulation of its faults. */
+static unsigned check_pass(const struct bitsim *s, const struct mf_fault *faults, unsigned n,
+		const uint8_t *detected, const uint64_t *time)
+{
+	unsigned i, bad = 0;
+	char spec[96];
+
+	for (i = 0; i < n; i++) {
+		uint8_t d;
+		uint64_t t;
+
+		if (bitsim_reference(s, &faults[i], &d, &t))
+			continue;
+		if (d == detected[i] && (!d || t == time[i]))
+			continue;
+		mf_format(&faults[i], spec, sizeof(spec));
+		fprintf(stderr, "marchsim: %s: bit-sliced %s %llu, reference %s %llu\n", spec,
+				detected[i] ? "detected at" : "missed", (unsigned long long)time[i],
+				d ? "detected at" : "missed", (unsigned long long)t);
+		bad++;
+	}
+	return bad;
+}
+
+static int write_json(const char *path, const char *test, const struct bitsim *s, const struct faultset *fs,
+		const struct tally *tally, double seconds)
+{
+	FILE *f = fopen(path, "w");
+	unsigned t, first = 1;
+	char buf[512];
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	march_format(s->test, 1, buf, sizeof(buf));
+	fprintf(f, "{\n  \"test\": \"%s\",\n  \"notation\": \"%s\",\n", test, buf);
+	fprintf(f, "  \"backgrounds\": [");
+	for (t = 0; t < s->nbg; t++)
+		fprintf(f, "%s[%u, %u]", t ? ", " : "", s->bg[t].zero, s->bg[t].one);
+	fprintf(f, "],\n  \"base\": %lu,\n  \"size\": %lu,\n  \"distance\": %u,\n",
+			(unsigned long)s->base, (unsigned long)s->size, fs->distance);
+	fprintf(f, "  \"operations\": %llu,\n  \"engine\": \"%s\",\n  \"seconds\": %.3f,\n  \"classes\": {",
+			(unsigned long long)bitsim_total_ops(s), bitsim_engine(), seconds);
+	for (t = 0; t < MF_NTYPES; t++) {
+		if (!tally[t].faults)
+			continue;
+		fprintf(f, "%s\n    \"%s\": { \"faults\": %llu, \"detected\": %llu }", first ? "" : ",",
+				mf_type_name(t), (unsigned long long)tally[t].faults,
+				(unsigned long long)tally[t].detected);
+		first = 0;
+	}
+	fprintf(f, "\n  }\n}\n");
+	return fclose(f) ? -1 : 0;
+}
+
+static void usage(FILE *f)
+{
+	fprintf(f,
+		"Usage: marchsim [options]\n"
+		"\n"
+		"Simulate a March test against the faults of an SRAM and report the coverage.\n"
+		"\n"
+		"  -a, --algorithm TEST     built-in test or March notation (default march-c-)\n"
+		"  -b, --backgrounds LIST   data backgrounds: bytes D for (D, ~D), or 'bits' for\n"
+		"                           the bit by bit backgrounds of ramtest.S (default 0)\n"
+		"  -B, --base ADDR          first byte of the memory (default 0x2000)\n"
+		"  -s, --size N             bytes of the memory (default 8192)\n"
+		"  -c, --classes LIST       fault classes of memfault.h, or all (default all)\n"
+		"  -n, --distance N         coupling faults: aggressors within N bytes of the\n"
+		"                           victim (default 1)\n"
+		"  -r, --retention N        drf: retention time in operations (default 1e6)\n"
+		"  -y, --delay N            operations a del stands for (default 1e7)\n"
+		"  -i, --init BYTE          memory contents before the test (default 0)\n"
+		"  -F, --fault SPEC         simulate this fault only, see memfault.h (repeatable)\n"
+		"  -k, --check N            compare every Nth pass with the scalar fault models\n"
+		"  -j, --json FILE          also write the results as JSON\n"
+		"  -l, --list               list the built-in tests\n"
+		"  -h, --help               show this help\n"
+		"\n"
+		"Exit status: 0 on success, 1 if --check found a difference, 2 for usage errors.\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "algorithm", required_argument, NULL, 'a' },
+		{ "backgrounds", required_argument, NULL, 'b' },
+		{ "base", required_argument, NULL, 'B' },
+		{ "size", required_argument, NULL, 's' },
+		{ "classes", required_argument, NULL, 'c' },
+		{ "distance", required_argument, NULL, 'n' },
+		{ "retention", required_argument, NULL, 'r' },
+		{ "delay", required_argument, NULL, 'y' },
+		{ "init", required_argument, NULL, 'i' },
+		{ "fault", required_argument, NULL, 'F' },
+		{ "check", required_argument, NULL, 'k' },
+		{ "json", required_argument, NULL, 'j' },
+		{ "list", no_argument, NULL, 'l' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	const char *algorithm = "march-c-", *backgrounds = "0", *classes_arg = "all", *json = NULL;
+	uint64_t base = 0x2000, size = 8192, distance = 1, retention = 1000000, delay = 10000000;
+	uint64_t init = 0, check = 0, v, index, passes = 0;
+	struct march_test test;
+	struct march_background bg[MARCH_MAX_BACKGROUNDS];
+	struct mf_fault faults[MAX_FAULTS], given[MAX_FAULTS];
+	uint64_t time[MAX_FAULTS];
+	uint8_t detected[MAX_FAULTS];
+	struct tally tally[MF_NTYPES], total = { 0, 0, 0 };
+	unsigned ngiven = 0, classes, n, i, bad = 0;
+	struct faultset fs;
+	struct bitsim s;
+	double t0, seconds;
+	char buf[512];
+	int nbg, c, status = 0;
+
+	while ((c = getopt_long(argc, argv, "a:b:B:s:c:n:r:y:i:F:k:j:lh", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'a':
+			algorithm = optarg;
+			break;
+		case 'b':
+			backgrounds = optarg;
+			break;
+		case 'c':
+			classes_arg = optarg;
+			break;
+		case 'B':
+		case 's':
+		case 'n':
+		case 'r':
+		case 'y':
+		case 'i':
+		case 'k':
+			if (parse_u64(optarg, &v)) {
+				fprintf(stderr, "marchsim: bad number '%s'\n", optarg);
+				return 2;
+			}
+			if (c == 'B')
+				base = v;
+			else if (c == 's')
+				size = v;
+			else if (c == 'n')
+				distance = v;
+			else if (c == 'r')
+				retention = v;
+			else if (c == 'y')
+				delay = v;
+			else if (c == 'i')
+				init = v;
+			else
+				check = v;
+			break;
+		case 'F':
+			if (ngiven == MAX_FAULTS) {
+				fprintf(stderr, "marchsim: too many faults\n");
+				return 2;
+			}
+			if (mf_parse(optarg, &given[ngiven++]))
+				return 2;
+			break;
+		case 'j':
+			json = optarg;
+			break;
+		case 'l':
+			list_tests();
+			return 0;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+	if (optind != argc) {
+		usage(stderr);
+		return 2;
+	}
+	if (!size || size > 0x1000000 || base + size > 0x1000000 || distance > 64 || init > 0xFF || !retention) {
+		fprintf(stderr, "marchsim: bad memory or fault parameters\n");
+		return 2;
+	}
+	if (march_parse(algorithm, &test) || faultset_classes(classes_arg, &classes))
+		return 2;
+	nbg = march_backgrounds(backgrounds, bg, MARCH_MAX_BACKGROUNDS);
+	if (nbg < 0)
+		return 2;
+	for (i = 0; i < ngiven; i++) {
+		const struct mf_fault *f = &given[i];
+		int coupled = f->type == MF_CFST || f->type == MF_CFID || f->type == MF_CFIN
+				|| f->type == MF_AF_ALIAS || f->type == MF_AF_MULTI;
+
+		if (f->victim.addr < base || f->victim.addr - base >= size
+				|| (coupled && (f->aggressor.addr < base || f->aggressor.addr - base >= size))) {
+			mf_format(f, buf, sizeof(buf));
+			fprintf(stderr, "marchsim: %s is outside the memory\n", buf);
+			return 2;
+		}
+	}
+
+	if (bitsim_init(&s, &test, bg, (unsigned)nbg, (uint32_t)base, (uint32_t)size)) {
+		fprintf(stderr, "marchsim: out of memory\n");
+		return 1;
+	}
+	s.init = (uint8_t)init;
+	s.delay = delay;
+	faultset_init(&fs, classes, (uint32_t)base, (uint32_t)size, (unsigned)distance, retention);
+	memset(tally, 0, sizeof(tally));
+
+	march_format(&test, 0, buf, sizeof(buf));
+	printf("test        %s\n", buf);
+	printf("            %un, %d background%s, %llu operations\n", march_ops_per_cell(&test), nbg,
+			nbg == 1 ? "" : "s", (unsigned long long)bitsim_total_ops(&s));
+
+	if (ngiven) {
+		bitsim_run(&s, given, ngiven, detected, time);
+		for (i = 0; i < ngiven; i++) {
+			mf_format(&given[i], buf, sizeof(buf));
+			if (detected[i])
+				printf("fault       %s: detected at operation %llu\n", buf, (unsigned long long)time[i]);
+			else
+				printf("fault       %s: not detected\n", buf);
+		}
+		if (check && check_pass(&s, given, ngiven, detected, time))
+			status = 1;
+		bitsim_free(&s);
+		return status;
+	}
+
+	t0 = now_seconds();
+	index = 0;
+	while (index < faultset_size(&fs)) {
+		for (n = 0; n < MAX_FAULTS && index < faultset_size(&fs); index++)
+			if (faultset_get(&fs, index, &faults[n]))
+				n++;
+		bitsim_run(&s, faults, n, detected, time);
+		for (i = 0; i < n; i++) {
+			struct tally *t = &tally[faults[i].type];
+
+			t->faults++;
+			if (detected[i]) {
+				t->detected++;
+				t->time += time[i];
+			}
+		}
+		if (check && passes % check == 0)
+			bad += check_pass(&s, faults, n, detected, time);
+		passes++;
+	}
+	seconds = now_seconds() - t0;
+
+	printf("\n%-10s %12s %12s %9s %16s\n", "class", "faults", "detected", "coverage", "mean detection");
+	for (i = 0; i < MF_NTYPES; i++) {
+		const struct tally *t = &tally[i];
+
+		if (!t->faults)
+			continue;
+		printf("%-10s %12llu %12llu %8.2f%% %16.0f\n", mf_type_name(i), (unsigned long long)t->faults,
+				(unsigned long long)t->detected, 100.0 * t->detected / t->faults,
+				t->detected ? (double)t->time / t->detected : 0.0);
+		total.faults += t->faults;
+		total.detected += t->detected;
+		total.time += t->time;
+	}
+	printf("%-10s %12llu %12llu %8.2f%% %16.0f\n", "total", (unsigned long long)total.faults,
+			(unsigned long long)total.detected, total.faults ? 100.0 * total.detected / total.faults : 0.0,
+			total.detected ? (double)total.time / total.detected : 0.0);
+	printf("\n%llu passes in %.2f s, %.0f faults/s (%s)\n", (unsigned long long)passes, seconds,
+			seconds > 0 ? total.faults / seconds : 0.0, bitsim_engine());
+	if (check)
+		printf("check       %u difference%s\n", bad, bad == 1 ? "" : "s");
+
+	if (json && write_json(json, algorithm, &s, &fs, tally, seconds))
+		status = 1;
+	if (bad)
+		status = 1;
+	bitsim_free(&s);
+	return status;
+}
@@ -0,0 +1,410 @@
+/*
+ * sramlayout - linker settings for classb_buffer and the map of the SRAM
+ * test sections.
+ *
+ * classb_sram_test() needs its buffer at the start of the internal SRAM
+ * and .data moved past it. With avr-gcc this takes a .classb_sram_buffer
+ * section at INTERNAL_SRAM_START and a new start address for .data, both
+ * of which follow from the device and from CLASSB_NSECS and CLASSB_OVERLAP
+ * in classb_sram.h. This tool computes them and prints them as Atmel
+ * Studio memory settings, as linker flags or as a linker script fragment.
+ *
+ * Given the linked ELF file, it also checks the placement and lists the
+ * objects of .data, .bss and .noinit, and the stack, in each test section.
+ * The sections differ in size, and all but the buffer are copied to the
+ * buffer and back, so the list shows which data is covered by the faster
+ * sections.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elf32.h"
+#include "xmega_devices.h"
+
+#define MAX_SECTIONS 256
+
+struct layout {
+	uint32_t sram_start, sram_size;
+	unsigned nsecs;
+	unsigned long overlap;      /* percent */
+	uint32_t sec_size, rem, ovl_size, buffer_size;
+	struct {
+		uint32_t start, count;  /* data addresses */
+		int copied;             /* saved to the buffer and restored */
+	} sec[MAX_SECTIONS];
+	unsigned nsec;
+};
+
+enum format { FORMAT_REPORT, FORMAT_STUDIO, FORMAT_FLAGS, FORMAT_LD };
+
+struct object {
+	const char *name;
+	const char *section;
+	uint32_t addr, size;        /* data addresses */
+};
+
+/* The sections of classb_sram_test(), as in classb_sram.c. */
+static void compute(struct layout *l)
+{
+	unsigned k;
+
+	l->sec_size = l->sram_size / l->nsecs;
+	l->rem = l->sram_size % l->nsecs;
+	l->ovl_size = (uint32_t)((unsigned long long)l->sec_size * l->overlap / 100);
+	l->buffer_size = l->sec_size + l->ovl_size;
+	l->nsec = 0;
+	for (k = 0; k < l->nsecs; k++) {
+		l->sec[k].start = l->sram_start + (k == 0 ? 0 : k == 1 ? l->sec_size : k * l->sec_size - l->ovl_size);
+		l->sec[k].count = k == 1 ? l->sec_size : l->sec_size + l->ovl_size;
+		l->sec[k].copied = k != 0;
+	}
+	l->nsec = l->nsecs;
+	if (l->rem) {
+		l->sec[k].start = l->sram_start + l->nsecs * l->sec_size - l->ovl_size;
+		l->sec[k].count = l->rem + l->ovl_size;
+		l->sec[k].copied = 1;
+		l->nsec++;
+	}
+}
+
+/* CLASSB_NSECS and CLASSB_OVERLAP from classb_sram.h. */
+static int read_config(const char *path, unsigned *nsecs, unsigned long *overlap, int *have_nsecs,
+		int *have_overlap)
+{
+	char line[512];
+	FILE *f = fopen(path, "r");
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long v;
+
+		if (!*have_nsecs && sscanf(line, " #define CLASSB_NSECS %lu", &v) == 1) {
+			*nsecs = (unsigned)v;
+			*have_nsecs = 1;
+		} else if (!*have_overlap && sscanf(line, " #define CLASSB_OVERLAP %lu", &v) == 1) {
+			*overlap = v;
+			*have_overlap = 1;
+		}
+	}
+	fclose(f);
+	if (!*have_nsecs || !*have_overlap) {
+		fprintf(stderr, "%s: no #define of %s\n", path, !*have_nsecs ? "CLASSB_NSECS" : "CLASSB_OVERLAP");
+		return -1;
+	}
+	return 0;
+}
+
+static void print_studio(FILE *f, const struct layout *l)
+{
+	fprintf(f, ".classb_sram_buffer=0x%X\n", (unsigned)l->sram_start);
+	fprintf(f, ".data=0x%X\n", (unsigned)(l->sram_start + l->buffer_size));
+}
+
+static void print_flags(FILE *f, const struct layout *l)
+{
+	fprintf(f, "-Wl,--section-start=.classb_sram_buffer=0x%lX -Wl,--section-start=.data=0x%lX\n",
+			AVR_SRAM_BASE + l->sram_start, AVR_SRAM_BASE + l->sram_start + l->buffer_size);
+}
+
+static void print_ld(FILE *f, const struct layout *l, const char *device)
+{
+	fprintf(f,
+		"/* classb_buffer for %s: CLASSB_NSECS %u, CLASSB_OVERLAP %lu.\n"
+		" * Link with -Wl,-T,<this file> -Wl,--section-start=.data=0x%lX. */\n"
+		"SECTIONS\n"
+		"{\n"
+		"  .classb_sram_buffer 0x%lX (NOLOAD) :\n"
+		"  {\n"
+		"    KEEP (*(.classb_sram_buffer))\n"
+		"  }\n"
+		"}\n"
+		"INSERT BEFORE .data;\n"
+		"ASSERT (SIZEOF (.classb_sram_buffer) == %lu, \"classb_buffer does not match CLASSB_NSECS and CLASSB_OVERLAP\");\n"
+		"ASSERT (ADDR (.data) >= 0x%lX, \".data overlaps classb_buffer\");\n",
+		device, l->nsecs, l->overlap, AVR_SRAM_BASE + l->sram_start + l->buffer_size,
+		AVR_SRAM_BASE + l->sram_start, (unsigned long)l->buffer_size,
+		AVR_SRAM_BASE + l->sram_start + l->buffer_size);
+}
+
+static int cmp_object(const void *a, const void *b)
+{
+	const struct object *oa = a, *ob = b;
+
+	if (oa->addr != ob->addr)
+		return oa->addr < ob->addr ? -1 : 1;
+	return strcmp(oa->name, ob->name);
+}
+
+/* The objects in the internal SRAM, by address. */
+static struct object *sram_objects(const struct elf_file *ef, const struct layout *l, unsigned *n)
+{
+	struct object *o = malloc((ef->nsymbols ? ef->nsymbols : 1) * sizeof(*o));
+	unsigned i;
+
+	*n = 0;
+	if (!o)
+		return NULL;
+	for (i = 0; i < ef->nsymbols; i++) {
+		const struct elf_symbol *s = &ef->symbols[i];
+		uint32_t a = s->value - AVR_SRAM_BASE;
+
+		if (s->type != ELF_STT_OBJECT || !s->size || s->value < AVR_SRAM_BASE || s->value >= AVR_EEPROM_BASE)
+			continue;
+		if (a + s->size <= l->sram_start || a >= l->sram_start + l->sram_size)
+			continue;
+		o[*n].name = s->name;
+		o[*n].section = s->shndx < ef->nsections ? ef->sections[s->shndx].name : "?";
+		o[*n].addr = a;
+		o[*n].size = s->size;
+		(*n)++;
+	}
+	qsort(o, *n, sizeof(*o), cmp_object);
+	return o;
+}
+
+/* Check the buffer and .data against the layout; returns the number of problems. */
+static int check_placement(FILE *f, const struct elf_file *ef, const struct layout *l)
+{
+	const struct elf_section *buf = elf_find_section(ef, ".classb_sram_buffer");
+	const struct elf_section *data = elf_find_section(ef, ".data");
+	const struct elf_symbol *sym = elf_find_symbol(ef, "classb_buffer");
+	uint32_t start = AVR_SRAM_BASE + l->sram_start, end = start + l->buffer_size;
+	int problems = 0;
+
+	if (!buf) {
+		fprintf(f, "error: no .classb_sram_buffer section\n");
+		return 1;
+	}
+	if (buf->addr != start) {
+		fprintf(f, "error: .classb_sram_buffer is at 0x%lX, not at the start of the SRAM 0x%lX\n",
+				(unsigned long)(buf->addr - AVR_SRAM_BASE), (unsigned long)l->sram_start);
+		problems++;
+	}
+	if (buf->size != l->buffer_size) {
+		fprintf(f, "error: .classb_sram_buffer has %lu bytes, the configuration needs %lu\n",
+				(unsigned long)buf->size, (unsigned long)l->buffer_size);
+		problems++;
+	}
+	if (sym && sym->value != start) {
+		fprintf(f, "error: classb_buffer is at 0x%lX\n", (unsigned long)(sym->value - AVR_SRAM_BASE));
+		problems++;
+	}
+	if (data && data->addr < end && data->addr + data->size > start) {
+		fprintf(f, "error: .data (0x%lX-0x%lX) overlaps classb_buffer (0x%lX-0x%lX)\n",
+				(unsigned long)(data->addr - AVR_SRAM_BASE),
+				(unsigned long)(data->addr - AVR_SRAM_BASE + data->size - 1),
+				(unsigned long)l->sram_start, (unsigned long)(l->sram_start + l->buffer_size - 1));
+		problems++;
+	}
+	return problems;
+}
+
+static void print_report(const struct layout *l, const char *device, const struct elf_file *ef)
+{
+	const struct elf_symbol *heap = ef ? elf_find_symbol(ef, "__heap_start") : NULL;
+	struct object *o = NULL;
+	unsigned no = 0, k, i;
+
+	printf("%s: %lu bytes of SRAM at 0x%lX, CLASSB_NSECS %u, CLASSB_OVERLAP %lu%%\n", device,
+			(unsigned long)l->sram_size, (unsigned long)l->sram_start, l->nsecs, l->overlap);
+	printf("classb_buffer: 0x%lX-0x%lX, %lu bytes\n\n", (unsigned long)l->sram_start,
+			(unsigned long)(l->sram_start + l->buffer_size - 1), (unsigned long)l->buffer_size);
+	printf("Atmel Studio, AVR/GNU Linker > Memory Settings, SRAM segment:\n");
+	print_studio(stdout, l);
+	printf("\nLinker flags:\n");
+	print_flags(stdout, l);
+	printf("\n");
+
+	if (ef)
+		o = sram_objects(ef, l, &no);
+	printf("%-8s %-15s %8s %8s\n", "section", "addresses", "tested", "copied");
+	for (k = 0; k < l->nsec; k++) {
+		uint32_t s = l->sec[k].start, e = s + l->sec[k].count;
+
+		printf("%-8u 0x%04lX-0x%04lX %8lu %8lu\n", k, (unsigned long)s, (unsigned long)(e - 1),
+				(unsigned long)l->sec[k].count, l->sec[k].copied ? (unsigned long)l->sec[k].count : 0UL);
+		for (i = 0; i < no; i++)
+			if (o[i].addr < e && o[i].addr + o[i].size > s)
+				printf("           0x%04lX %6lu  %-19s %s\n", (unsigned long)o[i].addr,
+						(unsigned long)o[i].size, o[i].section, o[i].name);
+		if (heap && heap->value - AVR_SRAM_BASE < e)
+			printf("           0x%04lX %6lu  %-19s %s\n",
+					(unsigned long)(heap->value - AVR_SRAM_BASE > s ? heap->value - AVR_SRAM_BASE : s),
+					(unsigned long)(e - (heap->value - AVR_SRAM_BASE > s ? heap->value - AVR_SRAM_BASE : s)),
+					"", "(heap and stack)");
+	}
+	free(o);
+}
+
+static void usage(FILE *f)
+{
+	unsigned i;
+
+	fprintf(f,
+		"Usage: sramlayout [options] [IMAGE.elf]\n"
+		"\n"
+		"Compute the linker settings for classb_buffer and map the SRAM test sections.\n"
+		"With IMAGE, check its placement and list the objects in each section.\n"
+		"\n"
+		"  -c, --config FILE        classb_sram.h to read CLASSB_NSECS and CLASSB_OVERLAP from\n"
+		"  -n, --nsecs N            CLASSB_NSECS\n"
+		"  -O, --overlap PCT        CLASSB_OVERLAP\n"
+		"  -d, --device NAME        device (default: from the ELF device info)\n"
+		"  -f, --format FORMAT      report (default), studio (memory settings),\n"
+		"                           flags (linker flags) or ld (linker script fragment)\n"
+		"  -o, --output FILE        output file for studio, flags and ld\n"
+		"  -h, --help               show this help\n"
+		"\n"
+		"Exit status: 0, or 1 if the image does not match the configuration.\n"
+		"\n"
+		"Devices:");
+	for (i = 0; i < xmega_ndevices; i++)
+		fprintf(f, " %s", xmega_devices[i].name);
+	fprintf(f, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "config", required_argument, NULL, 'c' },
+		{ "nsecs", required_argument, NULL, 'n' },
+		{ "overlap", required_argument, NULL, 'O' },
+		{ "device", required_argument, NULL, 'd' },
+		{ "format", required_argument, NULL, 'f' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	const char *config = NULL, *device = NULL, *output = NULL;
+	const struct xmega_device *dev;
+	enum format format = FORMAT_REPORT;
+	struct layout l = { 0 };
+	struct elf_file ef;
+	int have_nsecs = 0, have_overlap = 0, have_elf, c, status = 0;
+	unsigned long v;
+	char *end;
+	FILE *f = stdout;
+
+	while ((c = getopt_long(argc, argv, "c:n:O:d:f:o:h", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'c':
+			config = optarg;
+			break;
+		case 'n':
+		case 'O':
+			v = strtoul(optarg, &end, 0);
+			if (*end == 'U' || *end == 'u')
+				end++;
+			if (*end == 'L' || *end == 'l')
+				end++;
+			if (*end || end == optarg || (c == 'n' && (v == 0 || v >= MAX_SECTIONS)) || (c == 'O' && v > 100)) {
+				fprintf(stderr, "sramlayout: bad %s '%s'\n", c == 'n' ? "number of sections" : "overlap",
+						optarg);
+				return 2;
+			}
+			if (c == 'n') {
+				l.nsecs = (unsigned)v;
+				have_nsecs = 1;
+			} else {
+				l.overlap = v;
+				have_overlap = 1;
+			}
+			break;
+		case 'd':
+			device = optarg;
+			break;
+		case 'f':
+			if (!strcmp(optarg, "report"))
+				format = FORMAT_REPORT;
+			else if (!strcmp(optarg, "studio"))
+				format = FORMAT_STUDIO;
+			else if (!strcmp(optarg, "flags"))
+				format = FORMAT_FLAGS;
+			else if (!strcmp(optarg, "ld"))
+				format = FORMAT_LD;
+			else {
+				fprintf(stderr, "sramlayout: unknown format '%s'\n", optarg);
+				return 2;
+			}
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+	if (optind + 1 < argc) {
+		usage(stderr);
+		return 2;
+	}
+	have_elf = optind < argc;
+	if (config && read_config(config, &l.nsecs, &l.overlap, &have_nsecs, &have_overlap))
+		return 2;
+	if (!have_nsecs || !have_overlap) {
+		fprintf(stderr, "sramlayout: give classb_sram.h with --config, or --nsecs and --overlap\n");
+		return 2;
+	}
+	if (l.nsecs == 0 || l.nsecs >= MAX_SECTIONS || l.overlap > 100) {
+		fprintf(stderr, "sramlayout: CLASSB_NSECS %u or CLASSB_OVERLAP %lu out of range\n", l.nsecs, l.overlap);
+		return 2;
+	}
+	if (have_elf && elf_load(argv[optind], &ef))
+		return 2;
+	dev = device ? xmega_find_device(device) : have_elf ? xmega_detect_device(&ef) : NULL;
+	if (!dev) {
+		if (device)
+			fprintf(stderr, "sramlayout: unknown device '%s'\n", device);
+		else
+			fprintf(stderr, "sramlayout: no device, use -d\n");
+		if (have_elf)
+			elf_free(&ef);
+		return 2;
+	}
+	l.sram_start = XMEGA_INTERNAL_SRAM_START;
+	l.sram_size = dev->sram_size;
+	compute(&l);
+
+	if (format == FORMAT_REPORT) {
+		print_report(&l, dev->name, have_elf ? &ef : NULL);
+		if (have_elf) {
+			printf("\n");
+			if (check_placement(stdout, &ef, &l))
+				status = 1;
+			else
+				printf("%s: classb_buffer and .data are placed correctly\n", argv[optind]);
+		}
+	} else {
+		if (output && !(f = fopen(output, "w"))) {
+			perror(output);
+			status = 2;
+		} else if (format == FORMAT_STUDIO) {
+			print_studio(f, &l);
+		} else if (format == FORMAT_FLAGS) {
+			print_flags(f, &l);
+		} else {
+			print_ld(f, &l, dev->name);
+		}
+		if (f && f != stdout && fclose(f)) {
+			perror(output);
+			status = 2;
+		}
+		if (have_elf && !status && check_placement(stderr, &ef, &l))
+			status = 1;
+	}
+	if (have_elf)
+		elf_free(&ef);
+	return status;
+}
@@ -0,0 +1,1078 @@
+/*
+ * analysis.c - static worst-case execution time of AVRxm functions.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "analysis.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "avr_cpu.h"
+
+#define UNSET UINT64_MAX
+
+/* Per word address, while a function is explored. */
+#define MARK_SEEN   0x01        /* first word of an instruction */
+#define MARK_LEADER 0x02        /* starts a block */
+#define MARK_END    0x04        /* ends a block: branch, skip, jump, return */
+
+enum kind {
+	K_NORMAL,
+	K_BRANCH,                   /* taken: +1 cycle */
+	K_SKIP,                     /* skipping: +1 cycle per word skipped */
+	K_JUMP,
+	K_CALL,
+	K_RET,
+	K_IJMP,
+	K_ICALL,
+	K_SLEEP,
+	K_SPM,
+	K_INVALID,
+};
+
+struct insn {
+	unsigned words;
+	unsigned cycles;            /* branch not taken, nothing skipped, loads from SRAM */
+	enum kind kind;
+	uint32_t target;            /* word address, for branches, jumps and calls */
+};
+
+struct edge {
+	uint32_t to;                /* word address while building, then block index */
+	uint32_t extra;             /* cycles of taking this edge */
+};
+
+struct block {
+	uint32_t start, last;       /* word addresses of the first and last instruction */
+	uint64_t cost;              /* the callees included */
+	struct edge succ[2];
+	unsigned nsucc;
+};
+
+struct loop {
+	int header;
+	int *body;                  /* blocks, the header included */
+	unsigned nbody;
+};
+
+#define EXIT_PC UINT32_MAX
+
+static uint64_t add_sat(uint64_t a, uint64_t b)
+{
+	return a > UNSET - 1 - b ? UNSET - 1 : a + b;
+}
+
+static uint64_t mul_sat(uint64_t a, uint64_t b)
+{
+	return a && b > (UNSET - 1) / a ? UNSET - 1 : a * b;
+}
+
+static void decode(const struct wcet *w, uint32_t pc, struct insn *in)
+{
+	uint16_t op = pc < w->flash_words ? w->flash[pc] : 0xFFFF;
+	uint16_t next = pc + 1 < w->flash_words ? w->flash[pc + 1] : 0xFFFF;
+	unsigned pcb3 = w->pc_bytes == 3;
+	int32_t k;
+
+	in->words = avr_insn_words(op);
+	in->cycles = 1;
+	in->kind = K_NORMAL;
+	in->target = 0;
+	if (pc >= w->flash_words) {
+		in->kind = K_INVALID;
+		return;
+	}
+	switch (op >> 12) {
+	case 0x0:
+		if ((op & 0xFF00) == 0x0000 && op != 0)
+			in->kind = K_INVALID;
+		else if ((op & 0xFE00) == 0x0200)   /* MULS, MULSU, FMUL* */
+			in->cycles = 2;
+		break;
+	case 0x1:
+		if ((op & 0x0C00) == 0x0000)        /* CPSE */
+			in->kind = K_SKIP;
+		break;
+	case 0x8:
+	case 0xA:                               /* LDD/STD */
+		in->cycles = (op & 0x2C07) ? 2 : 1;
+		if (!(op & 0x0200))
+			in->cycles++;
+		break;
+	case 0x9:
+		switch ((op >> 8) & 0xF) {
+		case 0x0:
+		case 0x1:                           /* loads */
+			switch (op & 0xF) {
+			case 0x0: in->cycles = 3; break;                    /* LDS */
+			case 0x1: case 0x9: case 0xC: case 0xD:
+				in->cycles = 2; break;                          /* LD Z+, Y+, X, X+ */
+			case 0x2: case 0xA: case 0xE:
+				in->cycles = 3; break;                          /* LD -Z, -Y, -X */
+			case 0x4: case 0x5: case 0x6: case 0x7:
+				in->cycles = 3; break;                          /* LPM, ELPM */
+			case 0xF: in->cycles = 2; break;                    /* POP */
+			default: in->kind = K_INVALID; break;
+			}
+			break;
+		case 0x2:
+		case 0x3:                           /* stores */
+			switch (op & 0xF) {
+			case 0x0: case 0x2: case 0xA: case 0xE:
+			case 0x4: case 0x5: case 0x6: case 0x7:
+				in->cycles = 2; break;                          /* STS, ST -Z/-Y/-X, XCH, LAS, LAC, LAT */
+			case 0x1: case 0x9: case 0xC: case 0xD: case 0xF:
+				break;                                          /* ST Z+/Y+/X/X+, PUSH */
+			default: in->kind = K_INVALID; break;
+			}
+			break;
+		case 0x4:
+		case 0x5:
+			if ((op & 0x0E) == 0x0C || (op & 0x0E) == 0x0E) {   /* JMP, CALL */
+				in->target = ((uint32_t)(((op >> 3) & 0x3E) | (op & 1)) << 16) | next;
+				in->kind = (op & 2) ? K_CALL : K_JUMP;
+				in->cycles = (op & 2) ? (pcb3 ? 4 : 3) : 3;
+				break;
+			}
+			switch (op & 0xF) {
+			case 0x8:
+				if (!(op & 0x0100))
+					break;                                      /* BSET, BCLR */
+				switch ((op >> 4) & 0xF) {
+				case 0x0: case 0x1: in->kind = K_RET; in->cycles = pcb3 ? 5 : 4; break;
+				case 0x8: in->kind = K_SLEEP; break;
+				case 0x9: case 0xA: break;                      /* BREAK, WDR */
+				case 0xC: case 0xD: in->cycles = 3; break;      /* LPM, ELPM */
+				case 0xE: case 0xF: in->kind = K_SPM; break;
+				default: in->kind = K_INVALID; break;
+				}
+				break;
+			case 0x9:
+				switch (op & 0x01F0) {
+				case 0x0000: case 0x0010: in->kind = K_IJMP; in->cycles = 2; break;
+				case 0x0100: in->kind = K_ICALL; in->cycles = pcb3 ? 3 : 2; break;
+				case 0x0110: in->kind = K_ICALL; in->cycles = 3; break;
+				default: in->kind = K_INVALID; break;
+				}
+				break;
+			case 0x4:
+			case 0xB:
+				in->kind = K_INVALID;
+				break;
+			}
+			break;
+		case 0x6:
+		case 0x7:                           /* ADIW, SBIW */
+			in->cycles = 2;
+			break;
+		case 0x9:
+		case 0xB:                           /* SBIC, SBIS */
+			in->cycles = 2;
+			in->kind = K_SKIP;
+			break;
+		case 0x8:
+		case 0xA:                           /* CBI, SBI */
+			break;
+		default:                            /* MUL */
+			in->cycles = 2;
+			break;
+		}
+		break;
+	case 0xC:                               /* RJMP */
+	case 0xD:                               /* RCALL */
+		k = (int32_t)((int16_t)(op << 4) >> 4);
+		in->target = (uint32_t)((int32_t)pc + 1 + k) % w->flash_words;
+		in->kind = (op >> 12) == 0xC ? K_JUMP : K_CALL;
+		in->cycles = (op >> 12) == 0xC ? 2 : pcb3 ? 3 : 2;
+		break;
+	case 0xF:
+		if (!(op & 0x0800)) {               /* BRBS, BRBC */
+			k = (int32_t)((int16_t)(op << 6) >> 9);
+			in->target = (uint32_t)((int32_t)pc + 1 + k) % w->flash_words;
+			in->kind = K_BRANCH;
+		} else if (op & 0x0008) {
+			in->kind = K_INVALID;
+		} else if (op & 0x0400) {           /* SBRC, SBRS */
+			in->kind = K_SKIP;
+		}
+		break;
+	}
+}
+
+static int cmp_func(const void *a, const void *b)
+{
+	const struct wcet_func *fa = a, *fb = b;
+
+	return fa->entry < fb->entry ? -1 : fa->entry > fb->entry;
+}
+
+int wcet_init(struct wcet *w, const struct elf_file *ef, const struct xmega_device *dev)
+{
+	uint32_t size = dev->app_size + dev->boot_size, i;
+	uint8_t *image;
+	char value[32];
+
+	memset(w, 0, sizeof(*w));
+	w->ef = ef;
+	w->dev = dev;
+	w->flash_words = size / 2;
+	w->pc_bytes = xmega_pc_bytes(dev);
+	w->consts.ef = ef;
+	image = malloc(size);
+	w->flash = malloc(w->flash_words * sizeof(*w->flash));
+	if (!image || !w->flash) {
+		free(image);
+		fprintf(stderr, "wcet: out of memory\n");
+		return -1;
+	}
+	memset(image, 0xFF, size);
+	elf_load_image(ef, AVR_FLASH_BASE, image, size);
+	for (i = 0; i < w->flash_words; i++)
+		w->flash[i] = (uint16_t)(image[2 * i] | image[2 * i + 1] << 8);
+	free(image);
+
+	for (i = 0; i < ef->nsymbols; i++) {
+		const struct elf_symbol *s = &ef->symbols[i];
+		unsigned j;
+
+		if (s->type != ELF_STT_FUNC || !s->size || s->value >= size || (s->value & 1))
+			continue;
+		for (j = 0; j < w->nfuncs; j++)
+			if (w->funcs[j].entry == s->value / 2)
+				break;
+		if (j < w->nfuncs) {
+			/* Aliases: prefer the global name. */
+			if (s->bind != ELF_STB_LOCAL)
+				w->funcs[j].name = s->name;
+			continue;
+		}
+		if (wcet_func_at(w, s->value / 2) < 0)
+			return -1;
+		w->funcs[w->nfuncs - 1].name = s->name;
+		w->funcs[w->nfuncs - 1].size = s->size / 2;
+	}
+	if (w->nfuncs)
+		qsort(w->funcs, w->nfuncs, sizeof(*w->funcs), cmp_func);
+
+	/* The names of the device headers. */
+#define DEFINE(n, v) \
+	(snprintf(value, sizeof(value), "0x%lX", (unsigned long)(v)), \
+	 const_define(&w->consts, n, value, dev->name, 0))
+	if (DEFINE("INTERNAL_SRAM_START", XMEGA_INTERNAL_SRAM_START)
+			|| DEFINE("INTERNAL_SRAM_SIZE", dev->sram_size)
+			|| DEFINE("INTERNAL_SRAM_END", XMEGA_INTERNAL_SRAM_START + dev->sram_size - 1)
+			|| DEFINE("MAPPED_EEPROM_START", XMEGA_MAPPED_EEPROM_START)
+			|| DEFINE("EEPROM_SIZE", dev->eeprom_size)
+			|| DEFINE("APP_SECTION_SIZE", dev->app_size)
+			|| DEFINE("BOOT_SECTION_SIZE", dev->boot_size)
+			|| DEFINE("FLASHEND", size - 1)) {
+		fprintf(stderr, "wcet: out of memory\n");
+		return -1;
+	}
+#undef DEFINE
+	return 0;
+}
+
+void wcet_free(struct wcet *w)
+{
+	unsigned i;
+
+	for (i = 0; i < w->nfuncs; i++) {
+		free(w->funcs[i].loops);
+		free(w->funcs[i].callees);
+	}
+	for (i = 0; i < w->nbounds; i++) {
+		free(w->bounds[i].func);
+		free(w->bounds[i].expr);
+	}
+	free(w->funcs);
+	free(w->bounds);
+	free(w->flash);
+	const_free(&w->consts);
+}
+
+int wcet_add_bound(struct wcet *w, const char *loop, const char *expr, const char *origin)
+{
+	const char *plus = strchr(loop, '+');
+	struct wcet_bound *b;
+	long offset = -1;
+	char *end;
+
+	if (plus) {
+		offset = strtol(plus + 1, &end, 0);
+		if (plus == loop || *end || end == plus + 1 || offset < 0) {
+			fprintf(stderr, "wcet: %s: expected FUNC or FUNC+OFFSET, not '%s'\n", origin, loop);
+			return -1;
+		}
+	}
+	if (w->nbounds == w->bcap) {
+		b = realloc(w->bounds, (w->bcap = 2 * w->bcap + 16) * sizeof(*b));
+		if (!b)
+			goto oom;
+		w->bounds = b;
+	}
+	b = &w->bounds[w->nbounds];
+	b->func = plus ? strndup(loop, (size_t)(plus - loop)) : strdup(loop);
+	b->expr = strdup(expr);
+	if (!b->func || !b->expr) {
+		free(b->func);
+		free(b->expr);
+		goto oom;
+	}
+	b->offset = offset;
+	b->origin = origin;
+	b->used = 0;
+	w->nbounds++;
+	return 0;
+oom:
+	fprintf(stderr, "wcet: out of memory\n");
+	return -1;
+}
+
+int wcet_read_bounds(struct wcet *w, const char *path, int priority)
+{
+	char line[1024];
+	unsigned lineno = 0;
+	FILE *f;
+
+	if (const_read_header(&w->consts, path, priority))
+		return -1;
+	if (!(f = fopen(path, "r"))) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		char *s = line, *loop, *c;
+
+		lineno++;
+		while (isspace((unsigned char)*s))
+			s++;
+		if (!*s || *s == '#')
+			continue;
+		for (loop = s; *s && !isspace((unsigned char)*s); s++)
+			;
+		if (*s)
+			*s++ = '\0';
+		while (isspace((unsigned char)*s))
+			s++;
+		for (c = s + strlen(s); c > s && isspace((unsigned char)c[-1]); c--)
+			;
+		*c = '\0';
+		if (!*s) {
+			fprintf(stderr, "%s:%u: no bound for %s\n", path, lineno, loop);
+			fclose(f);
+			return -1;
+		}
+		if (wcet_add_bound(w, loop, s, path)) {
+			fclose(f);
+			return -1;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+int wcet_func_at(struct wcet *w, uint32_t entry)
+{
+	unsigned i;
+
+	for (i = 0; i < w->nfuncs; i++)
+		if (w->funcs[i].entry == entry)
+			return (int)i;
+	if (w->nfuncs == w->cap) {
+		struct wcet_func *n = realloc(w->funcs, (w->cap = 2 * w->cap + 64) * sizeof(*n));
+
+		if (!n) {
+			fprintf(stderr, "wcet: out of memory\n");
+			return -1;
+		}
+		w->funcs = n;
+	}
+	memset(&w->funcs[w->nfuncs], 0, sizeof(w->funcs[0]));
+	w->funcs[w->nfuncs].entry = entry;
+	w->funcs[w->nfuncs].callee = -1;
+	return (int)w->nfuncs++;
+}
+
+int wcet_find_func(const struct wcet *w, const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < w->nfuncs; i++)
+		if (w->funcs[i].name && !strcmp(w->funcs[i].name, name))
+			return (int)i;
+	return -1;
+}
+
+const char *wcet_where(const struct wcet *w, uint32_t pc, char *buf, size_t size)
+{
+	unsigned i;
+
+	for (i = 0; i < w->nfuncs; i++) {
+		const struct wcet_func *fn = &w->funcs[i];
+
+		if (fn->name && pc >= fn->entry && pc < fn->entry + fn->size) {
+			if (pc == fn->entry)
+				snprintf(buf, size, "%s", fn->name);
+			else
+				snprintf(buf, size, "%s+0x%X", fn->name, (unsigned)(pc - fn->entry) * 2);
+			return buf;
+		}
+	}
+	snprintf(buf, size, "0x%05X", (unsigned)pc * 2);
+	return buf;
+}
+
+const char *wcet_name(const struct wcet *w, int f, char *buf, size_t size)
+{
+	if (w->funcs[f].name)
+		snprintf(buf, size, "%s", w->funcs[f].name);
+	else
+		snprintf(buf, size, "0x%05X", (unsigned)w->funcs[f].entry * 2);
+	return buf;
+}
+
+const char *wcet_reason(const struct wcet *w, int f, char *buf, size_t size)
+{
+	const struct wcet_func *fn = &w->funcs[f];
+	char where[128];
+
+	wcet_where(w, fn->where, where, sizeof(where));
+	switch (fn->status) {
+	case WCET_OK: snprintf(buf, size, "ok"); break;
+	case WCET_UNBOUNDED_LOOP: snprintf(buf, size, "loop without a bound at %s", where); break;
+	case WCET_INDIRECT_JUMP: snprintf(buf, size, "indirect jump at %s", where); break;
+	case WCET_INDIRECT_CALL: snprintf(buf, size, "indirect call at %s", where); break;
+	case WCET_RECURSION: snprintf(buf, size, "recursive call at %s", where); break;
+	case WCET_SLEEP: snprintf(buf, size, "SLEEP at %s", where); break;
+	case WCET_SPM: snprintf(buf, size, "SPM at %s", where); break;
+	case WCET_IRREDUCIBLE: snprintf(buf, size, "loop with several entries at %s", where); break;
+	case WCET_INVALID: snprintf(buf, size, "invalid instruction or target at %s", where); break;
+	case WCET_NO_RETURN: snprintf(buf, size, "does not return"); break;
+	case WCET_CALLEE:
+		snprintf(buf, size, "calls %s, which has no bound", wcet_name(w, fn->callee, where, sizeof(where)));
+		break;
+	}
+	return buf;
+}
+
+static void problem(struct wcet *w, int f, enum wcet_status status, uint32_t pc)
+{
+	if (w->funcs[f].status == WCET_OK) {
+		w->funcs[f].status = status;
+		w->funcs[f].where = pc;
+	}
+}
+
+static int push(uint32_t **stack, size_t *n, size_t *cap, uint32_t pc)
+{
+	if (*n == *cap) {
+		uint32_t *s = realloc(*stack, (*cap = 2 * *cap + 64) * sizeof(*s));
+
+		if (!s)
+			return -1;
+		*stack = s;
+	}
+	(*stack)[(*n)++] = pc;
+	return 0;
+}
+
+/* A jump to the entry of another function. */
+static int is_tail_call(const struct wcet *w, int f, uint32_t target)
+{
+	unsigned i;
+
+	if (target == w->funcs[f].entry)
+		return 0;
+	for (i = 0; i < w->nfuncs; i++)
+		if (w->funcs[i].entry == target && w->funcs[i].size)
+			return 1;
+	return 0;
+}
+
+/* Mark the instructions reachable from the entry, and the block boundaries. */
+static int explore(struct wcet *w, int f, uint8_t *mark, uint32_t *lo, uint32_t *hi)
+{
+	uint32_t *stack = NULL;
+	size_t n = 0, cap = 0;
+	int err = 0;
+
+	*lo = *hi = w->funcs[f].entry;
+	mark[w->funcs[f].entry] |= MARK_LEADER;
+	err |= push(&stack, &n, &cap, w->funcs[f].entry);
+	while (n && !err) {
+		uint32_t pc = stack[--n];
+
+		while (!(mark[pc] & MARK_SEEN)) {
+			struct insn in;
+			uint32_t t[2];
+			unsigned nt = 0, i;
+
+			decode(w, pc, &in);
+			mark[pc] |= MARK_SEEN;
+			if (pc < *lo)
+				*lo = pc;
+			if (pc + in.words > *hi)
+				*hi = pc + in.words;
+			switch (in.kind) {
+			case K_BRANCH:
+				t[nt++] = in.target;
+				t[nt++] = pc + 1;
+				break;
+			case K_SKIP:
+				t[nt++] = pc + 1;
+				if (pc + 1 < w->flash_words)
+					t[nt++] = pc + 1 + avr_insn_words(w->flash[pc + 1]);
+				break;
+			case K_JUMP:
+				if (!is_tail_call(w, f, in.target))
+					t[nt++] = in.target;
+				break;
+			case K_RET:
+				break;
+			case K_IJMP:
+				problem(w, f, WCET_INDIRECT_JUMP, pc);
+				break;
+			case K_INVALID:
+				problem(w, f, WCET_INVALID, pc);
+				break;
+			case K_ICALL:
+				problem(w, f, WCET_INDIRECT_CALL, pc);
+				break;
+			case K_SLEEP:
+				problem(w, f, WCET_SLEEP, pc);
+				break;
+			case K_SPM:
+				problem(w, f, WCET_SPM, pc);
+				break;
+			default:
+				break;
+			}
+			if (in.kind == K_NORMAL || in.kind == K_CALL || in.kind == K_ICALL || in.kind == K_SLEEP
+					|| in.kind == K_SPM) {
+				if (pc + in.words >= w->flash_words) {
+					problem(w, f, WCET_INVALID, pc);
+					mark[pc] |= MARK_END;
+					break;
+				}
+				pc += in.words;
+				continue;
+			}
+			mark[pc] |= MARK_END;
+			for (i = 0; i < nt; i++) {
+				if (t[i] >= w->flash_words) {
+					problem(w, f, WCET_INVALID, pc);
+					continue;
+				}
+				mark[t[i]] |= MARK_LEADER;
+				err |= push(&stack, &n, &cap, t[i]);
+			}
+			break;
+		}
+	}
+	free(stack);
+	if (err)
+		fprintf(stderr, "wcet: out of memory\n");
+	return err ? -1 : 0;
+}
+
+static int add_callee(struct wcet *w, int f, int c)
+{
+	struct wcet_func *fn = &w->funcs[f];
+	unsigned i;
+	int *n;
+
+	for (i = 0; i < fn->ncallees; i++)
+		if (fn->callees[i] == c)
+			return 0;
+	if (!(n = realloc(fn->callees, (fn->ncallees + 1) * sizeof(*n))))
+		return -1;
+	fn->callees = n;
+	fn->callees[fn->ncallees++] = c;
+	return 0;
+}
+
+/* The bound of a callee, analysed if it has not been. */
+static int callee_cycles(struct wcet *w, int f, uint32_t pc, uint32_t target, uint64_t *cycles)
+{
+	int c = wcet_func_at(w, target);
+
+	*cycles = 0;
+	if (c < 0)
+		return -1;
+	if (w->funcs[c].state == 1) {
+		problem(w, f, WCET_RECURSION, pc);
+		return 0;
+	}
+	if (w->funcs[c].state == 0 && wcet_analyze(w, c))
+		return -1;
+	if (add_callee(w, f, c)) {
+		fprintf(stderr, "wcet: out of memory\n");
+		return -1;
+	}
+	if (w->funcs[c].status != WCET_OK) {
+		if (w->funcs[f].status == WCET_OK)
+			w->funcs[f].callee = c;
+		problem(w, f, WCET_CALLEE, pc);
+		return 0;
+	}
+	*cycles = w->funcs[c].cycles;
+	return 0;
+}
+
+/* Blocks of the marked instructions, with their cost and successors by address. */
+static int build_blocks(struct wcet *w, int f, const uint8_t *mark, uint32_t lo, uint32_t hi,
+		struct block **blocks, unsigned *nblocks)
+{
+	struct block *b = NULL, *cur = NULL;
+	unsigned n = 0, cap = 0;
+	uint32_t pc;
+	struct insn in;
+
+	for (pc = lo; pc < hi; pc += in.words) {
+		uint32_t next;
+		uint64_t cyc;
+
+		if (!(mark[pc] & MARK_SEEN)) {
+			in.words = 1;
+			cur = NULL;
+			continue;
+		}
+		decode(w, pc, &in);
+		if (!cur || (mark[pc] & MARK_LEADER)) {
+			if (n == cap) {
+				struct block *nb = realloc(b, (cap = 2 * cap + 64) * sizeof(*nb));
+
+				if (!nb)
+					goto oom;
+				b = nb;
+			}
+			cur = &b[n++];
+			memset(cur, 0, sizeof(*cur));
+			cur->start = pc;
+		}
+		cur->last = pc;
+		cur->cost = add_sat(cur->cost, in.cycles);
+		if (in.kind == K_CALL || (in.kind == K_JUMP && is_tail_call(w, f, in.target))) {
+			if (in.target >= w->flash_words) {
+				problem(w, f, WCET_INVALID, pc);
+			} else {
+				if (callee_cycles(w, f, pc, in.target, &cyc))
+					goto fail;
+				cur->cost = add_sat(cur->cost, cyc);
+			}
+		}
+		next = pc + in.words;
+		if (mark[pc] & MARK_END) {
+			switch (in.kind) {
+			case K_BRANCH:
+				cur->succ[cur->nsucc++] = (struct edge){ next, 0 };
+				cur->succ[cur->nsucc++] = (struct edge){ in.target, 1 };
+				break;
+			case K_SKIP:
+				cur->succ[cur->nsucc++] = (struct edge){ next, 0 };
+				if (next < w->flash_words) {
+					unsigned words = avr_insn_words(w->flash[next]);
+
+					cur->succ[cur->nsucc++] = (struct edge){ next + words, words };
+				}
+				break;
+			case K_JUMP:
+				cur->succ[cur->nsucc++] = (struct edge){ is_tail_call(w, f, in.target) ? EXIT_PC : in.target, 0 };
+				break;
+			case K_RET:
+				cur->succ[cur->nsucc++] = (struct edge){ EXIT_PC, 0 };
+				break;
+			default:
+				break;
+			}
+			cur = NULL;
+		} else if (next >= hi || !(mark[next] & MARK_SEEN) || (mark[next] & MARK_LEADER)) {
+			if (next < hi && (mark[next] & MARK_SEEN))
+				cur->succ[cur->nsucc++] = (struct edge){ next, 0 };
+			cur = NULL;
+		}
+	}
+	*blocks = b;
+	*nblocks = n;
+	return 0;
+oom:
+	fprintf(stderr, "wcet: out of memory\n");
+fail:
+	free(b);
+	return -1;
+}
+
+static int find_block(const struct block *b, unsigned n, uint32_t pc)
+{
+	unsigned lo = 0, hi = n;
+
+	while (lo < hi) {
+		unsigned mid = (lo + hi) / 2;
+
+		if (b[mid].start == pc)
+			return (int)mid;
+		if (b[mid].start < pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return -1;
+}
+
+static int cmp_loop_header(const void *a, const void *b)
+{
+	const struct loop *la = a, *lb = b;
+
+	return la->header - lb->header;
+}
+
+/* The bound of the loop with its header at word address header. */
+static int loop_bound(struct wcet *w, int f, uint32_t header, unsigned nloops, int64_t *bound)
+{
+	const char *name = w->funcs[f].name;
+	long offset = ((long)header - (long)w->funcs[f].entry) * 2;
+	char what[160];
+	unsigned i;
+
+	*bound = -1;
+	if (!name)
+		return 0;
+	for (i = 0; i < w->nbounds; i++) {
+		struct wcet_bound *b = &w->bounds[i];
+
+		if (strcmp(b->func, name) || (b->offset != offset && (b->offset != -1 || nloops != 1)))
+			continue;
+		snprintf(what, sizeof(what), "%s: bound of %s+0x%lX", b->origin, name, offset);
+		if (expr_eval(&w->consts, b->expr, what, bound))
+			return -1;
+		if (*bound < 0) {
+			fprintf(stderr, "wcet: %s is negative: %lld\n", what, (long long)*bound);
+			return -1;
+		}
+		b->used = 1;
+		return 0;
+	}
+	return 0;
+}
+
+/*
+ * Longest paths from head through the blocks marked in region, over the
+ * collapsed loops. The blocks are visited in reverse postorder, which is a
+ * topological order once the back edges are left out. iter gets the longest
+ * way back to head (for a loop), out the longest way out of the region.
+ */
+static void longest(const struct block *b, unsigned n, const int *order, unsigned norder, const uint8_t *region,
+		const int *rep, const uint8_t *collapsed, const uint64_t *ncost, uint64_t *dist, int head,
+		int is_loop, uint64_t *iter, uint64_t *out)
+{
+	unsigned i, k;
+
+	for (i = 0; i < norder; i++)
+		dist[order[i]] = UNSET;
+	dist[head] = ncost[head];
+	*iter = *out = UNSET;
+	for (i = 0; i < norder; i++) {
+		int x = order[i], u = rep[x];
+
+		if (x == (int)n || !region[x] || dist[u] == UNSET)
+			continue;
+		for (k = 0; k < b[x].nsucc; k++) {
+			uint32_t t = b[x].succ[k].to;
+			uint64_t d = add_sat(dist[u], collapsed[u] ? 0 : b[x].succ[k].extra);
+			int v;
+
+			if (t == n || !region[t]) {
+				if (*out == UNSET || d > *out)
+					*out = d;
+			} else if (is_loop && (int)t == head) {
+				if (*iter == UNSET || d > *iter)
+					*iter = d;
+			} else if ((v = rep[t]) != u) {
+				d = add_sat(d, ncost[v]);
+				if (dist[v] == UNSET || d > dist[v])
+					dist[v] = d;
+			}
+		}
+	}
+}
+
+int wcet_analyze(struct wcet *w, int f)
+{
+	struct block *b = NULL;
+	struct loop *loops = NULL;
+	unsigned nb = 0, nloops = 0, norder = 0, i, k, j;
+	uint8_t *mark = NULL, *region = NULL, *collapsed = NULL, *seen = NULL;
+	int *order = NULL, *rpo = NULL, *idom = NULL, *rep = NULL, *npred = NULL, *preds = NULL, *stack = NULL;
+	int *byorder = NULL, entry, ret = -1;
+	uint64_t *ncost = NULL, *dist = NULL, iter, out;
+	uint32_t lo, hi;
+
+	w->funcs[f].state = 1;
+	w->funcs[f].status = WCET_OK;
+	w->funcs[f].callee = -1;
+
+	if (!(mark = calloc(w->flash_words + 1, 1)))
+		goto oom;
+	if (explore(w, f, mark, &lo, &hi) || build_blocks(w, f, mark, lo, hi, &b, &nb))
+		goto done;
+	free(mark);
+	mark = NULL;
+
+	/* Successors by block index; the exit is block nb. */
+	for (i = 0; i < nb; i++)
+		for (k = 0; k < b[i].nsucc; k++) {
+			int t = b[i].succ[k].to == EXIT_PC ? (int)nb : find_block(b, nb, b[i].succ[k].to);
+
+			if (t < 0) {
+				problem(w, f, WCET_INVALID, b[i].last);
+				b[i].succ[k] = b[i].succ[--b[i].nsucc];
+				k--;
+				continue;
+			}
+			b[i].succ[k].to = (uint32_t)t;
+		}
+	entry = find_block(b, nb, w->funcs[f].entry);
+	w->funcs[f].blocks = nb;
+
+	order = malloc((nb + 1) * sizeof(*order));
+	rpo = malloc((nb + 1) * sizeof(*rpo));
+	idom = malloc((nb + 1) * sizeof(*idom));
+	rep = malloc((nb + 1) * sizeof(*rep));
+	npred = calloc(nb + 2, sizeof(*npred));
+	preds = malloc((2 * nb + 1) * sizeof(*preds));
+	stack = malloc(2 * (nb + 1) * sizeof(*stack));
+	byorder = malloc((nb + 1) * sizeof(*byorder));
+	region = calloc(nb + 1, 1);
+	collapsed = calloc(nb + 1, 1);
+	seen = calloc(nb + 1, 1);
+	ncost = malloc((nb + 1) * sizeof(*ncost));
+	dist = malloc((nb + 1) * sizeof(*dist));
+	if (!order || !rpo || !idom || !rep || !npred || !preds || !stack || !byorder || !region || !collapsed
+			|| !seen || !ncost || !dist)
+		goto oom;
+
+	/* Reverse postorder of the blocks reachable from the entry. */
+	{
+		unsigned sp = 0, npost = 0;
+
+		seen[entry] = 1;
+		stack[sp++] = entry;
+		stack[sp++] = 0;
+		while (sp) {
+			int x = stack[sp - 2], e = stack[sp - 1];
+
+			if (x < (int)nb && e < (int)b[x].nsucc) {
+				int t = (int)b[x].succ[e].to;
+
+				stack[sp - 1]++;
+				if (!seen[t]) {
+					seen[t] = 1;
+					stack[sp++] = t;
+					stack[sp++] = 0;
+				}
+				continue;
+			}
+			byorder[npost++] = x;
+			sp -= 2;
+		}
+		for (i = 0; i <= nb; i++)
+			rpo[i] = -1;
+		for (i = 0; i < npost; i++) {
+			order[i] = byorder[npost - 1 - i];
+			rpo[order[i]] = (int)i;
+		}
+		norder = npost;
+	}
+
+	/* Predecessors, then the immediate dominators (Cooper, Harvey and Kennedy). */
+	for (i = 0; i < nb; i++)
+		for (k = 0; k < b[i].nsucc; k++)
+			npred[b[i].succ[k].to + 1]++;
+	for (i = 1; i <= nb + 1; i++)
+		npred[i] += npred[i - 1];
+	{
+		int *fill = byorder;
+
+		for (i = 0; i <= nb; i++)
+			fill[i] = npred[i];
+		for (i = 0; i < nb; i++)
+			for (k = 0; k < b[i].nsucc; k++)
+				preds[fill[b[i].succ[k].to]++] = (int)i;
+	}
+	for (i = 0; i <= nb; i++)
+		idom[i] = -1;
+	idom[entry] = entry;
+	for (;;) {
+		int changed = 0;
+
+		for (i = 1; i < norder; i++) {
+			int x = order[i], nd = -1, p;
+
+			for (j = (unsigned)npred[x]; j < (unsigned)npred[x + 1]; j++) {
+				if (idom[p = preds[j]] < 0)
+					continue;
+				if (nd < 0) {
+					nd = p;
+					continue;
+				}
+				while (nd != p) {
+					while (rpo[nd] > rpo[p])
+						nd = idom[nd];
+					while (rpo[p] > rpo[nd])
+						p = idom[p];
+				}
+			}
+			if (idom[x] != nd) {
+				idom[x] = nd;
+				changed = 1;
+			}
+		}
+		if (!changed)
+			break;
+	}
+
+	/* Back edges and the natural loops of their headers. */
+	for (i = 0; i < norder; i++) {
+		int x = order[i];
+
+		if (x == (int)nb)
+			continue;
+		for (k = 0; k < b[x].nsucc; k++) {
+			int h = (int)b[x].succ[k].to, d = x;
+			struct loop *l;
+
+			if (rpo[h] > rpo[x])
+				continue;
+			while (d != h && d != entry)
+				d = idom[d];
+			if (d != h) {
+				problem(w, f, WCET_IRREDUCIBLE, b[h].start);
+				continue;
+			}
+			for (j = 0; j < nloops; j++)
+				if (loops[j].header == h)
+					break;
+			if (j == nloops) {
+				struct loop *nl = realloc(loops, (nloops + 1) * sizeof(*nl));
+
+				if (!nl)
+					goto oom;
+				loops = nl;
+				loops[nloops].header = h;
+				loops[nloops].nbody = 1;
+				if (!(loops[nloops].body = malloc((nb + 1) * sizeof(int))))
+					goto oom;
+				loops[nloops++].body[0] = h;
+			}
+			l = &loops[j];
+			/* The blocks that reach the latch without passing the header. */
+			memset(seen, 0, nb + 1);
+			for (j = 0; j < l->nbody; j++)
+				seen[l->body[j]] = 1;
+			if (!seen[x]) {
+				unsigned top = 0;
+
+				seen[x] = 1;
+				l->body[l->nbody++] = x;
+				stack[top++] = x;
+				while (top) {
+					int y = stack[--top];
+
+					for (j = (unsigned)npred[y]; j < (unsigned)npred[y + 1]; j++)
+						if (!seen[preds[j]] && rpo[preds[j]] >= 0) {
+							seen[preds[j]] = 1;
+							l->body[l->nbody++] = preds[j];
+							stack[top++] = preds[j];
+						}
+				}
+			}
+		}
+	}
+	if (w->funcs[f].status == WCET_IRREDUCIBLE)
+		goto finish;
+
+	/* Bounds, by loop header address. */
+	qsort(loops, nloops, sizeof(*loops), cmp_loop_header);
+	if (nloops && !(w->funcs[f].loops = calloc(nloops, sizeof(*w->funcs[f].loops))))
+		goto oom;
+	w->funcs[f].nloops = nloops;
+	for (i = 0; i < nloops; i++) {
+		struct wcet_loop *wl = &w->funcs[f].loops[i];
+
+		wl->header = b[loops[i].header].start;
+		wl->blocks = loops[i].nbody;
+		if (loop_bound(w, f, wl->header, nloops, &wl->bound))
+			goto done;
+		if (wl->bound < 0)
+			problem(w, f, WCET_UNBOUNDED_LOOP, wl->header);
+	}
+
+	/* Collapse the loops from the innermost out; inner loops have fewer blocks. */
+	for (i = 0; i <= nb; i++) {
+		rep[i] = (int)i;
+		ncost[i] = i < nb ? b[i].cost : 0;
+	}
+	for (;;) {
+		struct wcet_loop *wl;
+		int next = -1;
+
+		for (i = 0; i < nloops; i++)
+			if (!collapsed[loops[i].header] && (next < 0 || loops[i].nbody < loops[next].nbody))
+				next = (int)i;
+		if (next < 0)
+			break;
+		wl = &w->funcs[f].loops[next];
+		for (j = 0; j < loops[next].nbody; j++)
+			region[loops[next].body[j]] = 1;
+		longest(b, nb, order, norder, region, rep, collapsed, ncost, dist, loops[next].header, 1, &iter, &out);
+		for (j = 0; j < loops[next].nbody; j++)
+			region[loops[next].body[j]] = 0;
+		wl->iteration = iter == UNSET ? 0 : iter;
+		/* A loop without an exit ends the paths through it. */
+		wl->cycles = out == UNSET ? 0 : add_sat(mul_sat((uint64_t)(wl->bound < 0 ? 0 : wl->bound), wl->iteration), out);
+		ncost[loops[next].header] = wl->cycles;
+		collapsed[loops[next].header] = 1;
+		for (j = 0; j < loops[next].nbody; j++)
+			rep[loops[next].body[j]] = loops[next].header;
+	}
+
+	for (i = 0; i < norder; i++)
+		region[order[i]] = 1;
+	longest(b, nb, order, norder, region, rep, collapsed, ncost, dist, rep[entry], 0, &iter, &out);
+	if (out == UNSET)
+		problem(w, f, WCET_NO_RETURN, w->funcs[f].entry);
+	else
+		w->funcs[f].cycles = out;
+
+finish:
+	ret = 0;
+	goto done;
+oom:
+	fprintf(stderr, "wcet: out of memory\n");
+done:
+	w->funcs[f].state = 2;
+	for (i = 0; i < nloops; i++)
+		free(loops[i].body);
+	free(loops);
+	free(mark);
+	free(b);
+	free(order);
+	free(rpo);
+	free(idom);
+	free(rep);
+	free(npred);
+	free(preds);
+	free(stack);
+	free(byorder);
+	free(region);
+	free(collapsed);
+	free(seen);
+	free(ncost);
+	free(dist);
+	return ret;
+}
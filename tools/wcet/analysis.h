@@ -0,0 +1,125 @@
+/*
+ * analysis.h - static worst-case execution time of AVRxm functions.
+ *
+ * The control flow graph of a function is rebuilt from the Flash image,
+ * starting at its entry and following branches, skips and jumps; a jump to
+ * the entry of another function is a tail call. Every instruction is
+ * charged its cycles from avr_cpu.h, with the worst case where they depend
+ * on the data: loads take the extra cycle of the internal SRAM, taken
+ * branches and skips their extra cycles on the edges they take. A call
+ * costs the CALL plus the bound of the callee, which is analysed first.
+ *
+ * Loops are the natural loops of the graph, found with its dominators.
+ * Every loop needs a bound: the number of times its back edges are taken
+ * per entry into the loop, given as an expression (see expr.h). The loops
+ * are collapsed from the innermost out, each into one node that costs
+ * bound * its longest iteration + its longest path to an exit, and the
+ * bound of the function is the longest path from its entry to a return.
+ *
+ * What cannot be bounded is reported instead of a number: loops without a
+ * bound, indirect jumps and calls, recursion, SLEEP, SPM (the NVM stalls
+ * the CPU for the whole Flash write) and irreducible loops. Interrupts
+ * that preempt the function are not included, nor is the interrupt entry
+ * of a handler.
+ */
+
+#ifndef WCET_ANALYSIS_H
+#define WCET_ANALYSIS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elf32.h"
+#include "expr.h"
+#include "xmega_devices.h"
+
+enum wcet_status {
+	WCET_OK,
+	WCET_UNBOUNDED_LOOP,
+	WCET_INDIRECT_JUMP,
+	WCET_INDIRECT_CALL,
+	WCET_RECURSION,
+	WCET_SLEEP,
+	WCET_SPM,
+	WCET_IRREDUCIBLE,
+	WCET_INVALID,
+	WCET_NO_RETURN,
+	WCET_CALLEE,                /* a callee has no bound */
+};
+
+struct wcet_loop {
+	uint32_t header;            /* word address */
+	int64_t bound;              /* -1 if none was given */
+	uint64_t iteration;         /* cycles of the longest iteration */
+	uint64_t cycles;            /* of all iterations and the way out */
+	unsigned blocks;
+};
+
+struct wcet_func {
+	const char *name;           /* NULL for a call target without a symbol */
+	uint32_t entry;             /* word address */
+	uint32_t size;              /* words, 0 if unknown */
+	int state;                  /* 0 not analysed, 1 in progress, 2 done */
+	enum wcet_status status;
+	uint32_t where;             /* word address of the first problem */
+	int callee;                 /* for WCET_CALLEE */
+	uint64_t cycles;            /* valid for WCET_OK */
+	struct wcet_loop *loops;
+	unsigned nloops;
+	int *callees;
+	unsigned ncallees;
+	unsigned blocks;
+};
+
+struct wcet_bound {
+	char *func;
+	long offset;                /* bytes from the entry to the loop header, -1 for the only loop */
+	char *expr;
+	const char *origin;
+	int used;
+};
+
+struct wcet {
+	const struct elf_file *ef;
+	const struct xmega_device *dev;
+	uint16_t *flash;
+	uint32_t flash_words;
+	unsigned pc_bytes;
+	struct wcet_func *funcs;
+	unsigned nfuncs, cap;
+	struct wcet_bound *bounds;
+	unsigned nbounds, bcap;
+	struct constants consts;
+};
+
+/* Load the Flash image and the functions of ef. */
+int wcet_init(struct wcet *w, const struct elf_file *ef, const struct xmega_device *dev);
+void wcet_free(struct wcet *w);
+
+/* A loop bound: FUNC for the only loop of FUNC, or FUNC+OFFSET for the loop
+ * whose header is OFFSET bytes from the entry. */
+int wcet_add_bound(struct wcet *w, const char *loop, const char *expr, const char *origin);
+
+/* A file of "LOOP EXPR" lines; #define lines define constants, other lines
+ * starting with # are comments. */
+int wcet_read_bounds(struct wcet *w, const char *path, int priority);
+
+/* Index of the function at a word address, added if there is none. -1 if out of memory. */
+int wcet_func_at(struct wcet *w, uint32_t entry);
+
+/* Index of a function by name, or -1. */
+int wcet_find_func(const struct wcet *w, const char *name);
+
+/* Analyse function f and its callees. Returns -1 for errors in the bounds. */
+int wcet_analyze(struct wcet *w, int f);
+
+/* NAME+0xOFF, or the byte address, for a word address. */
+const char *wcet_where(const struct wcet *w, uint32_t pc, char *buf, size_t size);
+
+/* The name of a function, or its byte address. */
+const char *wcet_name(const struct wcet *w, int f, char *buf, size_t size);
+
+/* Why function f has no bound, e.g. "loop without a bound at f+0x1A". */
+const char *wcet_reason(const struct wcet *w, int f, char *buf, size_t size);
+
+#endif
@@ -0,0 +1,356 @@
+/*
+ * expr.c - integer constants and expressions for the loop bounds.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "expr.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Limit for constants defined in terms of each other, and for cycles. */
+#define EXPR_MAX_DEPTH 32
+
+struct parser {
+	const struct constants *cs;
+	const char *s;
+	const char *what;
+	unsigned depth;
+	int failed;
+};
+
+static const struct constant *find(const struct constants *cs, const char *name, size_t len)
+{
+	unsigned i;
+
+	for (i = 0; i < cs->n; i++)
+		if (strlen(cs->c[i].name) == len && !strncmp(cs->c[i].name, name, len))
+			return &cs->c[i];
+	return NULL;
+}
+
+int const_define(struct constants *cs, const char *name, const char *value, const char *origin, int priority)
+{
+	struct constant *c = (struct constant *)find(cs, name, strlen(name));
+	char *v;
+
+	if (c && c->priority > priority)
+		return 0;
+	if (!(v = strdup(value)))
+		return -1;
+	if (c) {
+		free(c->value);
+		c->value = v;
+		c->origin = origin;
+		c->priority = priority;
+		return 0;
+	}
+	if (cs->n == cs->cap) {
+		struct constant *n = realloc(cs->c, (cs->cap = 2 * cs->cap + 32) * sizeof(*n));
+
+		if (!n)
+			return free(v), -1;
+		cs->c = n;
+	}
+	c = &cs->c[cs->n];
+	if (!(c->name = strdup(name)))
+		return free(v), -1;
+	c->value = v;
+	c->origin = origin;
+	c->priority = priority;
+	cs->n++;
+	return 0;
+}
+
+int const_define_arg(struct constants *cs, const char *arg, int priority)
+{
+	const char *eq = strchr(arg, '=');
+	char name[128];
+
+	if (!eq || eq == arg || (size_t)(eq - arg) >= sizeof(name)) {
+		fprintf(stderr, "wcet: expected NAME=VALUE, not '%s'\n", arg);
+		return -1;
+	}
+	memcpy(name, arg, (size_t)(eq - arg));
+	name[eq - arg] = '\0';
+	return const_define(cs, name, eq + 1, "-D", priority);
+}
+
+int const_read_header(struct constants *cs, const char *path, int priority)
+{
+	char line[1024];
+	FILE *f = fopen(path, "r");
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		char *s = line, *name, *c;
+
+		while (isspace((unsigned char)*s))
+			s++;
+		if (*s++ != '#')
+			continue;
+		while (isspace((unsigned char)*s))
+			s++;
+		if (strncmp(s, "define", 6) || !isspace((unsigned char)s[6]))
+			continue;
+		for (s += 6; isspace((unsigned char)*s); s++)
+			;
+		name = s;
+		while (isalnum((unsigned char)*s) || *s == '_')
+			s++;
+		/* Function-like macros and empty definitions are not constants. */
+		if (s == name || *s == '(' || !isspace((unsigned char)*s))
+			continue;
+		*s++ = '\0';
+		if ((c = strstr(s, "//")))
+			*c = '\0';
+		if ((c = strstr(s, "/*")))
+			*c = '\0';
+		while (isspace((unsigned char)*s))
+			s++;
+		for (c = s + strlen(s); c > s && isspace((unsigned char)c[-1]); c--)
+			;
+		*c = '\0';
+		if (*s && const_define(cs, name, s, path, priority)) {
+			fclose(f);
+			return -1;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+void const_free(struct constants *cs)
+{
+	unsigned i;
+
+	for (i = 0; i < cs->n; i++) {
+		free(cs->c[i].name);
+		free(cs->c[i].value);
+	}
+	free(cs->c);
+	cs->c = NULL;
+	cs->n = cs->cap = 0;
+}
+
+static void error(struct parser *p, const char *fmt, const char *arg, size_t len)
+{
+	if (p->failed)
+		return;
+	fprintf(stderr, "wcet: %s: ", p->what);
+	fprintf(stderr, fmt, (int)len, arg);
+	fprintf(stderr, "\n");
+	p->failed = 1;
+}
+
+static void skip_space(struct parser *p)
+{
+	while (isspace((unsigned char)*p->s))
+		p->s++;
+}
+
+static int is_ident(int c)
+{
+	return isalnum(c) || c == '_';
+}
+
+/* A cast to an integer type: (uint16_t), (unsigned long) and the like. */
+static int skip_cast(struct parser *p)
+{
+	static const char *const words[] = { "unsigned", "signed", "int", "long", "short", "char", "const" };
+	const char *s = p->s + 1;
+	int types = 0;
+
+	for (;;) {
+		const char *w;
+		unsigned i;
+
+		while (isspace((unsigned char)*s))
+			s++;
+		if (*s == ')')
+			break;
+		for (w = s; is_ident((unsigned char)*s); s++)
+			;
+		if (s == w)
+			return 0;
+		for (i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+			if ((size_t)(s - w) == strlen(words[i]) && !strncmp(w, words[i], (size_t)(s - w)))
+				break;
+		if (i == sizeof(words) / sizeof(words[0]) && !(s - w > 2 && s[-2] == '_' && s[-1] == 't'))
+			return 0;
+		types++;
+	}
+	if (!types)
+		return 0;
+	p->s = s + 1;
+	return 1;
+}
+
+static int64_t parse_binary(struct parser *p, int level);
+
+static int64_t parse_name(struct parser *p)
+{
+	const char *name = p->s;
+	const struct constant *c;
+	size_t len;
+
+	while (is_ident((unsigned char)*p->s))
+		p->s++;
+	len = (size_t)(p->s - name);
+	if (len == 6 && !strncmp(name, "sizeof", 6)) {
+		const struct elf_symbol *sym = NULL;
+		char sname[128];
+		const char *s;
+
+		skip_space(p);
+		if (*p->s != '(') {
+			error(p, "expected '(' after %.*s", name, len);
+			return 0;
+		}
+		p->s++;
+		skip_space(p);
+		for (s = p->s; is_ident((unsigned char)*p->s); p->s++)
+			;
+		len = (size_t)(p->s - s);
+		if (len && len < sizeof(sname)) {
+			memcpy(sname, s, len);
+			sname[len] = '\0';
+			sym = p->cs->ef ? elf_find_symbol(p->cs->ef, sname) : NULL;
+		}
+		skip_space(p);
+		if (!sym || *p->s != ')') {
+			error(p, "sizeof needs the name of an ELF symbol, not '%.*s'", s, len);
+			return 0;
+		}
+		p->s++;
+		return sym->size;
+	}
+	if (!(c = find(p->cs, name, len))) {
+		error(p, "'%.*s' is not defined", name, len);
+		return 0;
+	}
+	if (p->depth >= EXPR_MAX_DEPTH) {
+		error(p, "'%.*s' is defined in terms of itself", name, len);
+		return 0;
+	} else {
+		struct parser sub = { p->cs, c->value, p->what, p->depth + 1, 0 };
+		int64_t v = parse_binary(&sub, 0);
+
+		skip_space(&sub);
+		if (!sub.failed && *sub.s)
+			error(&sub, "cannot evaluate %.*s", c->value, strlen(c->value));
+		p->failed |= sub.failed;
+		return v;
+	}
+}
+
+static int64_t parse_unary(struct parser *p)
+{
+	int64_t v;
+	char *end;
+
+	skip_space(p);
+	switch (*p->s) {
+	case '-':
+		p->s++;
+		return -parse_unary(p);
+	case '+':
+		p->s++;
+		return parse_unary(p);
+	case '~':
+		p->s++;
+		return ~parse_unary(p);
+	case '!':
+		p->s++;
+		return !parse_unary(p);
+	case '(':
+		if (skip_cast(p))
+			return parse_unary(p);
+		p->s++;
+		v = parse_binary(p, 0);
+		skip_space(p);
+		if (*p->s != ')') {
+			error(p, "expected ')' at '%.*s'", p->s, strlen(p->s));
+			return 0;
+		}
+		p->s++;
+		return v;
+	}
+	if (isdigit((unsigned char)*p->s)) {
+		v = (int64_t)strtoull(p->s, &end, 0);
+		p->s = end;
+		while (*p->s == 'u' || *p->s == 'U' || *p->s == 'l' || *p->s == 'L')
+			p->s++;
+		if (is_ident((unsigned char)*p->s) || *p->s == '.')
+			error(p, "not an integer: '%.*s'", end, strlen(end));
+		return v;
+	}
+	if (isalpha((unsigned char)*p->s) || *p->s == '_')
+		return parse_name(p);
+	error(p, *p->s ? "unexpected '%.*s'" : "unexpected end%.*s", p->s, strlen(p->s));
+	return 0;
+}
+
+/* Binary operators by C precedence, lowest first. */
+static int64_t parse_binary(struct parser *p, int level)
+{
+	static const char *const ops[][3] = {
+		{ "|" }, { "^" }, { "&" }, { "<<", ">>" }, { "+", "-" }, { "*", "/", "%" },
+	};
+	int64_t v, r;
+
+	if (level == (int)(sizeof(ops) / sizeof(ops[0])))
+		return parse_unary(p);
+	v = parse_binary(p, level + 1);
+	for (;;) {
+		const char *op = NULL;
+		unsigned i;
+
+		skip_space(p);
+		for (i = 0; i < 3 && ops[level][i]; i++)
+			if (!strncmp(p->s, ops[level][i], strlen(ops[level][i])))
+				op = ops[level][i];
+		/* Not the first character of || or &&. */
+		if (!op || (op[1] == '\0' && (op[0] == '|' || op[0] == '&') && p->s[1] == op[0]))
+			return v;
+		p->s += strlen(op);
+		r = parse_binary(p, level + 1);
+		if (p->failed)
+			return 0;
+		switch (op[0]) {
+		case '|': v |= r; break;
+		case '^': v ^= r; break;
+		case '&': v &= r; break;
+		case '<': v = r < 0 || r > 62 ? 0 : (int64_t)((uint64_t)v << r); break;
+		case '>': v = r < 0 || r > 62 ? 0 : v >> r; break;
+		case '+': v += r; break;
+		case '-': v -= r; break;
+		case '*': v *= r; break;
+		case '/':
+		case '%':
+			if (!r) {
+				error(p, "division by zero%.*s", "", 0);
+				return 0;
+			}
+			v = op[0] == '/' ? v / r : v % r;
+			break;
+		}
+	}
+}
+
+int expr_eval(const struct constants *cs, const char *text, const char *what, int64_t *value)
+{
+	struct parser p = { cs, text, what, 0, 0 };
+
+	*value = parse_binary(&p, 0);
+	skip_space(&p);
+	if (!p.failed && *p.s)
+		error(&p, "unexpected '%.*s'", p.s, strlen(p.s));
+	return p.failed ? -1 : 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * expr.h - integer constants and expressions for the loop bounds.
+ *
+ * Constants come from -D options, from the object-like #defines of the
+ * configuration headers and from the device. Their values are kept as text
+ * and evaluated when a bound uses them, so that a header may define them in
+ * terms of each other, e.g. CLASSB_SEC_SIZE as INTERNAL_SRAM_SIZE /
+ * CLASSB_NSECS. Expressions are C integer expressions: the usual unary and
+ * binary operators, parentheses, casts to integer types, which are ignored,
+ * and sizeof(SYMBOL) for the size of an ELF symbol.
+ */
+
+#ifndef WCET_EXPR_H
+#define WCET_EXPR_H
+
+#include <stdint.h>
+
+#include "elf32.h"
+
+struct constant {
+	char *name;
+	char *value;
+	const char *origin;         /* file or option, for messages */
+	int priority;               /* a higher priority is not replaced by a lower one */
+};
+
+struct constants {
+	struct constant *c;
+	unsigned n, cap;
+	const struct elf_file *ef;  /* for sizeof, or NULL */
+};
+
+/* Define or redefine name, unless it has a higher priority already. */
+int const_define(struct constants *cs, const char *name, const char *value, const char *origin, int priority);
+
+/* NAME=VALUE. */
+int const_define_arg(struct constants *cs, const char *arg, int priority);
+
+/* The object-like #defines of a C header; lines that are not are ignored. */
+int const_read_header(struct constants *cs, const char *path, int priority);
+
+void const_free(struct constants *cs);
+
+/* Evaluate an expression. Returns 0, or -1 with a message on stderr naming what. */
+int expr_eval(const struct constants *cs, const char *text, const char *what, int64_t *value);
+
+#endif
@@ -0,0 +1,327 @@
+/*
+ * wcet - static worst-case execution time of the functions of an AVR ELF file.
+ *
+ * The bounds are guaranteed for the given loop bounds, unlike the maxima
+ * that avrsim measures, which hold only for the paths that a run takes.
+ * See analysis.h for the method and expr.h for the bound expressions.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analysis.h"
+#include "elf32.h"
+#include "xmega_devices.h"
+
+/* Priorities of the constants: -D over the bound files over the headers. */
+#define PRIO_HEADER  1
+#define PRIO_BOUNDS  2
+#define PRIO_OPTION  3
+
+#define MAX_FILES 32
+
+static void json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fputc('\\', f);
+		fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static void print_func(const struct wcet *w, int f, double hz, int verbose)
+{
+	const struct wcet_func *fn = &w->funcs[f];
+	char name[128], where[128], reason[256];
+	unsigned i;
+
+	printf("%-32s 0x%05X", wcet_name(w, f, name, sizeof(name)), (unsigned)fn->entry * 2);
+	if (fn->status == WCET_OK) {
+		printf(" %12llu", (unsigned long long)fn->cycles);
+		if (hz > 0)
+			printf(" %12.1f", fn->cycles * 1e6 / hz);
+		printf("  ok\n");
+	} else {
+		printf(" %12s", "-");
+		if (hz > 0)
+			printf(" %12s", "-");
+		printf("  %s\n", wcet_reason(w, f, reason, sizeof(reason)));
+	}
+	if (!verbose)
+		return;
+	for (i = 0; i < fn->nloops; i++) {
+		const struct wcet_loop *l = &fn->loops[i];
+
+		printf("    loop %-30s", wcet_where(w, l->header, where, sizeof(where)));
+		if (l->bound >= 0)
+			printf(" bound %8lld", (long long)l->bound);
+		else
+			printf(" bound %8s", "?");
+		printf("  iteration %8llu", (unsigned long long)l->iteration);
+		if (l->bound >= 0)
+			printf("  total %12llu", (unsigned long long)l->cycles);
+		printf("\n");
+	}
+	for (i = 0; i < fn->ncallees; i++) {
+		const struct wcet_func *c = &w->funcs[fn->callees[i]];
+
+		printf("    call %-30s", wcet_name(w, fn->callees[i], name, sizeof(name)));
+		if (c->status == WCET_OK)
+			printf(" %12llu\n", (unsigned long long)c->cycles);
+		else
+			printf(" %12s\n", "-");
+	}
+}
+
+static int write_json(const char *path, const char *image, const struct wcet *w, const int *funcs, unsigned n)
+{
+	char buf[256];
+	FILE *f = fopen(path, "w");
+	unsigned i, j;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "{\n  \"image\": ");
+	json_string(f, image);
+	fprintf(f, ",\n  \"device\": \"%s\",\n  \"functions\": [", w->dev->name);
+	for (i = 0; i < n; i++) {
+		const struct wcet_func *fn = &w->funcs[funcs[i]];
+
+		fprintf(f, "%s\n    { \"name\": ", i ? "," : "");
+		json_string(f, wcet_name(w, funcs[i], buf, sizeof(buf)));
+		fprintf(f, ", \"address\": %lu, ", (unsigned long)fn->entry * 2);
+		if (fn->status == WCET_OK)
+			fprintf(f, "\"cycles\": %llu, \"status\": \"ok\"", (unsigned long long)fn->cycles);
+		else {
+			fprintf(f, "\"cycles\": null, \"status\": ");
+			json_string(f, wcet_reason(w, funcs[i], buf, sizeof(buf)));
+		}
+		fprintf(f, ",\n      \"loops\": [");
+		for (j = 0; j < fn->nloops; j++) {
+			const struct wcet_loop *l = &fn->loops[j];
+
+			fprintf(f, "%s{ \"address\": %lu, ", j ? ", " : "", (unsigned long)l->header * 2);
+			if (l->bound >= 0)
+				fprintf(f, "\"bound\": %lld, \"iteration\": %llu, \"cycles\": %llu }", (long long)l->bound,
+						(unsigned long long)l->iteration, (unsigned long long)l->cycles);
+			else
+				fprintf(f, "\"bound\": null, \"iteration\": %llu, \"cycles\": null }",
+						(unsigned long long)l->iteration);
+		}
+		fprintf(f, "],\n      \"calls\": [");
+		for (j = 0; j < fn->ncallees; j++) {
+			fprintf(f, "%s", j ? ", " : "");
+			json_string(f, wcet_name(w, fn->callees[j], buf, sizeof(buf)));
+		}
+		fprintf(f, "] }");
+	}
+	fprintf(f, "%s]\n}\n", n ? "\n  " : "");
+	return fclose(f) == 0 ? 0 : -1;
+}
+
+static void usage(FILE *f)
+{
+	fprintf(f,
+		"Usage: wcet [options] IMAGE.elf [FUNCTION...]\n"
+		"\n"
+		"Compute upper bounds of the cycles of the functions of an avr-gcc ELF file,\n"
+		"by default of all functions.\n"
+		"\n"
+		"  -b, --bounds FILE        loop bounds: 'FUNC[+OFFSET] EXPR' lines, and #define\n"
+		"                           lines for constants (repeatable)\n"
+		"  -l, --loop LOOP=EXPR     the bound of a loop, FUNC or FUNC+OFFSET, in back edges\n"
+		"                           taken per entry (repeatable)\n"
+		"  -c, --config FILE        header to take the #define constants from (repeatable)\n"
+		"  -D, --define NAME=VALUE  define a constant (repeatable)\n"
+		"  -d, --device NAME        device (default: from the ELF device info)\n"
+		"  -F, --freq HZ            also give the bounds in microseconds at this clock\n"
+		"  -j, --json FILE          write the results as JSON\n"
+		"  -v, --verbose            list the loops and calls of each function\n"
+		"  -h, --help               show this help\n"
+		"\n"
+		"Exit status: 0 if all functions have a bound, 1 if any has none, 2 for errors.\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{ "bounds", required_argument, NULL, 'b' },
+		{ "loop", required_argument, NULL, 'l' },
+		{ "config", required_argument, NULL, 'c' },
+		{ "define", required_argument, NULL, 'D' },
+		{ "device", required_argument, NULL, 'd' },
+		{ "freq", required_argument, NULL, 'F' },
+		{ "json", required_argument, NULL, 'j' },
+		{ "verbose", no_argument, NULL, 'v' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	const char *bounds[MAX_FILES], *configs[MAX_FILES], *defines[MAX_FILES], *loops[MAX_FILES];
+	unsigned nbounds = 0, nconfigs = 0, ndefines = 0, nloops = 0, nfuncs = 0, i;
+	const char *device = NULL, *json = NULL;
+	const struct xmega_device *dev;
+	struct elf_file ef;
+	struct wcet w;
+	double hz = 0;
+	int verbose = 0, status = 0, c, *funcs = NULL;
+	char *end;
+
+	while ((c = getopt_long(argc, argv, "b:l:c:D:d:F:j:vh", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'b':
+		case 'l':
+		case 'c':
+		case 'D': {
+			const char **list = c == 'b' ? bounds : c == 'l' ? loops : c == 'c' ? configs : defines;
+			unsigned *n = c == 'b' ? &nbounds : c == 'l' ? &nloops : c == 'c' ? &nconfigs : &ndefines;
+
+			if (*n == MAX_FILES) {
+				fprintf(stderr, "wcet: too many -%c options\n", c);
+				return 2;
+			}
+			list[(*n)++] = optarg;
+			break;
+		}
+		case 'd':
+			device = optarg;
+			break;
+		case 'F':
+			hz = strtod(optarg, &end);
+			if (*end || end == optarg || hz <= 0) {
+				fprintf(stderr, "wcet: bad frequency '%s'\n", optarg);
+				return 2;
+			}
+			break;
+		case 'j':
+			json = optarg;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		case 'h':
+			usage(stdout);
+			return 0;
+		default:
+			usage(stderr);
+			return 2;
+		}
+	}
+	if (optind >= argc) {
+		usage(stderr);
+		return 2;
+	}
+
+	if (elf_load(argv[optind], &ef))
+		return 2;
+	dev = device ? xmega_find_device(device) : xmega_detect_device(&ef);
+	if (!dev) {
+		if (device)
+			fprintf(stderr, "wcet: unknown device '%s'\n", device);
+		else
+			fprintf(stderr, "wcet: %s: no device info, use -d\n", argv[optind]);
+		elf_free(&ef);
+		return 2;
+	}
+	if (wcet_init(&w, &ef, dev)) {
+		wcet_free(&w);
+		elf_free(&ef);
+		return 2;
+	}
+	for (i = 0; i < nconfigs; i++)
+		if (const_read_header(&w.consts, configs[i], PRIO_HEADER))
+			goto error;
+	for (i = 0; i < nbounds; i++)
+		if (wcet_read_bounds(&w, bounds[i], PRIO_BOUNDS))
+			goto error;
+	for (i = 0; i < ndefines; i++)
+		if (const_define_arg(&w.consts, defines[i], PRIO_OPTION))
+			goto error;
+	for (i = 0; i < nloops; i++) {
+		const char *eq = strchr(loops[i], '=');
+		char loop[256];
+
+		if (!eq || (size_t)(eq - loops[i]) >= sizeof(loop)) {
+			fprintf(stderr, "wcet: expected LOOP=EXPR, not '%s'\n", loops[i]);
+			goto error;
+		}
+		memcpy(loop, loops[i], (size_t)(eq - loops[i]));
+		loop[eq - loops[i]] = '\0';
+		if (wcet_add_bound(&w, loop, eq + 1, "-l"))
+			goto error;
+	}
+
+	/* The functions to report, by name or address. */
+	if (!(funcs = malloc((optind + 1 < argc ? (unsigned)(argc - optind - 1) : w.nfuncs + 1) * sizeof(*funcs)))) {
+		fprintf(stderr, "wcet: out of memory\n");
+		goto error;
+	}
+	if (optind + 1 < argc) {
+		for (i = (unsigned)optind + 1; i < (unsigned)argc; i++) {
+			int f = wcet_find_func(&w, argv[i]);
+			unsigned long a;
+
+			if (f < 0) {
+				a = strtoul(argv[i], &end, 0);
+				if (*end || end == argv[i] || (a & 1) || a / 2 >= w.flash_words) {
+					fprintf(stderr, "wcet: '%s' is not a function or Flash address\n", argv[i]);
+					goto error;
+				}
+				if ((f = wcet_func_at(&w, (uint32_t)(a / 2))) < 0)
+					goto error;
+			}
+			funcs[nfuncs++] = f;
+		}
+	} else {
+		for (i = 0; i < w.nfuncs; i++)
+			funcs[nfuncs++] = (int)i;
+	}
+
+	for (i = 0; i < nfuncs; i++)
+		if (!w.funcs[funcs[i]].state && wcet_analyze(&w, funcs[i]))
+			goto error;
+
+	printf("%-32s %7s %12s", "function", "address", "cycles");
+	if (hz > 0)
+		printf(" %12s", "us");
+	printf("  status\n");
+	for (i = 0; i < nfuncs; i++) {
+		print_func(&w, funcs[i], hz, verbose);
+		if (w.funcs[funcs[i]].status != WCET_OK)
+			status = 1;
+	}
+	for (i = 0; i < w.nbounds; i++) {
+		int f = wcet_find_func(&w, w.bounds[i].func);
+
+		if (f < 0)
+			fprintf(stderr, "wcet: %s: no function %s\n", w.bounds[i].origin, w.bounds[i].func);
+		else if (w.funcs[f].state == 2 && !w.bounds[i].used) {
+			if (w.bounds[i].offset >= 0)
+				fprintf(stderr, "wcet: %s: no loop at %s+0x%lX\n", w.bounds[i].origin, w.bounds[i].func,
+						w.bounds[i].offset);
+			else
+				fprintf(stderr, "wcet: %s: %s has %u loops, give their offsets\n", w.bounds[i].origin,
+						w.bounds[i].func, w.funcs[f].nloops);
+		}
+	}
+	if (json && write_json(json, argv[optind], &w, funcs, nfuncs))
+		status = 2;
+
+	free(funcs);
+	wcet_free(&w);
+	elf_free(&ef);
+	return status;
+
+error:
+	free(funcs);
+	wcet_free(&w);
+	elf_free(&ef);
+	return 2;
+}